@@ -17,16 +17,23 @@ FOUNDATION_EXPORT const unsigned char PaleoNetCDFVersionString[];
 // In this header, you should import all the public headers of your framework using statements like #import <PaleoNetCDF/PublicHeader.h>
 
 #import "NCDFAttribute.h
+#import "NCDFBlockCache.h"
 #import "NCDFDataTypeFormatter.h"
 #import "NCDFDimension.h"
 #import "NCDFError.h"
 #import "NCDFErrorHandle.h"
+#import "NCDFFileLock.h"
 #import "NCDFHandle.h"
+#import "NCDFHyperslab.h"
+#import "NCDFMappedFile.h"
 #import "NCDFNameFormatter.h"
 #import "NCDFProtocols.h"
+#import "NCDFReadAhead.h"
+#import "NCDFReadToken.h"
 #import "NCDFSeriesDimension.h"
 #import "NCDFSeriesHandle.h"
 #import "NCDFSeriesVariable.h"
 #import "NCDFSlab.h"
+#import "NCDFUnpacking.h"
 #import "NCDFVariable.h"
 #import "NCDFVariableByteSizeFormatter.h"
@@ -70,6 +70,7 @@
     NSMutableArray *theValues;
     NCDFHandle *theHandle;
     NCDFErrorHandle *theErrorHandle;
+    BOOL _valuesLoaded;
 }
 
 /*!
@@ -108,7 +109,7 @@
 /*!
     @method loadValues
     @abstract Loads the values stored by the attribute.
-    @discussion This method accesses attribute information from an existing netcdf file.  Called during initialization.
+    @discussion This method accesses attribute information from an existing netcdf file.  Attributes read from a file load their values the first time they are asked for, so this method rarely needs to be called directly.
 */
 -(void)loadValues;
 
@@ -142,6 +143,7 @@
     @method renameAttribute:
     @param newName a NSString object
     @abstract Changes the name of an attribute.  Returns YES if successful.  Generates an NCDFError if not.
+    @discussion Variable attributes cannot be renamed while the calling thread has an edit session open on the handle.
 */
 -(BOOL)renameAttribute:(NSString *)newName;
 
@@ -11,6 +11,27 @@
 #import "NCDFErrorHandle.h"
 #import "NCDFVariable.h"
 
+@interface NCDFAttribute (PrivateMethods)
+/*!
+ @method loadValuesIfNeeded
+ @abstract Loads the values from the file unless they are already loaded.
+ */
+-(void)loadValuesIfNeeded;
+@end
+
+@implementation NCDFAttribute (PrivateMethods)
+
+-(void)loadValuesIfNeeded
+{
+    @synchronized(self)
+    {
+        if(!_valuesLoaded && theHandle)
+            [self loadValues];
+    }
+}
+
+@end
+
 @implementation NCDFAttribute
 
 -(id)initWithPath:(NSString *)thePath name:(NSString *)theName variableID:(int)theID length:(size_t)dataLength type:(nc_type)theType handle:(NCDFHandle *)handle
@@ -26,7 +47,8 @@
     type = theType;
     length = dataLength;
     theHandle = handle;
-	[self loadValues];
+    //values are read on first use.
+    _valuesLoaded = NO;
     return self;
 }
 
@@ -101,6 +123,7 @@
             {
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFAttribute" methodName:@"loadValues" subMethod:@"Fail to read byte data" errorCode:status];
                 free(theText);
+                [theHandle closeNCID:ncid];
                 return;
             }
             theData = [NSData dataWithBytes:theText length:length];
@@ -119,6 +142,7 @@
             {
                 free(theText);
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFAttribute" methodName:@"loadValues" subMethod:@"Fail to read character data" errorCode:status];
+                [theHandle closeNCID:ncid];
                 return;
             }
 
@@ -139,6 +163,7 @@
             {
                 free(array);
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFAttribute" methodName:@"loadValues" subMethod:@"Fail to read short data" errorCode:status];
+                [theHandle closeNCID:ncid];
                 return;
             }
 
@@ -157,6 +182,7 @@
             {
                 free(array);
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFAttribute" methodName:@"loadValues" subMethod:@"Fail to read integer data" errorCode:status];
+                [theHandle closeNCID:ncid];
                 return;
             }
             for(i=0;i<length;i++)
@@ -174,6 +200,7 @@
             {
                 free(array);
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFAttribute" methodName:@"loadValues" subMethod:@"Fail to read float data" errorCode:status];
+                [theHandle closeNCID:ncid];
                 return;
             }
             for(i=0;i<length;i++)
@@ -191,6 +218,7 @@
             {
                 free(array);
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFAttribute" methodName:@"loadValues" subMethod:@"Fail to read double data" errorCode:status];
+                [theHandle closeNCID:ncid];
                 return;
             }
             for(i=0;i<length;i++)
@@ -203,7 +231,8 @@
             [theErrorHandle addErrorFromSource:fileName className:@"NCDFAttribute" methodName:@"loadValues" subMethod:@"Case NC_Nat not hanlded" errorCode:status];
         }
     }
-    theValues = [tempValues copy];
+    theValues = [tempValues mutableCopy];
+    _valuesLoaded = YES;
     [theHandle closeNCID:ncid];
 }
 
@@ -216,6 +245,7 @@
         theValues = [NSMutableArray arrayWithArray:anArray];
     else
         theValues = [[NSMutableArray alloc] init];
+    _valuesLoaded = YES;
 }
 
 -(NSString *)attributeName
@@ -231,6 +261,7 @@
     NSLog(@"NCDFAttribute: contentDescription");
 #endif
     initial = [[NSMutableString alloc] init];
+    [self loadValuesIfNeeded];
     for(i=0;i<[theValues count];i++)
     {
         [initial appendString:[self stringFromObject:theValues[i]]];
@@ -329,18 +360,17 @@
     if(theErrorHandle == nil)
         theErrorHandle = [theHandle theErrorHandle];
     newName = [self parseNameString:newName];
-	ncid = [theHandle ncidWithOpenMode:NC_WRITE status:&status];
-
-    if(status!=NC_NOERR)
+    //an edit session carries variable attributes into the rewrite from the file, where a rename would bypass the session.
+    if(variableID!=NC_GLOBAL && [theHandle isInEditSession])
     {
-        [theErrorHandle addErrorFromSource:fileName className:@"NCDFAttribute" methodName:@"renameAttribute" subMethod:@"Open netCDF failed" errorCode:status];
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFAttribute" methodName:@"renameAttribute" subMethod:@"Edit session open" errorCode:NC_EINVAL];
         return NO;
     }
-    status = nc_redef(ncid);
+	ncid = [theHandle ncidForDefineWithStatus:&status];
+
     if(status!=NC_NOERR)
     {
-        [theErrorHandle addErrorFromSource:fileName className:@"NCDFAttribute" methodName:@"renameAttribute" subMethod:@"Redefine mode failed" errorCode:status];
-        [theHandle closeNCID:ncid];
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFAttribute" methodName:@"renameAttribute" subMethod:@"Open netCDF in define mode failed" errorCode:status];
         return NO;
     }
     status = nc_rename_att(ncid,variableID,[attName cStringUsingEncoding:NSUTF8StringEncoding],[newName cStringUsingEncoding:NSUTF8StringEncoding]);
@@ -351,13 +381,16 @@
         return NO;
     }
     [theHandle closeNCID:ncid];
-	[theHandle refresh];
+	if(variableID==NC_GLOBAL)
+		[theHandle refreshGlobalAttributes];
+	else
+		[theHandle refreshVariableWithID:variableID];
     return YES;
 }
 
 -(NSArray *)getAttributeValueArray
 {
-
+    [self loadValuesIfNeeded];
     return theValues;
 }
 
@@ -415,6 +448,7 @@
     [theTemp setObject:attName forKey:@"attributeName"];
     [theTemp setObject:[NSNumber numberWithInt:(int)type] forKey:@"nc_type"];
     [theTemp setObject:[NSNumber numberWithInt:(int)length] forKey:@"length"];
+    [self loadValuesIfNeeded];
     [theTemp setObject:[NSArray arrayWithArray:theValues] forKey:@"values"];
     thePropertyList = [NSDictionary dictionaryWithDictionary:theTemp];
     return thePropertyList;
@@ -427,8 +461,17 @@
     variableID = [anAtt variableID];
     type = [anAtt attributeNC_TYPE];
     length = [anAtt attributeLength];
-    //need to load values
-    [self setValueArray:[anAtt getAttributeValueArray]];
+    //only take values that have been loaded already; otherwise reload on demand.
+    if(anAtt->_valuesLoaded)
+        [self setValueArray:[anAtt getAttributeValueArray]];
+    else
+    {
+        @synchronized(self)
+        {
+            theValues = nil;
+            _valuesLoaded = NO;
+        }
+    }
 
 }
 
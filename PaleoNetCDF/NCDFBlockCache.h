@@ -0,0 +1,166 @@
+//
+//  NCDFBlockCache.h
+//  netcdf
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+/*!
+ @header
+ @class NCDFBlockCache
+ @abstract NCDFBlockCache keeps recently read blocks of variable data for every handle in the process.
+ @discussion Each variable is divided into aligned blocks planned with NCDFPlanTile, so a block is as contiguous in the file as the block size allows.  Reads made through NCDFVariable's getValueArrayAtLocation:edgeLengths:, and so through NCDFSeriesVariable, are assembled from cached blocks and only the missing blocks are read from the file.  Blocks are keyed by the file, its write generation, the variable and the block index, so handles on the same file share blocks and a write through any handle in the process makes the file's blocks unreachable; the handle also drops them at once.  The cache remembers the newest generation it has seen for each file: the first read at a newer generation drops the file's older blocks, and a block read at an older generation is not stored.  Writes by other processes do not move the generation, so handles with shared access check the file's modification date and size at most once every NCDFBlockCacheFileCheckInterval seconds (see validateBlocksForPath:modificationDate:size:).  The least recently used blocks are evicted to stay within the byte budget.  The cache starts off, with a budget of 0, because a read of a single value fetches its whole block; set a budget such as NCDFBlockCacheSuggestedByteBudget to turn it on for workloads that read overlapping or neighbouring regions again and again.
+ */
+
+#import <Foundation/Foundation.h>
+
+/*!
+ @defined NCDFBlockCacheStatisticHits
+ @discussion Statistics key.  NSNumber; blocks found in the cache.
+ */
+#define NCDFBlockCacheStatisticHits @"hits"
+/*!
+ @defined NCDFBlockCacheStatisticMisses
+ @discussion Statistics key.  NSNumber; blocks that had to be read from the file.
+ */
+#define NCDFBlockCacheStatisticMisses @"misses"
+/*!
+ @defined NCDFBlockCacheStatisticHitRate
+ @discussion Statistics key.  NSNumber; hits divided by hits and misses, 0 before any read.
+ */
+#define NCDFBlockCacheStatisticHitRate @"hitRate"
+/*!
+ @defined NCDFBlockCacheStatisticEvictions
+ @discussion Statistics key.  NSNumber; blocks evicted to stay within the budget.
+ */
+#define NCDFBlockCacheStatisticEvictions @"evictions"
+/*!
+ @defined NCDFBlockCacheStatisticBlocks
+ @discussion Statistics key.  NSNumber; blocks currently cached.
+ */
+#define NCDFBlockCacheStatisticBlocks @"blocks"
+/*!
+ @defined NCDFBlockCacheStatisticBytes
+ @discussion Statistics key.  NSNumber; bytes currently cached.
+ */
+#define NCDFBlockCacheStatisticBytes @"bytes"
+/*!
+ @defined NCDFBlockCacheStatisticByteBudget
+ @discussion Statistics key.  NSNumber; the byte budget.
+ */
+#define NCDFBlockCacheStatisticByteBudget @"byteBudget"
+
+/*!
+ @defined NCDFBlockCacheDefaultBlockSize
+ @discussion Target size in bytes of one block unless another size is set.
+ */
+#define NCDFBlockCacheDefaultBlockSize (256*1024)
+/*!
+ @defined NCDFBlockCacheSuggestedByteBudget
+ @discussion A byte budget to turn the shared cache on with.  The cache is off until a budget is set.
+ */
+#define NCDFBlockCacheSuggestedByteBudget (64*1024*1024)
+/*!
+ @defined NCDFBlockCacheFileCheckInterval
+ @discussion Seconds between checks of a shared access file's modification date and size.  Writes by other processes within the interval may be missed until the next check.
+ */
+#define NCDFBlockCacheFileCheckInterval 1.0
+
+@class NCDFBlockCacheEntry;
+
+@interface NCDFBlockCache : NSObject {
+    NSLock *_lock;
+    NSMutableDictionary *_entries;
+    NSMutableDictionary *_entriesByPath;
+    NSMutableDictionary *_generations;
+    NSMutableDictionary *_signatures;
+    NCDFBlockCacheEntry *_mostRecent;
+    NCDFBlockCacheEntry *_leastRecent;
+    size_t _byteBudget;
+    size_t _blockSize;
+    size_t _bytes;
+    uint64_t _hits;
+    uint64_t _misses;
+    uint64_t _evictions;
+}
+
+/*!
+ @method sharedCache
+ @abstract Returns the process-wide cache.
+ */
++(NCDFBlockCache *)sharedCache;
+
+/*!
+ @method setByteBudget:
+ @abstract Sets the most bytes the cache holds.  0, the default, turns the cache off and empties it.
+ */
+-(void)setByteBudget:(size_t)bytes;
+/*!
+ @method byteBudget
+ @abstract Returns the most bytes the cache holds.
+ */
+-(size_t)byteBudget;
+/*!
+ @method setBlockSize:
+ @abstract Sets the target size in bytes of one block.  Changing it empties the cache.
+ */
+-(void)setBlockSize:(size_t)bytes;
+/*!
+ @method blockSize
+ @abstract Returns the target size in bytes of one block.
+ */
+-(size_t)blockSize;
+
+/*!
+ @method dataForPath:generation:variableID:ndims:shape:recordCount:elementSize:start:edges:reader:
+ @abstract Assembles a region of a variable from cached blocks, reading the missing blocks.
+ @param path identifies the file.  Use the path of the handle's file lock so that every handle on the file agrees.
+ @param generation the file lock's write generation at the time of the read.
+ @param varID netcdf variable ID.
+ @param ndims number of dimensions of the variable.
+ @param shape length of the variable along each dimension.  Pass SIZE_MAX for the unlimited dimension so that blocks stay aligned as records are added; blocks are trimmed at the current record count given in recordCount.
+ @param recordCount current length of the unlimited dimension, ignored if no dimension is SIZE_MAX.
+ @param elementSize size in bytes of one value as returned by reader.
+ @param start corner of the region.
+ @param edges lengths of the region.
+ @param reader reads one block in native byte order, or returns nil.
+ @result The region, or nil if the cache is off, the region is too large to be worth caching, lies outside the variable, or a block could not be read.  The caller then reads the region itself.
+ @discussion Regions larger than a quarter of the budget are not cached, since they would evict the blocks of every other variable.
+ */
+-(NSData *)dataForPath:(NSString *)path generation:(uint64_t)generation variableID:(int)varID ndims:(int)ndims shape:(const size_t *)shape recordCount:(size_t)recordCount elementSize:(size_t)elementSize start:(const size_t *)start edges:(const size_t *)edges reader:(NSData *(^)(const size_t *start,const size_t *edges))reader;
+
+/*!
+ @method validateBlocksForPath:modificationDate:size:
+ @abstract Drops the blocks of a file if the file has changed since the last call.
+ @param path identifies the file, as passed to dataForPath:generation:variableID:ndims:shape:recordCount:elementSize:start:edges:reader:.
+ @param modificationDate the file's current modification date.
+ @param size the file's current size in bytes.
+ @discussion For files that other processes may write.  A write that changes neither the modification date nor the size, which can happen within the file system's timestamp resolution, is not detected.
+ */
+-(void)validateBlocksForPath:(NSString *)path modificationDate:(NSDate *)modificationDate size:(unsigned long long)size;
+
+/*!
+ @method removeBlocksForPath:
+ @abstract Drops every block of a file.  NCDFHandle calls this after each write.
+ */
+-(void)removeBlocksForPath:(NSString *)path;
+
+/*!
+ @method removeAllBlocks
+ @abstract Empties the cache.  The counters are kept.
+ */
+-(void)removeAllBlocks;
+
+/*!
+ @method statistics
+ @abstract Returns the cache statistics keyed by the NCDFBlockCacheStatistic keys.
+ */
+-(NSDictionary *)statistics;
+
+/*!
+ @method resetStatistics
+ @abstract Sets the hit, miss and eviction counters to 0.
+ */
+-(void)resetStatistics;
+@end
@@ -0,0 +1,418 @@
+//
+//  NCDFBlockCache.m
+//  netcdf
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import "NCDFBlockCache.h"
+#import "NCDFHyperslab.h"
+
+/*One cached block.  Entries are owned by the cache's dictionary; the links of the recency list do not retain.*/
+@interface NCDFBlockCacheEntry : NSObject {
+@public
+    NSString *key;
+    NSString *path;
+    NSData *data;
+    __unsafe_unretained NCDFBlockCacheEntry *moreRecent;
+    __unsafe_unretained NCDFBlockCacheEntry *lessRecent;
+}
+@end
+
+@implementation NCDFBlockCacheEntry
+@end
+
+@interface NCDFBlockCache (PrivateMethods)
+/*!
+ @method unlinkEntry:
+ @abstract Takes an entry out of the recency list.  Called with the lock held.
+ */
+-(void)unlinkEntry:(NCDFBlockCacheEntry *)entry;
+/*!
+ @method linkEntryAsMostRecent:
+ @abstract Puts an entry at the head of the recency list.  Called with the lock held.
+ */
+-(void)linkEntryAsMostRecent:(NCDFBlockCacheEntry *)entry;
+/*!
+ @method addEntry:
+ @abstract Adds an entry to the cache as the most recently used.  Called with the lock held.
+ */
+-(void)addEntry:(NCDFBlockCacheEntry *)entry;
+/*!
+ @method removeEntry:
+ @abstract Drops an entry from the cache.  Called with the lock held.
+ */
+-(void)removeEntry:(NCDFBlockCacheEntry *)entry;
+/*!
+ @method evictToFitBytes:
+ @abstract Evicts the least recently used blocks until bytes more fit in the budget.  Called with the lock held.
+ */
+-(void)evictToFitBytes:(size_t)bytes;
+/*!
+ @method removeEntriesForPath:
+ @abstract Drops every block of a file.  Called with the lock held.
+ */
+-(void)removeEntriesForPath:(NSString *)path;
+@end
+
+@implementation NCDFBlockCache (PrivateMethods)
+
+-(void)unlinkEntry:(NCDFBlockCacheEntry *)entry
+{
+    if(entry->moreRecent)
+        entry->moreRecent->lessRecent = entry->lessRecent;
+    else
+        _mostRecent = entry->lessRecent;
+    if(entry->lessRecent)
+        entry->lessRecent->moreRecent = entry->moreRecent;
+    else
+        _leastRecent = entry->moreRecent;
+    entry->moreRecent = nil;
+    entry->lessRecent = nil;
+}
+
+-(void)linkEntryAsMostRecent:(NCDFBlockCacheEntry *)entry
+{
+    entry->lessRecent = _mostRecent;
+    entry->moreRecent = nil;
+    if(_mostRecent)
+        _mostRecent->moreRecent = entry;
+    _mostRecent = entry;
+    if(!_leastRecent)
+        _leastRecent = entry;
+}
+
+-(void)addEntry:(NCDFBlockCacheEntry *)entry
+{
+    NSMutableSet *pathEntries;
+    _entries[entry->key] = entry;
+    pathEntries = _entriesByPath[entry->path];
+    if(!pathEntries)
+    {
+        pathEntries = [[NSMutableSet alloc] init];
+        _entriesByPath[entry->path] = pathEntries;
+    }
+    [pathEntries addObject:entry];
+    [self linkEntryAsMostRecent:entry];
+    _bytes += [entry->data length];
+}
+
+-(void)removeEntry:(NCDFBlockCacheEntry *)entry
+{
+    NSMutableSet *pathEntries;
+    [self unlinkEntry:entry];
+    _bytes -= [entry->data length];
+    pathEntries = _entriesByPath[entry->path];
+    [pathEntries removeObject:entry];
+    if([pathEntries count]==0)
+        [_entriesByPath removeObjectForKey:entry->path];
+    [_entries removeObjectForKey:entry->key];
+}
+
+-(void)evictToFitBytes:(size_t)bytes
+{
+    while(_leastRecent && _bytes+bytes>_byteBudget)
+    {
+        [self removeEntry:_leastRecent];
+        _evictions++;
+    }
+}
+
+-(void)removeEntriesForPath:(NSString *)path
+{
+    NSArray *entries;
+    int32_t i;
+    //the per-path index keeps a write from scanning the blocks of every other file.
+    entries = [_entriesByPath[path] allObjects];
+    for(i=0;i<[entries count];i++)
+        [self removeEntry:entries[i]];
+}
+
+@end
+
+@implementation NCDFBlockCache
+
++(NCDFBlockCache *)sharedCache
+{
+    static NCDFBlockCache *sharedCache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken,^{
+        sharedCache = [[NCDFBlockCache alloc] init];
+    });
+    return sharedCache;
+}
+
+-(id)init
+{
+    self = [super init];
+    if(self)
+    {
+        _lock = [[NSLock alloc] init];
+        _entries = [[NSMutableDictionary alloc] init];
+        _entriesByPath = [[NSMutableDictionary alloc] init];
+        _generations = [[NSMutableDictionary alloc] init];
+        _signatures = [[NSMutableDictionary alloc] init];
+        _mostRecent = nil;
+        _leastRecent = nil;
+        _byteBudget = 0;
+        _blockSize = NCDFBlockCacheDefaultBlockSize;
+        _bytes = 0;
+        _hits = 0;
+        _misses = 0;
+        _evictions = 0;
+    }
+    return self;
+}
+
+-(void)setByteBudget:(size_t)bytes
+{
+    [_lock lock];
+    _byteBudget = bytes;
+    [self evictToFitBytes:0];
+    [_lock unlock];
+}
+
+-(size_t)byteBudget
+{
+    size_t budget;
+    [_lock lock];
+    budget = _byteBudget;
+    [_lock unlock];
+    return budget;
+}
+
+-(void)setBlockSize:(size_t)bytes
+{
+    [_lock lock];
+    if(bytes<1)
+        bytes = 1;
+    if(bytes!=_blockSize)
+    {
+        //blocks of the old size no longer line up with the new block indices.
+        while(_leastRecent)
+            [self removeEntry:_leastRecent];
+        _blockSize = bytes;
+    }
+    [_lock unlock];
+}
+
+-(size_t)blockSize
+{
+    size_t blockSize;
+    [_lock lock];
+    blockSize = _blockSize;
+    [_lock unlock];
+    return blockSize;
+}
+
+-(NSData *)dataForPath:(NSString *)path generation:(uint64_t)generation variableID:(int)varID ndims:(int)ndims shape:(const size_t *)shape recordCount:(size_t)recordCount elementSize:(size_t)elementSize start:(const size_t *)start edges:(const size_t *)edges reader:(NSData *(^)(const size_t *start,const size_t *edges))reader
+{
+    size_t *tile,*lengths,*firstBlock,*lastBlock,*block,*blockStart,*blockCount,*index;
+    size_t regionBytes,blockBytes,blockSize,budget,rowBytes,srcOffset,dstOffset;
+    NSMutableData *theData;
+    NSMutableString *key;
+    NSData *blockData;
+    NCDFBlockCacheEntry *entry;
+    NSNumber *newestGeneration;
+    BOOL isValid,found;
+    int32_t i;
+
+    if(ndims<1 || elementSize==0)
+        return nil;
+    [_lock lock];
+    budget = _byteBudget;
+    blockSize = _blockSize;
+    newestGeneration = _generations[path];
+    if(!newestGeneration || [newestGeneration unsignedLongLongValue]<generation)
+    {
+        //the file has been written since its blocks were cached, and they can never be hit again.
+        if(newestGeneration)
+            [self removeEntriesForPath:path];
+        _generations[path] = @(generation);
+    }
+    else if([newestGeneration unsignedLongLongValue]>generation)
+    {
+        //the caller's generation was taken before a write this cache has already seen.
+        [_lock unlock];
+        return nil;
+    }
+    [_lock unlock];
+    regionBytes = elementSize;
+    for(i=0;i<ndims;i++)
+        regionBytes *= edges[i];
+    if(budget==0 || regionBytes==0 || regionBytes>budget/4)
+        return nil;
+
+    tile = (size_t *)malloc(sizeof(size_t)*ndims*8);
+    lengths = tile+ndims;
+    firstBlock = lengths+ndims;
+    lastBlock = firstBlock+ndims;
+    block = lastBlock+ndims;
+    blockStart = block+ndims;
+    blockCount = blockStart+ndims;
+    index = blockCount+ndims;
+    isValid = (NCDFPlanTile(ndims,shape,elementSize,blockSize,tile)>0);
+    for(i=0;i<ndims && isValid;i++)
+    {
+        lengths[i] = (shape[i]==SIZE_MAX) ? recordCount : shape[i];
+        if(start[i]+edges[i]>lengths[i])
+            isValid = NO;
+        else
+        {
+            firstBlock[i] = start[i]/tile[i];
+            lastBlock[i] = (start[i]+edges[i]-1)/tile[i];
+            block[i] = firstBlock[i];
+        }
+    }
+    if(!isValid)
+    {
+        free(tile);
+        return nil;
+    }
+
+    theData = [NSMutableData dataWithLength:regionBytes];
+    while(isValid)
+    {
+        blockBytes = elementSize;
+        for(i=0;i<ndims;i++)
+        {
+            blockStart[i] = block[i]*tile[i];
+            blockCount[i] = MIN(tile[i],lengths[i]-blockStart[i]);
+            blockBytes *= blockCount[i];
+        }
+        key = [NSMutableString stringWithFormat:@"%@ %llu %d",path,generation,varID];
+        for(i=0;i<ndims;i++)
+            [key appendFormat:@" %zu",block[i]];
+        [_lock lock];
+        entry = _entries[key];
+        //a partial block at the end of the records is stale once more records exist.
+        found = (entry && [entry->data length]==blockBytes);
+        if(found)
+        {
+            _hits++;
+            blockData = entry->data;
+            [self unlinkEntry:entry];
+            [self linkEntryAsMostRecent:entry];
+        }
+        else
+        {
+            _misses++;
+            if(entry)
+                [self removeEntry:entry];
+            blockData = nil;
+        }
+        [_lock unlock];
+        if(!blockData)
+        {
+            blockData = reader(blockStart,blockCount);
+            if([blockData length]!=blockBytes)
+            {
+                free(tile);
+                return nil;
+            }
+            [_lock lock];
+            //a write may have moved the generation on while the block was read; a block stored under the old generation would never be hit or dropped.
+            if(!_entries[key] && [blockData length]<=_byteBudget && [_generations[path] unsignedLongLongValue]==generation)
+            {
+                [self evictToFitBytes:[blockData length]];
+                entry = [[NCDFBlockCacheEntry alloc] init];
+                entry->key = [key copy];
+                entry->path = path;
+                entry->data = blockData;
+                [self addEntry:entry];
+            }
+            [_lock unlock];
+        }
+
+        //copy the part of the block inside the region one row of the fastest dimension at a time.
+        for(i=0;i<ndims;i++)
+            index[i] = MAX(start[i],blockStart[i]);
+        rowBytes = (MIN(start[ndims-1]+edges[ndims-1],blockStart[ndims-1]+blockCount[ndims-1])-index[ndims-1])*elementSize;
+        while(YES)
+        {
+            srcOffset = 0;
+            dstOffset = 0;
+            for(i=0;i<ndims;i++)
+            {
+                srcOffset = srcOffset*blockCount[i]+(index[i]-blockStart[i]);
+                dstOffset = dstOffset*edges[i]+(index[i]-start[i]);
+            }
+            memcpy((uint8_t *)[theData mutableBytes]+dstOffset*elementSize,(const uint8_t *)[blockData bytes]+srcOffset*elementSize,rowBytes);
+            for(i=ndims-2;i>=0;i--)
+            {
+                index[i]++;
+                if(index[i]<MIN(start[i]+edges[i],blockStart[i]+blockCount[i]))
+                    break;
+                index[i] = MAX(start[i],blockStart[i]);
+            }
+            if(i<0)
+                break;
+        }
+
+        for(i=ndims-1;i>=0;i--)
+        {
+            block[i]++;
+            if(block[i]<=lastBlock[i])
+                break;
+            block[i] = firstBlock[i];
+        }
+        if(i<0)
+            isValid = NO;
+    }
+    free(tile);
+    return theData;
+}
+
+-(void)validateBlocksForPath:(NSString *)path modificationDate:(NSDate *)modificationDate size:(unsigned long long)size
+{
+    NSArray *signature = @[modificationDate ? modificationDate : [NSDate distantPast],@(size)];
+    [_lock lock];
+    if(![_signatures[path] isEqualToArray:signature])
+    {
+        [self removeEntriesForPath:path];
+        _signatures[path] = signature;
+    }
+    [_lock unlock];
+}
+
+-(void)removeBlocksForPath:(NSString *)path
+{
+    [_lock lock];
+    [self removeEntriesForPath:path];
+    [_lock unlock];
+}
+
+-(void)removeAllBlocks
+{
+    [_lock lock];
+    while(_leastRecent)
+        [self removeEntry:_leastRecent];
+    [_lock unlock];
+}
+
+-(NSDictionary *)statistics
+{
+    NSDictionary *statistics;
+    [_lock lock];
+    statistics = @{NCDFBlockCacheStatisticHits:@(_hits),
+                   NCDFBlockCacheStatisticMisses:@(_misses),
+                   NCDFBlockCacheStatisticHitRate:@(_hits+_misses>0 ? (double)_hits/(double)(_hits+_misses) : 0.0),
+                   NCDFBlockCacheStatisticEvictions:@(_evictions),
+                   NCDFBlockCacheStatisticBlocks:@([_entries count]),
+                   NCDFBlockCacheStatisticBytes:@(_bytes),
+                   NCDFBlockCacheStatisticByteBudget:@(_byteBudget)};
+    [_lock unlock];
+    return statistics;
+}
+
+-(void)resetStatistics
+{
+    [_lock lock];
+    _hits = 0;
+    _misses = 0;
+    _evictions = 0;
+    [_lock unlock];
+}
+
+@end
@@ -77,17 +77,11 @@
     if(theErrorHandle==nil)
         theErrorHandle = [theHandle theErrorHandle];
     newName = [self parseNameString:newName];
-    ncid = [theHandle ncidWithOpenMode:NC_WRITE status:&status];
+    ncid = [theHandle ncidForDefineWithStatus:&status];
 
     if(status!=NC_NOERR)
     {
-        [theErrorHandle addErrorFromSource:fileName className:@"NCDFDimension" methodName:@"renameDimension" subMethod:@"Opening netCDF file" errorCode:status];
-        return NO;
-    }
-    status = nc_redef(ncid);
-    if(status!=NC_NOERR)
-    {
-        [theErrorHandle addErrorFromSource:fileName className:@"NCDFDimension" methodName:@"renameDimension" subMethod:@"redefine mode" errorCode:status];
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFDimension" methodName:@"renameDimension" subMethod:@"Opening netCDF file in define mode" errorCode:status];
         return NO;
     }
     theCName = (char *)malloc(sizeof(char)*[newName length]+1);
@@ -97,11 +91,12 @@
     if(status!=NC_NOERR)
     {
         [theErrorHandle addErrorFromSource:fileName className:@"NCDFDimension" methodName:@"renameDimension" subMethod:@"Renaming dimension" errorCode:status];
+        [theHandle closeNCID:ncid];
         return NO;
     }
     dimName = [newName copy];
     [theHandle closeNCID:ncid];
-	[theHandle refresh];
+	[theHandle refreshDimensions];
     return YES;
 }
 
@@ -162,6 +157,7 @@
     if(status!=NC_NOERR)
     {
         [theErrorHandle addErrorFromSource:fileName className:@"NCDFDimension" methodName:@"isUnlimited" subMethod:@"Is dimension unlimited?" errorCode:status];
+        [theHandle closeNCID:ncid];
         return NO;
     }
     [theHandle closeNCID:ncid];
@@ -181,7 +177,7 @@
     if([self isUnlimited])
         [theTemp setObject:[NSNumber numberWithInt:0] forKey:@"length"];
     else
-        [theTemp setObject:[NSNumber numberWithInt:(int)length] forKey:@"length"];
+        [theTemp setObject:[NSNumber numberWithUnsignedLongLong:length] forKey:@"length"];
     thePropertyList = [NSDictionary dictionaryWithDictionary:theTemp];
     return thePropertyList;
 }
@@ -0,0 +1,79 @@
+//
+//  NCDFFileLock.h
+//  netcdf
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+/*!
+ @header
+ @class NCDFFileLock
+ @abstract NCDFFileLock is a reader/writer lock shared by every NCDFHandle that works on the same file.
+ @discussion There is one NCDFFileLock per file path in a process.  NCDFHandle takes a shared lock for every read-only ncid it hands out and an exclusive lock for every writable ncid, and releases the lock when the ncid is returned with closeNCID:.  Readers of different files, and concurrent readers of the same file, therefore never wait on each other.  The lock is reentrant for the thread that holds it: a thread holding the write lock may take further read or write locks, a thread holding a read lock may take further read locks, and a thread holding read locks may upgrade to a write lock.  An upgrade releases the thread's read locks while it waits and restores them once the write lock is taken, so another writer may run in between and anything read before the upgrade must be read again.  Releasing a lock the calling thread does not hold is a programming error and raises an assertion.
+ */
+
+#import <Foundation/Foundation.h>
+#import <pthread.h>
+
+@interface NCDFFileLock : NSObject {
+    NSString *_path;
+    pthread_mutex_t _mutex;
+    pthread_cond_t _condition;
+    int32_t _readerCount;
+    int32_t _waitingWriterCount;
+    BOOL _hasWriter;
+    pthread_t _writerThread;
+    int32_t _writerDepth;
+    NSMutableDictionary *_threadReadDepths;
+    uint64_t _writeGeneration;
+}
+
+/*!
+ @method fileLockForPath:
+ @abstract Returns the lock shared by all users of the file at path.
+ @param path path to a netcdf file.  Symbolic links are resolved so that different spellings of the same path share one lock.
+ @discussion The lock exists for as long as somebody holds a reference to it.
+ */
++(NCDFFileLock *)fileLockForPath:(NSString *)path;
+
+/*!
+ @method path
+ @abstract The resolved path the lock protects.
+ */
+-(NSString *)path;
+
+/*!
+ @method lockForReading
+ @abstract Takes a shared lock.  Blocks while another thread holds or waits for the write lock.
+ */
+-(void)lockForReading;
+
+/*!
+ @method unlockForReading
+ @abstract Releases a shared lock taken with lockForReading.
+ */
+-(void)unlockForReading;
+
+/*!
+ @method lockForWriting
+ @abstract Takes the exclusive lock.  Blocks until every other thread has released its locks.
+ @discussion Read locks held by the calling thread are released while it waits and restored before it returns.
+ */
+-(void)lockForWriting;
+
+/*!
+ @method unlockForWriting
+ @abstract Releases the exclusive lock taken with lockForWriting.
+ @result The write generation after the release.
+ @discussion When the outermost write lock is released the write generation is incremented.  The returned value can be recorded by the writer to mark its own cached state as current.
+ */
+-(uint64_t)unlockForWriting;
+
+/*!
+ @method writeGeneration
+ @abstract A counter that changes whenever the file may have been written.
+ @discussion Anything that caches file contents or header information (open ncids, for example) can record the generation and compare it later to find out whether it is still valid.  Generations only grow, even across the locks created for the same path over the life of the process.
+ */
+-(uint64_t)writeGeneration;
+@end
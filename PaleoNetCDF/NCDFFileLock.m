@@ -0,0 +1,211 @@
+//
+//  NCDFFileLock.m
+//  netcdf
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import "NCDFFileLock.h"
+#import <stdatomic.h>
+
+static NSMapTable *fileLockRegistry;
+static NSLock *fileLockRegistryLock;
+/*Write generations are drawn from one process-wide counter, so a lock created for a path after the previous lock was released never repeats a generation of the path.*/
+static _Atomic uint64_t fileLockGenerationCounter;
+
+@interface NCDFFileLock (PrivateMethods)
+/*!
+ @method initWithPath:
+ @abstract Use fileLockForPath: instead.
+ */
+-(id)initWithPath:(NSString *)path;
+/*!
+ @method currentThreadKey
+ @abstract Key for the calling thread in the read depth dictionary.
+ */
+-(NSNumber *)currentThreadKey;
+/*!
+ @method currentThreadReadDepth
+ @abstract Number of read locks held by the calling thread.  The mutex must be held.
+ */
+-(int32_t)currentThreadReadDepth;
+@end
+
+@implementation NCDFFileLock (PrivateMethods)
+
+-(id)initWithPath:(NSString *)path
+{
+    self = [super init];
+    if(self)
+    {
+        _path = [path copy];
+        pthread_mutex_init(&_mutex,NULL);
+        pthread_cond_init(&_condition,NULL);
+        _readerCount = 0;
+        _waitingWriterCount = 0;
+        _hasWriter = NO;
+        _writerDepth = 0;
+        _threadReadDepths = [[NSMutableDictionary alloc] init];
+        _writeGeneration = atomic_fetch_add(&fileLockGenerationCounter,1)+1;
+    }
+    return self;
+}
+
+-(NSNumber *)currentThreadKey
+{
+    return [NSNumber numberWithUnsignedLongLong:(unsigned long long)(uintptr_t)pthread_self()];
+}
+
+-(int32_t)currentThreadReadDepth
+{
+    return [_threadReadDepths[[self currentThreadKey]] intValue];
+}
+
+@end
+
+@implementation NCDFFileLock
+
++(void)initialize
+{
+    if(self == [NCDFFileLock class])
+    {
+        fileLockRegistry = [NSMapTable strongToWeakObjectsMapTable];
+        fileLockRegistryLock = [[NSLock alloc] init];
+    }
+}
+
++(NCDFFileLock *)fileLockForPath:(NSString *)path
+{
+    NCDFFileLock *aLock;
+    NSString *key = [[path stringByStandardizingPath] stringByResolvingSymlinksInPath];
+    if(!key)
+        key = @"";
+    [fileLockRegistryLock lock];
+    aLock = [fileLockRegistry objectForKey:key];
+    if(!aLock)
+    {
+        aLock = [[NCDFFileLock alloc] initWithPath:key];
+        [fileLockRegistry setObject:aLock forKey:key];
+    }
+    [fileLockRegistryLock unlock];
+    return aLock;
+}
+
+-(NSString *)path
+{
+    return _path;
+}
+
+-(void)lockForReading
+{
+    NSNumber *threadKey = [self currentThreadKey];
+    int32_t depth;
+    pthread_mutex_lock(&_mutex);
+    depth = [_threadReadDepths[threadKey] intValue];
+    //a thread that already holds the lock never waits, even for a queued writer.
+    if(depth==0 && !(_hasWriter && pthread_equal(_writerThread,pthread_self())))
+    {
+        while(_hasWriter || _waitingWriterCount>0)
+            pthread_cond_wait(&_condition,&_mutex);
+    }
+    _readerCount++;
+    _threadReadDepths[threadKey] = [NSNumber numberWithInt:depth+1];
+    pthread_mutex_unlock(&_mutex);
+}
+
+-(void)unlockForReading
+{
+    NSNumber *threadKey = [self currentThreadKey];
+    int32_t depth;
+    pthread_mutex_lock(&_mutex);
+    depth = [_threadReadDepths[threadKey] intValue];
+    if(depth>0)
+    {
+        _readerCount--;
+        if(depth==1)
+            [_threadReadDepths removeObjectForKey:threadKey];
+        else
+            _threadReadDepths[threadKey] = [NSNumber numberWithInt:depth-1];
+        if(_readerCount==0 || _waitingWriterCount>0)
+            pthread_cond_broadcast(&_condition);
+    }
+    pthread_mutex_unlock(&_mutex);
+    NSAssert((depth>0), ([NSString stringWithFormat:@"unlockForReading without a read lock held by this thread: %@",_path]));
+}
+
+-(void)lockForWriting
+{
+    NSNumber *threadKey;
+    int32_t depth;
+    pthread_mutex_lock(&_mutex);
+    if(_hasWriter && pthread_equal(_writerThread,pthread_self()))
+    {
+        _writerDepth++;
+        pthread_mutex_unlock(&_mutex);
+        return;
+    }
+    //an upgrading reader gives up its read locks while it waits, so two readers upgrading at once cannot wait on each other.
+    threadKey = [self currentThreadKey];
+    depth = [_threadReadDepths[threadKey] intValue];
+    if(depth>0)
+    {
+        _readerCount -= depth;
+        [_threadReadDepths removeObjectForKey:threadKey];
+        pthread_cond_broadcast(&_condition);
+    }
+    _waitingWriterCount++;
+    while(_hasWriter || _readerCount>0)
+        pthread_cond_wait(&_condition,&_mutex);
+    _waitingWriterCount--;
+    _hasWriter = YES;
+    _writerThread = pthread_self();
+    _writerDepth = 1;
+    if(depth>0)
+    {
+        _readerCount += depth;
+        _threadReadDepths[threadKey] = [NSNumber numberWithInt:depth];
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+-(uint64_t)unlockForWriting
+{
+    uint64_t generation;
+    BOOL isWriter;
+    pthread_mutex_lock(&_mutex);
+    isWriter = (_hasWriter && pthread_equal(_writerThread,pthread_self()));
+    if(isWriter)
+    {
+        _writerDepth--;
+        if(_writerDepth==0)
+        {
+            _hasWriter = NO;
+            _writeGeneration = atomic_fetch_add(&fileLockGenerationCounter,1)+1;
+            pthread_cond_broadcast(&_condition);
+        }
+    }
+    generation = _writeGeneration;
+    pthread_mutex_unlock(&_mutex);
+    NSAssert(isWriter, ([NSString stringWithFormat:@"unlockForWriting without the write lock held by this thread: %@",_path]));
+    return generation;
+}
+
+-(uint64_t)writeGeneration
+{
+    uint64_t generation;
+    pthread_mutex_lock(&_mutex);
+    generation = _writeGeneration;
+    pthread_mutex_unlock(&_mutex);
+    return generation;
+}
+
+-(void)dealloc
+{
+    pthread_cond_destroy(&_condition);
+    pthread_mutex_destroy(&_mutex);
+    _threadReadDepths = nil;
+    _path = nil;
+}
+
+@end
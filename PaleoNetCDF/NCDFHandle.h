@@ -12,13 +12,13 @@
 #import <netcdf.h>
 
 //added 0.2.1d1
-@class NCDFErrorHandle,NCDFError,NCDFDimension,NCDFAttribute,NCDFVariable;
+@class NCDFErrorHandle,NCDFError,NCDFDimension,NCDFAttribute,NCDFVariable,NCDFFileLock,NCDFRewritePlan,NCDFMappedFile;
 
 /*!
 @header
  @class NCDFHandle
  @abstract NCDFHandle is the primary class of working with netcdf files
- @discussion NCDFHandle is the primary interface for a netcdf file.  It will automatically discover the contents for a netcdf file for you.  It also allows you to change the overall file structure by adding or removing attributes, dimensions, and variables.  Only one NCDFHandle should exist per netcdf file.  Although a handle may exist, the actual netcdf file is not open except when the handle is conducting a file operation.  It also manages some temporary work files created during the file editing process for protection of the original file.
+ @discussion NCDFHandle is the primary interface for a netcdf file.  It will automatically discover the contents for a netcdf file for you.  It also allows you to change the overall file structure by adding or removing attributes, dimensions, and variables.  Only one NCDFHandle should exist per netcdf file.  The handle keeps a small pool of open ncids so that repeated file operations do not reopen the file each time; pooled ncids are closed after an idle timeout, when the file changes on disk, or when closeAll is called.  It also manages some temporary work files created during the file editing process for protection of the original file.
  */
 @interface NCDFHandle : NSObject {
     NSMutableArray *theVariables;
@@ -29,6 +29,50 @@
 	NSLock *handleLock;
 	NSNumber *_theCompareValue;
 	int32_t netcdfVersion;
+	NSMutableArray *_ncidPool;
+	NSLock *_ncidPoolLock;
+	NSTimeInterval _ncidIdleTimeout;
+	BOOL _ncidPurgeScheduled;
+	NCDFFileLock *_fileLock;
+	int32_t _defineSessionNCID;
+	int32_t _defineSessionDepth;
+	NSThread *_defineSessionThread;
+	BOOL _defineSessionInDefineMode;
+	BOOL _defineSessionNeedsRefresh;
+	NSMutableArray *_defineSessionPendingData;
+	NSMutableDictionary *_variablesByName;
+	NSMutableDictionary *_dimensionsByName;
+	NSMutableDictionary *_globalAttributesByName;
+	uint64_t _dimensionsIndexedMutations;
+	uint64_t _globalAttributesIndexedMutations;
+	uint64_t _variablesIndexedMutations;
+	int32_t _unlimitedDimensionID;
+	BOOL _dimensionsLoaded;
+	BOOL _globalAttributesLoaded;
+	BOOL _variablesLoaded;
+	NSRecursiveLock *_metadataLock;
+	BOOL _sharedAccess;
+	size_t _rewriteMemoryCeiling;
+	size_t _headerFreeSpace;
+	size_t _variableAlignment;
+	size_t _recordAlignment;
+	NCDFRewritePlan *_editSessionPlan;
+	int32_t _editSessionDepth;
+	NSThread *_editSessionThread;
+	BOOL _usesMappedReads;
+	NCDFMappedFile *_mappedFile;
+	uint64_t _mappedFileGeneration;
+	BOOL _mappedFileUnavailable;
+	BOOL _inMemory;
+	BOOL _memoryReadOnly;
+	BOOL _persistsMemory;
+	NSString *_memoryPersistPath;
+#ifdef NCDF4
+	NSData *_memoryData;
+	int32_t _memoryNCID;
+	BOOL _memorySharedReads;
+	NSMutableDictionary *_memoryCheckouts;
+#endif
 }
 
 //*****************************INITIALIZATION METHODS***********************************
@@ -41,6 +85,15 @@
 */
 -(id)initWithFileAtPath:(NSString *)thePath ;
 
+/*!
+  @method initLazilyWithFileAtPath:
+  @abstract Initializes a new NCDFHandle for an existing file without reading its metadata.
+  @param thePath the path to an existing netcdf file.
+  @result An instance of NCDFHandle or nil if the file could not be opened as a netcdf file.
+  @discussion Only the header counts are read to validate the file.  NCDFDimension, NCDFAttribute and NCDFVariable objects are built separately for dimensions, global attributes and variables the first time each kind is asked for, and attribute values are only read when they are used.  Use this initializer when scanning many files to pick a few.  Lazy handles also start without shared access (see setSharedAccess:), so the netcdf library can buffer reads.
+*/
+-(id)initLazilyWithFileAtPath:(NSString *)thePath;
+
 /*!
   @method initByCreatingFileAtPath
   @abstract Creates a new empty netcdf file and initializes a new NCDFHandle for the new file.
@@ -51,9 +104,48 @@
 -(id)initByCreatingFileAtPath:(NSString *)thePath;
 -(id)initByCreatingFileAtPath:(NSString *)thePath withSettings:(int)settings;
 
+/*!
+  @method initByCreatingFileAtPath:withSettings:headerFreeSpace:
+  @abstract Creates a new netcdf file that reserves free space after its header.
+  @param thePath the path requested for a netcdf file.
+  @param settings the nc_create mode flags.
+  @param bytes the number of bytes to keep free after the header.  See setHeaderFreeSpace:.
+  @result An instance of NCDFHandle or nil if failed.
+*/
+-(id)initByCreatingFileAtPath:(NSString *)thePath withSettings:(int)settings headerFreeSpace:(size_t)bytes;
+
+/*!
+  @method initWithData:
+  @abstract Initializes a read-only NCDFHandle for a netcdf file held in memory.
+  @param data the complete contents of a netcdf file.
+  @result An instance of NCDFHandle or nil if the data is not a netcdf file.
+  @discussion With netCDF-4 (NCDF4) the data is opened in place with nc_open_mem, so nothing is written to or read from disk.  The handle keeps a copy of data (no copy is made for immutable NSData) and a single ncid open for its lifetime, and theFilePath returns a made-up name that only identifies the dataset.  Methods that change the file fail with NC_EPERM.  The bundled netCDF-3 library cannot open memory, so without NCDF4 this method posts ENOTSUP to the error log and returns nil.
+*/
+-(id)initWithData:(NSData *)data;
+
+/*!
+  @method initDisklessWithFileAtPath:persist:
+  @abstract Initializes a NCDFHandle that reads an existing file into memory and works on it there.
+  @param thePath the path to an existing netcdf file.
+  @param persist YES to write the dataset back to thePath when it is closed.
+  @result An instance of NCDFHandle or nil if failed.
+  @discussion The file is read once when the handle is created (NC_DISKLESS).  All later reads, writes and structural edits, including the rewrites done by deleteDimensionWithName: and friends, happen in memory.  Without NCDF4 there is no NC_DISKLESS, so ENOTSUP is posted to the error log and nil is returned.  The dataset is closed, and persisted if requested, by closeInMemoryDataset or when the handle is deallocated.
+*/
+-(id)initDisklessWithFileAtPath:(NSString *)thePath persist:(BOOL)persist;
+
+/*!
+  @method initDisklessByCreatingFileAtPath:withSettings:persist:
+  @abstract Creates a new empty netcdf dataset in memory.
+  @param thePath the name of the dataset, and the path it is written to if persist is YES.
+  @param settings the nc_create mode flags.  NC_DISKLESS is added.  Without NCDF4 no dataset is created and nil is returned, as for initDisklessWithFileAtPath:persist:.
+  @param persist YES to write the dataset to thePath when it is closed.
+  @result An instance of NCDFHandle or nil if failed.
+*/
+-(id)initDisklessByCreatingFileAtPath:(NSString *)thePath withSettings:(int)settings persist:(BOOL)persist;
+
 +(id)handleWithNewFileAtPath:(NSString *)thePath;
 +(id)handleWithNew64BitFileAtPath:(NSString *)thePath;
-#ifdef DNCDF4
+#ifdef NCDF4
 +(id)handleWithNewNetCDF4FileAtPath:(NSString *)thePath;
 +(id)handleWithNewClassicNetCDF4FileAtPath:(NSString *)thePath;
 #endif
@@ -76,16 +168,57 @@
 /*!
   @method refresh
   @abstract Force reset of the NCDFHandle metadata.
-  @discussion This method triggers the reset of all netcdf metadata.  This method should be called when there is reason to believe that the NCDFHandle is no longer in sync with the netcdf file.  Typically this can occur when changing the contents of a netcdf file.  Some methods will automatically call this method.<P>VALIDATION NOTES: Tested extensively and appears to function as expected.
+  @discussion This method triggers the reset of all netcdf metadata.  This method should be called when there is reason to believe that the NCDFHandle is no longer in sync with the netcdf file.  Typically this can occur when changing the contents of a netcdf file.  The handle's own editing methods only refresh what they changed (see refreshDimensions, refreshGlobalAttributes, refreshVariable: and refreshDimensionLengths).  Existing objects are matched to the file by name, so applications holding them stay in sync.<P>VALIDATION NOTES: Tested extensively and appears to function as expected.
 */
 -(void)refresh;
 
+/*!
+  @method refreshDimensions
+  @abstract Resyncs only the dimensions with the file.
+  @discussion Like refresh, the existing NCDFDimension objects are kept and updated.  Inside a define session every refresh method defers to the next lookup of the metadata or to commitDefineSession, whichever comes first.
+*/
+-(void)refreshDimensions;
+/*!
+  @method refreshDimensionLengths
+  @abstract Updates the length of every known dimension.
+  @discussion The cheapest refresh.  Use it after writing variable data, which can only change the length of the unlimited dimension.
+*/
+-(void)refreshDimensionLengths;
+/*!
+  @method refreshGlobalAttributes
+  @abstract Resyncs only the global attributes with the file.
+*/
+-(void)refreshGlobalAttributes;
+/*!
+  @method refreshVariables
+  @abstract Resyncs only the variables with the file.
+*/
+-(void)refreshVariables;
+/*!
+  @method refreshVariable:
+  @abstract Resyncs a single variable, including its name and attribute count, with the file.
+  @param aVar a variable belonging to the receiver.
+*/
+-(void)refreshVariable:(NCDFVariable *)aVar;
+/*!
+  @method refreshVariableWithID:
+  @abstract Resyncs the variable with the netcdf id theID.  A variable new to the handle is added.
+*/
+-(void)refreshVariableWithID:(int)theID;
+
 	/*!
     @method handleLock
     @abstract Returns an NSLock object for the handle.
 	*/
 -(NSLock *)handleLock;
 
+	/*!
+    @method fileLock
+    @abstract Returns the reader/writer lock shared by every handle on the receiver's file.
+    @discussion ncidWithOpenMode:status: takes a shared lock for read-only ncids and an exclusive lock for writable ncids, and closeNCID: releases it.  Use the lock directly only to group several file operations that must not be interleaved with writes from other threads.
+	*/
+-(NCDFFileLock *)fileLock;
+
 //*****************************ACCESSORS***********************************
 
 	/*!
@@ -167,7 +300,16 @@
  @param newSize integer with the new size of the dimension.
  @discussion This method resizes a dimension based on a given dimension name.  If fails, retunewSizea NO and creates a NCDFError.  This method works by creating an empty temporary netcdf file and recreating the old file within the new file except the dimension length is the newSize.  When complete, the new file is moved to the path of the old file.  The NCDFHandle will then resync to file.  Note, resizing an unlimited dimension may have unexpected results.  A new size to anything but 0 for an unlimited dimension may damage dependent variables.
 */
--(BOOL)resizeDimensionWithName:(NSString *)resizeDimName size:(int)newSize;
+-(BOOL)resizeDimensionWithName:(NSString *)resizeDimName size:(size_t)newSize;
+
+/*!
+  @method renameDimensionWithName:toName:
+  @abstract Renames a dimension.
+  @param oldName NSString name of the dimension.
+  @param newName NSString new name for the dimension.
+  @discussion Outside an edit session this is the same as renameDimension: on the dimension.  Inside an edit session the rename is applied when the file is rewritten at commit.
+*/
+-(BOOL)renameDimensionWithName:(NSString *)oldName toName:(NSString *)newName;
 
 
 
@@ -212,6 +354,94 @@
 */
 -(NSArray *)createNewGlobalAttributeWithArray:(NSArray *)theNewAttributes;
 
+//*****************************DEFINE SESSIONS***********************************
+
+/*!
+  @method beginDefineSession
+  @abstract Starts grouping schema changes into a single define mode pass.
+  @discussion Every netcdf header change (nc_redef/nc_enddef pair) rewrites the header and, when the header grows, moves all of the data in the file.  Between beginDefineSession and commitDefineSession, the methods that create, rename or delete dimensions, attributes and variables share one writable ncid that stays in define mode, and the handle does not refresh its metadata after each change.  The header is written once and the metadata is refreshed once when the session is committed.<P>The session holds the file's write lock, so other threads using the file wait until it is committed.  Sessions are per thread and may be nested; only the outermost commitDefineSession ends the session.  Objects created inside the session can be retrieved as soon as they are created: the first lookup after a change brings the handle's dimension, attribute and variable arrays up to date from the session's ncid without leaving define mode.  Variable data passed to createNewVariableWithPropertyList: is written after the header at commit.  Reading or writing variable data inside a session ends the define mode pass early; the next schema change starts a new one.
+  @result YES if the session was started.
+*/
+-(BOOL)beginDefineSession;
+
+/*!
+  @method commitDefineSession
+  @abstract Ends a define session started with beginDefineSession.
+  @discussion Leaves define mode, writes any variable data queued during the session and refreshes the handle's metadata.
+  @result NO if the header could not be written or no session was open on the calling thread.
+*/
+-(BOOL)commitDefineSession;
+
+/*!
+  @method defineWithBlock:
+  @abstract Runs defineBlock inside a define session.
+  @param defineBlock a block making schema changes on the handle passed to it.
+  @discussion A convenience for beginDefineSession and commitDefineSession.  An example would look like:<P>[aHandle defineWithBlock:^(NCDFHandle *theHandle){<BR>&nbsp;&nbsp;[theHandle createNewDimensionWithName:@"time" size:NC_UNLIMITED];<BR>&nbsp;&nbsp;[theHandle createNewVariableWithName:@"time" type:NC_DOUBLE dimNameArray:@[@"time"]];<BR>}];
+  @result The result of commitDefineSession, or NO if the session could not be started.
+*/
+-(BOOL)defineWithBlock:(void (^)(NCDFHandle *aHandle))defineBlock;
+
+/*!
+  @method beginDefineSessionReservingHeaderSpace:
+  @abstract Starts a define session that leaves at least bytes of free space after the header.
+  @param bytes the free space to reserve.  The handle's headerFreeSpace is raised to this value if it is smaller.
+  @discussion Use this before adding metadata to a large classic file whose header has no room left: the data is moved once when the session is committed, and later additions fit in place.
+  @result YES if the session was started.
+*/
+-(BOOL)beginDefineSessionReservingHeaderSpace:(size_t)bytes;
+
+/*!
+  @method isInDefineSession
+  @abstract Returns YES if the calling thread has a define session open on the receiver.
+*/
+-(BOOL)isInDefineSession;
+
+/*!
+  @method beginEditSession
+  @abstract Starts collecting structural edits so that the file is rewritten only once.
+  @discussion deleteDimensionWithName:, resizeDimensionWithName:size: deleteVariableWithName: and deleteVariablesWithNames: each rebuild the whole file in a temporary file.  Between beginEditSession and commitEditSession these methods, together with renameDimensionWithName:toName:, renameVariableWithName:toName:, createNewGlobalAttributeWithName:dataType:values:, deleteGlobalAttributeWithName: and NCDFVariable's createNewVariableAttributeWithName:dataType:values: and deleteVariableAttributeByName:, only record the edit, and commitEditSession applies all of them in a single rewrite.  Names used inside the session may be the names given by earlier renames in the same session.<P>The handle's metadata and the file are unchanged until the session is committed.  Other changes, such as new variables or variable data, are made to the file immediately and carried into the rewrite.  Variable attributes cannot be renamed while a session is open.  Sessions are per thread and may be nested; only the outermost commitEditSession performs the rewrite.
+  @result YES if the session was started, NO if another thread has an edit session open on the receiver.
+*/
+-(BOOL)beginEditSession;
+
+/*!
+  @method commitEditSession
+  @abstract Ends an edit session and rewrites the file once with every edit collected.
+  @result NO if the rewrite failed, no session was open on the calling thread or a define session is still open.  If nothing was edited the file is left alone.
+  @discussion If a define session is open the edit session is left open with all of its edits, so it can be committed again once the define session has been committed.
+*/
+-(BOOL)commitEditSession;
+
+/*!
+  @method cancelEditSession
+  @abstract Ends an edit session, including any nested sessions, without changing the file.
+*/
+-(void)cancelEditSession;
+
+/*!
+  @method editWithBlock:
+  @abstract Runs editBlock inside an edit session.
+  @param editBlock a block making structural edits on the handle passed to it.
+  @result The result of commitEditSession, or NO if the session could not be started.
+*/
+-(BOOL)editWithBlock:(void (^)(NCDFHandle *aHandle))editBlock;
+
+/*!
+  @method isInEditSession
+  @abstract Returns YES if the calling thread has an edit session open on the receiver.
+*/
+-(BOOL)isInEditSession;
+
+/*!
+  @method recordVariableAttributeEdit:forVariableName:
+  @abstract Adds a variable attribute edit to the calling thread's edit session.
+  @param anEdit attributeName, nc_type and values to create or replace the attribute, or attributeName alone to delete it.
+  @param variableName the variable's name as it was when the session began.
+  @result NO if the calling thread has no edit session open on the receiver.
+  @discussion NCDFVariable records its attribute edits here while a session is open; they are applied to the rewritten file by commitEditSession.
+*/
+-(BOOL)recordVariableAttributeEdit:(NSDictionary *)anEdit forVariableName:(NSString *)variableName;
+
 
 //*****************************VALIDATION OF TEXT***********************************
 
@@ -235,6 +465,19 @@
 */
 -(BOOL)createNewVariableWithName:(NSString *)variableName type:(nc_type)theType dimNameArray:(NSArray *)selectedDims;
 
+#ifdef NCDF4
+/*!
+  @method createNewVariableWithName:type:dimNameArray:storageOptions:
+  @abstract Creates a new netCDF-4 variable with chunking and filter settings.
+  @param variableName NSString of the name string.
+  @param theType The netcdf data type (NC_BYTE,NC_CHAR, etc)
+  @param selectedDims An array of dimension names in order of significance.
+  @param storageOptions NSDictionary using the NCDFVariableStorage keys defined in NCDFVariable.h.  Keys that are missing keep the library defaults.
+  @discussion Same as createNewVariableWithName:type:dimNameArray: but sets the chunk shape, deflate level, shuffle and fletcher32 before the variable leaves define mode.  Choose chunk shapes that match the dominant read pattern; a chunk is always read and decompressed as a whole.  The options can also be given to createNewVariableWithPropertyList: under NCDFVariablePropertyListFieldStorage.  Posts an NCDFError and returns NO if the file is not a netCDF-4 file or an option is invalid.
+*/
+-(BOOL)createNewVariableWithName:(NSString *)variableName type:(nc_type)theType dimNameArray:(NSArray *)selectedDims storageOptions:(NSDictionary *)storageOptions;
+#endif
+
 /*!
   @method createNewVariableWithPropertyList:
   @abstract Creates a new variable based on a property list.
@@ -264,6 +507,15 @@
 */
 -(BOOL)deleteVariablesWithNames:(NSArray *)nameArray;
 
+/*!
+  @method renameVariableWithName:toName:
+  @abstract Renames a variable.
+  @param oldName NSString name of the variable.
+  @param newName NSString new name for the variable.
+  @discussion Outside an edit session this is the same as renameVariable: on the variable.  Inside an edit session the rename is applied when the file is rewritten at commit.
+*/
+-(BOOL)renameVariableWithName:(NSString *)oldName toName:(NSString *)newName;
+
 /*!
   @method retrieveVariableByName:
   @abstract Access a variable by name.
@@ -309,10 +561,38 @@
   @method extendUnlimitedVariableBy:
   @abstract Extend the length of the unlimited dimension via the dimension variable.
   @param units The numbers of values to extend the unlimited dimension length.
-  @discussion This function provides a simple method to make all variables that are dependent on a unlimited dimension longer.  By adding to this length, all variables that use the unlimited variable with increase in size automatically.
+  @discussion This function provides a simple method to make all variables that are dependent on a unlimited dimension longer.  By adding to this length, all variables that use the unlimited variable with increase in size automatically.  Every record variable, the dimension variable included, holds fill values in the new records.  Only the last new record of the dimension variable is written; the library fills the rest.  Use appendRecords:withData: to write the new records' data at the same time.
 
 */
 -(BOOL)extendUnlimitedVariableBy:(int)units;
+
+/*!
+  @method appendRecords:withData:
+  @abstract Appends records to several record variables at once.
+  @param recordCount the number of records to append.
+  @param dataByVariableName NSData objects keyed by record variable name.  Each holds recordCount whole records of the variable in its netcdf type and native byte order, in netcdf dimensional order.
+  @result NO if any variable is not a record variable, any data has the wrong length, or a write fails.  The error is posted to the error handle.
+  @discussion All of the data is written through one writable ncid and the unlimited dimension's cached length is updated without refreshing the handle, which makes this the method to use for appending one time step at a time.  When data is given for every record variable in the file, the records are written in no-fill mode so that the new records are written only once.  Otherwise the library fills the new records first so that the record variables without data hold fill values.  netcdf cannot shrink the record dimension, so records added before a failed write stay in the file; the error reports the record count the file was left with, and every record variable that was not written holds fill values in them.
+*/
+-(BOOL)appendRecords:(size_t)recordCount withData:(NSDictionary *)dataByVariableName;
+
+/*!
+  @method readVariables:atLocations:edgeLengths:
+  @abstract Reads regions of several variables as one batch.
+  @param variableNames names of the variables to read.  A name given more than once is read once; the repeats are reported to the error handle.
+  @param startCoordinateArrays one array of start coordinates per variable, in the order of variableNames, or nil to start every variable at its origin.  An NSNull entry starts that variable at its origin.
+  @param edgeLengthArrays one array of edge lengths per variable, or nil to read every variable whole.  An NSNull entry reads that variable to its end.
+  @result NCDFSlab objects keyed by variable name.  Variables that could not be read are missing and their errors are posted to the error handle.  If startCoordinateArrays or edgeLengthArrays is given with a count other than that of variableNames, nothing is read, NC_EINVAL is posted and the result is empty.
+  @discussion All of the reads are planned before any is made.  Regions that can be served from the memory mapping (see setUsesMappedReads:) are copied out of it without the netcdf library; their slabs convert to the host's byte order when their data is used.  The remaining reads are sorted into file order and made through shared read-only ncids.  For classic and 64-bit offset files, which the library keeps no shared state for apart from its list of open datasets, the reads are split between up to four ncids read on parallel threads.  Other threads cannot open or close netcdf files while the parallel reads run.  netCDF-4 files, in-memory datasets and reads made inside a define session use a single ncid.
+*/
+-(NSDictionary *)readVariables:(NSArray *)variableNames atLocations:(NSArray *)startCoordinateArrays edgeLengths:(NSArray *)edgeLengthArrays;
+
+/*!
+  @method readVariables:atLocations:edgeLengths:completion:
+  @abstract Performs readVariables:atLocations:edgeLengths: on a background queue.
+  @param completion called with the NCDFSlab objects keyed by variable name.  It is called on a background queue.
+*/
+-(void)readVariables:(NSArray *)variableNames atLocations:(NSArray *)startCoordinateArrays edgeLengths:(NSArray *)edgeLengthArrays completion:(void (^)(NSDictionary *slabsByVariableName))completion;
 	/*!
     @method htmlDescription
     @abstract Returns a description of the variable and all of its attributes in an html form.
@@ -345,6 +625,128 @@
 	 */
 -(NSNumber *)compareValue;
 -(int)ncidForReadOnly;
+/*!
+ @method closeNCID:
+ @abstract Returns an ncid obtained from ncidWithOpenMode:status: to the handle.
+ @param ncid the ncid to release.
+ @discussion The ncid is not necessarily closed.  Pooled ncids are kept open for reuse until they have been idle for ncidIdleTimeout seconds.  A writable ncid leaves define mode and is synced to disk when it is released.
+ */
 -(void)closeNCID:(int)ncid;
+/*!
+ @method ncidWithOpenMode:status:
+ @abstract Provides an open ncid for the handle's file.
+ @param openMode NC_NOWRITE (or NC_SHARE) for reading, NC_WRITE for writing.
+ @param status returns the netcdf status of the open.
+ @discussion Inside a define session on the calling thread, the session's ncid is returned after leaving define mode.  Otherwise the file's NCDFFileLock is taken before the ncid is handed out: shared for reading, exclusive for writing.  It is held until the ncid is returned with closeNCID:, so concurrent readers of the same file proceed in parallel while a writer has the file to itself.  Idle ncids in the handle's pool are reused when no writer has touched the file since they were last used and the file's modification date and size have not changed.  The file's modification date and size are checked at most once a second.  A writable ncid may also satisfy a read request.  Requesting a writable ncid closes the idle read-only ncids, since their header information would be stale after the write.  An ncid is handed to one caller at a time, since the netcdf library is not safe to use on one ncid from several threads.  Every ncid must be returned with closeNCID:; the handle is kept alive until it is.
+ */
 -(int)ncidWithOpenMode:(int)openMode status:(int32_t *)status;
+/*!
+ @method ncidForDefineWithStatus:
+ @abstract Provides a writable ncid in define mode.
+ @param status returns the netcdf status.
+ @discussion Used by the methods that change the file's header.  Inside a define session this is the session's ncid.  Otherwise a writable ncid is checked out and put into define mode.  Either way the ncid must be returned with closeNCID:, followed by the narrowest refresh method that covers the change once it has succeeded.
+ */
+-(int)ncidForDefineWithStatus:(int32_t *)status;
+/*!
+ @method closeAll
+ @abstract Closes every pooled ncid.
+ @discussion Idle ncids are closed immediately.  ncids that are still in use are closed as soon as they are returned with closeNCID:.  Call this method before moving or deleting the handle's file outside of the handle.
+ */
+-(void)closeAll;
+/*!
+ @method setNCIDIdleTimeout:
+ @abstract Sets the number of seconds an unused ncid stays open.
+ @param timeout the idle timeout in seconds.  A timeout of 0 disables pooling so that every ncid is closed when it is released.
+ */
+-(void)setNCIDIdleTimeout:(NSTimeInterval)timeout;
+/*!
+ @method ncidIdleTimeout
+ @abstract Returns the number of seconds an unused ncid stays open.
+ */
+-(NSTimeInterval)ncidIdleTimeout;
+/*!
+ @method setSharedAccess:
+ @abstract Sets whether ncids are opened with NC_SHARE.
+ @param shared YES to open with NC_SHARE.
+ @discussion NC_SHARE turns off the netcdf library's buffering so that changes made by other processes are seen immediately.  It is on by default for handles created with initWithFileAtPath: and off for handles created with initLazilyWithFileAtPath:.  Pooled ncids are checked against the file's modification date and size before reuse, at most once a second.  Idle ncids are closed so that the next file operation uses the new setting.
+ */
+-(void)setSharedAccess:(BOOL)shared;
+/*!
+ @method sharedAccess
+ @abstract Returns YES if ncids are opened with NC_SHARE.
+ */
+-(BOOL)sharedAccess;
+/*!
+ @method setHeaderFreeSpace:
+ @abstract Sets the free space kept after the header whenever the handle leaves define mode.
+ @param bytes the number of bytes to reserve.  The default is 0.
+ @discussion In classic and 64-bit offset files the data starts right after the header.  When a new dimension, attribute or variable makes the header larger than the space before the data, the netcdf library moves all of the data in the file.  Reserving free space (nc__enddef h_minfree) lets later header changes be written in place.  The space is added the next time the header is written, which for an existing file moves the data one last time.  Rewrites of the file carry the setting into the new file.
+ */
+-(void)setHeaderFreeSpace:(size_t)bytes;
+/*!
+ @method headerFreeSpace
+ @abstract Returns the free space kept after the header.
+ */
+-(size_t)headerFreeSpace;
+/*!
+ @method setVariableAlignment:recordAlignment:
+ @abstract Sets the alignment of the start of the fixed size data and of the record data.
+ @param vAlign alignment in bytes of the first fixed size variable, NC_ALIGN_CHUNK for the file system block size, or 1 for none.
+ @param rAlign alignment in bytes of the first record, NC_ALIGN_CHUNK for the file system block size, or 1 for none.
+ @discussion Aligning the data to the file system block size keeps reads of whole variables from straddling an extra block, and gives the header room to grow up to the alignment boundary.  Applied whenever the handle leaves define mode.
+ */
+-(void)setVariableAlignment:(size_t)vAlign recordAlignment:(size_t)rAlign;
+/*!
+ @method variableAlignment
+ @abstract Returns the alignment of the fixed size data.
+ */
+-(size_t)variableAlignment;
+/*!
+ @method recordAlignment
+ @abstract Returns the alignment of the record data.
+ */
+-(size_t)recordAlignment;
+/*!
+ @method setRewriteMemoryCeiling:
+ @abstract Sets the most memory used to copy variable data when the file is rewritten.
+ @param bytes the size in bytes of the largest piece of a variable held in memory.  The default is 64 MB.
+ @discussion deleteDimensionWithName:, resizeDimensionWithName:size:, deleteVariableWithName: and deleteVariablesWithNames: rebuild the file in a temporary file.  Variable data is copied into it in hyperslabs no larger than this ceiling, so very large variables can be rewritten without being read into memory.  Larger ceilings mean fewer, larger reads and writes.
+ */
+-(void)setRewriteMemoryCeiling:(size_t)bytes;
+/*!
+ @method rewriteMemoryCeiling
+ @abstract Returns the most memory used to copy variable data when the file is rewritten.
+ */
+-(size_t)rewriteMemoryCeiling;
+/*!
+ @method setUsesMappedReads:
+ @abstract Sets whether variable reads are served from a memory mapping of the file when possible.
+ @param mapped YES to read through the mapping.  The default is NO.
+ @discussion With mapped reads on, readAllVariableData, getValueArrayAtLocation:edgeLengths:, getAllDataInSlab and getSlabForStartCoordinates:edgeLengths: read fixed size variables of classic and 64-bit offset files from mappedFile instead of through the netcdf library, whenever the requested region is contiguous in the file.  The region is copied out of the mapping once, and multi-byte types are converted to the host's byte order in that copy (slabs convert only when their data is first used).  Everything else falls back to the netcdf library.  Returned data never points into the mapping, so it is not changed by later writes to the file.
+ */
+-(void)setUsesMappedReads:(BOOL)mapped;
+/*!
+ @method usesMappedReads
+ @abstract Returns YES if variable reads are served from a memory mapping when possible.
+ */
+-(BOOL)usesMappedReads;
+/*!
+ @method mappedFile
+ @abstract Returns a read-only memory mapping of the file.
+ @result The mapping, or nil if the file is not a classic or 64-bit offset file or a define session is open.
+ @discussion The mapping is made on first use and replaced after the file is written, by this or any other handle or process.  Hold the file lock for reading while obtaining and reading from the mapping so that no write happens in between, and do not keep the mapping once the lock is released; see NCDFMappedFile for the lifetime of a mapping and of the data copied from it.
+ */
+-(NCDFMappedFile *)mappedFile;
+/*!
+ @method isInMemory
+ @abstract Returns YES if the receiver works on a dataset held in memory.  Always NO without NCDF4.
+ */
+-(BOOL)isInMemory;
+/*!
+ @method closeInMemoryDataset
+ @abstract Closes the receiver's in-memory dataset, writing it to disk if it was created or opened with persist.
+ @result NO if the dataset could not be closed or persisted.
+ @discussion The handle cannot be used after this method.  It is called automatically when the handle is deallocated.
+ */
+-(BOOL)closeInMemoryDataset;
 @end
@@ -11,9 +11,212 @@
 #import "NCDFDimension.h"
 #import "NCDFAttribute.h"
 #import "NCDFVariable.h"
+#import "NCDFFileLock.h"
+#import "NCDFHyperslab.h"
+#import "NCDFMappedFile.h"
+#import "NCDFSlab.h"
+#import "NCDFBlockCache.h"
 #import <netcdf.h>
 
-static NSLock *fileDatabaseLock;
+#define NCDFHandleDefaultNCIDIdleTimeout 30.0
+#define NCDFHandleMaxIdleNCIDsPerMode 2
+#define NCDFHandleFileSignatureInterval 1.0
+#define NCDFHandleDefaultRewriteMemoryCeiling (64*1024*1024)
+/*nc_enddef lays out the header with no free space and no alignment beyond four bytes.*/
+#define NCDFHandleDefaultHeaderFreeSpace 0
+#define NCDFHandleDefaultAlignment 1
+#define NCDFHandleMaxParallelReads 4
+
+/*The netcdf library keeps a process-wide table of open datasets that is not thread safe.  nc_open, nc_create and nc_close change the table and take this lock for writing.  Each read made by the workers of readVariables:atLocations:edgeLengths:, which look their ncids up in the table, takes it for reading, so the workers read together but never while a dataset is opened or closed.  Access to the files themselves is coordinated by NCDFFileLock.*/
+static pthread_rwlock_t ncLibraryLock = PTHREAD_RWLOCK_INITIALIZER;
+
+/*A single open ncid held in an NCDFHandle's pool.  openMode is NC_NOWRITE or NC_WRITE.  The library keeps one buffer per ncid, so an ncid is never shared and inUse marks the single checkout.  owner holds the handle for the length of the checkout, so a handle cannot be deallocated while one of its ncids is being used.  The file lock's write generation and the modification date and size of the file are recorded when the ncid is opened and whenever it is released after a write, so a change to the file by another handle or process can be detected before the ncid is reused; lastValidated is when the file was last checked.  lockedForWriting records which kind of file lock the current checkout holds.*/
+@interface NCDFPooledNCID : NSObject {
+@public
+    int32_t ncid;
+    int32_t openMode;
+    BOOL inUse;
+    NCDFHandle *owner;
+    BOOL isStale;
+    BOOL checkedOutForWriting;
+    BOOL lockedForWriting;
+    uint64_t writeGeneration;
+    NSTimeInterval lastUsed;
+    NSDate *fileModificationDate;
+    unsigned long long fileSize;
+    NSTimeInterval lastValidated;
+}
+@end
+
+@implementation NCDFPooledNCID
+@end
+
+/*The handle's dimension, attribute and variable arrays are handed out as mutable arrays, so not every change to them goes through the handle.  NCDFIndexedArray counts every mutation so that a name index built from it can tell when it is out of date.*/
+@interface NCDFIndexedArray : NSMutableArray {
+    NSMutableArray *_objects;
+@public
+    uint64_t mutationCount;
+}
+@end
+
+@implementation NCDFIndexedArray
+
+-(id)init
+{
+    return [self initWithCapacity:0];
+}
+
+-(id)initWithCapacity:(NSUInteger)numItems
+{
+    self = [super init];
+    if(self)
+        _objects = [[NSMutableArray alloc] initWithCapacity:numItems];
+    return self;
+}
+
+-(NSUInteger)count
+{
+    return [_objects count];
+}
+
+-(id)objectAtIndex:(NSUInteger)index
+{
+    return [_objects objectAtIndex:index];
+}
+
+-(NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state objects:(id __unsafe_unretained [])buffer count:(NSUInteger)len
+{
+    return [_objects countByEnumeratingWithState:state objects:buffer count:len];
+}
+
+-(void)insertObject:(id)anObject atIndex:(NSUInteger)index
+{
+    mutationCount++;
+    [_objects insertObject:anObject atIndex:index];
+}
+
+-(void)removeObjectAtIndex:(NSUInteger)index
+{
+    mutationCount++;
+    [_objects removeObjectAtIndex:index];
+}
+
+-(void)addObject:(id)anObject
+{
+    mutationCount++;
+    [_objects addObject:anObject];
+}
+
+-(void)removeLastObject
+{
+    mutationCount++;
+    [_objects removeLastObject];
+}
+
+-(void)replaceObjectAtIndex:(NSUInteger)index withObject:(id)anObject
+{
+    mutationCount++;
+    [_objects replaceObjectAtIndex:index withObject:anObject];
+}
+
+@end
+
+#ifdef NCDF4
+/*The checkouts of an in-memory dataset's single ncid made by one thread.  The thread takes the file lock on its first checkout, upgrades it on its first writable checkout and releases it when count returns to zero, so the order the checkouts are returned in does not matter.*/
+@interface NCDFMemoryCheckout : NSObject {
+@public
+    int32_t count;
+    BOOL readLocked;
+    BOOL writeLocked;
+}
+@end
+
+@implementation NCDFMemoryCheckout
+@end
+#endif
+
+/*One variable region planned by readVariables:atLocations:edgeLengths:.  start and edges are malloc'd and freed with the read.  data is filled from the mapping, in which case isBigEndian is set, or by the library, in which case status holds the result of the read.*/
+@interface NCDFPlannedRead : NSObject {
+@public
+    NCDFVariable *variable;
+    NSString *variableName;
+    NSArray *edgeLengths;
+    size_t *start;
+    size_t *edges;
+    NSData *data;
+    BOOL isBigEndian;
+    int32_t status;
+}
+@end
+
+@implementation NCDFPlannedRead
+
+-(void)dealloc
+{
+    free(start);
+    free(edges);
+}
+
+@end
+
+/*The structural edits carried out by one rewrite of a file, either requested by a single rewrite method or collected by an edit session.  Dimension and variable names are the names in the file before the rewrite.  dimensionLengths holds NSNumber lengths and the rename dictionaries map old names to new ones.  globalAttributeEdits holds global attribute property lists in the order the edits were made; an entry without values deletes the attribute.*/
+@interface NCDFRewritePlan : NSObject {
+@public
+    NSMutableSet *omittedDimensions;
+    NSMutableDictionary *dimensionLengths;
+    NSMutableDictionary *dimensionRenames;
+    NSMutableSet *omittedVariables;
+    NSMutableDictionary *variableRenames;
+    NSMutableArray *globalAttributeEdits;
+    NSMutableDictionary *variableAttributeEdits;
+}
+-(NSString *)originalDimensionName:(NSString *)aName;
+-(NSString *)originalVariableName:(NSString *)aName;
+-(BOOL)hasEdits;
+@end
+
+@implementation NCDFRewritePlan
+
+-(id)init
+{
+    self = [super init];
+    if(self)
+    {
+        omittedDimensions = [[NSMutableSet alloc] init];
+        dimensionLengths = [[NSMutableDictionary alloc] init];
+        dimensionRenames = [[NSMutableDictionary alloc] init];
+        omittedVariables = [[NSMutableSet alloc] init];
+        variableRenames = [[NSMutableDictionary alloc] init];
+        globalAttributeEdits = [[NSMutableArray alloc] init];
+        variableAttributeEdits = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+-(NSString *)originalDimensionName:(NSString *)aName
+{
+    //edits made after a rename use the new name.
+    NSArray *keys = [dimensionRenames allKeysForObject:aName];
+    if([keys count]>0)
+        return keys[0];
+    return aName;
+}
+
+-(NSString *)originalVariableName:(NSString *)aName
+{
+    NSArray *keys = [variableRenames allKeysForObject:aName];
+    if([keys count]>0)
+        return keys[0];
+    return aName;
+}
+
+-(BOOL)hasEdits
+{
+    return ([omittedDimensions count]>0 || [dimensionLengths count]>0 || [dimensionRenames count]>0 || [omittedVariables count]>0 || [variableRenames count]>0 || [globalAttributeEdits count]>0 || [variableAttributeEdits count]>0);
+}
+
+@end
+
 @interface NCDFHandle (PrivateMethods)
 
 /*!
@@ -44,6 +247,211 @@ static NSLock *fileDatabaseLock;
  */
 -(void)seedArrays:(NSArray *)typeArrays;
 
+/*!
+ @method seedDimensions:ncid:
+ @abstract Adds an NCDFDimension for every dimension in the file to theDims.
+ @result NO if the file could not be inquired.
+ */
+-(BOOL)seedDimensions:(NSMutableArray *)theDims ncid:(int)ncid;
+/*!
+ @method seedGlobalAttributes:ncid:
+ @abstract Adds an NCDFAttribute for every global attribute in the file to theAtts.
+ @result NO if the file could not be inquired.
+ */
+-(BOOL)seedGlobalAttributes:(NSMutableArray *)theAtts ncid:(int)ncid;
+/*!
+ @method seedVariables:ncid:
+ @abstract Adds an NCDFVariable for every variable in the file to theVars.
+ @result NO if the file could not be inquired.
+ */
+-(BOOL)seedVariables:(NSMutableArray *)theVars ncid:(int)ncid;
+/*!
+ @method seedVariableWithID:ncid:
+ @abstract Returns a new NCDFVariable for the variable theID, or nil if it could not be inquired.
+ */
+-(NCDFVariable *)seedVariableWithID:(int)theID ncid:(int)ncid;
+/*!
+ @method reconcileDimensions:
+ @abstract Brings theDimensions in line with freshly seeded dimensions, keeping the existing objects.
+ */
+-(void)reconcileDimensions:(NSArray *)freshDims;
+/*!
+ @method reconcileGlobalAttributes:
+ @abstract Brings theGlobalAttributes in line with freshly seeded attributes, keeping the existing objects.
+ */
+-(void)reconcileGlobalAttributes:(NSArray *)freshAtts;
+/*!
+ @method reconcileVariables:
+ @abstract Brings theVariables in line with freshly seeded variables, keeping the existing objects.
+ */
+-(void)reconcileVariables:(NSArray *)freshVars;
+/*!
+ @method indexDimensions
+ @abstract Rebuilds the name index of theDimensions.
+ */
+-(void)indexDimensions;
+/*!
+ @method indexGlobalAttributes
+ @abstract Rebuilds the name index of theGlobalAttributes.
+ */
+-(void)indexGlobalAttributes;
+/*!
+ @method indexVariables
+ @abstract Rebuilds the name index of theVariables.
+ */
+-(void)indexVariables;
+
+/*!
+ @method loadDimensionsIfNeeded
+ @abstract Seeds theDimensions the first time they are needed by a lazily opened handle.
+ @discussion Safe to call from several threads at once; the table is seeded exactly once under the handle's metadata lock.
+ */
+-(void)loadDimensionsIfNeeded;
+/*!
+ @method loadGlobalAttributesIfNeeded
+ @abstract Seeds theGlobalAttributes the first time they are needed by a lazily opened handle.
+ */
+-(void)loadGlobalAttributesIfNeeded;
+/*!
+ @method loadVariablesIfNeeded
+ @abstract Seeds theVariables the first time they are needed by a lazily opened handle.
+ */
+-(void)loadVariablesIfNeeded;
+/*!
+ @method loadMetadataIfNeeded
+ @abstract Seeds every kind of metadata that has not been seeded yet.
+ */
+-(void)loadMetadataIfNeeded;
+/*!
+ @method catchUpDefineSession
+ @abstract Brings the loaded metadata up to date with the changes made so far in the calling thread's define session.
+ @discussion The schema methods only mark the metadata stale inside a session.  The first lookup after a change reseeds it through the session's ncid, which answers inquiries in define mode, so the header is still written only once.
+ */
+-(void)catchUpDefineSession;
+
+/*!
+ @method setupNCIDPool
+ @abstract Prepares the pool of open ncids.  Must be called before any file access by the initialization methods.
+ */
+-(void)setupNCIDPool;
+/*!
+ @method pooledNCIDForNCID:
+ @abstract Returns the pool entry for ncid or nil if ncid is not pooled.  The pool lock must be held.
+ */
+-(NCDFPooledNCID *)pooledNCIDForNCID:(int)ncid;
+/*!
+ @method recordFileSignatureForPooledNCID:
+ @abstract Stores the current modification date and size of the file in a pool entry.
+ */
+-(void)recordFileSignatureForPooledNCID:(NCDFPooledNCID *)entry;
+/*!
+ @method fileSignatureMatchesPooledNCID:
+ @abstract Returns NO if the file has been modified since the pool entry was last validated.
+ @discussion The file is only examined if it has not been in the last NCDFHandleFileSignatureInterval seconds, so a burst of checkouts costs one stat.  Writes made through other handles in this process are caught by the file lock's write generation regardless.
+ */
+-(BOOL)fileSignatureMatchesPooledNCID:(NCDFPooledNCID *)entry;
+/*!
+ @method closePooledNCID:
+ @abstract Closes the ncid of a pool entry and removes it from the pool.  The pool lock must be held.
+ */
+-(void)closePooledNCID:(NCDFPooledNCID *)entry;
+/*!
+ @method scheduleIdleNCIDPurge
+ @abstract Arranges for idle ncids to be closed once the idle timeout has passed.
+ */
+-(void)scheduleIdleNCIDPurge;
+/*!
+ @method purgeIdleNCIDs
+ @abstract Closes the ncids that have been idle longer than the idle timeout.
+ */
+-(void)purgeIdleNCIDs;
+/*!
+ @method createVariableWithName:type:dimNames:storageOptions:
+ @abstract Defines a variable whose dimensions are given by name.
+ @discussion Dimension names are looked up in the file rather than in the handle's metadata so that dimensions defined earlier in the same define session can be used.  storageOptions may be nil; it is only used by netCDF-4 builds.
+ */
+-(BOOL)createVariableWithName:(NSString *)varName type:(nc_type)theType dimNames:(NSArray *)theDimNames storageOptions:(NSDictionary *)storageOptions;
+#ifdef NCDF4
+/*!
+ @method defineStorage:ncid:variableID:
+ @abstract Applies netCDF-4 storage options to a variable in define mode.
+ @result The netcdf status of the first call that failed.
+ */
+-(int)defineStorage:(NSDictionary *)options ncid:(int)ncid variableID:(int)varID;
+#endif
+/*!
+ @method rewritePlanForEdit
+ @abstract Returns the plan a structural edit should be added to.
+ @discussion This is the open edit session's plan on the session thread and a new, empty plan otherwise.
+ */
+-(NCDFRewritePlan *)rewritePlanForEdit;
+/*!
+ @method applyRewritePlan:methodName:
+ @abstract Rewrites the file with plan unless plan belongs to an open edit session.
+ @result YES if the edit was recorded in the session or the rewrite succeeded.
+ */
+-(BOOL)applyRewritePlan:(NCDFRewritePlan *)plan methodName:(NSString *)methodName;
+/*!
+ @method rewriteFileWithPlan:methodName:
+ @abstract Rebuilds the file in a temporary file with the edits in plan and moves it over the original.
+ @param plan the dimensions and variables to leave out, resize or rename and the global and variable attribute changes.  Variables that use an omitted dimension are left out as well.
+ @param methodName name of the calling method for error reporting.
+ @discussion The header is copied through property lists in one define session.  Variable data is then copied directly between the two files in tiles no larger than rewriteMemoryCeiling, so no variable is ever read into memory as a whole.  Along a resized dimension only the part that exists in both files is copied.
+ */
+-(BOOL)rewriteFileWithPlan:(NCDFRewritePlan *)plan methodName:(NSString *)methodName;
+/*!
+ @method endDefineModeForNCID:
+ @abstract Leaves define mode with the handle's header free space and alignment.
+ @result The netcdf status of nc__enddef.
+ */
+-(int)endDefineModeForNCID:(int)ncid;
+/*!
+ @method writeFillValuesToRecords:count:variableID:ncid:
+ @abstract Writes the variable's fill value into a run of its records.
+ @discussion Used by appendRecords:withData: to clean up the records it added in no-fill mode when a write fails.  The variable's _FillValue attribute is used if it has one of the variable's type, otherwise the library's default fill value.
+ @result The netcdf status.
+ */
+-(int)writeFillValuesToRecords:(size_t)recordStart count:(size_t)recordCount variableID:(int)varID ncid:(int)ncid;
+/*!
+ @method setCachedLength:ofUnlimitedDimensionID:
+ @abstract Updates the unlimited dimension's cached length after records were added, without refreshing the handle.
+ */
+-(void)setCachedLength:(size_t)newLength ofUnlimitedDimensionID:(int)unlimitedID;
+#ifdef NCDF4
+/*!
+ @method setupInMemoryNCID:readOnly:persists:
+ @abstract Makes ncid the single ncid through which the receiver reaches its in-memory dataset.
+ @discussion The dataset gets a file lock of its own, since the path it was read from, or is persisted to, is not the dataset being worked on.
+ */
+-(void)setupInMemoryNCID:(int)ncid readOnly:(BOOL)readOnly persists:(BOOL)persists;
+/*!
+ @method checkOutInMemoryNCIDForWriting:status:
+ @abstract ncidWithOpenMode:status: for in-memory datasets.
+ @discussion There is only one ncid.  Classic and 64-bit offset datasets are read from memory without any state in the ncid, so readers share it under the read lock.  Writers, and every user of a netCDF-4 dataset, take the write lock.
+ */
+-(int)checkOutInMemoryNCIDForWriting:(BOOL)forWriting status:(int32_t *)status;
+/*!
+ @method checkInInMemoryNCID:
+ @abstract closeNCID: for in-memory datasets.  The last release leaves define mode.
+ */
+-(void)checkInInMemoryNCID:(int)ncid;
+/*!
+ @method adoptInMemoryDatasetOfHandle:
+ @abstract Closes the receiver's in-memory dataset and takes over aHandle's in its place.
+ @discussion Used by rewrites of in-memory datasets instead of moving a temporary file over the original.
+ */
+-(void)adoptInMemoryDatasetOfHandle:(NCDFHandle *)aHandle;
+#endif
+/*!
+ @method openInMemoryDatasetWithData:atPath:create:settings:persist:methodName:
+ @abstract The work shared by initWithData:, initDisklessWithFileAtPath:persist: and initDisklessByCreatingFileAtPath:withSettings:persist:.
+ @discussion Sets up the receiver and opens data in memory, or opens or creates the dataset at thePath with NC_DISKLESS when data is nil.  The bundled netcdf 3.6 library has neither nc_open_mem nor NC_DISKLESS, so without NCDF4 nothing is opened and ENOTSUP is posted to the error handle.  Errors are logged, since the caller returns nil and its error handle is lost.
+ @param thePath the dataset's path, or nil to name an in-memory dataset that has no file.
+ @param methodName the initializer, for error reporting.
+ @result YES if the dataset is open and the receiver can be used.
+ */
+-(BOOL)openInMemoryDatasetWithData:(NSData *)data atPath:(NSString *)thePath create:(BOOL)create settings:(int)settings persist:(BOOL)persist methodName:(NSString *)methodName;
+
 @end
 
 @implementation NCDFHandle (PrivateMethods)
@@ -57,6 +465,7 @@ static NSLock *fileDatabaseLock;
         filePath = [thePath copy];
     else
         filePath = [[NSString alloc] init];
+    _fileLock = [NCDFFileLock fileLockForPath:filePath];
 }
 
 -(void)initializeArrays
@@ -66,17 +475,22 @@ static NSLock *fileDatabaseLock;
     theVariables = nil;
     theDimensions = nil;
     theGlobalAttributes = nil;
-    theVariables = [[NSMutableArray alloc] init];
-    theGlobalAttributes = [[NSMutableArray alloc] init];
-    theDimensions = [[NSMutableArray alloc] init];
+    theVariables = [[NCDFIndexedArray alloc] init];
+    theGlobalAttributes = [[NCDFIndexedArray alloc] init];
+    theDimensions = [[NCDFIndexedArray alloc] init];
     [self seedArrays:[NSArray arrayWithObjects:theDimensions,theGlobalAttributes,theVariables,nil]];
+    _dimensionsLoaded = YES;
+    _globalAttributesLoaded = YES;
+    _variablesLoaded = YES;
+    [self indexDimensions];
+    [self indexGlobalAttributes];
+    [self indexVariables];
 }
 
 -(void)seedArrays:(NSArray *)typeArrays
 {
     /*Populates NCDFDimension,NCDFAttribute,and NCDFVariable objects based on an existing netcdf file.  This method should only be invoked by subclasses of any of the above objects when the objects values were changed in the file.  However, changing these values will release objects held by the handle.*/
-    int32_t ncid,status,numberDims,numberVariables,numberGlobalAtts,numberUnlimited;
-    int32_t i;
+    int32_t ncid,status;
 
     if(!filePath)
         return;
@@ -86,114 +500,1046 @@ static NSLock *fileDatabaseLock;
         NSLog(@"seedArrays: error open");
         return;
     }
-    status = nc_inq(ncid,&numberDims,&numberVariables,&numberGlobalAtts,&numberUnlimited);
+    if([self seedDimensions:typeArrays[0] ncid:ncid])
+        if([self seedGlobalAttributes:typeArrays[1] ncid:ncid])
+            [self seedVariables:typeArrays[2] ncid:ncid];
+    [self closeNCID:ncid];
+}
 
+-(BOOL)seedDimensions:(NSMutableArray *)theDims ncid:(int)ncid
+{
+    int32_t status,numberDims;
+    int32_t i;
+
+    status = nc_inq_ndims(ncid,&numberDims);
+    if(status==NC_NOERR)
+        status = nc_inq_unlimdim(ncid,&_unlimitedDimensionID);
     if(status!=NC_NOERR)
     {
-        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"seedArrays" subMethod:@"Inquiring netCDF file" errorCode:status];
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"seedDimensions" subMethod:@"Inquiring netCDF file" errorCode:status];
         NSLog(@"seedArrays: error nc_inq");
-        return;
+        return NO;
     }
     for(i=0;i<numberDims;i++)
     {
-        char name[NC_MAX_NAME];
+        char name[NC_MAX_NAME+1];
         NSString *cocoaName;
         size_t length;
         NCDFDimension *theDim;
         status = nc_inq_dim(ncid,i,name,&length);
         if(status!=NC_NOERR)
         {
-            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"seedArrays" subMethod:@"Inquiring DIMS in netCDF file" errorCode:status];
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"seedDimensions" subMethod:@"Inquiring DIMS in netCDF file" errorCode:status];
             NSLog(@"seedArrays: error nc_inq_dim");
-            return;
+            return NO;
         }
         cocoaName = [NSString stringWithCString:name encoding:NSUTF8StringEncoding];
         theDim = [[NCDFDimension alloc] initWithFileName:filePath dimID:i name:cocoaName length:length handle:self];
-        [typeArrays[0] addObject:theDim];
+        [theDims addObject:theDim];
     }
+    return YES;
+}
+
+-(BOOL)seedGlobalAttributes:(NSMutableArray *)theAtts ncid:(int)ncid
+{
+    int32_t status,numberGlobalAtts;
+    int32_t i;
+
     status = nc_inq_natts(ncid, &numberGlobalAtts);
     if(status!=NC_NOERR)
     {
         NSLog(@"seedArrays: app count error");
-        return;
+        return NO;
     }
     for(i=0;i<numberGlobalAtts;i++)
     {
-        char *name = (char *)calloc(NC_MAX_NAME, sizeof(char));
+        char name[NC_MAX_NAME+1];
         nc_type attributeType;
         size_t length;
         NCDFAttribute *theAtt;
         status = nc_inq_attname(ncid, NC_GLOBAL,i, name);
         if(status!=NC_NOERR)
         {
-            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"seedArrays" subMethod:@"Inquiring attribute by name in netCDF file" errorCode:status];
-            NSLog(@"seedArrays: error nc_inq_attname %i %s",i, name);
-            return;
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"seedGlobalAttributes" subMethod:@"Inquiring attribute by name in netCDF file" errorCode:status];
+            NSLog(@"seedArrays: error nc_inq_attname %i",i);
+            return NO;
         }
         status = nc_inq_att ( ncid, NC_GLOBAL, name,
                              &attributeType, &length);
         if(status!=NC_NOERR)
         {
-            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"seedArrays" subMethod:@"Inquiring attribute in netCDF file" errorCode:status];
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"seedGlobalAttributes" subMethod:@"Inquiring attribute in netCDF file" errorCode:status];
             NSLog(@"seedArrays: error nc_inq_att %i %s",i, name);
-            return;
+            return NO;
         }
         theAtt = [[NCDFAttribute alloc] initWithPath:filePath name:[NSString stringWithCString:name encoding:NSUTF8StringEncoding] variableID:NC_GLOBAL length:length type:attributeType handle:self];
-        [typeArrays[1] addObject:theAtt];
-        free(name);
+        [theAtts addObject:theAtt];
+    }
+    return YES;
+}
+
+-(BOOL)seedVariables:(NSMutableArray *)theVars ncid:(int)ncid
+{
+    int32_t status,numberVariables;
+    int32_t i;
+    NCDFVariable *theVar;
+
+    status = nc_inq_nvars(ncid,&numberVariables);
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"seedVariables" subMethod:@"Inquiring netCDF file" errorCode:status];
+        return NO;
     }
     for(i=0;i<numberVariables;i++)
     {
-        char name[NC_MAX_NAME];
-        nc_type theType;
-        int32_t numberOfDims,j;
-        int32_t dimIDs[NC_MAX_VAR_DIMS];
-        int32_t numberOfAttributes;
-        NSMutableArray *theDimList;
-        NCDFVariable *theVar;
-        status = nc_inq_var (ncid,i,name,&theType,&numberOfDims,dimIDs,&numberOfAttributes);
-        if(status!=NC_NOERR)
+        theVar = [self seedVariableWithID:i ncid:ncid];
+        if(!theVar)
+            return NO;
+        [theVars addObject:theVar];
+    }
+    return YES;
+}
+
+-(NCDFVariable *)seedVariableWithID:(int)theID ncid:(int)ncid
+{
+    char name[NC_MAX_NAME+1];
+    nc_type theType;
+    int32_t numberOfDims,j,status;
+    int32_t dimIDs[NC_MAX_VAR_DIMS];
+    int32_t numberOfAttributes;
+    NSMutableArray *theDimList;
+
+    status = nc_inq_var (ncid,theID,name,&theType,&numberOfDims,dimIDs,&numberOfAttributes);
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"seedVariableWithID" subMethod:@"Inquiring variable in netCDF file" errorCode:status];
+        return nil;
+    }
+    theDimList = [[NSMutableArray alloc] init];
+    for(j=0;j<numberOfDims;j++)
+    {
+        [theDimList addObject:[NSNumber numberWithInt:dimIDs[j]]];
+    }
+    return [[NCDFVariable alloc] initWithPath:filePath variableName:[NSString stringWithCString:name encoding:NSUTF8StringEncoding] variableID:theID type:theType theDims:theDimList attributeCount:numberOfAttributes handle:self];
+}
+
+-(void)reconcileDimensions:(NSArray *)freshDims
+{
+    /*Matches freshly inquired dimensions to the ones already handed out by name, so that objects held by applications stay valid.  The keyed lookup keeps this linear in the number of dimensions.*/
+    NSMutableDictionary *existing = [NSMutableDictionary dictionaryWithCapacity:[theDimensions count]];
+    NSMutableArray *reconciled = [NSMutableArray arrayWithCapacity:[freshDims count]];
+    NCDFDimension *aDim,*mainDim;
+    int32_t i;
+
+    for(i=0;i<[theDimensions count];i++)
+        existing[[theDimensions[i] dimensionName]] = theDimensions[i];
+    for(i=0;i<[freshDims count];i++)
+    {
+        aDim = freshDims[i];
+        mainDim = existing[[aDim dimensionName]];
+        if(mainDim)
         {
-            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"seedArrays" subMethod:@"Inquiring variable in netCDF file" errorCode:status];
-            return;
+            [mainDim updateDimensionWithDimension:aDim];
+            [reconciled addObject:mainDim];
         }
-        theDimList = [[NSMutableArray alloc] init];
-        for(j=0;j<numberOfDims;j++)
+        else
+            [reconciled addObject:aDim];
+    }
+    //same array object, so that callers holding it stay in sync.
+    [theDimensions setArray:reconciled];
+    [theDimensions sortUsingSelector:@selector(compare:)];
+    [self indexDimensions];
+}
+
+-(void)reconcileGlobalAttributes:(NSArray *)freshAtts
+{
+    NSMutableDictionary *existing = [NSMutableDictionary dictionaryWithCapacity:[theGlobalAttributes count]];
+    NSMutableArray *reconciled = [NSMutableArray arrayWithCapacity:[freshAtts count]];
+    NCDFAttribute *anAtt,*mainAtt;
+    int32_t i;
+
+    for(i=0;i<[theGlobalAttributes count];i++)
+        existing[[theGlobalAttributes[i] attributeName]] = theGlobalAttributes[i];
+    for(i=0;i<[freshAtts count];i++)
+    {
+        anAtt = freshAtts[i];
+        mainAtt = existing[[anAtt attributeName]];
+        if(mainAtt)
         {
-            [theDimList addObject:[NSNumber numberWithInt:dimIDs[j]]];
+            [mainAtt updateAttributeWithAttribute:anAtt];
+            [reconciled addObject:mainAtt];
         }
-        theVar = [[NCDFVariable alloc] initWithPath:filePath variableName:[NSString stringWithCString:name encoding:NSUTF8StringEncoding] variableID:i type:theType theDims:theDimList attributeCount:numberOfAttributes handle:self];
-        [typeArrays[2] addObject:theVar];
+        else
+            [reconciled addObject:anAtt];
     }
-    [self closeNCID:ncid];
+    [theGlobalAttributes setArray:reconciled];
+    [self indexGlobalAttributes];
 }
 
-
--(void)createFileAtPath:(NSString *)thePath withSettings:(int)settings
+-(void)reconcileVariables:(NSArray *)freshVars
 {
-    /*Creates a new netcdf file at path.  This method should not be invoked.*/
-    /*Initialization*/
-    //FORMATS
-    /*quoting from manual: The creation mode flag. The following flags are available: NC NOCLOBBER,
-     NC SHARE, NC 64BIT OFFSET, NC NETCDF4, NC CLASSIC MODEL.
-     Setting NC NOCLOBBER means you do not want to clobber (overwrite) an
-     existing dataset; an error (NC EEXIST) is returned if the specified dataset
-     already exists.
-     The NC SHARE*/
-    int32_t status;
-    int32_t ncid;
+    NSMutableDictionary *existing = [NSMutableDictionary dictionaryWithCapacity:[theVariables count]];
+    NSMutableArray *reconciled = [NSMutableArray arrayWithCapacity:[freshVars count]];
+    NCDFVariable *aVar,*mainVar;
+    int32_t i;
 
-    [self setFilePath:thePath];
-    [fileDatabaseLock lock];
-    status = nc_create([thePath UTF8String],settings,&ncid);
-    [fileDatabaseLock unlock];
+    for(i=0;i<[theVariables count];i++)
+        existing[[theVariables[i] variableName]] = theVariables[i];
+    for(i=0;i<[freshVars count];i++)
+    {
+        aVar = freshVars[i];
+        mainVar = existing[[aVar variableName]];
+        if(mainVar)
+        {
+            [mainVar updateVariableWithVariable:aVar];
+            [reconciled addObject:mainVar];
+        }
+        else
+            [reconciled addObject:aVar];
+    }
+    [theVariables setArray:reconciled];
+    [self indexVariables];
+}
+
+-(void)loadDimensionsIfNeeded
+{
+    int32_t ncid,status;
+    BOOL loaded;
+    [self catchUpDefineSession];
+    [_metadataLock lock];
+    loaded = _dimensionsLoaded;
+    [_metadataLock unlock];
+    if(loaded)
+        return;
+    //the ncid is checked out before the metadata lock is taken so the file lock is always acquired first.
+    ncid = [self ncidWithOpenMode:NC_NOWRITE status:&status];
     if(status!=NC_NOERR)
     {
-        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createFileAtPath" subMethod:@"Creating new file" errorCode:status];
-        //NSLog(@"seedArrays: error nc_create");
-        return;
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"loadDimensionsIfNeeded" subMethod:@"Opening file" errorCode:status];
+        return;
+    }
+    [_metadataLock lock];
+    if(!_dimensionsLoaded)
+    {
+        if([self seedDimensions:theDimensions ncid:ncid])
+            _dimensionsLoaded = YES;
+        else
+            [theDimensions removeAllObjects];
+        [self indexDimensions];
+    }
+    [_metadataLock unlock];
+    [self closeNCID:ncid];
+}
+
+-(void)loadGlobalAttributesIfNeeded
+{
+    int32_t ncid,status;
+    BOOL loaded;
+    [self catchUpDefineSession];
+    [_metadataLock lock];
+    loaded = _globalAttributesLoaded;
+    [_metadataLock unlock];
+    if(loaded)
+        return;
+    ncid = [self ncidWithOpenMode:NC_NOWRITE status:&status];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"loadGlobalAttributesIfNeeded" subMethod:@"Opening file" errorCode:status];
+        return;
+    }
+    [_metadataLock lock];
+    if(!_globalAttributesLoaded)
+    {
+        if([self seedGlobalAttributes:theGlobalAttributes ncid:ncid])
+            _globalAttributesLoaded = YES;
+        else
+            [theGlobalAttributes removeAllObjects];
+        [self indexGlobalAttributes];
+    }
+    [_metadataLock unlock];
+    [self closeNCID:ncid];
+}
+
+-(void)loadVariablesIfNeeded
+{
+    int32_t ncid,status;
+    BOOL loaded;
+    [self catchUpDefineSession];
+    [_metadataLock lock];
+    loaded = _variablesLoaded;
+    [_metadataLock unlock];
+    if(loaded)
+        return;
+    ncid = [self ncidWithOpenMode:NC_NOWRITE status:&status];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"loadVariablesIfNeeded" subMethod:@"Opening file" errorCode:status];
+        return;
+    }
+    [_metadataLock lock];
+    if(!_variablesLoaded)
+    {
+        if([self seedVariables:theVariables ncid:ncid])
+            _variablesLoaded = YES;
+        else
+            [theVariables removeAllObjects];
+        [self indexVariables];
+    }
+    [_metadataLock unlock];
+    [self closeNCID:ncid];
+}
+
+-(void)loadMetadataIfNeeded
+{
+    [self loadDimensionsIfNeeded];
+    [self loadGlobalAttributesIfNeeded];
+    [self loadVariablesIfNeeded];
+}
+
+-(void)catchUpDefineSession
+{
+    NSMutableArray *tempDim,*tempAtt,*tempVar;
+    if(!_defineSessionNeedsRefresh || ![self isInDefineSession])
+        return;
+    //cleared first, since reconciling looks the metadata up again.
+    _defineSessionNeedsRefresh = NO;
+    if(_dimensionsLoaded)
+    {
+        tempDim = [[NSMutableArray alloc] init];
+        if([self seedDimensions:tempDim ncid:_defineSessionNCID])
+            [self reconcileDimensions:tempDim];
+    }
+    if(_globalAttributesLoaded)
+    {
+        tempAtt = [[NSMutableArray alloc] init];
+        if([self seedGlobalAttributes:tempAtt ncid:_defineSessionNCID])
+            [self reconcileGlobalAttributes:tempAtt];
+    }
+    if(_variablesLoaded)
+    {
+        tempVar = [[NSMutableArray alloc] init];
+        if([self seedVariables:tempVar ncid:_defineSessionNCID])
+            [self reconcileVariables:tempVar];
+    }
+}
+
+-(void)indexDimensions
+{
+    int32_t i;
+    _dimensionsByName = [[NSMutableDictionary alloc] initWithCapacity:[theDimensions count]];
+    for(i=0;i<[theDimensions count];i++)
+        _dimensionsByName[[theDimensions[i] dimensionName]] = theDimensions[i];
+    _dimensionsIndexedMutations = ((NCDFIndexedArray *)theDimensions)->mutationCount;
+}
+
+-(void)indexGlobalAttributes
+{
+    int32_t i;
+    _globalAttributesByName = [[NSMutableDictionary alloc] initWithCapacity:[theGlobalAttributes count]];
+    for(i=0;i<[theGlobalAttributes count];i++)
+        _globalAttributesByName[[theGlobalAttributes[i] attributeName]] = theGlobalAttributes[i];
+    _globalAttributesIndexedMutations = ((NCDFIndexedArray *)theGlobalAttributes)->mutationCount;
+}
+
+-(void)indexVariables
+{
+    int32_t i;
+    _variablesByName = [[NSMutableDictionary alloc] initWithCapacity:[theVariables count]];
+    for(i=0;i<[theVariables count];i++)
+        _variablesByName[[theVariables[i] variableName]] = theVariables[i];
+    _variablesIndexedMutations = ((NCDFIndexedArray *)theVariables)->mutationCount;
+}
+
+-(void)createFileAtPath:(NSString *)thePath withSettings:(int)settings
+{
+    /*Creates a new netcdf file at path.  This method should not be invoked.*/
+    /*Initialization*/
+    //FORMATS
+    /*quoting from manual: The creation mode flag. The following flags are available: NC NOCLOBBER,
+     NC SHARE, NC 64BIT OFFSET, NC NETCDF4, NC CLASSIC MODEL.
+     Setting NC NOCLOBBER means you do not want to clobber (overwrite) an
+     existing dataset; an error (NC EEXIST) is returned if the specified dataset
+     already exists.
+     The NC SHARE*/
+    int32_t status;
+    int32_t ncid;
+
+    [self setFilePath:thePath];
+    [_fileLock lockForWriting];
+    pthread_rwlock_wrlock(&ncLibraryLock);
+    status = nc_create([thePath UTF8String],settings,&ncid);
+    pthread_rwlock_unlock(&ncLibraryLock);
+    if(status!=NC_NOERR)
+    {
+        [_fileLock unlockForWriting];
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createFileAtPath" subMethod:@"Creating new file" errorCode:status];
+        //NSLog(@"seedArrays: error nc_create");
+        return;
+    }
+    //the new file is in define mode.  Pool it as a writable ncid so that releasing it ends define mode and the following edits reuse it.
+    NCDFPooledNCID *entry = [[NCDFPooledNCID alloc] init];
+    entry->ncid = ncid;
+    entry->openMode = NC_WRITE;
+    entry->inUse = YES;
+    entry->owner = self;
+    entry->checkedOutForWriting = YES;
+    entry->lockedForWriting = YES;
+    entry->writeGeneration = [_fileLock writeGeneration];
+    [_ncidPoolLock lock];
+    [_ncidPool addObject:entry];
+    [_ncidPoolLock unlock];
+    [self closeNCID:ncid];
+}
+
+-(int)endDefineModeForNCID:(int)ncid
+{
+    /*h_minfree keeps room after the header so that later additions fit without moving the data.  v_minfree is left at 0; record data always follows the fixed size variables.*/
+    return nc__enddef(ncid,_headerFreeSpace,_variableAlignment,0,_recordAlignment);
+}
+
+-(int)writeFillValuesToRecords:(size_t)recordStart count:(size_t)recordCount variableID:(int)varID ncid:(int)ncid
+{
+    int32_t status,ndims,i;
+    int dimIDs[NC_MAX_VAR_DIMS];
+    nc_type type,attType;
+    size_t start[NC_MAX_VAR_DIMS],count[NC_MAX_VAR_DIMS],attLength,typeSize,valueCount,r,v;
+    char fillValue[8];
+    NSMutableData *record;
+
+    status = nc_inq_vartype(ncid,varID,&type);
+    if(status==NC_NOERR)
+        status = nc_inq_varndims(ncid,varID,&ndims);
+    if(status==NC_NOERR)
+        status = nc_inq_vardimid(ncid,varID,dimIDs);
+    if(status!=NC_NOERR)
+        return status;
+    typeSize = NCDFSizeOfType(type);
+    switch(type)
+    {
+        case NC_BYTE:
+            *(signed char *)fillValue = NC_FILL_BYTE;
+            break;
+        case NC_CHAR:
+            *(char *)fillValue = NC_FILL_CHAR;
+            break;
+        case NC_SHORT:
+            *(short *)fillValue = NC_FILL_SHORT;
+            break;
+        case NC_INT:
+            *(int *)fillValue = NC_FILL_INT;
+            break;
+        case NC_FLOAT:
+            *(float *)fillValue = NC_FILL_FLOAT;
+            break;
+        case NC_DOUBLE:
+            *(double *)fillValue = NC_FILL_DOUBLE;
+            break;
+        default:
+            return NC_EBADTYPE;
+    }
+    if(nc_inq_att(ncid,varID,"_FillValue",&attType,&attLength)==NC_NOERR && attType==type && attLength==1)
+        nc_get_att(ncid,varID,"_FillValue",fillValue);
+    //one record at a time, so the buffer stays the size of a record.
+    valueCount = 1;
+    start[0] = 0;
+    count[0] = 1;
+    for(i=1;i<ndims && status==NC_NOERR;i++)
+    {
+        start[i] = 0;
+        status = nc_inq_dimlen(ncid,dimIDs[i],&count[i]);
+        valueCount *= count[i];
+    }
+    if(status!=NC_NOERR)
+        return status;
+    record = [NSMutableData dataWithLength:valueCount*typeSize];
+    for(v=0;v<valueCount;v++)
+        memcpy((char *)[record mutableBytes]+v*typeSize,fillValue,typeSize);
+    for(r=0;r<recordCount && status==NC_NOERR;r++)
+    {
+        start[0] = recordStart+r;
+        status = nc_put_vara(ncid,varID,start,count,[record bytes]);
+    }
+    return status;
+}
+
+-(void)setCachedLength:(size_t)newLength ofUnlimitedDimensionID:(int)unlimitedID
+{
+    NCDFDimension *unlimitedDim;
+    if(!_dimensionsLoaded)
+        return;
+    unlimitedDim = [self retrieveDimensionByIndex:unlimitedID];
+    if(unlimitedDim)
+        [unlimitedDim updateDimensionWithDimension:[[NCDFDimension alloc] initWithFileName:filePath dimID:unlimitedID name:[unlimitedDim dimensionName] length:newLength handle:self]];
+}
+
+#ifdef NCDF4
+-(void)setupInMemoryNCID:(int)ncid readOnly:(BOOL)readOnly persists:(BOOL)persists
+{
+    int format;
+    _inMemory = YES;
+    _memoryNCID = ncid;
+    _memoryReadOnly = readOnly;
+    _persistsMemory = persists;
+    _memoryPersistPath = (persists ? filePath : nil);
+    _memoryCheckouts = [[NSMutableDictionary alloc] init];
+    _memorySharedReads = (nc_inq_format(ncid,&format)==NC_NOERR && (format==NC_FORMAT_CLASSIC || format==NC_FORMAT_64BIT));
+    //NC_SHARE only matters to files that other processes can see.
+    _sharedAccess = NO;
+    _fileLock = [NCDFFileLock fileLockForPath:[NSString stringWithFormat:@"/inmemory/%@.nc",[[NSUUID UUID] UUIDString]]];
+}
+
+-(int)checkOutInMemoryNCIDForWriting:(BOOL)forWriting status:(int32_t *)status
+{
+    NSNumber *threadKey = [NSNumber numberWithUnsignedLongLong:(unsigned long long)(uintptr_t)pthread_self()];
+    NCDFMemoryCheckout *checkout;
+    if(forWriting && _memoryReadOnly)
+    {
+        *status = NC_EPERM;
+        return -1;
+    }
+    if(!_memorySharedReads)
+        forWriting = YES;
+    [_ncidPoolLock lock];
+    checkout = _memoryCheckouts[threadKey];
+    if(!checkout)
+    {
+        checkout = [[NCDFMemoryCheckout alloc] init];
+        _memoryCheckouts[threadKey] = checkout;
+    }
+    [_ncidPoolLock unlock];
+    if(forWriting && !checkout->writeLocked)
+    {
+        [_fileLock lockForWriting];
+        checkout->writeLocked = YES;
+    }
+    else if(!forWriting && !checkout->readLocked && !checkout->writeLocked)
+    {
+        [_fileLock lockForReading];
+        checkout->readLocked = YES;
+    }
+    checkout->count++;
+    if(_memoryNCID<0)
+    {
+        [self checkInInMemoryNCID:-1];
+        *status = NC_EBADID;
+        return -1;
+    }
+    *status = NC_NOERR;
+    return _memoryNCID;
+}
+
+-(void)checkInInMemoryNCID:(int)ncid
+{
+    NSNumber *threadKey = [NSNumber numberWithUnsignedLongLong:(unsigned long long)(uintptr_t)pthread_self()];
+    NCDFMemoryCheckout *checkout;
+    int32_t status;
+    [_ncidPoolLock lock];
+    checkout = _memoryCheckouts[threadKey];
+    if(checkout)
+    {
+        checkout->count--;
+        if(checkout->count==0)
+            [_memoryCheckouts removeObjectForKey:threadKey];
+    }
+    [_ncidPoolLock unlock];
+    if(!checkout || checkout->count>0)
+        return;
+    if(checkout->writeLocked)
+    {
+        //the thread's last writable checkout has been returned, and nobody else can hold the ncid.
+        if(!_memoryReadOnly && _memoryNCID>=0)
+        {
+            status = [self endDefineModeForNCID:_memoryNCID];
+            if(status!=NC_NOERR && status!=NC_ENOTINDEFINE)
+                [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"closeNCID" subMethod:@"Ending define mode" errorCode:status];
+        }
+        [_fileLock unlockForWriting];
+    }
+    if(checkout->readLocked)
+        [_fileLock unlockForReading];
+}
+
+-(void)adoptInMemoryDatasetOfHandle:(NCDFHandle *)aHandle
+{
+    int32_t status;
+    [_fileLock lockForWriting];
+    pthread_rwlock_wrlock(&ncLibraryLock);
+    status = nc_close(_memoryNCID);
+    pthread_rwlock_unlock(&ncLibraryLock);
+    if(status != NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"adoptInMemoryDatasetOfHandle" subMethod:@"Closing replaced dataset" errorCode:status];
+    }
+    _memoryNCID = aHandle->_memoryNCID;
+    _memorySharedReads = aHandle->_memorySharedReads;
+    //the new dataset persists to the temporary path it was created under; closeInMemoryDataset moves it over filePath.
+    _memoryPersistPath = aHandle->_memoryPersistPath;
+    _memoryData = nil;
+    aHandle->_memoryNCID = -1;
+    aHandle->_memoryPersistPath = nil;
+    [_fileLock unlockForWriting];
+}
+#endif
+
+-(BOOL)openInMemoryDatasetWithData:(NSData *)data atPath:(NSString *)thePath create:(BOOL)create settings:(int)settings persist:(BOOL)persist methodName:(NSString *)methodName
+{
+    int32_t status,errorCount;
+    NSString *subMethod;
+#ifdef NCDF4
+    int32_t ncid;
+#endif
+    theErrorHandle = [[NCDFErrorHandle alloc] init];
+    [self setupNCIDPool];
+    _rewriteMemoryCeiling = NCDFHandleDefaultRewriteMemoryCeiling;
+    _headerFreeSpace = NCDFHandleDefaultHeaderFreeSpace;
+    _variableAlignment = NCDFHandleDefaultAlignment;
+    _recordAlignment = NCDFHandleDefaultAlignment;
+    handleLock = [[NSLock alloc] init];
+    //without a file, the name only identifies the dataset in errors and to the file lock.
+    [self setFilePath:(thePath ? thePath : [NSString stringWithFormat:@"/inmemory/%@.nc",[[NSUUID UUID] UUIDString]])];
+    errorCount = [theErrorHandle errorCount];
+    subMethod = (data ? @"Opening memory" : (create ? @"Creating dataset" : @"Opening file"));
+#ifdef NCDF4
+    _memoryData = [data copy];
+    pthread_rwlock_wrlock(&ncLibraryLock);
+    if(data)
+        status = nc_open_mem([filePath UTF8String],NC_NOWRITE,[_memoryData length],(void *)[_memoryData bytes],&ncid);
+    else if(create)
+        status = nc_create([filePath UTF8String],settings|NC_DISKLESS|(persist ? NC_PERSIST : 0),&ncid);
+    else
+        status = nc_open([filePath UTF8String],NC_WRITE|NC_DISKLESS|(persist ? NC_PERSIST : 0),&ncid);
+    pthread_rwlock_unlock(&ncLibraryLock);
+    if(status==NC_NOERR)
+    {
+        [self setupInMemoryNCID:ncid readOnly:(data!=nil) persists:persist];
+        if(create)
+        {
+            //the new dataset is in define mode.
+            status = [self endDefineModeForNCID:ncid];
+            if(status!=NC_NOERR)
+                subMethod = @"Ending define mode";
+        }
+    }
+#else
+    //the bundled netcdf 3.6 library can neither open memory nor keep a dataset off disk.
+    status = ENOTSUP;
+    subMethod = [subMethod stringByAppendingString:@" without netCDF-4"];
+#endif
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:methodName subMethod:subMethod errorCode:status];
+        [theErrorHandle logAllErrors];
+        return NO;
+    }
+    [self initializeArrays];
+    if(errorCount<[theErrorHandle errorCount])
+    {
+        [theErrorHandle logAllErrors];
+        return NO;
+    }
+    return YES;
+}
+
+-(void)setupNCIDPool
+{
+    _ncidPool = [[NSMutableArray alloc] init];
+    _ncidPoolLock = [[NSLock alloc] init];
+    _metadataLock = [[NSRecursiveLock alloc] init];
+    _ncidIdleTimeout = NCDFHandleDefaultNCIDIdleTimeout;
+    _ncidPurgeScheduled = NO;
+    _sharedAccess = YES;
+#ifdef NCDF4
+    _memoryNCID = -1;
+#endif
+    _inMemory = NO;
+}
+
+-(NCDFPooledNCID *)pooledNCIDForNCID:(int)ncid
+{
+    int32_t i;
+    for(i=0;i<[_ncidPool count];i++)
+    {
+        NCDFPooledNCID *entry = _ncidPool[i];
+        if(entry->ncid==ncid)
+            return entry;
+    }
+    return nil;
+}
+
+-(void)recordFileSignatureForPooledNCID:(NCDFPooledNCID *)entry
+{
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:filePath error:nil];
+    entry->fileModificationDate = [attributes fileModificationDate];
+    entry->fileSize = [attributes fileSize];
+    entry->lastValidated = [NSDate timeIntervalSinceReferenceDate];
+}
+
+-(BOOL)fileSignatureMatchesPooledNCID:(NCDFPooledNCID *)entry
+{
+    NSDictionary *attributes;
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    if(entry->fileModificationDate && now-entry->lastValidated<NCDFHandleFileSignatureInterval)
+        return YES;
+    attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:filePath error:nil];
+    if(!attributes || !entry->fileModificationDate)
+        return NO;
+    if(![[attributes fileModificationDate] isEqualToDate:entry->fileModificationDate])
+        return NO;
+    if([attributes fileSize]!=entry->fileSize)
+        return NO;
+    entry->lastValidated = now;
+    return YES;
+}
+
+-(void)closePooledNCID:(NCDFPooledNCID *)entry
+{
+    int32_t status;
+    pthread_rwlock_wrlock(&ncLibraryLock);
+    status = nc_close(entry->ncid);
+    pthread_rwlock_unlock(&ncLibraryLock);
+    if(status != NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"closePooledNCID" subMethod:@"Closing netCDF file" errorCode:status];
+    }
+    [_ncidPool removeObject:entry];
+}
+
+-(void)scheduleIdleNCIDPurge
+{
+    __weak NCDFHandle *weakSelf = self;
+    NSTimeInterval timeout;
+    [_ncidPoolLock lock];
+    if(_ncidPurgeScheduled || _ncidIdleTimeout<=0.0 || [_ncidPool count]==0)
+    {
+        [_ncidPoolLock unlock];
+        return;
+    }
+    _ncidPurgeScheduled = YES;
+    timeout = _ncidIdleTimeout;
+    [_ncidPoolLock unlock];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW,(int64_t)(timeout*NSEC_PER_SEC)),dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW,0),^{
+        [weakSelf purgeIdleNCIDs];
+    });
+}
+
+-(void)purgeIdleNCIDs
+{
+    int32_t i;
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    [_ncidPoolLock lock];
+    _ncidPurgeScheduled = NO;
+    for(i=(int32_t)[_ncidPool count]-1;i>=0;i--)
+    {
+        NCDFPooledNCID *entry = _ncidPool[i];
+        if(!entry->inUse && now-entry->lastUsed>=_ncidIdleTimeout)
+            [self closePooledNCID:entry];
+    }
+    [_ncidPoolLock unlock];
+    [self scheduleIdleNCIDPurge];
+}
+
+-(NCDFRewritePlan *)rewritePlanForEdit
+{
+    if([self isInEditSession])
+        return _editSessionPlan;
+    return [[NCDFRewritePlan alloc] init];
+}
+
+-(BOOL)applyRewritePlan:(NCDFRewritePlan *)plan methodName:(NSString *)methodName
+{
+    if(plan==_editSessionPlan && [self isInEditSession])
+        return YES;
+    return [self rewriteFileWithPlan:plan methodName:methodName];
+}
+
+-(BOOL)rewriteFileWithPlan:(NCDFRewritePlan *)plan methodName:(NSString *)methodName
+{
+    NSFileManager *theManager = [NSFileManager defaultManager];
+    NCDFHandle *newHandle;
+    NSString *tempPath = [filePath stringByAppendingString:@"_.nc"];
+    NSArray *omitDimNames = [plan->omittedDimensions allObjects];
+    NSMutableArray *survivingVariables = [[NSMutableArray alloc] init];
+    NSMutableArray *survivingNames = [[NSMutableArray alloc] init];
+    NSMutableArray *globalAttributes = [[NSMutableArray alloc] init];
+    NSMutableDictionary *aPropertyList;
+    NSMutableArray *dimNames;
+    NSDictionary *anEdit;
+    NCDFVariable *aVar;
+    BOOL keep;
+    int32_t i,j,errorCount,newErrorCount,status,srcNCID,dstNCID,srcVarID,dstVarID,nAtts,ndims,dstUnlimitedID;
+    int srcDimIDs[NC_MAX_VAR_DIMS],dstDimIDs[NC_MAX_VAR_DIMS];
+    size_t shape[NC_MAX_VAR_DIMS],srcLength,dstLength;
+    char varCName[NC_MAX_NAME+1],attCName[NC_MAX_NAME+1];
+    int format,settings;
+    BOOL inMemory = NO;
+
+    [self loadMetadataIfNeeded];
+    errorCount = [theErrorHandle errorCount];
+    //the new file keeps the format of the old one, so netCDF-4 storage settings can be recreated and classic files are not upgraded.
+    srcNCID = [self ncidWithOpenMode:NC_NOWRITE status:&status];
+    if(status==NC_NOERR)
+    {
+        status = nc_inq_format(srcNCID,&format);
+        [self closeNCID:srcNCID];
+    }
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:methodName subMethod:@"Inquiring format" errorCode:status];
+        return NO;
+    }
+    switch(format)
+    {
+        case NC_FORMAT_64BIT:
+            settings = NC_CLOBBER|NC_64BIT_OFFSET;
+            break;
+#ifdef NCDF4
+        case NC_FORMAT_NETCDF4:
+            settings = NC_CLOBBER|NC_NETCDF4;
+            break;
+        case NC_FORMAT_NETCDF4_CLASSIC:
+            settings = NC_CLOBBER|NC_NETCDF4|NC_CLASSIC_MODEL;
+            break;
+#endif
+        default:
+            settings = NC_CLOBBER;
+            break;
+    }
+    if(_memoryReadOnly)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:methodName subMethod:@"Rewriting read-only memory" errorCode:NC_EPERM];
+        return NO;
+    }
+    while([theManager fileExistsAtPath:tempPath])
+    {
+        tempPath = [tempPath stringByAppendingString:@"_.nc"];
+    }
+#ifdef NCDF4
+    inMemory = _inMemory;
+    if(inMemory)
+    {
+        //a persistent dataset is rebuilt under the temporary path, not over the dataset still open at filePath.  closeInMemoryDataset moves it into place.
+        newHandle = [[NCDFHandle alloc] initDisklessByCreatingFileAtPath:tempPath withSettings:settings persist:_persistsMemory];
+    }
+    else
+#endif
+    {
+        newHandle = [[NCDFHandle alloc] initByCreatingFileAtPath:tempPath withSettings:settings headerFreeSpace:_headerFreeSpace];
+    }
+    if(!newHandle)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:methodName subMethod:@"Creating temporary file" errorCode:NC_EPERM];
+        return NO;
+    }
+    [newHandle setHeaderFreeSpace:_headerFreeSpace];
+    [newHandle setVariableAlignment:_variableAlignment recordAlignment:_recordAlignment];
+    newErrorCount = [[newHandle theErrorHandle] errorCount];
+    srcNCID = [self ncidWithOpenMode:NC_NOWRITE status:&status];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:methodName subMethod:@"Opening file" errorCode:status];
+        [newHandle closeAll];
+        //a persistent in-memory dataset writes itself to tempPath when it is closed.
+        if(inMemory)
+            [newHandle closeInMemoryDataset];
+        [theManager removeItemAtPath:tempPath error:nil];
+        return NO;
+    }
+    //Step 1. Header
+    [newHandle beginDefineSession];
+    for(i=0;i<[theGlobalAttributes count];i++)
+    {
+        [globalAttributes addObject:[theGlobalAttributes[i] propertyList]];
+    }
+    //edited attributes keep their place, new ones go last.
+    for(i=0;i<[plan->globalAttributeEdits count];i++)
+    {
+        anEdit = plan->globalAttributeEdits[i];
+        for(j=0;j<[globalAttributes count];j++)
+        {
+            if([globalAttributes[j][@"attributeName"] isEqualToString:anEdit[@"attributeName"]])
+                break;
+        }
+        if(j<[globalAttributes count])
+        {
+            if(anEdit[@"values"])
+                [globalAttributes replaceObjectAtIndex:j withObject:anEdit];
+            else
+                [globalAttributes removeObjectAtIndex:j];
+        }
+        else if(anEdit[@"values"])
+            [globalAttributes addObject:anEdit];
+    }
+    for(i=0;i<[globalAttributes count];i++)
+    {
+        [newHandle createNewGlobalAttributeWithPropertyList:globalAttributes[i]];
+    }
+    for(i=0;i<[theDimensions count];i++)
+    {
+        NSString *dimName = [theDimensions[i] dimensionName];
+        if([plan->omittedDimensions containsObject:dimName])
+            continue;
+        aPropertyList = [NSMutableDictionary dictionaryWithDictionary:[theDimensions[i] propertyList]];
+        if(plan->dimensionRenames[dimName])
+            [aPropertyList setObject:plan->dimensionRenames[dimName] forKey:@"dimName"];
+        if(plan->dimensionLengths[dimName])
+            [aPropertyList setObject:plan->dimensionLengths[dimName] forKey:@"length"];
+        [newHandle createNewDimensionWithPropertyList:aPropertyList];
+    }
+    for(i=0;i<[theVariables count];i++)
+    {
+        aVar = theVariables[i];
+        keep = ![plan->omittedVariables containsObject:[aVar variableName]];
+        for(j=0;j<[omitDimNames count] && keep;j++)
+        {
+            if([aVar doesVariableUseDimensionName:omitDimNames[j]])
+                keep = NO;
+        }
+        if(!keep)
+            continue;
+        aPropertyList = [NSMutableDictionary dictionaryWithDictionary:[aVar definitionPropertyList]];
+        if(plan->variableRenames[[aVar variableName]])
+            [aPropertyList setObject:plan->variableRenames[[aVar variableName]] forKey:@"variableName"];
+        dimNames = [NSMutableArray arrayWithArray:aPropertyList[@"dimNames"]];
+        for(j=0;j<[dimNames count];j++)
+        {
+            if(plan->dimensionRenames[dimNames[j]])
+                [dimNames replaceObjectAtIndex:j withObject:plan->dimensionRenames[dimNames[j]]];
+        }
+        [aPropertyList setObject:dimNames forKey:@"dimNames"];
+        if([newHandle createNewVariableWithPropertyList:aPropertyList])
+        {
+            [survivingVariables addObject:aVar];
+            [survivingNames addObject:aPropertyList[@"variableName"]];
+        }
+        else
+        {
+            //a variable that cannot be recreated would be lost, so the rewrite fails instead.
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:methodName subMethod:[NSString stringWithFormat:@"Defining variable %@",[aVar variableName]] errorCode:NC_EINVAL];
+        }
+    }
+    //variable property lists do not carry their attributes into the new file, so they are copied directly.
+    dstNCID = [newHandle ncidForDefineWithStatus:&status];
+    for(i=0;i<[survivingVariables count] && status==NC_NOERR;i++)
+    {
+        aVar = survivingVariables[i];
+        srcVarID = [aVar variableID];
+        nAtts = 0;
+        [survivingNames[i] getCString:varCName maxLength:NC_MAX_NAME+1 encoding:NSUTF8StringEncoding];
+        status = nc_inq_varid(dstNCID,varCName,&dstVarID);
+        if(status==NC_NOERR)
+            status = nc_inq_varnatts(srcNCID,srcVarID,&nAtts);
+        for(j=0;j<nAtts && status==NC_NOERR;j++)
+        {
+            status = nc_inq_attname(srcNCID,srcVarID,j,attCName);
+            if(status==NC_NOERR)
+                status = nc_copy_att(srcNCID,srcVarID,attCName,dstNCID,dstVarID);
+        }
+    }
+    if(status!=NC_NOERR)
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:methodName subMethod:@"Copying variable attributes" errorCode:status];
+    [newHandle closeNCID:dstNCID];
+    [newHandle commitDefineSession];
+    //variable attribute edits from an edit session are made on top of the copied attributes, in the order they were made.
+    for(i=0;i<[survivingVariables count];i++)
+    {
+        NSArray *attributeEdits = plan->variableAttributeEdits[[survivingVariables[i] variableName]];
+        NCDFVariable *newVar = nil;
+        if([attributeEdits count]>0)
+            newVar = [newHandle retrieveVariableByName:survivingNames[i]];
+        for(j=0;j<[attributeEdits count] && newVar;j++)
+        {
+            anEdit = attributeEdits[j];
+            if(anEdit[@"values"])
+                [newVar createNewVariableAttributePropertyList:anEdit];
+            else
+                [newVar deleteVariableAttributeByName:anEdit[@"attributeName"]];
+        }
+    }
+    //Step 2. Data
+    if(errorCount==[theErrorHandle errorCount] && newErrorCount==[[newHandle theErrorHandle] errorCount])
+    {
+        dstNCID = [newHandle ncidWithOpenMode:NC_WRITE status:&status];
+        if(status!=NC_NOERR)
+        {
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:methodName subMethod:@"Opening temporary file" errorCode:status];
+        }
+        else
+        {
+            status = nc_inq_unlimdim(dstNCID,&dstUnlimitedID);
+            for(i=0;i<[survivingVariables count] && status==NC_NOERR;i++)
+            {
+                aVar = survivingVariables[i];
+                srcVarID = [aVar variableID];
+                ndims = 0;
+                [survivingNames[i] getCString:varCName maxLength:NC_MAX_NAME+1 encoding:NSUTF8StringEncoding];
+                status = nc_inq_varid(dstNCID,varCName,&dstVarID);
+                if(status==NC_NOERR)
+                    status = nc_inq_varndims(dstNCID,dstVarID,&ndims);
+                if(status==NC_NOERR)
+                    status = nc_inq_vardimid(dstNCID,dstVarID,dstDimIDs);
+                if(status==NC_NOERR)
+                    status = nc_inq_vardimid(srcNCID,srcVarID,srcDimIDs);
+                for(j=0;j<ndims && status==NC_NOERR;j++)
+                {
+                    status = nc_inq_dimlen(srcNCID,srcDimIDs[j],&srcLength);
+                    if(status==NC_NOERR)
+                        status = nc_inq_dimlen(dstNCID,dstDimIDs[j],&dstLength);
+                    //the new file has no records yet, so every existing record is copied.
+                    if(dstDimIDs[j]==dstUnlimitedID)
+                        dstLength = srcLength;
+                    shape[j] = (srcLength<dstLength)?srcLength:dstLength;
+                }
+                if(status==NC_NOERR)
+                    status = NCDFCopyVariableData(srcNCID,srcVarID,dstNCID,dstVarID,ndims,shape,_rewriteMemoryCeiling);
+            }
+            if(status!=NC_NOERR)
+                [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:methodName subMethod:@"Copying variable data" errorCode:status];
+            [newHandle closeNCID:dstNCID];
+        }
+    }
+    [self closeNCID:srcNCID];
+    for(i=newErrorCount;i<[[newHandle theErrorHandle] errorCount];i++)
+    {
+        [theErrorHandle addError:[[newHandle theErrorHandle] errorAtIndex:i]];
+    }
+    if(errorCount<[theErrorHandle errorCount])
+    {
+        [newHandle closeAll];
+        //a persistent in-memory dataset writes itself to tempPath when it is closed.
+        if(inMemory)
+            [newHandle closeInMemoryDataset];
+        [theManager removeItemAtPath:tempPath error:nil];
+        return NO;
+    }
+    else
+    {
+        [newHandle closeAll];
+        /*Readers of this or any other handle on the file wait until the new file is in place, and releasing the write lock moves the file on to a new generation, so pooled ncids, mappings and cached blocks of the old file are all dropped before their next use.*/
+        [_fileLock lockForWriting];
+        [self closeAll];
+        status = NC_NOERR;
+#ifdef NCDF4
+        if(inMemory)
+            [self adoptInMemoryDatasetOfHandle:newHandle];
+        else
+#endif
+        {
+            //rename replaces the old file in one step, so other processes see either file but never neither.
+            if(rename([tempPath fileSystemRepresentation],[filePath fileSystemRepresentation])!=0)
+                status = NC_EPERM;
+        }
+        //blocks of the old file can never be hit again, so their memory is given back now.
+        [[NCDFBlockCache sharedCache] removeBlocksForPath:[_fileLock path]];
+        [_fileLock unlockForWriting];
+        if(status!=NC_NOERR)
+        {
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:methodName subMethod:@"Replacing file" errorCode:status];
+            [theManager removeItemAtPath:tempPath error:nil];
+            return NO;
+        }
+        [self refresh];
+        return YES;
     }
-    [self closeNCID:ncid];
 }
 
 @end
@@ -202,12 +1548,6 @@ static NSLock *fileDatabaseLock;
 
 #pragma mark *** Initilization methods ***
 
-+ (void)initialize
-{
-    fileDatabaseLock = [[NSLock alloc] init];
-    NSAssert( fileDatabaseLock != nil, @"Could not create fileDatabaseLock");
-}
-
 -(id)initWithFileAtPath:(NSString *)thePath
 {
     /*Initializes a NCDFHandle from an existing file at thePath*/
@@ -217,8 +1557,14 @@ static NSLock *fileDatabaseLock;
     self = [super init];
     //added 0.2.1d1
     theErrorHandle = [[NCDFErrorHandle alloc] init];
+    [self setupNCIDPool];
+    _rewriteMemoryCeiling = NCDFHandleDefaultRewriteMemoryCeiling;
+    _headerFreeSpace = NCDFHandleDefaultHeaderFreeSpace;
+    _variableAlignment = NCDFHandleDefaultAlignment;
+    _recordAlignment = NCDFHandleDefaultAlignment;
 
     errorCount = [theErrorHandle errorCount];
+    handleLock = [[NSLock alloc] init];
     [self setFilePath:thePath];
     [self initializeArrays];
     if(errorCount<[theErrorHandle errorCount])
@@ -230,7 +1576,51 @@ static NSLock *fileDatabaseLock;
         return self;
 }
 
+-(id)initLazilyWithFileAtPath:(NSString *)thePath
+{
+    /*Initializes a NCDFHandle from an existing file at thePath without seeding its metadata.  The arrays are filled by the accessors on first use.*/
+    /*Initialization*/
+    int32_t ncid,status;
+
+    self = [super init];
+    theErrorHandle = [[NCDFErrorHandle alloc] init];
+    [self setupNCIDPool];
+    _rewriteMemoryCeiling = NCDFHandleDefaultRewriteMemoryCeiling;
+    _headerFreeSpace = NCDFHandleDefaultHeaderFreeSpace;
+    _variableAlignment = NCDFHandleDefaultAlignment;
+    _recordAlignment = NCDFHandleDefaultAlignment;
+    _sharedAccess = NO;
+    handleLock = [[NSLock alloc] init];
+    [self setFilePath:thePath];
+    theVariables = [[NCDFIndexedArray alloc] init];
+    theGlobalAttributes = [[NCDFIndexedArray alloc] init];
+    theDimensions = [[NCDFIndexedArray alloc] init];
+    _unlimitedDimensionID = -1;
+    ncid = [self ncidWithOpenMode:NC_NOWRITE status:&status];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"initLazilyWithFileAtPath" subMethod:@"Opening file" errorCode:status];
+        [theErrorHandle logAllErrors];
+        return nil;
+    }
+    //the header counts are all that is read up front.
+    status = nc_inq(ncid,NULL,NULL,NULL,&_unlimitedDimensionID);
+    [self closeNCID:ncid];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"initLazilyWithFileAtPath" subMethod:@"Inquiring netCDF file" errorCode:status];
+        [theErrorHandle logAllErrors];
+        return nil;
+    }
+    return self;
+}
+
 -(id)initByCreatingFileAtPath:(NSString *)thePath withSettings:(int)settings
+{
+    return [self initByCreatingFileAtPath:thePath withSettings:settings headerFreeSpace:NCDFHandleDefaultHeaderFreeSpace];
+}
+
+-(id)initByCreatingFileAtPath:(NSString *)thePath withSettings:(int)settings headerFreeSpace:(size_t)bytes
 {
     /*Creates a NCDFHandle and netcdf file at thePath.  This file is empty and must be populated with dimensions, attributes, and variables*/
     /*Initialization*/
@@ -239,6 +1629,12 @@ static NSLock *fileDatabaseLock;
     self = [super init];
     //added 0.2.1d1
     theErrorHandle =[[NCDFErrorHandle alloc] init];
+    [self setupNCIDPool];
+    _rewriteMemoryCeiling = NCDFHandleDefaultRewriteMemoryCeiling;
+    //set before the file is created so that the first header written already has room to grow.
+    _headerFreeSpace = bytes;
+    _variableAlignment = NCDFHandleDefaultAlignment;
+    _recordAlignment = NCDFHandleDefaultAlignment;
     errorCount = [theErrorHandle errorCount];
     [self createFileAtPath:thePath withSettings:settings];
     if(errorCount<[theErrorHandle errorCount])
@@ -266,6 +1662,11 @@ static NSLock *fileDatabaseLock;
     self = [super init];
     //added 0.2.1d1
     theErrorHandle =[[NCDFErrorHandle alloc] init];
+    [self setupNCIDPool];
+    _rewriteMemoryCeiling = NCDFHandleDefaultRewriteMemoryCeiling;
+    _headerFreeSpace = NCDFHandleDefaultHeaderFreeSpace;
+    _variableAlignment = NCDFHandleDefaultAlignment;
+    _recordAlignment = NCDFHandleDefaultAlignment;
     errorCount = [theErrorHandle errorCount];
     [self createFileAtPath:thePath withSettings:NC_CLOBBER];
     if(errorCount<[theErrorHandle errorCount])
@@ -284,6 +1685,36 @@ static NSLock *fileDatabaseLock;
     return self;
 }
 
+-(id)initWithData:(NSData *)data
+{
+    /*Initializes a read-only NCDFHandle for a netcdf file held in memory.  The library reads the bytes in place, so the handle keeps them for as long as the dataset is open.*/
+    /*Initialization*/
+    self = [super init];
+    if(![self openInMemoryDatasetWithData:data atPath:nil create:NO settings:0 persist:NO methodName:@"initWithData"])
+        return nil;
+    return self;
+}
+
+-(id)initDisklessWithFileAtPath:(NSString *)thePath persist:(BOOL)persist
+{
+    /*Initializes a NCDFHandle that reads the file at thePath into memory once and works on it there.*/
+    /*Initialization*/
+    self = [super init];
+    if(![self openInMemoryDatasetWithData:nil atPath:thePath create:NO settings:0 persist:persist methodName:@"initDisklessWithFileAtPath"])
+        return nil;
+    return self;
+}
+
+-(id)initDisklessByCreatingFileAtPath:(NSString *)thePath withSettings:(int)settings persist:(BOOL)persist
+{
+    /*Creates a NCDFHandle and an empty netcdf dataset in memory.*/
+    /*Initialization*/
+    self = [super init];
+    if(![self openInMemoryDatasetWithData:nil atPath:thePath create:YES settings:settings persist:persist methodName:@"initDisklessByCreatingFileAtPath"])
+        return nil;
+    return self;
+}
+
 +(id)handleWithNewFileAtPath:(NSString *)thePath
 {
     NCDFHandle *aHandle = [[NCDFHandle alloc] initByCreatingFileAtPath:thePath withSettings:NC_CLOBBER];
@@ -322,87 +1753,202 @@ static NSLock *fileDatabaseLock;
     return handleLock;
 }
 
+-(NCDFFileLock *)fileLock
+{
+    return _fileLock;
+}
+
 -(void)refresh
 {
-    /*This method immediately invalidates all objects held by the handle.  After invalidation, the handle reloads object information for access.*/
+    /*This method immediately invalidates all objects held by the handle.  After invalidation, the handle reloads object information for access.  Inside a define session the refresh waits for the commit.*/
     /*Initialization*/
 
+    if([self isInDefineSession])
+    {
+        _defineSessionNeedsRefresh = YES;
+        return;
+    }
+    if(!_dimensionsLoaded || !_globalAttributesLoaded || !_variablesLoaded)
+    {
+        //kinds a lazy handle has not loaded yet will be read fresh when first asked for.
+        [self refreshDimensions];
+        [self refreshGlobalAttributes];
+        [self refreshVariables];
+        return;
+    }
     NSMutableArray *tempDim = [[NSMutableArray alloc] init];
     NSMutableArray *tempAtt = [[NSMutableArray alloc] init];
     NSMutableArray *tempVar = [[NSMutableArray alloc] init];
     [self seedArrays:[NSArray arrayWithObjects:tempDim,tempAtt,tempVar,nil]];
+    [self reconcileDimensions:tempDim];
+    [self reconcileGlobalAttributes:tempAtt];
+    [self reconcileVariables:tempVar];
+}
 
-    NSMutableArray *theDimsLeft = [NSMutableArray arrayWithArray:theDimensions] ;
-    NCDFDimension *aDim,*mainDim;
-    NSEnumerator *anEnum = [tempDim objectEnumerator];
-    while(aDim = [anEnum nextObject])
+-(void)refreshDimensions
+{
+    int32_t ncid,status;
+    NSMutableArray *tempDim;
+
+    if([self isInDefineSession])
     {
-        mainDim = [self retrieveDimensionByName:[aDim dimensionName]];
-        if(mainDim)
-        {
-            [theDimsLeft removeObject:mainDim]; //delete the dim from our temp main list
-            [mainDim updateDimensionWithDimension:aDim];
-        }
-        else
-            [theDimensions addObject:aDim];
-        mainDim = nil;
+        _defineSessionNeedsRefresh = YES;
+        return;
     }
-    NSEnumerator *anEnuma = [theDimsLeft objectEnumerator];
-    while(aDim = [anEnuma nextObject])
+    if(!_dimensionsLoaded)
+        return;
+    ncid = [self ncidWithOpenMode:NC_SHARE status:&status];
+    if(status!=NC_NOERR)
     {
-        [theDimensions removeObject:aDim];
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"refreshDimensions" subMethod:@"Opening file" errorCode:status];
+        return;
     }
-    [theDimsLeft removeAllObjects];
-    [theDimensions sortUsingSelector:@selector(compare:)];
+    tempDim = [[NSMutableArray alloc] init];
+    if([self seedDimensions:tempDim ncid:ncid])
+        [self reconcileDimensions:tempDim];
+    [self closeNCID:ncid];
+}
 
-    //global attributes
-    NCDFAttribute *anAtt,*mainAtt;
-    NSEnumerator *anEnum1 = [tempAtt objectEnumerator];
+-(void)refreshDimensionLengths
+{
+    int32_t ncid,status,i;
+    size_t length;
+    NCDFDimension *aDim;
 
-    NSMutableArray *theAttsLeft = [NSMutableArray arrayWithArray:theGlobalAttributes] ;
-    while(anAtt = [anEnum1 nextObject])
+    if([self isInDefineSession])
     {
-        mainAtt = [self retrieveGlobalAttributeByName:[anAtt attributeName]];
-        if(mainAtt)
+        _defineSessionNeedsRefresh = YES;
+        return;
+    }
+    if(!_dimensionsLoaded)
+        return;
+    ncid = [self ncidWithOpenMode:NC_SHARE status:&status];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"refreshDimensionLengths" subMethod:@"Opening file" errorCode:status];
+        return;
+    }
+    for(i=0;i<[theDimensions count];i++)
+    {
+        aDim = theDimensions[i];
+        status = nc_inq_dimlen(ncid,[aDim dimensionID],&length);
+        if(status!=NC_NOERR)
         {
-            [theAttsLeft removeObject:mainAtt]; //delete the dim from our temp main list
-            [mainAtt updateAttributeWithAttribute:anAtt];
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"refreshDimensionLengths" subMethod:@"Inquiring dimension length" errorCode:status];
+            break;
         }
-        else
-            [theGlobalAttributes addObject:anAtt];
-        mainAtt = nil;
+        if(length!=[aDim dimLength])
+            [aDim updateDimensionWithDimension:[[NCDFDimension alloc] initWithFileName:filePath dimID:[aDim dimensionID] name:[aDim dimensionName] length:length handle:self]];
+    }
+    [self closeNCID:ncid];
+}
+
+-(void)refreshGlobalAttributes
+{
+    int32_t ncid,status;
+    NSMutableArray *tempAtt;
+
+    if([self isInDefineSession])
+    {
+        _defineSessionNeedsRefresh = YES;
+        return;
+    }
+    if(!_globalAttributesLoaded)
+        return;
+    ncid = [self ncidWithOpenMode:NC_SHARE status:&status];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"refreshGlobalAttributes" subMethod:@"Opening file" errorCode:status];
+        return;
+    }
+    tempAtt = [[NSMutableArray alloc] init];
+    if([self seedGlobalAttributes:tempAtt ncid:ncid])
+        [self reconcileGlobalAttributes:tempAtt];
+    [self closeNCID:ncid];
+}
+
+-(void)refreshVariables
+{
+    int32_t ncid,status;
+    NSMutableArray *tempVar;
+
+    if([self isInDefineSession])
+    {
+        _defineSessionNeedsRefresh = YES;
+        return;
     }
-    NSEnumerator *anEnum1a = [theAttsLeft objectEnumerator];
-    while(anAtt = [anEnum1a nextObject])
+    if(!_variablesLoaded)
+        return;
+    ncid = [self ncidWithOpenMode:NC_SHARE status:&status];
+    if(status!=NC_NOERR)
     {
-        [theGlobalAttributes removeObject:anAtt];
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"refreshVariables" subMethod:@"Opening file" errorCode:status];
+        return;
     }
-    [theAttsLeft removeAllObjects];
+    tempVar = [[NSMutableArray alloc] init];
+    if([self seedVariables:tempVar ncid:ncid])
+        [self reconcileVariables:tempVar];
+    [self closeNCID:ncid];
+}
 
-    //global variables
-    //global attributes
-    NCDFVariable *aVar,*mainVar;
-    NSEnumerator *anEnum2 = [tempVar objectEnumerator];
-    //NSLog([tempVar description]);
-    NSMutableArray *theVarsLeft = [NSMutableArray arrayWithArray:theVariables];
-    while(aVar = [anEnum2 nextObject])
+-(void)refreshVariable:(NCDFVariable *)aVar
+{
+    [self refreshVariableWithID:[aVar variableID]];
+}
+
+-(void)refreshVariableWithID:(int)theID
+{
+    /*Variable ids are assigned in order of definition and only change when the file is rewritten, so the variable is looked up by id.  This also follows a rename.*/
+    int32_t ncid,status,i;
+    NCDFVariable *freshVar,*mainVar;
+
+    if([self isInDefineSession])
     {
-        mainVar = [self retrieveVariableByName:[aVar variableName]];
-        if(mainVar)
+        _defineSessionNeedsRefresh = YES;
+        return;
+    }
+    if(!_variablesLoaded)
+        return;
+    ncid = [self ncidWithOpenMode:NC_SHARE status:&status];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"refreshVariableWithID" subMethod:@"Opening file" errorCode:status];
+        return;
+    }
+    freshVar = [self seedVariableWithID:theID ncid:ncid];
+    [self closeNCID:ncid];
+    if(!freshVar)
+        return;
+    mainVar = nil;
+    if(theID>=0 && theID<[theVariables count] && [theVariables[theID] variableID]==theID)
+        mainVar = theVariables[theID];
+    else
+    {
+        for(i=0;i<[theVariables count];i++)
         {
-            [theVarsLeft removeObject:mainVar]; //delete the dim from our temp main list
-            [mainVar updateVariableWithVariable:aVar];
+            if([theVariables[i] variableID]==theID)
+            {
+                mainVar = theVariables[i];
+                break;
+            }
+        }
+    }
+    if(mainVar)
+    {
+        NSString *oldName = [mainVar variableName];
+        [mainVar updateVariableWithVariable:freshVar];
+        if(![oldName isEqualToString:[mainVar variableName]])
+        {
+            if(_variablesByName[oldName]==mainVar)
+                [_variablesByName removeObjectForKey:oldName];
+            _variablesByName[[mainVar variableName]] = mainVar;
         }
-        else
-            [theVariables addObject:aVar];
-        mainAtt = nil;
     }
-    NSEnumerator *anEnum2a = [theVarsLeft objectEnumerator];
-    while(aVar = [anEnum2a nextObject])
+    else
     {
-        [theVariables removeObject:aVar];
+        [theVariables addObject:freshVar];
+        _variablesByName[[freshVar variableName]] = freshVar;
     }
-    [theVarsLeft removeAllObjects];
 }
 
 #pragma mark *** Simple Accessing Methods ***
@@ -411,6 +1957,7 @@ static NSLock *fileDatabaseLock;
 {
     /*Returns a mutable array listing all the dimensions in the current netcdf file.  This method may be updated to return only a NSArray*/
     /*Accessors*/
+    [self loadDimensionsIfNeeded];
     return theDimensions;
 }
 
@@ -418,6 +1965,7 @@ static NSLock *fileDatabaseLock;
 {
     /*Returns a mutable array listing all the global attributes in the current netcdf file.  This method may be updated to return only a NSArray*/
     /*Accessors*/
+    [self loadGlobalAttributesIfNeeded];
     return theGlobalAttributes;
 }
 
@@ -425,6 +1973,7 @@ static NSLock *fileDatabaseLock;
 {
     /*Returns a mutable array listing all the global attributes in the current netcdf file. This method may be updated to return only a NSArray*/
     /*Accessors*/
+    [self loadVariablesIfNeeded];
     return theVariables;
 }
 
@@ -446,16 +1995,10 @@ static NSLock *fileDatabaseLock;
 
     char *theCName;
     dimName = [self parseNameString:dimName];
-    ncid = [self ncidWithOpenMode:NC_WRITE status:&status];
+    ncid = [self ncidForDefineWithStatus:&status];
     if(status!=NC_NOERR)
     {
-        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createNewDimensionWithName" subMethod:@"Opening file" errorCode:status];
-        return NO;
-    }
-    status = nc_redef(ncid);
-    if(status!=NC_NOERR)
-    {
-        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createNewDimensionWithName" subMethod:@"Set redefine mode" errorCode:status];
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createNewDimensionWithName" subMethod:@"Opening file in define mode" errorCode:status];
         return NO;
     }
     theCName = (char *)malloc(sizeof(char)*[dimName length]+1);
@@ -465,11 +2008,12 @@ static NSLock *fileDatabaseLock;
     if(status!=NC_NOERR)
     {
         [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createNewDimensionWithName" subMethod:@"Define dimension" errorCode:status];
+        [self closeNCID:ncid];
         return NO;
     }
 
     [self closeNCID:ncid];
-    [self refresh];
+    [self refreshDimensions];
     return YES;
 }
 
@@ -477,12 +2021,8 @@ static NSLock *fileDatabaseLock;
 {
     BOOL result;
     size_t length;
-    int32_t i;
-    i = [propertyList[@"length"] intValue];
-    length = (size_t)i;
+    length = (size_t)[propertyList[@"length"] unsignedLongLongValue];
     result = [self createNewDimensionWithName:propertyList[@"dimName"] size:length];
-    if(result)
-        [self refresh];
     return result;
 }
 
@@ -500,13 +2040,14 @@ static NSLock *fileDatabaseLock;
     NSMutableArray *validDim = [[NSMutableArray alloc] init];
     NSMutableArray *returnDims = [[NSMutableArray alloc] init];
 
+    [self loadDimensionsIfNeeded];
     for(i=0;i<[newDimensionArray count];i++)
     {
         BOOL valid;
         valid = YES;
         for(j=0;j<[theDimensions count];j++)
         {
-            if([newDimensionArray[i] isEqualToDim:theDimensions[i]])
+            if([newDimensionArray[i] isEqualToDim:theDimensions[j]])
             {
                 valid = NO;
                 j = (int)[theDimensions count];
@@ -523,16 +2064,10 @@ static NSLock *fileDatabaseLock;
 
         }
     }
-    ncid = [self ncidWithOpenMode:NC_WRITE status:&status];
-    if(status!=NC_NOERR)
-    {
-        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createNewDimensionsFromDimensionArray" subMethod:@"Opening file" errorCode:status];
-        return nil;
-    }
-    status = nc_redef(ncid);
+    ncid = [self ncidForDefineWithStatus:&status];
     if(status!=NC_NOERR)
     {
-        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createNewDimensionsFromDimensionArray" subMethod:@"Set redefine mode" errorCode:status];
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createNewDimensionsFromDimensionArray" subMethod:@"Opening file in define mode" errorCode:status];
         return nil;
     }
     //cycle through dims
@@ -556,139 +2091,41 @@ static NSLock *fileDatabaseLock;
         }
     }
     [self closeNCID:ncid];
-    [self refresh];
+    [self refreshDimensions];
     return [NSArray arrayWithArray:returnDims];
 }
 
 -(BOOL)deleteDimensionWithName:(NSString *)deleteDimName
 {
-    NSFileManager *theManager = [NSFileManager defaultManager];
-    NCDFHandle *newHandle;
-    NSString *tempPath = [filePath stringByAppendingString:@"_.nc"];
-
-    int32_t i, errorCount;
-    errorCount = [theErrorHandle errorCount];
-    while([theManager fileExistsAtPath:tempPath])
-    {
-        tempPath = [tempPath stringByAppendingString:@"_.nc"];
-    }
-    newHandle = [[NCDFHandle alloc] initByCreatingFileAtPath:tempPath];
-    for(i=0;i<[theGlobalAttributes count];i++)
-    {
-        [newHandle createNewGlobalAttributeWithPropertyList:[theGlobalAttributes[i] propertyList]];
-    }
-    for(i=0;i<[theDimensions count];i++)
-    {
-        if(![[theDimensions[i] dimensionName] isEqualToString:deleteDimName])
-            [newHandle createNewDimensionWithPropertyList:[theDimensions[i] propertyList]];
-    }
-    for(i=0;i<[theVariables count];i++)
-    {
-        if(![theVariables[i] doesVariableUseDimensionName:deleteDimName])
-        {
-            [newHandle createNewVariableWithPropertyList:[theVariables[i] propertyList]];
-        }
-    }
-    if(errorCount<[theErrorHandle errorCount])
-    {
-        [theManager removeItemAtPath:tempPath error:nil];
-        return NO;
-    }
-    else
-    {
-        [theManager removeItemAtPath:filePath error:nil];
-        [theManager moveItemAtPath:tempPath toPath:filePath error:nil];
-        [self refresh];
-        return YES;
-    }
+    NCDFRewritePlan *plan = [self rewritePlanForEdit];
+    [plan->omittedDimensions addObject:[plan originalDimensionName:deleteDimName]];
+    return [self applyRewritePlan:plan methodName:@"deleteDimensionWithName"];
 }
 
--(BOOL)resizeDimensionWithName:(NSString *)resizeDimName size:(int)newSize
+-(BOOL)resizeDimensionWithName:(NSString *)resizeDimName size:(size_t)newSize
 {
-    NSFileManager *theManager = [NSFileManager defaultManager];
-    NCDFHandle *newHandle;
-    NSString *tempPath = [filePath stringByAppendingString:@"_.nc"];
-
-    int32_t i, errorCount;
-    errorCount = [theErrorHandle errorCount];
-    while([theManager fileExistsAtPath:tempPath])
-    {
-        tempPath = [tempPath stringByAppendingString:@"_.nc"];
-    }
-    newHandle = [[NCDFHandle alloc] initByCreatingFileAtPath:tempPath];
-    for(i=0;i<[theGlobalAttributes count];i++)
-    {
-        [newHandle createNewGlobalAttributeWithPropertyList:[theGlobalAttributes[i] propertyList]];
-    }
-    for(i=0;i<[theDimensions count];i++)
-    {
-        if(![[theDimensions[i] dimensionName] isEqualToString:resizeDimName])
-            [newHandle createNewDimensionWithPropertyList:[theDimensions[i] propertyList]];
-        else
-            [newHandle createNewDimensionWithName:resizeDimName size:(size_t)newSize];
-    }
-    for(i=0;i<[theVariables count];i++)
-    {
-        if(![theVariables[i] doesVariableUseDimensionName:resizeDimName])
-            [newHandle createNewVariableWithPropertyList:[theVariables[i] propertyList]];
-        else
-        {
-            int32_t newSize,newCount;
-            NSArray *theUsedDims = [theVariables[i] allVariableDimInformation];
-            NSMutableData *newData;
-            NSMutableDictionary *propertyList;
-            newSize = 1;
-            for(newCount = 0;newCount<[theUsedDims count];newCount++)
-            {
-                if(![[theUsedDims[newCount] dimensionName] isEqualToString:resizeDimName])
-                    newSize *= (int)[theUsedDims[newCount] dimLength];
-                else
-                    newSize *= newSize;
-            }
-
-            switch ([(NCDFVariable *)theVariables[i] variableNC_TYPE])
-            {
-                case NC_BYTE:
-                    newSize *= 1;
-                    break;
-                case NC_CHAR:
-                    newSize *= 1;
-                    break;
-                case NC_SHORT:
-                    newSize *= 2;
-                    break;
-                case NC_INT:
-                    newSize *= 4;
-                    break;
-                case NC_FLOAT:
-                    newSize *= 4;
-                    break;
-                case NC_DOUBLE:
-                    newSize *= 8;
-                    break;
-                default:
-                    break;
-            }
-            newData = [NSMutableData dataWithData:[theVariables[i] readAllVariableData]];
-            [newData setLength:newSize];
-            propertyList = [NSMutableDictionary dictionaryWithDictionary:[theVariables[i] propertyList]];
-            [propertyList setObject:[NSData dataWithData:newData] forKey:@"data"];
-            [newHandle createNewVariableWithPropertyList:[NSDictionary dictionaryWithDictionary:propertyList]];
-        }
-    }
-
-    if(errorCount<[theErrorHandle errorCount])
-    {
-        [theManager removeItemAtPath:tempPath error:nil];
-        return NO;
-    }
-    else
+    NCDFRewritePlan *plan = [self rewritePlanForEdit];
+    [plan->dimensionLengths setObject:[NSNumber numberWithUnsignedLongLong:newSize] forKey:[plan originalDimensionName:resizeDimName]];
+    return [self applyRewritePlan:plan methodName:@"resizeDimensionWithName"];
+}
+
+-(BOOL)renameDimensionWithName:(NSString *)oldName toName:(NSString *)newName
+{
+    NCDFRewritePlan *plan;
+    NCDFDimension *aDim;
+    if([self isInEditSession])
     {
-        [theManager removeItemAtPath:filePath error:nil];
-        [theManager moveItemAtPath:tempPath toPath:filePath error:nil];
-        [self refresh];
+        plan = [self rewritePlanForEdit];
+        [plan->dimensionRenames setObject:[self parseNameString:newName] forKey:[plan originalDimensionName:oldName]];
         return YES;
     }
+    aDim = [self retrieveDimensionByName:oldName];
+    if(!aDim)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"renameDimensionWithName" subMethod:@"Finding dimension" errorCode:NC_EBADDIM];
+        return NO;
+    }
+    return [aDim renameDimension:newName];
 }
 /*additional methods needed
  1) create dimensions via dimension array and variable array - minimize work
@@ -709,17 +2146,16 @@ static NSLock *fileDatabaseLock;
     BOOL dataWritten;
 
     attName = [self parseNameString:attName];
-
-    ncid = [self ncidWithOpenMode:NC_WRITE status:&status];
-    if(status!=NC_NOERR)
+    if([self isInEditSession])
     {
-        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createNewGlobalAttributeWithName" subMethod:@"Opening file" errorCode:status];
-        return NO;
+        [_editSessionPlan->globalAttributeEdits addObject:[NSDictionary dictionaryWithObjectsAndKeys:attName,@"attributeName",[NSNumber numberWithInt:(int)theType],@"nc_type",(theValues?theValues:[NSArray array]),@"values",nil]];
+        return YES;
     }
-    status = nc_redef(ncid);
+
+    ncid = [self ncidForDefineWithStatus:&status];
     if(status!=NC_NOERR)
     {
-        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createNewGlobalAttributeWithName" subMethod:@"Redefine mode" errorCode:status];
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createNewGlobalAttributeWithName" subMethod:@"Opening file in define mode" errorCode:status];
         return NO;
     }
     dataWritten = NO;
@@ -826,7 +2262,7 @@ static NSLock *fileDatabaseLock;
     [self closeNCID:ncid];
     if(!dataWritten)
         return NO;
-    [self refresh];
+    [self refreshGlobalAttributes];
     return YES;
 }
 
@@ -836,8 +2272,6 @@ static NSLock *fileDatabaseLock;
     int32_t i;
     i = [[propertyList objectForKey:@"nc_type"] intValue];
     result = [self createNewGlobalAttributeWithName:propertyList[@"attributeName"] dataType:(nc_type)i values:propertyList[@"values"]];
-    if(result)
-        [self refresh];
     return result;
 }
 
@@ -847,6 +2281,7 @@ static NSLock *fileDatabaseLock;
     int32_t i,j;
     NSMutableArray *existingAttributes = [[NSMutableArray alloc] init];
 
+    [self loadGlobalAttributesIfNeeded];
     for(i=0;i<[theNewAttributes count];i++)
     {
         BOOL valid,result;
@@ -881,21 +2316,22 @@ static NSLock *fileDatabaseLock;
     int32_t ncid;
     int32_t status;
 
-    ncid = [self ncidWithOpenMode:NC_WRITE status:&status];
-    if(status != NC_NOERR)
+    if([self isInEditSession])
     {
-        return NO;
+        [_editSessionPlan->globalAttributeEdits addObject:[NSDictionary dictionaryWithObject:attName forKey:@"attributeName"]];
+        return YES;
     }
-    else
+    ncid = [self ncidForDefineWithStatus:&status];
+    if(status != NC_NOERR)
     {
-        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"deleteGlobalAttributeWithName" subMethod:@"Open file" errorCode:status];
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"deleteGlobalAttributeWithName" subMethod:@"Open file in define mode" errorCode:status];
+        return NO;
     }
-    nc_redef(ncid);
     status = nc_del_att(ncid,NC_GLOBAL,[attName UTF8String]);
     [self closeNCID:ncid];
     if(status==NC_NOERR)
     {
-        [self refresh];
+        [self refreshGlobalAttributes];
         return YES;
     }
     else
@@ -905,6 +2341,193 @@ static NSLock *fileDatabaseLock;
     }
 }
 
+#pragma mark *** Define Session Methods ***
+
+-(BOOL)beginDefineSession
+{
+    /*Checks out one writable ncid and leaves it in define mode until commitDefineSession.  The schema methods pick it up through ncidForDefineWithStatus: and defer their refresh, so a whole batch of definitions costs one header write and one refresh.  The write lock taken by the checkout keeps other threads out of the file for the duration of the session.*/
+    int32_t ncid,status;
+
+    if([self isInDefineSession])
+    {
+        _defineSessionDepth++;
+        return YES;
+    }
+    ncid = [self ncidWithOpenMode:NC_WRITE status:&status];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"beginDefineSession" subMethod:@"Opening file" errorCode:status];
+        return NO;
+    }
+    status = nc_redef(ncid);
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"beginDefineSession" subMethod:@"Set redefine mode" errorCode:status];
+        [self closeNCID:ncid];
+        return NO;
+    }
+    _defineSessionNCID = ncid;
+    _defineSessionDepth = 1;
+    _defineSessionInDefineMode = YES;
+    _defineSessionNeedsRefresh = NO;
+    _defineSessionPendingData = [[NSMutableArray alloc] init];
+    _defineSessionThread = [NSThread currentThread];
+    return YES;
+}
+
+-(BOOL)commitDefineSession
+{
+    int32_t ncid,status,i;
+    BOOL result,needsRefresh;
+    NSArray *pendingData;
+    NCDFVariable *aVar;
+
+    if(![self isInDefineSession])
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"commitDefineSession" subMethod:@"No define session" errorCode:NC_EINVAL];
+        return NO;
+    }
+    _defineSessionDepth--;
+    if(_defineSessionDepth>0)
+        return YES;
+    result = YES;
+    ncid = _defineSessionNCID;
+    needsRefresh = _defineSessionNeedsRefresh;
+    pendingData = _defineSessionPendingData;
+    if(_defineSessionInDefineMode)
+    {
+        status = [self endDefineModeForNCID:ncid];
+        if(status!=NC_NOERR)
+        {
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"commitDefineSession" subMethod:@"Ending define mode" errorCode:status];
+            result = NO;
+        }
+    }
+    _defineSessionThread = nil;
+    _defineSessionPendingData = nil;
+    _defineSessionInDefineMode = NO;
+    _defineSessionNeedsRefresh = NO;
+    _defineSessionNCID = -1;
+    [self closeNCID:ncid];
+    if(needsRefresh || [pendingData count]>0)
+        [self refresh];
+    if([pendingData count]>0)
+    {
+        for(i=0;i<[pendingData count];i++)
+        {
+            aVar = [self retrieveVariableByName:pendingData[i][@"variableName"]];
+            [aVar writeAllVariableData:pendingData[i][@"data"]];
+        }
+        [self refreshDimensionLengths];
+    }
+    return result;
+}
+
+-(BOOL)beginDefineSessionReservingHeaderSpace:(size_t)bytes
+{
+    if(bytes>_headerFreeSpace)
+        _headerFreeSpace = bytes;
+    return [self beginDefineSession];
+}
+
+-(BOOL)defineWithBlock:(void (^)(NCDFHandle *aHandle))defineBlock
+{
+    if(![self beginDefineSession])
+        return NO;
+    defineBlock(self);
+    return [self commitDefineSession];
+}
+
+-(BOOL)isInDefineSession
+{
+    //only the owning thread ever stores itself here, so no other thread can see a match.
+    return (_defineSessionThread!=nil && _defineSessionThread==[NSThread currentThread]);
+}
+
+#pragma mark *** Edit Session Methods ***
+
+-(BOOL)beginEditSession
+{
+    /*Structural edits made until commitEditSession are added to one plan instead of each rewriting the file.*/
+    if([self isInEditSession])
+    {
+        _editSessionDepth++;
+        return YES;
+    }
+    if(_editSessionThread!=nil)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"beginEditSession" subMethod:@"Edit session open on another thread" errorCode:NC_EINVAL];
+        return NO;
+    }
+    _editSessionPlan = [[NCDFRewritePlan alloc] init];
+    _editSessionDepth = 1;
+    _editSessionThread = [NSThread currentThread];
+    return YES;
+}
+
+-(BOOL)commitEditSession
+{
+    NCDFRewritePlan *plan;
+
+    if(![self isInEditSession])
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"commitEditSession" subMethod:@"No edit session" errorCode:NC_EINVAL];
+        return NO;
+    }
+    //the rewrite replaces the file under the define session's ncid, so the session stays open with its edits until the define session is committed.
+    if(_editSessionDepth==1 && [_editSessionPlan hasEdits] && [self isInDefineSession])
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"commitEditSession" subMethod:@"Define session open" errorCode:NC_EINDEFINE];
+        return NO;
+    }
+    _editSessionDepth--;
+    if(_editSessionDepth>0)
+        return YES;
+    plan = _editSessionPlan;
+    _editSessionPlan = nil;
+    _editSessionThread = nil;
+    if(![plan hasEdits])
+        return YES;
+    return [self rewriteFileWithPlan:plan methodName:@"commitEditSession"];
+}
+
+-(void)cancelEditSession
+{
+    if(![self isInEditSession])
+        return;
+    _editSessionPlan = nil;
+    _editSessionDepth = 0;
+    _editSessionThread = nil;
+}
+
+-(BOOL)editWithBlock:(void (^)(NCDFHandle *aHandle))editBlock
+{
+    if(![self beginEditSession])
+        return NO;
+    editBlock(self);
+    return [self commitEditSession];
+}
+
+-(BOOL)isInEditSession
+{
+    return (_editSessionThread!=nil && _editSessionThread==[NSThread currentThread]);
+}
+
+-(BOOL)recordVariableAttributeEdit:(NSDictionary *)anEdit forVariableName:(NSString *)variableName
+{
+    NSMutableArray *attributeEdits;
+    if(![self isInEditSession])
+        return NO;
+    attributeEdits = _editSessionPlan->variableAttributeEdits[variableName];
+    if(!attributeEdits)
+    {
+        attributeEdits = [[NSMutableArray alloc] init];
+        _editSessionPlan->variableAttributeEdits[variableName] = attributeEdits;
+    }
+    [attributeEdits addObject:anEdit];
+    return YES;
+}
+
 #pragma mark *** Validation Methods ***
 
 -(NSString *)parseNameString:(NSString *)theString
@@ -938,14 +2561,13 @@ static NSLock *fileDatabaseLock;
     int32_t *theDimNumbers;
     int32_t i,ncid,varID;
     NSString *theName;
-    ncid = [self ncidWithOpenMode:NC_WRITE status:&status];
+    ncid = [self ncidForDefineWithStatus:&status];
 
     if(status != NC_NOERR)
     {
-        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createVariableWithName" subMethod:@"Open File" errorCode:status];
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createVariableWithName" subMethod:@"Open File in define mode" errorCode:status];
         return NO;
     }
-    status = nc_redef(ncid);
     theDimNumbers = (int32_t *)malloc(sizeof(int)*[theVariableDims count]);
     for(i=0;i<[theVariableDims count];i++)
     {
@@ -958,15 +2580,102 @@ static NSLock *fileDatabaseLock;
     if(status != NC_NOERR)
     {
         [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createVariableWithName" subMethod:@"Define variable" errorCode:status];
+        [self closeNCID:ncid];
         return NO;
     }
     [self closeNCID:ncid];
 
-    [self refresh];
+    [self refreshVariableWithID:varID];
 
     return YES;
 }
 
+-(BOOL)createVariableWithName:(NSString *)varName type:(nc_type)theType dimNames:(NSArray *)theDimNames storageOptions:(NSDictionary *)storageOptions
+{
+    /*Creates a new variable within the reciever's file from the names of its dimensions, in the order of most significant to least significant.  The dimension ids are inquired from the file so that dimensions defined earlier in a define session, which the handle does not list yet, can be used.*/
+    /*Editing netCDF File*/
+    int32_t status;
+    int32_t theDimNumbers[NC_MAX_VAR_DIMS];
+    int32_t i,ncid,varID;
+    NSString *theName;
+#ifdef NCDF4
+    int format;
+#endif
+
+    if([theDimNames count]>NC_MAX_VAR_DIMS)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createVariableWithName" subMethod:@"Too many dimensions" errorCode:NC_EMAXDIMS];
+        return NO;
+    }
+    ncid = [self ncidForDefineWithStatus:&status];
+    if(status != NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createVariableWithName" subMethod:@"Open File in define mode" errorCode:status];
+        return NO;
+    }
+    for(i=0;i<[theDimNames count];i++)
+    {
+        status = nc_inq_dimid(ncid,[theDimNames[i] UTF8String],&theDimNumbers[i]);
+        if(status != NC_NOERR)
+        {
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createVariableWithName" subMethod:@"Missing dimension" errorCode:status];
+            [self closeNCID:ncid];
+            return NO;
+        }
+    }
+    theName = [self parseNameString:varName];
+    status = nc_def_var(ncid,[theName UTF8String],theType,(int)[theDimNames count],theDimNumbers,&varID);
+    if(status != NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createVariableWithName" subMethod:@"Define variable" errorCode:status];
+        [self closeNCID:ncid];
+        return NO;
+    }
+#ifdef NCDF4
+    //classic format files have no storage settings to define.
+    if(storageOptions && nc_inq_format(ncid,&format)==NC_NOERR && (format==NC_FORMAT_NETCDF4 || format==NC_FORMAT_NETCDF4_CLASSIC))
+    {
+        status = [self defineStorage:storageOptions ncid:ncid variableID:varID];
+        if(status != NC_NOERR)
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createVariableWithName" subMethod:@"Define storage" errorCode:status];
+    }
+#endif
+    [self closeNCID:ncid];
+    [self refreshVariableWithID:varID];
+    return (status == NC_NOERR);
+}
+
+#ifdef NCDF4
+-(int)defineStorage:(NSDictionary *)options ncid:(int)ncid variableID:(int)varID
+{
+    int32_t status,i,ndims,deflateLevel;
+    size_t chunks[NC_MAX_VAR_DIMS];
+    NSArray *chunkSizes = options[NCDFVariableStorageChunkSizes];
+
+    status = NC_NOERR;
+    if([options[NCDFVariableStorageContiguous] boolValue])
+        status = nc_def_var_chunking(ncid,varID,NC_CONTIGUOUS,NULL);
+    else if(chunkSizes)
+    {
+        status = nc_inq_varndims(ncid,varID,&ndims);
+        if(status==NC_NOERR && [chunkSizes count]!=ndims)
+            status = NC_EINVAL;
+        for(i=0;i<ndims && status==NC_NOERR;i++)
+            chunks[i] = [chunkSizes[i] unsignedLongValue];
+        if(status==NC_NOERR)
+            status = nc_def_var_chunking(ncid,varID,NC_CHUNKED,chunks);
+    }
+    if(status==NC_NOERR && (options[NCDFVariableStorageDeflateLevel] || options[NCDFVariableStorageShuffle]))
+    {
+        deflateLevel = [options[NCDFVariableStorageDeflateLevel] intValue];
+        status = nc_def_var_deflate(ncid,varID,[options[NCDFVariableStorageShuffle] boolValue]?1:0,deflateLevel>0?1:0,deflateLevel);
+    }
+    if(status==NC_NOERR && [options[NCDFVariableStorageFletcher32] boolValue])
+        status = nc_def_var_fletcher32(ncid,varID,NC_FLETCHER32);
+    return status;
+}
+#endif
+
 -(BOOL)createNewVariableWithPropertyList:(NSDictionary *)propertyList
 {
     /*This method assumes that the property list is for the current handle.
@@ -974,29 +2683,25 @@ static NSLock *fileDatabaseLock;
      work to synchronize dimensions*/
     BOOL result;
     int32_t i;
-    NSMutableArray *newDimIDs;
-    NSArray *newDimNames;
     NCDFVariable *aVar;
-    newDimIDs = [[NSMutableArray alloc] init];
-    newDimNames = propertyList[@"dimNames"];
-
-    for(i=0;i<[newDimNames count];i++)
-    {
-        NCDFDimension *aDim = [self retrieveDimensionByName:newDimNames[i]];
-        [newDimIDs addObject:aDim];
-    }
 
     i = [[propertyList objectForKey:@"nc_type"] intValue];
-    result = [self createVariableWithName:propertyList[@"variableName"] type:(nc_type)i dimArray:newDimIDs];
+    result = [self createVariableWithName:propertyList[@"variableName"] type:(nc_type)i dimNames:propertyList[@"dimNames"] storageOptions:propertyList[NCDFVariablePropertyListFieldStorage]];
     if(propertyList[@"data"]!=nil)
     {
-        aVar = nil;
-        aVar = [self retrieveVariableByName:propertyList[@"variableName"]];
-        [aVar writeAllVariableData:propertyList[@"data"]];
-
+        if([self isInDefineSession])
+        {
+            //the variable does not exist in the handle until the session is committed.
+            [_defineSessionPendingData addObject:[NSDictionary dictionaryWithObjectsAndKeys:propertyList[@"variableName"],@"variableName",propertyList[@"data"],@"data",nil]];
+        }
+        else
+        {
+            aVar = nil;
+            aVar = [self retrieveVariableByName:propertyList[@"variableName"]];
+            [aVar writeAllVariableData:propertyList[@"data"]];
+            [self refreshDimensionLengths];
+        }
     }
-
-    [self refresh];
     return result;
 }
 
@@ -1005,6 +2710,7 @@ static NSLock *fileDatabaseLock;
     int32_t i,j,k;
     NSMutableArray *variablesNotAdded;
     variablesNotAdded = [[NSMutableArray alloc] init];
+    [self loadDimensionsIfNeeded];
 
     for(i=0;i<[theNewVariables count];i++)
     {
@@ -1037,10 +2743,8 @@ static NSLock *fileDatabaseLock;
 
 -(BOOL)createNewVariableWithName:(NSString *)variableName type:(nc_type)theType dimNameArray:(NSArray *)selectedDims
 {
-    int32_t i,j,ncid,vid,status;
-    int32_t *selectedDimIDs;
+    int32_t i;
     NSMutableArray *theCurrentVars = [self getVariables];
-    NSMutableArray *theCurrentDims = [self getDimensions];
 
     //step 1. Parse variable name
     variableName = [self parseNameString:variableName];
@@ -1053,266 +2757,502 @@ static NSLock *fileDatabaseLock;
             i = (int)[theCurrentVars count];
         }
     }
-    //step 3. check for dimensions  If dim not present return an error.
-    selectedDimIDs = (int32_t *)malloc(sizeof(int)*NC_MAX_VAR_DIMS);//the max prevents nils.
-    for(i=0;i<[selectedDims count];i++)
-        selectedDimIDs[i] = -1;
-    for(i=0;i<[theCurrentDims count];i++)
-    {
-        for(j=0;j<[selectedDims count];j++)
-        {
-            if([[theCurrentDims[i] dimensionName] isEqualToString:selectedDims[j]])
-            {
-                selectedDimIDs[j] = [theCurrentDims[i] dimensionID];
-            }
+    //step 3. create.  Missing dimensions are reported as errors.
+    return [self createVariableWithName:variableName type:theType dimNames:selectedDims storageOptions:nil];
+}
 
-        }
+#ifdef NCDF4
+-(BOOL)createNewVariableWithName:(NSString *)variableName type:(nc_type)theType dimNameArray:(NSArray *)selectedDims storageOptions:(NSDictionary *)storageOptions
+{
+    int32_t i;
+    NSMutableArray *theCurrentVars = [self getVariables];
 
-    }
-    if(selectedDimIDs[[selectedDims count]-1]==-1)
+    variableName = [self parseNameString:variableName];
+    for(i=0;i<[theCurrentVars count];i++)
     {
-        NSLog(@"Missing dim");
-        free(selectedDimIDs);
-        return NO;
+        if([[theCurrentVars[i] variableName] isEqualToString:variableName])
+        {
+            variableName = [variableName stringByAppendingString:@"_1"];
+            i = (int)[theCurrentVars count];
+        }
     }
-    //step 4.  I think we have everything, let's create.
+    return [self createVariableWithName:variableName type:theType dimNames:selectedDims storageOptions:storageOptions];
+}
+#endif
 
-    ncid = [self ncidWithOpenMode:NC_WRITE status:&status];
+-(BOOL)deleteVariableWithName:(NSString *)deleteVariableName
+{
+    NCDFRewritePlan *plan = [self rewritePlanForEdit];
+    [plan->omittedVariables addObject:[plan originalVariableName:deleteVariableName]];
+    return [self applyRewritePlan:plan methodName:@"deleteVariableWithName"];
+}
 
-    if(status != NC_NOERR)
-    {
-        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createNewVariableWithName" subMethod:@"Open File" errorCode:status];
-        free(selectedDimIDs);
-        return NO;
-    }
-    status = nc_redef(ncid);
-    if(status != NC_NOERR)
-    {
-        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createNewVariableWithName" subMethod:@"Redefine Mode" errorCode:status];
-        free(selectedDimIDs);
-        return NO;
-    }
-    status = nc_def_var(ncid,[variableName UTF8String],theType, (int)[selectedDims count],selectedDimIDs,&vid);
-    free(selectedDimIDs);
-    if(status != NC_NOERR)
+-(BOOL)deleteVariablesWithNames:(NSArray *)nameArray
+{
+    NCDFRewritePlan *plan = [self rewritePlanForEdit];
+    int32_t i;
+    for(i=0;i<[nameArray count];i++)
     {
-        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"createNewVariableWithName" subMethod:@"Variable write" errorCode:status];
-        return NO;
+        [plan->omittedVariables addObject:[plan originalVariableName:nameArray[i]]];
     }
-    [self closeNCID:ncid];
-    [self refresh];
-    return YES;
+    return [self applyRewritePlan:plan methodName:@"deleteVariablesWithNames"];
 }
 
--(BOOL)deleteVariableWithName:(NSString *)deleteVariableName
+-(BOOL)renameVariableWithName:(NSString *)oldName toName:(NSString *)newName
 {
-    NSFileManager *theManager = [NSFileManager defaultManager];
-    NCDFHandle *newHandle;
-    NSString *tempPath = [filePath stringByAppendingString:@"_.nc"];
-    int32_t i, errorCount;
-    errorCount = [theErrorHandle errorCount];
-    while([theManager fileExistsAtPath:tempPath])
-    {
-        tempPath = [tempPath stringByAppendingString:@"_.nc"];
-    }
-    newHandle = [[NCDFHandle alloc] initByCreatingFileAtPath:tempPath];
-    for(i=0;i<[theGlobalAttributes count];i++)
-    {
-        [newHandle createNewGlobalAttributeWithPropertyList:[theGlobalAttributes[i] propertyList]];
-    }
-    for(i=0;i<[theDimensions count];i++)
-    {
-        [newHandle createNewDimensionWithPropertyList:[theDimensions[i] propertyList]];
-    }
-    for(i=0;i<[theVariables count];i++)
+    NCDFRewritePlan *plan;
+    NCDFVariable *aVar;
+    if([self isInEditSession])
     {
-        if(![[theVariables[i] variableName] isEqualToString:deleteVariableName])
-        {
-            [newHandle createNewVariableWithPropertyList:[theVariables[i] propertyList]];
-        }
+        plan = [self rewritePlanForEdit];
+        [plan->variableRenames setObject:[self parseNameString:newName] forKey:[plan originalVariableName:oldName]];
+        return YES;
     }
-    if(errorCount<[theErrorHandle errorCount])
+    aVar = [self retrieveVariableByName:oldName];
+    if(!aVar)
     {
-        [theManager removeItemAtPath:tempPath error:nil];
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"renameVariableWithName" subMethod:@"Finding variable" errorCode:NC_ENOTVAR];
         return NO;
     }
-    else
-    {
-        [theManager removeItemAtPath:filePath error:nil];
-        [theManager moveItemAtPath:tempPath toPath:filePath error:nil];
-        [self refresh];
-        return YES;
-    }
+    return [aVar renameVariable:newName];
 }
 
--(BOOL)deleteVariablesWithNames:(NSArray *)nameArray
+-(NSDictionary *)readVariables:(NSArray *)variableNames atLocations:(NSArray *)startCoordinateArrays edgeLengths:(NSArray *)edgeLengthArrays
 {
-    NSFileManager *theManager = [NSFileManager defaultManager];
-    NCDFHandle *newHandle;
-    NSString *tempPath = [filePath stringByAppendingString:@"_.nc"];
+    NSMutableDictionary *results = [[NSMutableDictionary alloc] init];
+    NSMutableArray *reads = [[NSMutableArray alloc] init];
+    NSMutableArray *libraryReads = [[NSMutableArray alloc] init];
+    NSMutableSet *plannedNames = [[NSMutableSet alloc] init];
+    NCDFPlannedRead *aRead;
+    NCDFMappedFile *mapping;
+    NCDFVariable *aVar;
+    NSArray *startCoordinates,*edgeLengths,*shape;
+    int32_t i,j,ndims,status,format;
+    size_t workerCount,readCount;
+    int ncids[NCDFHandleMaxParallelReads];
+    int *workerNCIDs = ncids;
 
-    int32_t i, errorCount,j;
-    errorCount = [theErrorHandle errorCount];
-    while([theManager fileExistsAtPath:tempPath])
+    //the coordinate and edge arrays are indexed alongside the names, so one of another length cannot be matched up with them.
+    if((startCoordinateArrays && [startCoordinateArrays count]!=[variableNames count]) || (edgeLengthArrays && [edgeLengthArrays count]!=[variableNames count]))
     {
-        tempPath = [tempPath stringByAppendingString:@"_.nc"];
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"readVariables" subMethod:@"Checking argument counts" errorCode:NC_EINVAL];
+        return results;
     }
-    newHandle = [[NCDFHandle alloc] initByCreatingFileAtPath:tempPath];
-    for(i=0;i<[theGlobalAttributes count];i++)
+    //Step 1. Plan
+    for(i=0;i<[variableNames count];i++)
+    {
+        //the results are keyed by name, so a second read of the same variable would replace the first.
+        if([plannedNames containsObject:variableNames[i]])
+        {
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"readVariables" subMethod:[NSString stringWithFormat:@"Duplicate variable %@",variableNames[i]] errorCode:NC_EINVAL];
+            continue;
+        }
+        [plannedNames addObject:variableNames[i]];
+        aVar = [self retrieveVariableByName:variableNames[i]];
+        if(!aVar)
+        {
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"readVariables" subMethod:[NSString stringWithFormat:@"Finding variable %@",variableNames[i]] errorCode:NC_ENOTVAR];
+            continue;
+        }
+        shape = [aVar lengthArray];
+        ndims = (int32_t)[shape count];
+        startCoordinates = nil;
+        if(startCoordinateArrays && startCoordinateArrays[i]!=[NSNull null])
+            startCoordinates = startCoordinateArrays[i];
+        edgeLengths = shape;
+        if(edgeLengthArrays && edgeLengthArrays[i]!=[NSNull null])
+            edgeLengths = edgeLengthArrays[i];
+        if((startCoordinates && ![startCoordinates isKindOfClass:[NSArray class]]) || ![edgeLengths isKindOfClass:[NSArray class]])
+        {
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"readVariables" subMethod:[NSString stringWithFormat:@"Checking coordinates of %@",variableNames[i]] errorCode:NC_EINVAL];
+            continue;
+        }
+        if((startCoordinates && [startCoordinates count]!=ndims) || [edgeLengths count]!=ndims)
+        {
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"readVariables" subMethod:[NSString stringWithFormat:@"Checking coordinates of %@",variableNames[i]] errorCode:NC_EINVALCOORDS];
+            continue;
+        }
+        aRead = [[NCDFPlannedRead alloc] init];
+        aRead->variable = aVar;
+        aRead->variableName = variableNames[i];
+        aRead->edgeLengths = edgeLengths;
+        aRead->start = (size_t *)calloc(ndims+1,sizeof(size_t));
+        aRead->edges = (size_t *)calloc(ndims+1,sizeof(size_t));
+        for(j=0;j<ndims;j++)
+        {
+            if(startCoordinates)
+                aRead->start[j] = (size_t)[startCoordinates[j] unsignedLongLongValue];
+            aRead->edges[j] = (size_t)[edgeLengths[j] unsignedLongLongValue];
+        }
+        [reads addObject:aRead];
+    }
+    //Step 2. Regions in the mapping need no library calls at all.
+    if(_usesMappedReads)
     {
-        [newHandle createNewGlobalAttributeWithPropertyList:[theGlobalAttributes[i] propertyList]];
+        [_fileLock lockForReading];
+        mapping = [self mappedFile];
+        for(i=0;i<[reads count] && mapping;i++)
+        {
+            aRead = reads[i];
+            aRead->data = [mapping dataForVariableID:[aRead->variable variableID] start:aRead->start edges:aRead->edges];
+            aRead->isBigEndian = (aRead->data!=nil);
+        }
+        [_fileLock unlockForReading];
     }
-    for(i=0;i<[theDimensions count];i++)
+    for(i=0;i<[reads count];i++)
     {
-        [newHandle createNewDimensionWithPropertyList:[theDimensions[i] propertyList]];
+        aRead = reads[i];
+        if(!aRead->data)
+            [libraryReads addObject:aRead];
     }
-    for(i=0;i<[theVariables count];i++)
+    //Step 3. Everything else in file order through shared ncids.
+    readCount = [libraryReads count];
+    if(readCount>0)
     {
-        BOOL Valid;
-        Valid = YES;
-        for(j=0;j<[nameArray count];j++)
+        [libraryReads sortUsingComparator:^NSComparisonResult(NCDFPlannedRead *first, NCDFPlannedRead *second) {
+            return [first->variable compare:second->variable];
+        }];
+        ncids[0] = [self ncidWithOpenMode:NC_NOWRITE status:&status];
+        workerCount = 1;
+        format = 0;
+        //the netcdf-3 library keeps all of its state per ncid, so reads through different ncids can run together.  HDF5 cannot.
+        if(status!=NC_NOERR)
+            workerCount = 0;
+        else if(![self isInDefineSession] && nc_inq_format(ncids[0],&format)==NC_NOERR && (format==NC_FORMAT_CLASSIC || format==NC_FORMAT_64BIT))
+            workerCount = MIN(MIN(readCount,(size_t)[[NSProcessInfo processInfo] activeProcessorCount]),(size_t)NCDFHandleMaxParallelReads);
+#ifdef NCDF4
+        if(_inMemory && workerCount>1)
+            workerCount = 1;
+#endif
+        //the ncids are checked out here, on the calling thread, so that the workers never wait on the file lock.
+        for(i=1;i<(int32_t)workerCount;i++)
         {
-            if([[theVariables[i] variableName] isEqualToString:nameArray[j]])
-                Valid = NO;
+            ncids[i] = [self ncidWithOpenMode:NC_NOWRITE status:&status];
+            if(status!=NC_NOERR)
+            {
+                workerCount = i;
+                break;
+            }
         }
-        if(Valid)
+        for(i=0;i<(int32_t)readCount && workerCount==0;i++)
         {
-            NSDictionary *aTempDict = [theVariables[i] propertyList];
-            [newHandle refresh];
-            [newHandle createNewVariableWithPropertyList:aTempDict];
+            aRead = libraryReads[i];
+            aRead->status = status;
         }
+        if(workerCount==1)
+        {
+            for(i=0;i<(int32_t)readCount;i++)
+            {
+                aRead = libraryReads[i];
+                aRead->data = [aRead->variable valueArrayWithNCID:ncids[0] start:aRead->start edges:aRead->edges status:&status];
+                aRead->status = status;
+            }
+        }
+        else if(workerCount>1)
+        {
+            /*The library looks every ncid up in its process-wide list of open datasets, which nc_open and nc_close change.  Each read holds ncLibraryLock for reading, so other threads can open and close datasets between reads but not during one.  The workers only read and record their status; errors are posted below, on this thread.*/
+            //each worker reads a contiguous run of the sorted reads.
+            dispatch_apply(workerCount,dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0),^(size_t worker) {
+                size_t k;
+                int32_t readStatus;
+                NCDFPlannedRead *workerRead;
+                for(k=worker*readCount/workerCount;k<(worker+1)*readCount/workerCount;k++)
+                {
+                    workerRead = libraryReads[k];
+                    pthread_rwlock_rdlock(&ncLibraryLock);
+                    workerRead->data = [workerRead->variable valueArrayWithNCID:workerNCIDs[worker] start:workerRead->start edges:workerRead->edges status:&readStatus];
+                    pthread_rwlock_unlock(&ncLibraryLock);
+                    workerRead->status = readStatus;
+                }
+            });
+        }
+        for(i=0;i<(int32_t)workerCount;i++)
+            [self closeNCID:ncids[i]];
     }
-    if(errorCount<[theErrorHandle errorCount])
-    {
-        [theManager removeItemAtPath:tempPath error:nil];
-        return NO;
-    }
-    else
+    //Step 4. Results
+    for(i=0;i<[reads count];i++)
     {
-        [theManager removeItemAtPath:filePath error:nil];
-        [theManager moveItemAtPath:tempPath toPath:filePath error:nil];
-        [self refresh];
-        return YES;
+        aRead = reads[i];
+        if(aRead->data && aRead->isBigEndian)
+            [results setObject:[[NCDFSlab alloc] initSlabWithBigEndianData:aRead->data withType:[aRead->variable variableNC_TYPE] withLengths:aRead->edgeLengths] forKey:aRead->variableName];
+        else if(aRead->data)
+            [results setObject:[[NCDFSlab alloc] initSlabWithData:aRead->data withType:[aRead->variable variableNC_TYPE] withLengths:aRead->edgeLengths] forKey:aRead->variableName];
+        else
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"readVariables" subMethod:[NSString stringWithFormat:@"Reading %@",aRead->variableName] errorCode:aRead->status];
     }
+    return results;
+}
+
+-(void)readVariables:(NSArray *)variableNames atLocations:(NSArray *)startCoordinateArrays edgeLengths:(NSArray *)edgeLengthArrays completion:(void (^)(NSDictionary *slabsByVariableName))completion
+{
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0),^{
+        NSDictionary *results = [self readVariables:variableNames atLocations:startCoordinateArrays edgeLengths:edgeLengthArrays];
+        if(completion)
+            completion(results);
+    });
 }
 
 #pragma mark *** Presently Unclassified Methods ***
 
 -(NCDFVariable *)retrieveVariableByName:(NSString *)aName
 {
-    int32_t i;
-
-    for(i=0;i<[theVariables count];i++)
+    /*The indexes are rebuilt whenever their array has been changed since they were built, including changes made through the array returned by getVariables.  A hit whose name no longer matches was renamed in place.*/
+    NCDFVariable *aVar;
+    if(!aName)
+        return nil;
+    [self loadVariablesIfNeeded];
+    if(_variablesIndexedMutations!=((NCDFIndexedArray *)theVariables)->mutationCount)
+        [self indexVariables];
+    aVar = _variablesByName[aName];
+    if(aVar && ![[aVar variableName] isEqualToString:aName])
     {
-        if([[theVariables[i] variableName] isEqualToString:aName])
-            return theVariables[i];
+        [self indexVariables];
+        aVar = _variablesByName[aName];
     }
-    return nil;
+    return aVar;
 }
 
 -(NCDFDimension *)retrieveDimensionByName:(NSString *)aName
 {
-    int32_t i;
-
-    for(i=0;i<[theDimensions count];i++)
+    if(!aName)
+        return nil;
+    NCDFDimension *aDim;
+    [self loadDimensionsIfNeeded];
+    if(_dimensionsIndexedMutations!=((NCDFIndexedArray *)theDimensions)->mutationCount)
+        [self indexDimensions];
+    aDim = _dimensionsByName[aName];
+    if(aDim && ![[aDim dimensionName] isEqualToString:aName])
     {
-        if([[theDimensions[i] dimensionName] isEqualToString:aName])
-            return theDimensions[i];
+        [self indexDimensions];
+        aDim = _dimensionsByName[aName];
     }
-    return nil;
+    return aDim;
 }
 
 -(NCDFAttribute *)retrieveGlobalAttributeByName:(NSString *)aName
 {
-    int32_t i;
-
-    for(i=0;i<[theGlobalAttributes count];i++)
+    if(!aName)
+        return nil;
+    NCDFAttribute *anAtt;
+    [self loadGlobalAttributesIfNeeded];
+    if(_globalAttributesIndexedMutations!=((NCDFIndexedArray *)theGlobalAttributes)->mutationCount)
+        [self indexGlobalAttributes];
+    anAtt = _globalAttributesByName[aName];
+    if(anAtt && ![[anAtt attributeName] isEqualToString:aName])
     {
-        if([[theGlobalAttributes[i] attributeName] isEqualToString:aName])
-            return theGlobalAttributes[i];
+        [self indexGlobalAttributes];
+        anAtt = _globalAttributesByName[aName];
     }
-    return nil;
+    return anAtt;
 }
 
 -(NCDFDimension *)retrieveUnlimitedDimension
 {
-    int32_t i;
-
-    for(i=0;i<[theDimensions count];i++)
-    {
-        if([theDimensions[i] isUnlimited] )
-            return theDimensions[i];
-    }
-    return nil;
-
+    /*The unlimited dimension id is recorded whenever the dimensions are seeded.*/
+    return [self retrieveDimensionByIndex:_unlimitedDimensionID];
 }
 
 -(NCDFVariable *)retrieveUnlimitedVariable
 {
-    int32_t i;
-    NSString *nameOfUnlimited = [[self retrieveUnlimitedDimension] dimensionName];
-
-    for(i=0;i<[theVariables count];i++)
-    {
-        if([[theVariables[i] variableName] isEqualToString:nameOfUnlimited])
-            return theVariables[i];
-    }
-    return nil;
+    return [self retrieveVariableByName:[[self retrieveUnlimitedDimension] dimensionName]];
 }
 
 -(NCDFDimension *)retrieveDimensionByIndex:(int)index
 {
+    /*theDimensions is kept sorted by dimension id and netcdf dimension ids are contiguous, so the array itself is the id index.*/
+    [self loadDimensionsIfNeeded];
+    if(index<0 || index>=[theDimensions count])
+        return nil;
     return theDimensions[index];
 }
 
 -(BOOL)extendUnlimitedVariableBy:(int)units
 {
-    BOOL result;
-    size_t dimLength;
-    int32_t dataSize,i;
-    NSMutableArray *startCoords;
-    NSMutableArray *endCoords;
-    NSArray *varDimIDs;
-    NSData *emptyObject;
+    /*Writes fill values into the last new record of the unlimited dimension variable.  In fill mode the library fills every record before it, of every record variable, as the dimension grows, so no buffer for the whole extension is needed.*/
     NCDFVariable *aVar = [self retrieveUnlimitedVariable];
+    int32_t ncid,status,unlimitedID,oldFillMode;
+    size_t recordStart,newLength;
+    NSString *subMethod;
 
-    dimLength = [[self retrieveUnlimitedDimension] dimLength];
-    varDimIDs = [aVar variableDimensions];
-    //set start coords
-    startCoords = [[NSMutableArray alloc] init];
-    dataSize = 1 * units;
-    for(i=0;i<[varDimIDs count];i++)
+    if(units<=0)
+        return (units==0);
+    if(!aVar)
     {
-        if(i==0)
-            [startCoords addObject:[NSNumber numberWithInt:(int)dimLength]];
-        else
-            [startCoords addObject:[NSNumber numberWithInt:0]];
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"extendUnlimitedVariableBy" subMethod:@"Finding unlimited variable" errorCode:NC_ENORECVARS];
+        return NO;
+    }
+    ncid = [self ncidWithOpenMode:NC_WRITE status:&status];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"extendUnlimitedVariableBy" subMethod:@"Opening file" errorCode:status];
+        return NO;
     }
-    //end coords
-    endCoords = [[NSMutableArray alloc] init];
-    for(i=0;i<[varDimIDs count];i++)
+    subMethod = @"Inquiring record dimension";
+    unlimitedID = -1;
+    recordStart = 0;
+    status = nc_inq_unlimdim(ncid,&unlimitedID);
+    if(status==NC_NOERR)
+        status = nc_inq_dimlen(ncid,unlimitedID,&recordStart);
+    if(status==NC_NOERR)
     {
-        if(i==0)
-            [endCoords addObject:[NSNumber numberWithInt:(units)]];
-        else
+        subMethod = @"Setting fill mode";
+        status = nc_set_fill(ncid,NC_FILL,&oldFillMode);
+    }
+    if(status==NC_NOERR)
+    {
+        subMethod = @"Writing fill values";
+        status = [self writeFillValuesToRecords:recordStart+(size_t)units-1 count:1 variableID:[aVar variableID] ncid:ncid];
+        nc_set_fill(ncid,oldFillMode,&oldFillMode);
+    }
+    newLength = recordStart;
+    if(status==NC_NOERR)
+        status = nc_inq_dimlen(ncid,unlimitedID,&newLength);
+    if(status!=NC_NOERR)
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"extendUnlimitedVariableBy" subMethod:subMethod errorCode:status];
+    [self closeNCID:ncid];
+    if(newLength!=recordStart)
+        [self setCachedLength:newLength ofUnlimitedDimensionID:unlimitedID];
+    return (status==NC_NOERR);
+}
+
+-(BOOL)appendRecords:(size_t)recordCount withData:(NSDictionary *)dataByVariableName
+{
+    /*Writes recordCount new records for every record variable named in dataByVariableName through one writable ncid.*/
+    int32_t ncid,status,unlimitedID,varCount,varID,ndims,i,j,oldFillMode;
+    int dimIDs[NC_MAX_VAR_DIMS];
+    nc_type type;
+    size_t start[NC_MAX_VAR_DIMS],count[NC_MAX_VAR_DIMS],recordStart,newLength,byteCount;
+    char varCName[NC_MAX_NAME+1];
+    NSArray *names;
+    NSData *theData;
+    NSString *subMethod;
+    NSMutableIndexSet *writtenVarIDs;
+    BOOL coversAllRecordVariables,fillChanged;
+
+    if(recordCount==0)
+        return YES;
+    ncid = [self ncidWithOpenMode:NC_WRITE status:&status];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"appendRecords" subMethod:@"Opening file" errorCode:status];
+        return NO;
+    }
+    //Step 1. Find the record variables
+    subMethod = @"Inquiring record variables";
+    unlimitedID = -1;
+    recordStart = 0;
+    varCount = 0;
+    coversAllRecordVariables = YES;
+    status = nc_inq_unlimdim(ncid,&unlimitedID);
+    if(status==NC_NOERR && unlimitedID<0)
+        status = NC_ENORECVARS;
+    if(status==NC_NOERR)
+        status = nc_inq_dimlen(ncid,unlimitedID,&recordStart);
+    if(status==NC_NOERR)
+        status = nc_inq_nvars(ncid,&varCount);
+    for(varID=0;varID<varCount && status==NC_NOERR && coversAllRecordVariables;varID++)
+    {
+        status = nc_inq_varndims(ncid,varID,&ndims);
+        if(status==NC_NOERR && ndims>0)
+            status = nc_inq_vardimid(ncid,varID,dimIDs);
+        if(status==NC_NOERR && ndims>0 && dimIDs[0]==unlimitedID)
         {
-            [endCoords addObject:[NSNumber numberWithInt:(int)[[self retrieveDimensionByIndex:[varDimIDs[i] intValue]] dimLength]]];
+            status = nc_inq_varname(ncid,varID,varCName);
+            if(status==NC_NOERR && !dataByVariableName[[NSString stringWithUTF8String:varCName]])
+                coversAllRecordVariables = NO;
         }
     }
-    dataSize *= [aVar sizeUnitVariableForType];
-    emptyObject = [NSData dataWithData:[NSMutableData dataWithLength:dataSize]];
-    result  = [aVar writeValueArrayAtLocation:startCoords edgeLengths:endCoords withValue:emptyObject];
-    [self refresh];
-    if(!result)
-        NSLog(@"extendUnlimitedVariableBy failed");
-    else
-        NSLog(@"extendUnlimitedVariableBy okay");
-    return result;
+    //the library would otherwise write fill values into every new record before the data goes in.  Unwritten record variables still need them.
+    fillChanged = NO;
+    if(status==NC_NOERR && coversAllRecordVariables)
+    {
+        status = nc_set_fill(ncid,NC_NOFILL,&oldFillMode);
+        fillChanged = (status==NC_NOERR);
+    }
+    //Step 2. Write the records
+    names = [dataByVariableName allKeys];
+    writtenVarIDs = [NSMutableIndexSet indexSet];
+    for(i=0;i<[names count] && status==NC_NOERR;i++)
+    {
+        theData = dataByVariableName[names[i]];
+        subMethod = @"Inquiring variable";
+        [names[i] getCString:varCName maxLength:NC_MAX_NAME+1 encoding:NSUTF8StringEncoding];
+        ndims = 0;
+        status = nc_inq_varid(ncid,varCName,&varID);
+        if(status==NC_NOERR)
+            status = nc_inq_vartype(ncid,varID,&type);
+        if(status==NC_NOERR)
+            status = nc_inq_varndims(ncid,varID,&ndims);
+        if(status==NC_NOERR)
+            status = nc_inq_vardimid(ncid,varID,dimIDs);
+        if(status==NC_NOERR && (ndims==0 || dimIDs[0]!=unlimitedID))
+        {
+            subMethod = @"Not a record variable";
+            status = NC_ENORECVARS;
+        }
+        if(status!=NC_NOERR)
+            break;
+        start[0] = recordStart;
+        count[0] = recordCount;
+        byteCount = recordCount*NCDFSizeOfType(type);
+        for(j=1;j<ndims && status==NC_NOERR;j++)
+        {
+            start[j] = 0;
+            status = nc_inq_dimlen(ncid,dimIDs[j],&count[j]);
+            byteCount *= count[j];
+        }
+        if(status==NC_NOERR && [theData length]!=byteCount)
+        {
+            subMethod = @"Data length does not match records";
+            status = NC_EEDGE;
+        }
+        if(status==NC_NOERR)
+        {
+            subMethod = @"Writing records";
+            status = nc_put_vara(ncid,varID,start,count,[theData bytes]);
+            if(status==NC_NOERR)
+                [writtenVarIDs addIndex:(NSUInteger)varID];
+        }
+    }
+    if(fillChanged)
+        nc_set_fill(ncid,oldFillMode,&oldFillMode);
+    //only the record count can have changed, so the unlimited dimension is updated in place.
+    newLength = recordStart;
+    if(unlimitedID>=0)
+        nc_inq_dimlen(ncid,unlimitedID,&newLength);
+    if(status!=NC_NOERR)
+    {
+        if(fillChanged && newLength>recordStart)
+        {
+            /*An earlier write extended the records in no-fill mode, and the records cannot be removed again.  Every record variable that was not written gets fill values, so the partial records read as missing rather than as whatever was on disk.*/
+            int32_t fillStatus = NC_NOERR;
+            for(varID=0;varID<varCount && fillStatus==NC_NOERR;varID++)
+            {
+                if([writtenVarIDs containsIndex:(NSUInteger)varID])
+                    continue;
+                fillStatus = nc_inq_varndims(ncid,varID,&ndims);
+                if(fillStatus==NC_NOERR && ndims>0)
+                    fillStatus = nc_inq_vardimid(ncid,varID,dimIDs);
+                if(fillStatus==NC_NOERR && ndims>0 && dimIDs[0]==unlimitedID)
+                    fillStatus = [self writeFillValuesToRecords:recordStart count:newLength-recordStart variableID:varID ncid:ncid];
+            }
+            if(fillStatus!=NC_NOERR)
+                [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"appendRecords" subMethod:@"Writing fill values" errorCode:fillStatus];
+        }
+        if(newLength>recordStart)
+            subMethod = [NSString stringWithFormat:@"%@ (the record dimension was left at %zu records, %zu of them added)",subMethod,newLength,newLength-recordStart];
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"appendRecords" subMethod:subMethod errorCode:status];
+    }
+    [self closeNCID:ncid];
+    if(newLength!=recordStart)
+        [self setCachedLength:newLength ofUnlimitedDimensionID:unlimitedID];
+    return (status==NC_NOERR);
 }
 
 -(NSString *)htmlDescription
 {
     NSMutableString *theString = [[NSMutableString alloc] init];
+    [self loadMetadataIfNeeded];
     //Step 1. Header
     [theString appendString:@"<html>\n"];
     [theString appendString:@"<head>\n"];
@@ -1467,9 +3407,7 @@ static NSLock *fileDatabaseLock;
 {
     int32_t ncid;
     int32_t status;
-    [fileDatabaseLock lock];
-    status = nc_open([filePath cStringUsingEncoding:NSUTF8StringEncoding],NC_NOWRITE,&ncid);
-    [fileDatabaseLock unlock];
+    ncid = [self ncidWithOpenMode:NC_NOWRITE status:&status];
     if(status != NC_NOERR)
     {
         [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"ncidForReadOnly" subMethod:@"Opening netCDF file" errorCode:status];
@@ -1481,31 +3419,396 @@ static NSLock *fileDatabaseLock;
 
 -(int)ncidWithOpenMode:(int)openMode status:(int32_t *)status
 {
-    int32_t ncid;
-    [fileDatabaseLock lock];
-    if(openMode	== NC_WRITE)
-        openMode = NC_WRITE|NC_SHARE;
-    else if(openMode == NC_NOWRITE)
-        openMode = NC_SHARE;
-    *status = nc_open([filePath cStringUsingEncoding:NSUTF8StringEncoding],openMode,&ncid);
-    [fileDatabaseLock unlock];
+    int32_t ncid,i;
+    BOOL forWriting = (openMode & NC_WRITE) ? YES : NO;
+    NCDFPooledNCID *entry = nil;
+    uint64_t generation;
+
+    if([self isInDefineSession])
+    {
+        //everything this thread does inside its define session goes through the session ncid.  Data access needs data mode.
+        *status = NC_NOERR;
+        if(_defineSessionInDefineMode)
+        {
+            *status = [self endDefineModeForNCID:_defineSessionNCID];
+            if(*status != NC_NOERR)
+                return -1;
+            _defineSessionInDefineMode = NO;
+        }
+        return _defineSessionNCID;
+    }
+    if(forWriting && _memoryReadOnly)
+    {
+        *status = NC_EPERM;
+        return -1;
+    }
+#ifdef NCDF4
+    if(_inMemory)
+        return [self checkOutInMemoryNCIDForWriting:forWriting status:status];
+#endif
+
+    if(forWriting)
+        [_fileLock lockForWriting];
+    else
+        [_fileLock lockForReading];
+    generation = [_fileLock writeGeneration];
+    [_ncidPoolLock lock];
+    if(forWriting)
+    {
+        //read-only ncids would hold a stale header after this write.
+        for(i=(int32_t)[_ncidPool count]-1;i>=0;i--)
+        {
+            NCDFPooledNCID *anEntry = _ncidPool[i];
+            if(anEntry->openMode==NC_NOWRITE)
+            {
+                if(!anEntry->inUse)
+                    [self closePooledNCID:anEntry];
+                else
+                    anEntry->isStale = YES;
+            }
+        }
+    }
+    for(i=0;i<[_ncidPool count];i++)
+    {
+        NCDFPooledNCID *anEntry = _ncidPool[i];
+        if(anEntry->inUse || anEntry->isStale)
+            continue;
+        if(forWriting && anEntry->openMode!=NC_WRITE)
+            continue;
+        entry = anEntry;
+        break;
+    }
+    if(entry && (entry->writeGeneration!=generation || ![self fileSignatureMatchesPooledNCID:entry]))
+    {
+        //the file was written by another handle or process.  None of the idle ncids can be trusted.
+        for(i=(int32_t)[_ncidPool count]-1;i>=0;i--)
+        {
+            NCDFPooledNCID *anEntry = _ncidPool[i];
+            if(!anEntry->inUse)
+                [self closePooledNCID:anEntry];
+            else
+                anEntry->isStale = YES;
+        }
+        entry = nil;
+    }
+    if(!entry)
+    {
+        openMode = forWriting ? NC_WRITE : NC_NOWRITE;
+        if(_sharedAccess)
+            openMode |= NC_SHARE;
+        pthread_rwlock_wrlock(&ncLibraryLock);
+        *status = nc_open([filePath cStringUsingEncoding:NSUTF8StringEncoding],openMode,&ncid);
+        pthread_rwlock_unlock(&ncLibraryLock);
+        if(*status != NC_NOERR)
+        {
+            [_ncidPoolLock unlock];
+            if(forWriting)
+                [_fileLock unlockForWriting];
+            else
+                [_fileLock unlockForReading];
+            return -1;
+        }
+        entry = [[NCDFPooledNCID alloc] init];
+        entry->ncid = ncid;
+        entry->openMode = forWriting ? NC_WRITE : NC_NOWRITE;
+        entry->writeGeneration = generation;
+        [self recordFileSignatureForPooledNCID:entry];
+        [_ncidPool addObject:entry];
+    }
+    *status = NC_NOERR;
+    entry->inUse = YES;
+    entry->owner = self;
+    entry->lockedForWriting = forWriting;
+    if(forWriting)
+        entry->checkedOutForWriting = YES;
+    entry->lastUsed = [NSDate timeIntervalSinceReferenceDate];
+    ncid = entry->ncid;
+    [_ncidPoolLock unlock];
     return ncid;
 }
 
 -(void)closeNCID:(int)ncid
 {
     int32_t status;
-    [fileDatabaseLock lock];
-    status = nc_close(ncid);
-    [fileDatabaseLock unlock];
+    int32_t idleCount,i;
+    BOOL wasLockedForWriting;
+    uint64_t generation;
+    NCDFPooledNCID *entry;
+    NCDFHandle *checkoutOwner NS_VALID_UNTIL_END_OF_SCOPE;
+
+    if([self isInDefineSession] && ncid==_defineSessionNCID)
+        return;
+#ifdef NCDF4
+    if(_inMemory && ncid==_memoryNCID)
+    {
+        [self checkInInMemoryNCID:ncid];
+        return;
+    }
+#endif
+    [_ncidPoolLock lock];
+    entry = [self pooledNCIDForNCID:ncid];
+    if(!entry)
+    {
+        [_ncidPoolLock unlock];
+        pthread_rwlock_wrlock(&ncLibraryLock);
+        status = nc_close(ncid);
+        pthread_rwlock_unlock(&ncLibraryLock);
+        if(status != NC_NOERR)
+        {
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"closeNCID" subMethod:@"Closing netCDF file" errorCode:status];
+        }
+        return;
+    }
+    entry->inUse = NO;
+    //kept until the end of this method, which may be the last use of the handle.
+    checkoutOwner = entry->owner;
+    entry->owner = nil;
+    entry->lastUsed = [NSDate timeIntervalSinceReferenceDate];
+    wasLockedForWriting = entry->lockedForWriting;
+    if(entry->checkedOutForWriting)
+    {
+        //nc_close used to end define mode and flush.  Do the same without closing.
+        entry->checkedOutForWriting = NO;
+        status = [self endDefineModeForNCID:ncid];
+        if(status==NC_NOERR || status==NC_ENOTINDEFINE)
+            status = nc_sync(ncid);
+        if(status != NC_NOERR)
+        {
+            [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"closeNCID" subMethod:@"Ending define mode" errorCode:status];
+            entry->isStale = YES;
+        }
+        else
+            [self recordFileSignatureForPooledNCID:entry];
+    }
+    idleCount = 0;
+    for(i=0;i<[_ncidPool count];i++)
+    {
+        NCDFPooledNCID *anEntry = _ncidPool[i];
+        if(!anEntry->inUse && anEntry->openMode==entry->openMode)
+            idleCount++;
+    }
+    if(entry->isStale || _ncidIdleTimeout<=0.0 || idleCount>NCDFHandleMaxIdleNCIDsPerMode)
+        [self closePooledNCID:entry];
+    [_ncidPoolLock unlock];
+    if(wasLockedForWriting)
+    {
+        generation = [_fileLock unlockForWriting];
+        //this handle's own write is the one that moved the generation on.
+        [_ncidPoolLock lock];
+        if([_ncidPool containsObject:entry] && !entry->inUse && !entry->isStale)
+            entry->writeGeneration = generation;
+        [_ncidPoolLock unlock];
+        //cached blocks of the old generation can never be hit again.
+        [[NCDFBlockCache sharedCache] removeBlocksForPath:[_fileLock path]];
+    }
+    else
+        [_fileLock unlockForReading];
+    [self scheduleIdleNCIDPurge];
+}
+
+-(int)ncidForDefineWithStatus:(int32_t *)status
+{
+    int32_t ncid;
+    if([self isInDefineSession])
+    {
+        *status = NC_NOERR;
+        if(!_defineSessionInDefineMode)
+        {
+            *status = nc_redef(_defineSessionNCID);
+            if(*status != NC_NOERR)
+                return -1;
+            _defineSessionInDefineMode = YES;
+        }
+        return _defineSessionNCID;
+    }
+    ncid = [self ncidWithOpenMode:NC_WRITE status:status];
+    if(*status != NC_NOERR)
+        return -1;
+    *status = nc_redef(ncid);
+    if(*status != NC_NOERR)
+    {
+        [self closeNCID:ncid];
+        return -1;
+    }
+    return ncid;
+}
+
+-(void)closeAll
+{
+    int32_t i;
+    [_ncidPoolLock lock];
+    for(i=(int32_t)[_ncidPool count]-1;i>=0;i--)
+    {
+        NCDFPooledNCID *entry = _ncidPool[i];
+        if(!entry->inUse)
+            [self closePooledNCID:entry];
+        else
+            entry->isStale = YES;
+    }
+    [_ncidPoolLock unlock];
+    @synchronized(self)
+    {
+        _mappedFile = nil;
+        _mappedFileUnavailable = NO;
+    }
+}
+
+-(void)setNCIDIdleTimeout:(NSTimeInterval)timeout
+{
+    [_ncidPoolLock lock];
+    _ncidIdleTimeout = timeout;
+    [_ncidPoolLock unlock];
+    if(timeout<=0.0)
+        [self closeAll];
+    else
+        [self scheduleIdleNCIDPurge];
+}
+
+-(NSTimeInterval)ncidIdleTimeout
+{
+    return _ncidIdleTimeout;
+}
+
+-(void)setSharedAccess:(BOOL)shared
+{
+    if(_sharedAccess==shared)
+        return;
+    _sharedAccess = shared;
+    [self closeAll];
+}
+
+-(BOOL)sharedAccess
+{
+    return _sharedAccess;
+}
+
+-(void)setHeaderFreeSpace:(size_t)bytes
+{
+    _headerFreeSpace = bytes;
+}
+
+-(size_t)headerFreeSpace
+{
+    return _headerFreeSpace;
+}
+
+-(void)setVariableAlignment:(size_t)vAlign recordAlignment:(size_t)rAlign
+{
+    _variableAlignment = vAlign;
+    _recordAlignment = rAlign;
+}
+
+-(size_t)variableAlignment
+{
+    return _variableAlignment;
+}
+
+-(size_t)recordAlignment
+{
+    return _recordAlignment;
+}
+
+-(void)setRewriteMemoryCeiling:(size_t)bytes
+{
+    _rewriteMemoryCeiling = bytes;
+}
+
+-(size_t)rewriteMemoryCeiling
+{
+    return _rewriteMemoryCeiling;
+}
+
+-(void)setUsesMappedReads:(BOOL)mapped
+{
+    _usesMappedReads = mapped;
+}
+
+-(BOOL)usesMappedReads
+{
+    return _usesMappedReads;
+}
+
+-(NCDFMappedFile *)mappedFile
+{
+    NCDFMappedFile *mapping;
+    uint64_t generation;
+    //data written inside a define session has not reached the file yet.
+    if([self isInDefineSession])
+        return nil;
+#ifdef NCDF4
+    //the file on disk, if there is one, is not the dataset being worked on.
+    if(_inMemory)
+        return nil;
+#endif
+    generation = [_fileLock writeGeneration];
+    @synchronized(self)
+    {
+        if(_mappedFileGeneration!=generation || (_mappedFile && ![_mappedFile matchesFileOnDisk]))
+        {
+            _mappedFile = nil;
+            _mappedFileUnavailable = NO;
+        }
+        if(!_mappedFile && !_mappedFileUnavailable)
+        {
+            _mappedFile = [[NCDFMappedFile alloc] initWithPath:filePath];
+            _mappedFileGeneration = generation;
+            //netCDF-4 files are not tried again until the file changes.
+            _mappedFileUnavailable = (_mappedFile==nil);
+        }
+        mapping = _mappedFile;
+    }
+    return mapping;
+}
+
+-(BOOL)isInMemory
+{
+    return _inMemory;
+}
+
+-(BOOL)closeInMemoryDataset
+{
+#ifdef NCDF4
+    NSFileManager *theManager = [NSFileManager defaultManager];
+    int32_t status;
+    if(!_inMemory || _memoryNCID<0)
+        return YES;
+    [_fileLock lockForWriting];
+    pthread_rwlock_wrlock(&ncLibraryLock);
+    status = nc_close(_memoryNCID);
+    pthread_rwlock_unlock(&ncLibraryLock);
+    _memoryNCID = -1;
+    _memoryData = nil;
+    //after a rewrite the dataset was persisted to the rewrite's temporary path.
+    if(status==NC_NOERR && _memoryPersistPath && ![_memoryPersistPath isEqualToString:filePath])
+    {
+        [theManager removeItemAtPath:filePath error:nil];
+        if(![theManager moveItemAtPath:_memoryPersistPath toPath:filePath error:nil])
+            status = NC_EPERM;
+    }
+    _memoryPersistPath = nil;
+    [_fileLock unlockForWriting];
     if(status != NC_NOERR)
     {
-        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"closeNCID" subMethod:@"Closing netCDF file" errorCode:status];
+        [theErrorHandle addErrorFromSource:filePath className:@"NCDFHandle" methodName:@"closeInMemoryDataset" subMethod:@"Closing dataset" errorCode:status];
+        return NO;
     }
+    return YES;
+#else
+    //without netCDF-4 no handle is ever in memory.
+    return YES;
+#endif
 }
 
 -(void)dealloc
 {
+    int32_t i;
+    if(_inMemory)
+        [self closeInMemoryDataset];
+    //a checked out ncid keeps its handle alive until it is returned, so every ncid left in the pool is idle.
+    for(i=(int32_t)[_ncidPool count]-1;i>=0;i--)
+        [self closePooledNCID:_ncidPool[i]];
+    _ncidPool = nil;
+    _ncidPoolLock = nil;
     theVariables = nil;
     theGlobalAttributes = nil;
     theDimensions = nil;
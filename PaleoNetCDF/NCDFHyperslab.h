@@ -0,0 +1,169 @@
+//
+//  NCDFHyperslab.h
+//  netcdf
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+/*!
+ @header
+ @abstract C helpers for walking a variable in bounded-size hyperslabs.
+ @discussion These functions work directly on open ncids so that large variables can be read and written a tile at a time instead of being materialized in memory as a whole.  A tile is planned from the shape of the region and a memory ceiling, filling the fastest varying dimensions first so that each tile is as contiguous on disk as the ceiling allows.
+ */
+
+#import <Foundation/Foundation.h>
+#import <netcdf.h>
+
+/*!
+ @defined NCDFReorderConcurrentMinimumBytes
+ @discussion Buffers at least this large are reordered by NCDFReverseUnits and NCDFRotateUnits on several threads when concurrency is allowed.
+ */
+#define NCDFReorderConcurrentMinimumBytes (4*1024*1024)
+
+/*!
+ @function NCDFSizeOfType
+ @abstract Returns the size in bytes of one element of a netcdf external type.
+ @param type NC_BYTE, NC_CHAR, NC_SHORT, NC_INT, NC_FLOAT or NC_DOUBLE.
+ @result The element size, or 0 for an unknown type.
+ */
+size_t NCDFSizeOfType(nc_type type);
+
+/*!
+ @function NCDFPlanTile
+ @abstract Chooses the largest tile of a region that fits within a memory ceiling.
+ @param ndims number of dimensions of the region.
+ @param shape length of the region along each dimension.
+ @param elementSize size in bytes of one element.
+ @param memoryCeiling maximum size in bytes of one tile.  A tile is always at least one element.
+ @param tile returns the tile length along each dimension.
+ @result The number of elements in one full tile, or 0 if the region is empty.
+ */
+size_t NCDFPlanTile(int ndims,const size_t *shape,size_t elementSize,size_t memoryCeiling,size_t *tile);
+
+/*!
+ @function NCDFAdvanceTile
+ @abstract Moves start to the next tile of a region.
+ @param ndims number of dimensions of the region.
+ @param shape length of the region along each dimension.
+ @param tile tile lengths returned by NCDFPlanTile.
+ @param start the corner of the current tile, updated in place.  Begin with every index at 0.
+ @param count returns the lengths of the tile at the new start, trimmed at the edges of the region.
+ @result NO once every tile has been visited.
+ */
+BOOL NCDFAdvanceTile(int ndims,const size_t *shape,const size_t *tile,size_t *start,size_t *count);
+
+/*!
+ @function NCDFPlanChunk
+ @abstract Chooses the largest tile of a region that fits within a memory ceiling, splitting only some dimensions.
+ @param ndims number of dimensions of the region.
+ @param shape length of the region along each dimension.
+ @param split YES for each dimension that may be split.  Dimensions that may not are always whole in the tile.  NULL lets every dimension be split, as NCDFPlanTile does.
+ @param elementSize size in bytes of one element.
+ @param memoryCeiling maximum size in bytes of one tile.  A tile holds at least one element along each split dimension, so whole dimensions that may not be split can make it larger.
+ @param tile returns the tile length along each dimension.
+ @result The number of elements in one full tile, or 0 if the region is empty.
+ */
+size_t NCDFPlanChunk(int ndims,const size_t *shape,const BOOL *split,size_t elementSize,size_t memoryCeiling,size_t *tile);
+
+/*!
+ @function NCDFArrayFromSizes
+ @abstract Returns an array of NSNumber objects holding count sizes, the form coordinates take in the Objective-C API.
+ */
+NSArray *NCDFArrayFromSizes(int count,const size_t *sizes);
+
+/*!
+ @function NCDFEnumerateTiles
+ @abstract Reads a region one tile at a time and hands each tile to a visitor.
+ @param ndims number of dimensions of the region.
+ @param shape length of the region along each dimension.
+ @param tile tile lengths returned by NCDFPlanTile or NCDFPlanChunk.
+ @param prefetch YES to read the next tile on a background queue while the visitor runs.  At most two tiles are then in memory.
+ @param reader reads one tile, or returns nil.
+ @param visitor receives each tile with its corner and lengths.  Setting *stop to YES ends the enumeration.
+ @result NO if the reader failed.
+ @discussion Tiles are visited in row-major order of their corners.  The start and count arrays passed to the blocks are only valid during the call.
+ */
+BOOL NCDFEnumerateTiles(int ndims,const size_t *shape,const size_t *tile,BOOL prefetch,NSData *(^reader)(const size_t *start,const size_t *count),void (^visitor)(NSData *data,const size_t *start,const size_t *count,BOOL *stop));
+
+/*!
+ @function NCDFReverseUnits
+ @abstract Reverses the order of units within each block of a buffer, in place.
+ @param buffer outerCount blocks laid end to end, each holding unitCount units of unitBytes bytes.
+ @param outerCount number of blocks, the product of the lengths of the dimensions before the reversed one.
+ @param unitCount number of units in a block, the length of the reversed dimension.
+ @param unitBytes size in bytes of one unit, the element size times the lengths of the dimensions after the reversed one.
+ @param concurrent YES to reverse blocks on several threads when the buffer is at least NCDFReorderConcurrentMinimumBytes.
+ @discussion Units are swapped pairwise with memcpy through a small stack buffer, so no memory is allocated.
+ */
+void NCDFReverseUnits(void *buffer,size_t outerCount,size_t unitCount,size_t unitBytes,BOOL concurrent);
+
+/*!
+ @function NCDFRotateUnits
+ @abstract Rotates the units within each block of a buffer, in place.
+ @param shift the unit at position p moves to position p+shift, wrapping at the end of the block.  Negative values rotate the other way.
+ @result NO if the scratch buffer could not be allocated.
+ @discussion buffer, outerCount, unitCount, unitBytes and concurrent are as for NCDFReverseUnits.  Each block is rotated with one memmove and two memcpy calls through a scratch buffer holding the shorter of the two parts that trade places, at most half a block per thread.
+ */
+BOOL NCDFRotateUnits(void *buffer,size_t outerCount,size_t unitCount,size_t unitBytes,ptrdiff_t shift,BOOL concurrent);
+
+/*!
+ @function NCDFCopyVariableData
+ @abstract Copies a region of a variable from one open ncid to another in tiles.
+ @param srcNCID ncid to read from.
+ @param srcVarID variable to read from.
+ @param dstNCID ncid to write to.  It must be in data mode.
+ @param dstVarID variable to write to.  It must have the same type and number of dimensions as the source.
+ @param ndims number of dimensions of both variables.
+ @param shape length of the region to copy along each dimension, starting at the origin.
+ @param memoryCeiling maximum number of bytes held in memory at any time.
+ @result NC_NOERR or the netcdf status of the first failed call.
+ @discussion Data is copied in the file's external type, so no conversion takes place.
+ */
+int NCDFCopyVariableData(int srcNCID,int srcVarID,int dstNCID,int dstVarID,int ndims,const size_t *shape,size_t memoryCeiling);
+
+/*!
+ @function NCDFRowMajorImap
+ @abstract Fills an index map that lays a region out in memory in the usual row-major order.
+ @param ndims number of dimensions of the region.
+ @param count length of the region along each dimension.
+ @param imap returns the distance in elements between neighbouring values along each dimension.
+ */
+void NCDFRowMajorImap(int ndims,const size_t *count,ptrdiff_t *imap);
+
+/*!
+ @function NCDFTransposedImap
+ @abstract Fills an index map that lays a region out in memory with its dimensions reordered.
+ @param ndims number of dimensions of the region.
+ @param count length of the region along each variable dimension.
+ @param order order[i] is the variable dimension that becomes dimension i of the laid out data.  Must be a permutation of 0 to ndims-1.
+ @param imap returns, for each variable dimension, the distance in elements between neighbouring values.
+ @discussion Reading with this map through nc_get_varm_* transposes the data on the fly.
+ */
+void NCDFTransposedImap(int ndims,const size_t *count,const int *order,ptrdiff_t *imap);
+
+/*!
+ @function NCDFImapExtent
+ @abstract Returns the number of elements a buffer needs to receive a region laid out with an index map.
+ @param ndims number of dimensions of the region.
+ @param count length of the region along each dimension.
+ @param imap non-negative distances in elements between neighbouring values along each dimension.
+ @result The number of elements from the first to the last value, or 0 if the region is empty.
+ */
+size_t NCDFImapExtent(int ndims,const size_t *count,const ptrdiff_t *imap);
+
+/*!
+ @function NCDFCopyStridedRegion
+ @abstract Copies a strided region of a row-major array in memory to a buffer laid out with an index map.
+ @param ndims number of dimensions of the array.
+ @param shape length of the array along each dimension.
+ @param elementSize size in bytes of one element.
+ @param source the array.
+ @param start corner of the region.
+ @param count number of values to copy along each dimension.
+ @param stride distance between copied values along each dimension, at least 1.
+ @param imap distance in elements between neighbouring values in destination along each dimension.
+ @param destination buffer of at least NCDFImapExtent elements.
+ @discussion The in-memory counterpart of nc_get_varm_*, used by NCDFSlab.  Values are copied as they are, without byte order conversion.
+ */
+void NCDFCopyStridedRegion(int ndims,const size_t *shape,size_t elementSize,const void *source,const size_t *start,const size_t *count,const ptrdiff_t *stride,const ptrdiff_t *imap,void *destination);
@@ -0,0 +1,426 @@
+//
+//  NCDFHyperslab.m
+//  netcdf
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import "NCDFHyperslab.h"
+
+size_t NCDFSizeOfType(nc_type type)
+{
+    switch(type)
+    {
+        case NC_BYTE:
+        case NC_CHAR:
+            return 1;
+        case NC_SHORT:
+            return 2;
+        case NC_INT:
+        case NC_FLOAT:
+            return 4;
+        case NC_DOUBLE:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+size_t NCDFPlanTile(int ndims,const size_t *shape,size_t elementSize,size_t memoryCeiling,size_t *tile)
+{
+    size_t budget,elements;
+    int32_t i;
+    for(i=0;i<ndims;i++)
+    {
+        if(shape[i]==0)
+            return 0;
+    }
+    if(elementSize==0)
+        elementSize = 1;
+    budget = memoryCeiling/elementSize;
+    if(budget<1)
+        budget = 1;
+    elements = 1;
+    //fill from the fastest varying dimension so each tile is one contiguous run when possible.
+    for(i=ndims-1;i>=0;i--)
+    {
+        if(budget>=shape[i])
+        {
+            tile[i] = shape[i];
+            budget /= shape[i];
+        }
+        else
+        {
+            tile[i] = budget;
+            budget = 1;
+        }
+        elements *= tile[i];
+    }
+    return elements;
+}
+
+BOOL NCDFAdvanceTile(int ndims,const size_t *shape,const size_t *tile,size_t *start,size_t *count)
+{
+    int32_t i;
+    for(i=ndims-1;i>=0;i--)
+    {
+        start[i] += tile[i];
+        if(start[i]<shape[i])
+            break;
+        start[i] = 0;
+    }
+    if(i<0)
+        return NO;
+    for(i=0;i<ndims;i++)
+    {
+        count[i] = tile[i];
+        if(start[i]+count[i]>shape[i])
+            count[i] = shape[i]-start[i];
+    }
+    return YES;
+}
+
+size_t NCDFPlanChunk(int ndims,const size_t *shape,const BOOL *split,size_t elementSize,size_t memoryCeiling,size_t *tile)
+{
+    size_t *splitShape,*splitTile;
+    size_t wholeElements,elements;
+    int32_t i,splitCount;
+    if(!split)
+        return NCDFPlanTile(ndims,shape,elementSize,memoryCeiling,tile);
+    for(i=0;i<ndims;i++)
+    {
+        if(shape[i]==0)
+            return 0;
+    }
+    if(elementSize==0)
+        elementSize = 1;
+    splitShape = (size_t *)malloc(sizeof(size_t)*(ndims+1));
+    splitTile = (size_t *)malloc(sizeof(size_t)*(ndims+1));
+    //the dimensions kept whole act as one larger element for the split ones.
+    wholeElements = 1;
+    splitCount = 0;
+    for(i=0;i<ndims;i++)
+    {
+        if(split[i])
+            splitShape[splitCount++] = shape[i];
+        else
+        {
+            tile[i] = shape[i];
+            wholeElements *= shape[i];
+        }
+    }
+    elements = wholeElements*NCDFPlanTile(splitCount,splitShape,elementSize*wholeElements,memoryCeiling,splitTile);
+    splitCount = 0;
+    for(i=0;i<ndims;i++)
+    {
+        if(split[i])
+            tile[i] = splitTile[splitCount++];
+    }
+    free(splitShape);
+    free(splitTile);
+    return elements;
+}
+
+NSArray *NCDFArrayFromSizes(int count,const size_t *sizes)
+{
+    NSMutableArray *theArray = [NSMutableArray arrayWithCapacity:count];
+    int32_t i;
+    for(i=0;i<count;i++)
+        [theArray addObject:[NSNumber numberWithUnsignedLongLong:sizes[i]]];
+    return theArray;
+}
+
+BOOL NCDFEnumerateTiles(int ndims,const size_t *shape,const size_t *tile,BOOL prefetch,NSData *(^reader)(const size_t *start,const size_t *count),void (^visitor)(NSData *data,const size_t *start,const size_t *count,BOOL *stop))
+{
+    size_t *start,*count,*nextStart,*nextCount,*swap;
+    __block NSData *nextData;
+    NSData *theData;
+    dispatch_group_t group;
+    BOOL hasNext,stop,isValid;
+    int32_t i;
+
+    for(i=0;i<ndims;i++)
+    {
+        if(shape[i]==0)
+            return YES;
+    }
+    start = (size_t *)calloc(ndims+1,sizeof(size_t));
+    count = (size_t *)calloc(ndims+1,sizeof(size_t));
+    nextStart = (size_t *)calloc(ndims+1,sizeof(size_t));
+    nextCount = (size_t *)calloc(ndims+1,sizeof(size_t));
+    for(i=0;i<ndims;i++)
+        count[i] = MIN(tile[i],shape[i]);
+    group = prefetch ? dispatch_group_create() : nil;
+    theData = reader(start,count);
+    isValid = (theData!=nil);
+    stop = NO;
+    while(isValid)
+    {
+        @autoreleasepool {
+            memcpy(nextStart,start,sizeof(size_t)*ndims);
+            hasNext = NCDFAdvanceTile(ndims,shape,tile,nextStart,nextCount);
+            nextData = nil;
+            //the next tile is read while the visitor works on this one.
+            if(hasNext && prefetch)
+            {
+                const size_t *readStart = nextStart;
+                const size_t *readCount = nextCount;
+                dispatch_group_async(group,dispatch_get_global_queue(QOS_CLASS_UTILITY,0),^{
+                    nextData = reader(readStart,readCount);
+                });
+            }
+            visitor(theData,start,count,&stop);
+            if(hasNext && prefetch)
+                dispatch_group_wait(group,DISPATCH_TIME_FOREVER);
+            if(stop || !hasNext)
+                break;
+            theData = prefetch ? nextData : reader(nextStart,nextCount);
+            isValid = (theData!=nil);
+            swap = start;
+            start = nextStart;
+            nextStart = swap;
+            swap = count;
+            count = nextCount;
+            nextCount = swap;
+        }
+    }
+    free(start);
+    free(count);
+    free(nextStart);
+    free(nextCount);
+    return isValid;
+}
+
+static void NCDFSwapBytes(uint8_t *a,uint8_t *b,size_t length)
+{
+    uint8_t temp[4096];
+    size_t n;
+    while(length>0)
+    {
+        n = MIN(length,sizeof(temp));
+        memcpy(temp,a,n);
+        memcpy(a,b,n);
+        memcpy(b,temp,n);
+        a += n;
+        b += n;
+        length -= n;
+    }
+}
+
+/*Returns how many threads share a reorder of outerCount blocks, 1 unless concurrency is allowed and worth it.*/
+static size_t NCDFReorderWorkerCount(size_t outerCount,size_t totalBytes,BOOL concurrent)
+{
+    if(!concurrent || outerCount<2 || totalBytes<NCDFReorderConcurrentMinimumBytes)
+        return 1;
+    return MAX(MIN(outerCount,(size_t)[[NSProcessInfo processInfo] activeProcessorCount]),(size_t)1);
+}
+
+void NCDFReverseUnits(void *buffer,size_t outerCount,size_t unitCount,size_t unitBytes,BOOL concurrent)
+{
+    size_t blockBytes,workerCount;
+    blockBytes = unitCount*unitBytes;
+    if(unitCount<2 || unitBytes==0)
+        return;
+    workerCount = NCDFReorderWorkerCount(outerCount,outerCount*blockBytes,concurrent);
+    //each worker reverses a contiguous run of blocks.
+    dispatch_apply(workerCount,dispatch_get_global_queue(QOS_CLASS_USER_INITIATED,0),^(size_t worker) {
+        size_t k,j;
+        uint8_t *block;
+        for(k=worker*outerCount/workerCount;k<(worker+1)*outerCount/workerCount;k++)
+        {
+            block = (uint8_t *)buffer+k*blockBytes;
+            for(j=0;j<unitCount/2;j++)
+                NCDFSwapBytes(block+j*unitBytes,block+(unitCount-1-j)*unitBytes,unitBytes);
+        }
+    });
+}
+
+BOOL NCDFRotateUnits(void *buffer,size_t outerCount,size_t unitCount,size_t unitBytes,ptrdiff_t shift,BOOL concurrent)
+{
+    size_t blockBytes,workerCount,right,shorter;
+    __block BOOL result;
+    if(unitCount<2 || unitBytes==0)
+        return YES;
+    shift %= (ptrdiff_t)unitCount;
+    if(shift<0)
+        shift += (ptrdiff_t)unitCount;
+    if(shift==0)
+        return YES;
+    right = (size_t)shift;
+    shorter = MIN(right,unitCount-right);
+    blockBytes = unitCount*unitBytes;
+    workerCount = NCDFReorderWorkerCount(outerCount,outerCount*blockBytes,concurrent);
+    result = YES;
+    dispatch_apply(workerCount,dispatch_get_global_queue(QOS_CLASS_USER_INITIATED,0),^(size_t worker) {
+        size_t k;
+        uint8_t *block,*temp;
+        temp = (uint8_t *)malloc(shorter*unitBytes);
+        if(!temp)
+        {
+            result = NO;
+            return;
+        }
+        for(k=worker*outerCount/workerCount;k<(worker+1)*outerCount/workerCount;k++)
+        {
+            block = (uint8_t *)buffer+k*blockBytes;
+            if(right==shorter)
+            {
+                //the last units wrap to the front.
+                memcpy(temp,block+(unitCount-right)*unitBytes,right*unitBytes);
+                memmove(block+right*unitBytes,block,(unitCount-right)*unitBytes);
+                memcpy(block,temp,right*unitBytes);
+            }
+            else
+            {
+                //the first units wrap to the back.
+                memcpy(temp,block,shorter*unitBytes);
+                memmove(block,block+shorter*unitBytes,right*unitBytes);
+                memcpy(block+right*unitBytes,temp,shorter*unitBytes);
+            }
+        }
+        free(temp);
+    });
+    return result;
+}
+
+int NCDFCopyVariableData(int srcNCID,int srcVarID,int dstNCID,int dstVarID,int ndims,const size_t *shape,size_t memoryCeiling)
+{
+    int32_t status,i;
+    nc_type type;
+    size_t elementSize,tileElements;
+    size_t *tile,*start,*count;
+    void *buffer;
+
+    status = nc_inq_vartype(srcNCID,srcVarID,&type);
+    if(status!=NC_NOERR)
+        return status;
+    elementSize = NCDFSizeOfType(type);
+    if(elementSize==0)
+        return NC_EBADTYPE;
+    //a scalar variable still needs one start/count entry for the netcdf library.
+    tile = (size_t *)calloc(ndims>0?ndims:1,sizeof(size_t));
+    start = (size_t *)calloc(ndims>0?ndims:1,sizeof(size_t));
+    count = (size_t *)calloc(ndims>0?ndims:1,sizeof(size_t));
+    tileElements = NCDFPlanTile(ndims,shape,elementSize,memoryCeiling,tile);
+    if(tileElements==0)
+    {
+        free(tile);
+        free(start);
+        free(count);
+        return NC_NOERR;
+    }
+    buffer = malloc(tileElements*elementSize);
+    if(!buffer)
+    {
+        free(tile);
+        free(start);
+        free(count);
+        return NC_ENOMEM;
+    }
+    for(i=0;i<ndims;i++)
+        count[i] = tile[i];
+    do
+    {
+        status = nc_get_vara(srcNCID,srcVarID,start,count,buffer);
+        if(status!=NC_NOERR)
+            break;
+        status = nc_put_vara(dstNCID,dstVarID,start,count,buffer);
+        if(status!=NC_NOERR)
+            break;
+    }
+    while(NCDFAdvanceTile(ndims,shape,tile,start,count));
+    free(buffer);
+    free(tile);
+    free(start);
+    free(count);
+    return status;
+}
+
+void NCDFRowMajorImap(int ndims,const size_t *count,ptrdiff_t *imap)
+{
+    ptrdiff_t distance;
+    int32_t i;
+    distance = 1;
+    for(i=ndims-1;i>=0;i--)
+    {
+        imap[i] = distance;
+        distance *= (ptrdiff_t)count[i];
+    }
+}
+
+void NCDFTransposedImap(int ndims,const size_t *count,const int *order,ptrdiff_t *imap)
+{
+    ptrdiff_t distance;
+    int32_t i;
+    //order[i] is the variable dimension that becomes dimension i of the result.
+    distance = 1;
+    for(i=ndims-1;i>=0;i--)
+    {
+        imap[order[i]] = distance;
+        distance *= (ptrdiff_t)count[order[i]];
+    }
+}
+
+size_t NCDFImapExtent(int ndims,const size_t *count,const ptrdiff_t *imap)
+{
+    size_t extent;
+    int32_t i;
+    extent = 1;
+    for(i=0;i<ndims;i++)
+    {
+        if(count[i]==0)
+            return 0;
+        extent += (count[i]-1)*(size_t)imap[i];
+    }
+    return extent;
+}
+
+void NCDFCopyStridedRegion(int ndims,const size_t *shape,size_t elementSize,const void *source,const size_t *start,const size_t *count,const ptrdiff_t *stride,const ptrdiff_t *imap,void *destination)
+{
+    size_t *index;
+    size_t srcOffset,dstOffset,rowBytes,k;
+    BOOL contiguousRows;
+    int32_t i;
+    if(ndims<1)
+    {
+        memcpy(destination,source,elementSize);
+        return;
+    }
+    for(i=0;i<ndims;i++)
+    {
+        if(count[i]==0)
+            return;
+    }
+    index = (size_t *)calloc(ndims,sizeof(size_t));
+    //rows that are contiguous on both sides are copied whole.
+    contiguousRows = (stride[ndims-1]==1 && imap[ndims-1]==1);
+    rowBytes = count[ndims-1]*elementSize;
+    while(YES)
+    {
+        srcOffset = 0;
+        dstOffset = 0;
+        for(i=0;i<ndims;i++)
+        {
+            srcOffset = srcOffset*shape[i]+start[i]+index[i]*(size_t)stride[i];
+            dstOffset += index[i]*(size_t)imap[i];
+        }
+        if(contiguousRows)
+            memcpy((uint8_t *)destination+dstOffset*elementSize,(const uint8_t *)source+srcOffset*elementSize,rowBytes);
+        else
+        {
+            for(k=0;k<count[ndims-1];k++)
+                memcpy((uint8_t *)destination+(dstOffset+k*(size_t)imap[ndims-1])*elementSize,(const uint8_t *)source+(srcOffset+k*(size_t)stride[ndims-1])*elementSize,elementSize);
+        }
+        for(i=ndims-2;i>=0;i--)
+        {
+            index[i]++;
+            if(index[i]<count[i])
+                break;
+            index[i] = 0;
+        }
+        if(i<0)
+            break;
+    }
+    free(index);
+}
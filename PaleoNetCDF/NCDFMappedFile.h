@@ -0,0 +1,113 @@
+//
+//  NCDFMappedFile.h
+//  netcdf
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+/*!
+ @header
+ @class NCDFMappedFile
+ @abstract NCDFMappedFile maps a classic or 64-bit offset netcdf file into memory so that fixed size variables are read without the netcdf library.
+ @discussion The file is mapped read-only and its header is parsed to find where each fixed size variable's data begins.  Reads of a region that is contiguous in the file are copied out of the mapping in one pass, either as they are or straight into the host's byte order.  The data is in the file's external representation, which is big-endian, so multi-byte values returned by the dataForVariableID: methods have to be converted with NCDFCopyToHostByteOrder before use on a little-endian machine.  Record variables and netCDF-4 files are not mapped.
+
+ Lifetime: nothing returned by a mapping points into it, so data outlives the mapping and does not change when the file is later written.  The mapping itself describes the file as it was when it was made and is only valid until the file is written: NCDFHandle drops its mapping when the file lock's write generation moves on or the file's modification date or size changes, and copies out of it only while holding the file lock for reading.  A file that another process truncates while it is mapped will fault on the next copy, so mapped reads should only be used on files that are rewritten by replacement, as NCDFHandle does.
+ */
+
+#import <Foundation/Foundation.h>
+#import <netcdf.h>
+
+/*!
+ @function NCDFCopyToHostByteOrder
+ @abstract Converts values from the netcdf external representation to the host's byte order.
+ @param source values in big-endian order.
+ @param destination buffer for count values.  It may be the same as source.
+ @param count number of values.
+ @param type netcdf type of the values.
+ @discussion On a big-endian host, or for one byte types, the values are copied unchanged.
+ */
+void NCDFCopyToHostByteOrder(const void *source,void *destination,size_t count,nc_type type);
+
+struct NCDFMappedVariable;
+
+@interface NCDFMappedFile : NSObject {
+    NSString *_path;
+    const uint8_t *_bytes;
+    size_t _length;
+    int32_t _formatVersion;
+    int32_t _variableCount;
+    struct NCDFMappedVariable *_variables;
+    NSDate *_fileModificationDate;
+}
+
+/*!
+ @method initWithPath:
+ @abstract Maps the file at path.
+ @param path path to a classic or 64-bit offset netcdf file.
+ @result The mapping, or nil if the file cannot be mapped or is not a classic or 64-bit offset file.
+ */
+-(id)initWithPath:(NSString *)path;
+
+/*!
+ @method path
+ @abstract The path of the mapped file.
+ */
+-(NSString *)path;
+
+/*!
+ @method length
+ @abstract The size in bytes of the mapping.
+ */
+-(size_t)length;
+
+/*!
+ @method formatVersion
+ @abstract 1 for a classic file and 2 for a 64-bit offset file.
+ */
+-(int)formatVersion;
+
+/*!
+ @method matchesFileOnDisk
+ @abstract Returns NO if the file's modification date or size has changed since it was mapped.
+ */
+-(BOOL)matchesFileOnDisk;
+
+/*!
+ @method canMapVariableID:
+ @abstract Returns YES if the variable's data can be read from the mapping.
+ @param varID netcdf variable ID.
+ @discussion Only fixed size variables whose data lies entirely inside the mapping can be read.
+ */
+-(BOOL)canMapVariableID:(int)varID;
+
+/*!
+ @method dataForVariableID:
+ @abstract Returns a copy of all of a fixed size variable's data.
+ @param varID netcdf variable ID.
+ @result Big-endian data, or nil if the variable cannot be mapped.  It may be converted to the host's byte order in place.
+ */
+-(NSMutableData *)dataForVariableID:(int)varID;
+
+/*!
+ @method dataForVariableID:start:edges:
+ @abstract Returns a copy of a region of a fixed size variable.
+ @param varID netcdf variable ID.
+ @param start corner of the region, one index per dimension.
+ @param edges lengths of the region along each dimension.
+ @result Big-endian data, or nil if the variable cannot be mapped, the region is out of range, or the region is not contiguous in the file.  It may be converted to the host's byte order in place.
+ @discussion A region is contiguous when, after the first dimension with a length other than one, every dimension is read in full.  Whole rows, planes and single values are always contiguous.
+ */
+-(NSMutableData *)dataForVariableID:(int)varID start:(const size_t *)start edges:(const size_t *)edges;
+
+/*!
+ @method copyVariableID:start:edges:toHostBuffer:
+ @abstract Copies a region of a fixed size variable into a buffer in the host's byte order.
+ @param varID netcdf variable ID.
+ @param start corner of the region, one index per dimension.
+ @param edges lengths of the region along each dimension.
+ @param buffer room for the whole region.
+ @result NO, leaving the buffer untouched, if dataForVariableID:start:edges: would return nil.
+ */
+-(BOOL)copyVariableID:(int)varID start:(const size_t *)start edges:(const size_t *)edges toHostBuffer:(void *)buffer;
+@end
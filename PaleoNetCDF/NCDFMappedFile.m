@@ -0,0 +1,402 @@
+//
+//  NCDFMappedFile.m
+//  netcdf
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import "NCDFMappedFile.h"
+#import "NCDFHyperslab.h"
+#import <libkern/OSByteOrder.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <fcntl.h>
+#import <unistd.h>
+
+#define NCDFMappedFileTagDimension 0x0A
+#define NCDFMappedFileTagVariable 0x0B
+#define NCDFMappedFileTagAttribute 0x0C
+
+/*One variable from the header.  shape has ndims entries and byteLength is the size of the data of a fixed size variable.  A record variable's first dimension has length 0 in the header; record variables are never mapped.*/
+struct NCDFMappedVariable {
+    nc_type type;
+    int32_t ndims;
+    size_t *shape;
+    BOOL isRecord;
+    BOOL isMappable;
+    uint64_t begin;
+    size_t byteLength;
+};
+
+/*Position in the header while it is parsed.  Every read checks the bounds of the mapping and sets failed instead of reading past the end.*/
+typedef struct {
+    const uint8_t *bytes;
+    size_t length;
+    size_t position;
+    BOOL failed;
+} NCDFHeaderCursor;
+
+static void NCDFHeaderSkip(NCDFHeaderCursor *cursor,size_t count)
+{
+    if(cursor->failed || count>cursor->length-cursor->position)
+    {
+        cursor->failed = YES;
+        return;
+    }
+    cursor->position += count;
+}
+
+static uint32_t NCDFHeaderReadUInt32(NCDFHeaderCursor *cursor)
+{
+    uint32_t value;
+    if(cursor->failed || 4>cursor->length-cursor->position)
+    {
+        cursor->failed = YES;
+        return 0;
+    }
+    value = OSReadBigInt32(cursor->bytes,cursor->position);
+    cursor->position += 4;
+    return value;
+}
+
+static uint64_t NCDFHeaderReadUInt64(NCDFHeaderCursor *cursor)
+{
+    uint64_t value;
+    if(cursor->failed || 8>cursor->length-cursor->position)
+    {
+        cursor->failed = YES;
+        return 0;
+    }
+    value = OSReadBigInt64(cursor->bytes,cursor->position);
+    cursor->position += 8;
+    return value;
+}
+
+//names and attribute values are padded to four bytes.
+static void NCDFHeaderSkipPadded(NCDFHeaderCursor *cursor,uint64_t count)
+{
+    if(count>cursor->length)
+    {
+        cursor->failed = YES;
+        return;
+    }
+    NCDFHeaderSkip(cursor,(size_t)((count+3) & ~(uint64_t)3));
+}
+
+static void NCDFHeaderSkipName(NCDFHeaderCursor *cursor)
+{
+    NCDFHeaderSkipPadded(cursor,NCDFHeaderReadUInt32(cursor));
+}
+
+static void NCDFHeaderSkipAttributes(NCDFHeaderCursor *cursor)
+{
+    uint32_t tag,count,i;
+    nc_type type;
+    tag = NCDFHeaderReadUInt32(cursor);
+    count = NCDFHeaderReadUInt32(cursor);
+    if(tag!=NCDFMappedFileTagAttribute)
+    {
+        if(tag!=0 || count!=0)
+            cursor->failed = YES;
+        return;
+    }
+    for(i=0;i<count && !cursor->failed;i++)
+    {
+        NCDFHeaderSkipName(cursor);
+        type = (nc_type)NCDFHeaderReadUInt32(cursor);
+        if(NCDFSizeOfType(type)==0)
+            cursor->failed = YES;
+        NCDFHeaderSkipPadded(cursor,(uint64_t)NCDFHeaderReadUInt32(cursor)*NCDFSizeOfType(type));
+    }
+}
+
+void NCDFCopyToHostByteOrder(const void *source,void *destination,size_t count,nc_type type)
+{
+    size_t i;
+    size_t elementSize = NCDFSizeOfType(type);
+    uint8_t *target = (uint8_t *)destination;
+    if(elementSize<=1 || OSHostByteOrder()==OSBigEndian)
+    {
+        if(source!=destination)
+            memmove(destination,source,count*elementSize);
+        return;
+    }
+    //the external representation is only four byte aligned, so values are read and written unaligned.
+    switch(elementSize)
+    {
+        case 2:
+            for(i=0;i<count;i++)
+            {
+                uint16_t value = OSReadBigInt16(source,i*2);
+                memcpy(target+i*2,&value,2);
+            }
+            break;
+        case 4:
+            for(i=0;i<count;i++)
+            {
+                uint32_t value = OSReadBigInt32(source,i*4);
+                memcpy(target+i*4,&value,4);
+            }
+            break;
+        case 8:
+            for(i=0;i<count;i++)
+            {
+                uint64_t value = OSReadBigInt64(source,i*8);
+                memcpy(target+i*8,&value,8);
+            }
+            break;
+    }
+}
+
+@interface NCDFMappedFile (PrivateMethods)
+/*!
+ @method parseHeader
+ @abstract Reads the dimensions and variables from the mapped header.
+ @result NO if the header is not a valid classic or 64-bit offset header.
+ */
+-(BOOL)parseHeader;
+/*!
+ @method getOffset:length:ofVariableID:start:edges:
+ @abstract Finds the bytes of the mapping that hold a region of a fixed size variable.
+ @result NO if the variable cannot be mapped, the region is out of range, or the region is not contiguous in the file.  start and edges may both be NULL for the whole variable.
+ */
+-(BOOL)getOffset:(uint64_t *)offset length:(size_t *)length ofVariableID:(int)varID start:(const size_t *)start edges:(const size_t *)edges;
+@end
+
+@implementation NCDFMappedFile (PrivateMethods)
+
+-(BOOL)parseHeader
+{
+    NCDFHeaderCursor cursor;
+    uint32_t tag,dimCount,dimID;
+    int32_t i,j;
+    size_t *dimLengths;
+    size_t elementCount,elementSize;
+    if(_length<4 || _bytes[0]!='C' || _bytes[1]!='D' || _bytes[2]!='F' || (_bytes[3]!=1 && _bytes[3]!=2))
+        return NO;
+    _formatVersion = _bytes[3];
+    cursor.bytes = _bytes;
+    cursor.length = _length;
+    cursor.position = 4;
+    cursor.failed = NO;
+    //numrecs only matters to record variables, which are not mapped.
+    NCDFHeaderReadUInt32(&cursor);
+    tag = NCDFHeaderReadUInt32(&cursor);
+    dimCount = NCDFHeaderReadUInt32(&cursor);
+    if(cursor.failed || (tag!=NCDFMappedFileTagDimension && (tag!=0 || dimCount!=0)) || dimCount>_length/8)
+        return NO;
+    dimLengths = (size_t *)calloc(dimCount+1,sizeof(size_t));
+    for(i=0;i<(int32_t)dimCount;i++)
+    {
+        NCDFHeaderSkipName(&cursor);
+        dimLengths[i] = NCDFHeaderReadUInt32(&cursor);
+    }
+    NCDFHeaderSkipAttributes(&cursor);
+    tag = NCDFHeaderReadUInt32(&cursor);
+    _variableCount = (int32_t)NCDFHeaderReadUInt32(&cursor);
+    if(cursor.failed || (tag!=NCDFMappedFileTagVariable && (tag!=0 || _variableCount!=0)) || _variableCount<0 || (size_t)_variableCount>_length/8)
+    {
+        _variableCount = 0;
+        free(dimLengths);
+        return NO;
+    }
+    _variables = (struct NCDFMappedVariable *)calloc(_variableCount+1,sizeof(struct NCDFMappedVariable));
+    for(i=0;i<_variableCount && !cursor.failed;i++)
+    {
+        struct NCDFMappedVariable *var = &_variables[i];
+        NCDFHeaderSkipName(&cursor);
+        var->ndims = (int32_t)NCDFHeaderReadUInt32(&cursor);
+        if(var->ndims<0 || var->ndims>NC_MAX_VAR_DIMS)
+        {
+            cursor.failed = YES;
+            break;
+        }
+        var->shape = (size_t *)calloc(var->ndims+1,sizeof(size_t));
+        elementCount = 1;
+        for(j=0;j<var->ndims;j++)
+        {
+            dimID = NCDFHeaderReadUInt32(&cursor);
+            if(dimID>=dimCount)
+            {
+                cursor.failed = YES;
+                break;
+            }
+            var->shape[j] = dimLengths[dimID];
+            if(var->shape[j]==0 && j==0)
+                var->isRecord = YES;
+            else if(var->shape[j]!=0 && elementCount>SIZE_MAX/var->shape[j])
+                cursor.failed = YES;
+            else
+                elementCount *= var->shape[j];
+        }
+        NCDFHeaderSkipAttributes(&cursor);
+        var->type = (nc_type)NCDFHeaderReadUInt32(&cursor);
+        //vsize is limited to 32 bits and is not needed to find fixed size data.
+        NCDFHeaderReadUInt32(&cursor);
+        if(_formatVersion==1)
+            var->begin = NCDFHeaderReadUInt32(&cursor);
+        else
+            var->begin = NCDFHeaderReadUInt64(&cursor);
+        elementSize = NCDFSizeOfType(var->type);
+        if(!var->isRecord && elementSize>0 && elementCount<=SIZE_MAX/elementSize)
+        {
+            var->byteLength = elementCount*elementSize;
+            var->isMappable = (var->begin<=_length && var->byteLength<=_length-var->begin);
+        }
+    }
+    free(dimLengths);
+    return !cursor.failed;
+}
+
+-(BOOL)getOffset:(uint64_t *)offset length:(size_t *)length ofVariableID:(int)varID start:(const size_t *)start edges:(const size_t *)edges
+{
+    struct NCDFMappedVariable *var;
+    size_t elementCount,elementOffset;
+    int32_t i,first;
+    if(![self canMapVariableID:varID])
+        return NO;
+    var = &_variables[varID];
+    if(!start || !edges)
+    {
+        *offset = var->begin;
+        *length = var->byteLength;
+        return YES;
+    }
+    elementCount = 1;
+    for(i=0;i<var->ndims;i++)
+    {
+        if(start[i]>var->shape[i] || edges[i]>var->shape[i]-start[i])
+            return NO;
+        elementCount *= edges[i];
+    }
+    *offset = var->begin;
+    *length = 0;
+    if(elementCount==0)
+        return YES;
+    //leading dimensions of length one select a single row, plane, etc.  After them everything must be read in full.
+    first = 0;
+    while(first<var->ndims && edges[first]==1)
+        first++;
+    for(i=first+1;i<var->ndims;i++)
+    {
+        if(start[i]!=0 || edges[i]!=var->shape[i])
+            return NO;
+    }
+    elementOffset = 0;
+    for(i=0;i<var->ndims;i++)
+        elementOffset = elementOffset*var->shape[i] + start[i];
+    *offset = var->begin+elementOffset*NCDFSizeOfType(var->type);
+    *length = elementCount*NCDFSizeOfType(var->type);
+    return YES;
+}
+
+@end
+
+@implementation NCDFMappedFile
+
+-(id)initWithPath:(NSString *)path
+{
+    int32_t fileDescriptor;
+    struct stat fileStatus;
+    void *bytes;
+    self = [super init];
+    if(!self)
+        return nil;
+    _path = [path copy];
+    fileDescriptor = open([path fileSystemRepresentation],O_RDONLY);
+    if(fileDescriptor<0)
+        return nil;
+    if(fstat(fileDescriptor,&fileStatus)!=0 || fileStatus.st_size<=0)
+    {
+        close(fileDescriptor);
+        return nil;
+    }
+    bytes = mmap(NULL,(size_t)fileStatus.st_size,PROT_READ,MAP_SHARED,fileDescriptor,0);
+    close(fileDescriptor);
+    if(bytes==MAP_FAILED)
+        return nil;
+    _bytes = (const uint8_t *)bytes;
+    _length = (size_t)fileStatus.st_size;
+    _fileModificationDate = [[[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil] fileModificationDate];
+    if(![self parseHeader])
+        return nil;
+    return self;
+}
+
+-(NSString *)path
+{
+    return _path;
+}
+
+-(size_t)length
+{
+    return _length;
+}
+
+-(int)formatVersion
+{
+    return _formatVersion;
+}
+
+-(BOOL)matchesFileOnDisk
+{
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:_path error:nil];
+    if(!attributes || !_fileModificationDate)
+        return NO;
+    if(![[attributes fileModificationDate] isEqualToDate:_fileModificationDate])
+        return NO;
+    if([attributes fileSize]!=_length)
+        return NO;
+    return YES;
+}
+
+-(BOOL)canMapVariableID:(int)varID
+{
+    if(varID<0 || varID>=_variableCount)
+        return NO;
+    return _variables[varID].isMappable;
+}
+
+-(NSMutableData *)dataForVariableID:(int)varID
+{
+    return [self dataForVariableID:varID start:NULL edges:NULL];
+}
+
+-(NSMutableData *)dataForVariableID:(int)varID start:(const size_t *)start edges:(const size_t *)edges
+{
+    uint64_t offset;
+    size_t length;
+    if(![self getOffset:&offset length:&length ofVariableID:varID start:start edges:edges])
+        return nil;
+    //a copy, so that the data neither changes under later in-place writes nor outlives the mapping.
+    return [NSMutableData dataWithBytes:_bytes+offset length:length];
+}
+
+-(BOOL)copyVariableID:(int)varID start:(const size_t *)start edges:(const size_t *)edges toHostBuffer:(void *)buffer
+{
+    uint64_t offset;
+    size_t length;
+    if(![self getOffset:&offset length:&length ofVariableID:varID start:start edges:edges])
+        return NO;
+    if(length>0)
+        NCDFCopyToHostByteOrder(_bytes+offset,buffer,length/NCDFSizeOfType(_variables[varID].type),_variables[varID].type);
+    return YES;
+}
+
+-(void)dealloc
+{
+    int32_t i;
+    if(_bytes)
+        munmap((void *)_bytes,_length);
+    if(_variables)
+    {
+        for(i=0;i<_variableCount;i++)
+            free(_variables[i].shape);
+        free(_variables);
+    }
+    _path = nil;
+    _fileModificationDate = nil;
+}
+
+@end
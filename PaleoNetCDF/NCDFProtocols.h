@@ -11,7 +11,7 @@
 #import <Foundation/Foundation.h>
 #import <netcdf.h>
 
-@class NCDFAttribute,NCDFSlab;
+@class NCDFAttribute,NCDFSlab,NCDFReadToken;
 @protocol NCDFImmutableVariableProtocol
 
 //variable metadata
@@ -22,13 +22,13 @@
 -(NSString *)dataTypeWithDimDescription;
 -(NSArray *)getVariableAttributes;
 -(BOOL)isDimensionVariable;
--(int)sizeUnitVariable;
--(int)sizeUnitVariableForType;
--(int)currentVariableSize;
--(int)currentVariableByteSize;
+-(size_t)sizeUnitVariable;
+-(size_t)sizeUnitVariableForType;
+-(size_t)currentVariableSize;
+-(size_t)currentVariableByteSize;
 -(NSArray *)lengthArray;
 -(BOOL)isUnlimited;
--(int)unlimitedVariableLength;
+-(int64_t)unlimitedVariableLength;
 -(NSArray *)dimensionNames;
 -(NSArray *)allVariableDimInformation;
 -(NCDFAttribute *)variableAttributeByName:(NSString *)name;
@@ -41,7 +41,19 @@
 -(id)getSingleValue:(NSArray *)coordinates;
 -(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths;
 -(NCDFSlab *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths;
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths asType:(nc_type)type;
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride;
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride imap:(NSArray *)imap;
+-(NCDFSlab *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride;
+-(NCDFSlab *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride dimensionOrder:(NSArray *)order;
 -(NCDFSlab *)getAllDataInSlab;
+-(BOOL)enumerateChunksWithMaxBytes:(size_t)maxBytes alongDimensions:(NSArray *)dimensionNames usingBlock:(void (^)(NCDFSlab *chunk,NSArray *origin,BOOL *stop))block;
+-(BOOL)enumerateChunksWithMaxBytes:(size_t)maxBytes alongDimensions:(NSArray *)dimensionNames prefetch:(BOOL)prefetch usingBlock:(void (^)(NCDFSlab *chunk,NSArray *origin,BOOL *stop))block;
+
+//asynchronous reads are optional so that existing conformers keep compiling; check respondsToSelector: before calling them.
+@optional
+-(NCDFReadToken *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths priority:(qos_class_t)priority completionQueue:(dispatch_queue_t)queue completion:(void (^)(NSData *data))completion;
+-(NCDFReadToken *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths priority:(qos_class_t)priority completionQueue:(dispatch_queue_t)queue completion:(void (^)(NCDFSlab *slab))completion;
 @end
 
 @protocol NCDFImmutableDimensionProtocol
@@ -0,0 +1,129 @@
+//
+//  NCDFReadAhead.h
+//  netcdf
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+/*!
+ @header
+ @class NCDFReadAhead
+ @abstract NCDFReadAhead prefetches the next records of a record variable that is being stepped through.
+ @discussion A record variable that has a read-ahead depth (see NCDFVariable's setReadAheadDepth:) passes every read of a single record through its NCDFReadAhead.  When consecutive reads cover the same region of a record and move along the unlimited dimension by a steady step (one record forward, one back, or any repeated stride), the following records are read on a background queue into a buffer bounded by the depth and a byte limit.  Later reads of those records are answered from the buffer.  The buffer is discarded whenever the file is written, as seen through the file lock's write generation, or when the pattern changes.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class NCDFFileLock;
+
+/*!
+ @defined NCDFReadAheadStatisticDepth
+ @discussion Statistics key.  NSNumber; the number of records read ahead.
+ */
+#define NCDFReadAheadStatisticDepth @"depth"
+/*!
+ @defined NCDFReadAheadStatisticHits
+ @discussion Statistics key.  NSNumber; single record reads answered from the buffer.
+ */
+#define NCDFReadAheadStatisticHits @"hits"
+/*!
+ @defined NCDFReadAheadStatisticMisses
+ @discussion Statistics key.  NSNumber; single record reads that had to go to the file.
+ */
+#define NCDFReadAheadStatisticMisses @"misses"
+/*!
+ @defined NCDFReadAheadStatisticHitRate
+ @discussion Statistics key.  NSNumber; hits divided by hits and misses, 0 before any read.
+ */
+#define NCDFReadAheadStatisticHitRate @"hitRate"
+/*!
+ @defined NCDFReadAheadStatisticPrefetchedRecords
+ @discussion Statistics key.  NSNumber; records read ahead into the buffer.
+ */
+#define NCDFReadAheadStatisticPrefetchedRecords @"prefetchedRecords"
+/*!
+ @defined NCDFReadAheadStatisticBufferedBytes
+ @discussion Statistics key.  NSNumber; bytes currently held in the buffer.
+ */
+#define NCDFReadAheadStatisticBufferedBytes @"bufferedBytes"
+
+/*!
+ @defined NCDFReadAheadDefaultBufferLimit
+ @discussion Bytes of prefetched records kept by a read-ahead buffer unless another limit is set.
+ */
+#define NCDFReadAheadDefaultBufferLimit (64*1024*1024)
+
+@interface NCDFReadAhead : NSObject {
+    NSLock *_lock;
+    dispatch_queue_t _queue;
+    NCDFFileLock *_fileLock;
+    NSData *(^_fetchBlock)(const size_t *start,const size_t *edges);
+    int32_t _ndims;
+    int32_t _depth;
+    size_t _bufferLimit;
+    size_t _bufferedBytes;
+    NSMutableDictionary *_buffer;
+    NSMutableSet *_pendingRecords;
+    NSData *_patternKey;
+    long long _lastRecord;
+    long long _lastStep;
+    long long _stride;
+    uint64_t _generation;
+    uint64_t _hits;
+    uint64_t _misses;
+    uint64_t _prefetchedRecords;
+}
+
+/*!
+ @method initWithDimensionCount:fileLock:fetchBlock:
+ @abstract Initializes a read-ahead buffer for one record variable.
+ @param ndims the variable's number of dimensions.  The first is the unlimited dimension.
+ @param fileLock the lock of the variable's file, whose write generation invalidates the buffer.
+ @param fetchBlock reads one region of the variable in native byte order, or returns nil.  It is called on a background queue.
+ */
+-(id)initWithDimensionCount:(int)ndims fileLock:(NCDFFileLock *)fileLock fetchBlock:(NSData *(^)(const size_t *start,const size_t *edges))fetchBlock;
+
+/*!
+ @method setDepth:
+ @abstract Sets the number of records read ahead of the current one.
+ */
+-(void)setDepth:(int)depth;
+/*!
+ @method depth
+ @abstract Returns the number of records read ahead of the current one.
+ */
+-(int)depth;
+/*!
+ @method setBufferLimit:
+ @abstract Sets the most bytes held in the buffer.  Records that would go over the limit are not kept.
+ */
+-(void)setBufferLimit:(size_t)bytes;
+/*!
+ @method bufferLimit
+ @abstract Returns the most bytes held in the buffer.
+ */
+-(size_t)bufferLimit;
+
+/*!
+ @method dataForStart:edges:
+ @abstract Notes a read and returns its data if the buffer holds it.
+ @param start corner of the read.
+ @param edges lengths of the read.  Only reads of a single record take part in read-ahead.
+ @result The buffered data, or nil if the read has to go to the file.
+ @discussion Also schedules the prefetch of the records that follow when the reads so far form a steady step.
+ */
+-(NSData *)dataForStart:(const size_t *)start edges:(const size_t *)edges;
+
+/*!
+ @method discardBuffer
+ @abstract Drops every buffered and pending record.
+ */
+-(void)discardBuffer;
+
+/*!
+ @method statistics
+ @abstract Returns the read-ahead statistics keyed by the NCDFReadAheadStatistic keys.
+ */
+-(NSDictionary *)statistics;
+@end
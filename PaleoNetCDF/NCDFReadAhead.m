@@ -0,0 +1,262 @@
+//
+//  NCDFReadAhead.m
+//  netcdf
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import "NCDFReadAhead.h"
+#import "NCDFFileLock.h"
+
+@interface NCDFReadAhead (PrivateMethods)
+/*!
+ @method resetPatternWithKey:
+ @abstract Drops the buffer and the step history.  Called with the lock held.
+ */
+-(void)resetPatternWithKey:(NSData *)key;
+/*!
+ @method trimBufferAroundRecord:
+ @abstract Drops buffered records that are not among the next depth records along the current step.  Called with the lock held.
+ */
+-(void)trimBufferAroundRecord:(long long)record;
+/*!
+ @method scheduleRecordsAfter:start:edges:
+ @abstract Queues the prefetch of the next depth records along the current step.  Called with the lock held.
+ */
+-(void)scheduleRecordsAfter:(long long)record start:(const size_t *)start edges:(const size_t *)edges;
+@end
+
+@implementation NCDFReadAhead (PrivateMethods)
+
+-(void)resetPatternWithKey:(NSData *)key
+{
+    [_buffer removeAllObjects];
+    [_pendingRecords removeAllObjects];
+    _bufferedBytes = 0;
+    _patternKey = key;
+    _lastRecord = -1;
+    _lastStep = 0;
+    _stride = 0;
+}
+
+-(void)trimBufferAroundRecord:(long long)record
+{
+    NSArray *keys;
+    long long offset;
+    int32_t i;
+    keys = [_buffer allKeys];
+    for(i=0;i<[keys count];i++)
+    {
+        offset = [keys[i] longLongValue]-record;
+        if(_stride==0 || offset%_stride!=0 || offset/_stride<1 || offset/_stride>_depth)
+        {
+            _bufferedBytes -= [_buffer[keys[i]] length];
+            [_buffer removeObjectForKey:keys[i]];
+        }
+    }
+}
+
+-(void)scheduleRecordsAfter:(long long)record start:(const size_t *)start edges:(const size_t *)edges
+{
+    NSNumber *key;
+    NSMutableData *startData,*edgeData;
+    long long next;
+    uint64_t generation;
+    int32_t i;
+    generation = _generation;
+    edgeData = [NSMutableData dataWithBytes:edges length:sizeof(size_t)*_ndims];
+    for(i=1;i<=_depth;i++)
+    {
+        next = record+_stride*i;
+        if(next<0)
+            break;
+        key = @(next);
+        if(_buffer[key] || [_pendingRecords containsObject:key])
+            continue;
+        [_pendingRecords addObject:key];
+        startData = [NSMutableData dataWithBytes:start length:sizeof(size_t)*_ndims];
+        ((size_t *)[startData mutableBytes])[0] = (size_t)next;
+        dispatch_async(_queue,^{
+            NSData *theData;
+            BOOL wanted;
+            [self->_lock lock];
+            wanted = [self->_pendingRecords containsObject:key] && self->_generation==generation;
+            [self->_lock unlock];
+            if(!wanted)
+                return;
+            //a record past the end of the unlimited dimension fails to read and is simply not kept.
+            theData = self->_fetchBlock([startData bytes],[edgeData bytes]);
+            [self->_lock lock];
+            if([self->_pendingRecords containsObject:key])
+            {
+                [self->_pendingRecords removeObject:key];
+                if(theData && self->_generation==generation && [self->_fileLock writeGeneration]==generation && self->_bufferedBytes+[theData length]<=self->_bufferLimit)
+                {
+                    self->_buffer[key] = theData;
+                    self->_bufferedBytes += [theData length];
+                    self->_prefetchedRecords++;
+                }
+            }
+            [self->_lock unlock];
+        });
+    }
+}
+
+@end
+
+@implementation NCDFReadAhead
+
+-(id)initWithDimensionCount:(int)ndims fileLock:(NCDFFileLock *)fileLock fetchBlock:(NSData *(^)(const size_t *start,const size_t *edges))fetchBlock
+{
+    self = [super init];
+    if(self)
+    {
+        _lock = [[NSLock alloc] init];
+        _queue = dispatch_queue_create("NCDFReadAhead",DISPATCH_QUEUE_SERIAL);
+        dispatch_set_target_queue(_queue,dispatch_get_global_queue(QOS_CLASS_UTILITY,0));
+        _fileLock = fileLock;
+        _fetchBlock = [fetchBlock copy];
+        _ndims = ndims;
+        _depth = 0;
+        _bufferLimit = NCDFReadAheadDefaultBufferLimit;
+        _bufferedBytes = 0;
+        _buffer = [[NSMutableDictionary alloc] init];
+        _pendingRecords = [[NSMutableSet alloc] init];
+        _patternKey = nil;
+        _lastRecord = -1;
+        _lastStep = 0;
+        _stride = 0;
+        _generation = [fileLock writeGeneration];
+        _hits = 0;
+        _misses = 0;
+        _prefetchedRecords = 0;
+    }
+    return self;
+}
+
+-(void)setDepth:(int)depth
+{
+    [_lock lock];
+    _depth = depth>0 ? depth : 0;
+    if(_depth==0)
+        [self resetPatternWithKey:nil];
+    else if(_lastRecord>=0)
+        [self trimBufferAroundRecord:_lastRecord];
+    [_lock unlock];
+}
+
+-(int)depth
+{
+    int depth;
+    [_lock lock];
+    depth = _depth;
+    [_lock unlock];
+    return depth;
+}
+
+-(void)setBufferLimit:(size_t)bytes
+{
+    [_lock lock];
+    _bufferLimit = bytes;
+    if(_bufferedBytes>_bufferLimit)
+        [self resetPatternWithKey:_patternKey];
+    [_lock unlock];
+}
+
+-(size_t)bufferLimit
+{
+    size_t limit;
+    [_lock lock];
+    limit = _bufferLimit;
+    [_lock unlock];
+    return limit;
+}
+
+-(NSData *)dataForStart:(const size_t *)start edges:(const size_t *)edges
+{
+    NSMutableData *key;
+    NSData *theData;
+    NSNumber *record;
+    uint64_t generation;
+    long long step;
+    if(_ndims<1 || edges[0]!=1)
+        return nil;
+    //the region within a record identifies the pattern; only the record index may change between steps.
+    key = [NSMutableData dataWithCapacity:sizeof(size_t)*2*_ndims];
+    [key appendBytes:start+1 length:sizeof(size_t)*(_ndims-1)];
+    [key appendBytes:edges+1 length:sizeof(size_t)*(_ndims-1)];
+    record = @((long long)start[0]);
+    generation = [_fileLock writeGeneration];
+    [_lock lock];
+    if(_depth==0)
+    {
+        [_lock unlock];
+        return nil;
+    }
+    if(generation!=_generation)
+    {
+        _generation = generation;
+        [self resetPatternWithKey:key];
+    }
+    else if(![key isEqualToData:_patternKey])
+        [self resetPatternWithKey:key];
+    theData = _buffer[record];
+    if(theData)
+    {
+        _hits++;
+        _bufferedBytes -= [theData length];
+        [_buffer removeObjectForKey:record];
+    }
+    else
+    {
+        _misses++;
+        [_pendingRecords removeObject:record];
+    }
+    if(_lastRecord>=0)
+    {
+        //a step of one record either way is sequential at once; any other stride once it repeats.
+        step = [record longLongValue]-_lastRecord;
+        if(step!=0)
+        {
+            _stride = (step==_lastStep || step==1 || step==-1) ? step : 0;
+            _lastStep = step;
+        }
+    }
+    _lastRecord = [record longLongValue];
+    [self trimBufferAroundRecord:_lastRecord];
+    if(_stride!=0)
+        [self scheduleRecordsAfter:_lastRecord start:start edges:edges];
+    [_lock unlock];
+    return theData;
+}
+
+-(void)discardBuffer
+{
+    [_lock lock];
+    [self resetPatternWithKey:nil];
+    [_lock unlock];
+}
+
+-(NSDictionary *)statistics
+{
+    NSDictionary *statistics;
+    [_lock lock];
+    statistics = @{NCDFReadAheadStatisticDepth:@(_depth),
+                   NCDFReadAheadStatisticHits:@(_hits),
+                   NCDFReadAheadStatisticMisses:@(_misses),
+                   NCDFReadAheadStatisticHitRate:@(_hits+_misses>0 ? (double)_hits/(double)(_hits+_misses) : 0.0),
+                   NCDFReadAheadStatisticPrefetchedRecords:@(_prefetchedRecords),
+                   NCDFReadAheadStatisticBufferedBytes:@(_bufferedBytes)};
+    [_lock unlock];
+    return statistics;
+}
+
+-(void)dealloc
+{
+    _fetchBlock = nil;
+    _buffer = nil;
+    _pendingRecords = nil;
+}
+
+@end
@@ -0,0 +1,75 @@
+//
+//  NCDFReadToken.h
+//  netcdf
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+/*!
+ @header
+ @class NCDFReadToken
+ @abstract NCDFReadToken represents one caller's interest in an asynchronous read.
+ @discussion The asynchronous read methods of NCDFVariable and NCDFSeriesVariable return a token.  Requests wait in a pending list and are started, most urgent first, by at most NCDFReadTokenMaxConcurrentReads workers, each running on a global queue of its read's quality of service; the completion is called on the caller's queue.  Requests for the same region of the same variable that are still in flight are coalesced: the data is read once and every token's completion receives it.  Cancelling a token drops its completion.  When every token of a read has been cancelled while the read is still pending, the read is never made, so stale requests do not wait their turn behind the file lock or hold a worker thread.  A pending read runs at the highest priority asked for by any of its tokens.
+ */
+
+#import <Foundation/Foundation.h>
+
+/*!
+ @defined NCDFReadTokenMaxConcurrentReads
+ @discussion Most asynchronous reads made at the same time.  Further requests wait in the pending list, where they can still be cancelled.
+ */
+#define NCDFReadTokenMaxConcurrentReads 4
+
+@class NCDFReadRequest;
+
+@interface NCDFReadToken : NSObject {
+    NCDFReadRequest *_request;
+    dispatch_queue_t _completionQueue;
+    void (^_completion)(id result);
+    BOOL _cancelled;
+    BOOL _finished;
+}
+
+/*!
+ @method readWithKey:priority:readBlock:completionQueue:completion:
+ @abstract Starts or joins an asynchronous read.
+ @param key identifies the read.  Reads with equal keys that are in flight at the same time are made once.  Joining a pending read with a higher priority raises the priority of the read.
+ @param priority quality of service class of the queue the read is made on.  Pending reads of higher priority are started first.
+ @param readBlock makes the read and returns its result, or nil if it failed.
+ @param queue queue on which completion is called.  The main queue is used if nil.
+ @param completion called with the result of readBlock unless the token is cancelled first.
+ @result A token for the caller.
+ @discussion NCDFVariable and NCDFSeriesVariable use this method for their asynchronous reads; it can be used in the same way for any other read.
+ */
++(NCDFReadToken *)readWithKey:(NSString *)key priority:(qos_class_t)priority readBlock:(id (^)(void))readBlock completionQueue:(dispatch_queue_t)queue completion:(void (^)(id result))completion;
+
+/*!
+ @method keyForReader:operation:startCoordinates:edgeLengths:
+ @abstract Builds the coalescing key for a read of a region of a variable.
+ @param reader the object that makes the read.  It is identified by address, which is safe because the read block keeps it alive while the read is in flight.
+ @param operation the name of the read method, so that reads returning different kinds of results are kept apart.
+ @param startCoordinates start position along each dimension, or nil.
+ @param edgeLengths edge lengths along each dimension, or nil.
+ */
++(NSString *)keyForReader:(id)reader operation:(NSString *)operation startCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths;
+
+/*!
+ @method cancel
+ @abstract Drops the token's completion and, if no other token waits for the same read and it has not started yet, the read itself.
+ @discussion The completion is guaranteed not to be called once cancel returns, unless it is already running.
+ */
+-(void)cancel;
+
+/*!
+ @method isCancelled
+ @abstract Returns YES if the token was cancelled.
+ */
+-(BOOL)isCancelled;
+
+/*!
+ @method isFinished
+ @abstract Returns YES once the token's completion has run, or as soon as the token is cancelled.
+ */
+-(BOOL)isFinished;
+@end
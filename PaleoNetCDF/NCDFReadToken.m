@@ -0,0 +1,217 @@
+//
+//  NCDFReadToken.m
+//  netcdf
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import "NCDFReadToken.h"
+
+/*Reads in flight keyed by their key, the reads waiting for a worker, the number of workers running, and the lock that protects them and the state of every request and token.*/
+static NSMutableDictionary *inFlightReads;
+static NSMutableArray *pendingReads;
+static int32_t activeReadCount;
+static NSLock *inFlightReadsLock;
+
+/*One read shared by all the tokens whose requests were coalesced into it.  A request leaves inFlightReads when it starts delivering its result or when it is cancelled while pending, so later requests for the same key make a fresh read.  priority is the highest quality of service asked for by any of its tokens, and decides both the order in which pending reads are started and the queue the read runs on.*/
+@interface NCDFReadRequest : NSObject {
+@public
+    NSString *key;
+    NSMutableArray *tokens;
+    id (^readBlock)(void);
+    qos_class_t priority;
+    BOOL started;
+}
+@end
+
+@implementation NCDFReadRequest
+@end
+
+@interface NCDFReadToken (PrivateMethods)
+/*!
+ @method initWithRequest:completionQueue:completion:
+ @abstract Use readWithKey:priority:readBlock:completionQueue:completion: instead.
+ */
+-(id)initWithRequest:(NCDFReadRequest *)request completionQueue:(dispatch_queue_t)queue completion:(void (^)(id result))completion;
+/*!
+ @method deliverResult:
+ @abstract Calls the completion on the completion queue unless the token has been cancelled by then.
+ */
+-(void)deliverResult:(id)result;
+/*!
+ @method startPendingReads
+ @abstract Starts the most urgent pending reads while fewer than NCDFReadTokenMaxConcurrentReads are running.
+ @discussion inFlightReadsLock must be held.  Each worker starts the next pending read when its own read is done.
+ */
++(void)startPendingReads;
+@end
+
+@implementation NCDFReadToken (PrivateMethods)
+
+-(id)initWithRequest:(NCDFReadRequest *)request completionQueue:(dispatch_queue_t)queue completion:(void (^)(id result))completion
+{
+    self = [super init];
+    if(self)
+    {
+        _request = request;
+        _completionQueue = queue ? queue : dispatch_get_main_queue();
+        _completion = [completion copy];
+        _cancelled = NO;
+        _finished = NO;
+    }
+    return self;
+}
+
+-(void)deliverResult:(id)result
+{
+    dispatch_async(_completionQueue,^{
+        void (^completion)(id result);
+        [inFlightReadsLock lock];
+        completion = self->_cancelled ? nil : self->_completion;
+        self->_completion = nil;
+        self->_finished = YES;
+        [inFlightReadsLock unlock];
+        if(completion)
+            completion(result);
+    });
+}
+
++(void)startPendingReads
+{
+    NCDFReadRequest *request;
+    id (^readBlock)(void);
+    int32_t i,next;
+    while(activeReadCount<NCDFReadTokenMaxConcurrentReads && [pendingReads count]>0)
+    {
+        //qos classes increase with urgency; among equals the oldest request goes first.
+        next = 0;
+        for(i=1;i<[pendingReads count];i++)
+        {
+            if(((NCDFReadRequest *)pendingReads[i])->priority>((NCDFReadRequest *)pendingReads[next])->priority)
+                next = i;
+        }
+        request = pendingReads[next];
+        [pendingReads removeObjectAtIndex:next];
+        request->started = YES;
+        readBlock = request->readBlock;
+        //the block keeps the reader alive, so it is let go of as soon as the read is made.
+        request->readBlock = nil;
+        activeReadCount++;
+        dispatch_async(dispatch_get_global_queue(request->priority,0),^{
+            NSArray *waitingTokens;
+            id result;
+            int32_t j;
+            result = readBlock();
+            //tokens that join from here on would miss the result, so the request stops accepting them.
+            [inFlightReadsLock lock];
+            if(inFlightReads[request->key]==request)
+                [inFlightReads removeObjectForKey:request->key];
+            waitingTokens = [NSArray arrayWithArray:request->tokens];
+            [request->tokens removeAllObjects];
+            activeReadCount--;
+            [NCDFReadToken startPendingReads];
+            [inFlightReadsLock unlock];
+            for(j=0;j<[waitingTokens count];j++)
+                [waitingTokens[j] deliverResult:result];
+        });
+    }
+}
+
+@end
+
+@implementation NCDFReadToken
+
++(void)initialize
+{
+    if(self == [NCDFReadToken class])
+    {
+        inFlightReads = [[NSMutableDictionary alloc] init];
+        pendingReads = [[NSMutableArray alloc] init];
+        activeReadCount = 0;
+        inFlightReadsLock = [[NSLock alloc] init];
+    }
+}
+
++(NCDFReadToken *)readWithKey:(NSString *)key priority:(qos_class_t)priority readBlock:(id (^)(void))readBlock completionQueue:(dispatch_queue_t)queue completion:(void (^)(id result))completion
+{
+    NCDFReadRequest *request;
+    NCDFReadToken *token;
+
+    [inFlightReadsLock lock];
+    request = inFlightReads[key];
+    if(!request)
+    {
+        request = [[NCDFReadRequest alloc] init];
+        request->key = [key copy];
+        request->tokens = [[NSMutableArray alloc] init];
+        request->readBlock = [readBlock copy];
+        request->priority = priority;
+        inFlightReads[request->key] = request;
+        [pendingReads addObject:request];
+    }
+    else if(!request->started && priority>request->priority)
+    {
+        //qos classes increase with urgency, so a more urgent caller is not left waiting behind a background read.
+        request->priority = priority;
+    }
+    token = [[NCDFReadToken alloc] initWithRequest:request completionQueue:queue completion:completion];
+    [request->tokens addObject:token];
+    [NCDFReadToken startPendingReads];
+    [inFlightReadsLock unlock];
+    return token;
+}
+
++(NSString *)keyForReader:(id)reader operation:(NSString *)operation startCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths
+{
+    return [NSString stringWithFormat:@"%p %@ %@ %@",reader,operation,[startCoordinates componentsJoinedByString:@","],[edgeLengths componentsJoinedByString:@","]];
+}
+
+-(void)cancel
+{
+    NCDFReadRequest *request;
+    [inFlightReadsLock lock];
+    if(!_cancelled && !_finished)
+    {
+        _cancelled = YES;
+        //a cancelled token is finished whether or not its read has started; its completion will never run.
+        _finished = YES;
+        _completion = nil;
+        request = _request;
+        [request->tokens removeObject:self];
+        if([request->tokens count]==0 && !request->started)
+        {
+            [pendingReads removeObjectIdenticalTo:request];
+            request->readBlock = nil;
+            if(inFlightReads[request->key]==request)
+                [inFlightReads removeObjectForKey:request->key];
+        }
+    }
+    [inFlightReadsLock unlock];
+}
+
+-(BOOL)isCancelled
+{
+    BOOL cancelled;
+    [inFlightReadsLock lock];
+    cancelled = _cancelled;
+    [inFlightReadsLock unlock];
+    return cancelled;
+}
+
+-(BOOL)isFinished
+{
+    BOOL finished;
+    [inFlightReadsLock lock];
+    finished = _finished;
+    [inFlightReadsLock unlock];
+    return finished;
+}
+
+-(void)dealloc
+{
+    _request = nil;
+    _completion = nil;
+}
+
+@end
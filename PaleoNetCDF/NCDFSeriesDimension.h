@@ -78,14 +78,21 @@
 	@param length edge length  - can be 1 to n
 	@discussion Returns an array with NSRange objects describing a selection for each file for later reading. This method is for unlimited dimensions only.
 	*/
--(NSArray *)rangeArrayForStart:(int)start andLength:(int)length;
+-(NSArray *)rangeArrayForStart:(size_t)start andLength:(size_t)length;
 
 	/*!
 	@method rangeArrayForRange:
 	@abstract Returns an array with NSRange objects for unlimited dimensions describing the start and length information for each file.
-	@param aRange uses a NSRange object instead of two int values in -(NSArray *)rangeArrayForStart:(int)start andLength:(int)length
+	@param aRange uses a NSRange object instead of two size_t values in -(NSArray *)rangeArrayForStart:(size_t)start andLength:(size_t)length
 	@discussion Returns an array with NSRange objects describing a selection for each file for later reading. This method is for unlimited dimensions only.
 	*/
 -(NSArray *)rangeArrayForRange:(NSRange)aRange;
 
+	/*!
+	@method fileRanges
+	@abstract Returns an array with an NSRange object for each file giving the part of the unlimited dimension it holds, in series coordinates.
+	@discussion This method is for unlimited dimensions only.
+	*/
+-(NSArray *)fileRanges;
+
 @end
@@ -78,7 +78,7 @@
 	return _isUnlimited;
 }
 
--(NSArray *)rangeArrayForStart:(int)start andLength:(int)length
+-(NSArray *)rangeArrayForStart:(size_t)start andLength:(size_t)length
 {
 	NSRange rangeRequest = NSMakeRange(start,length);
 	return [self rangeArrayForRange:rangeRequest];
@@ -103,6 +103,11 @@
 	return [NSArray arrayWithArray:resultArray];
 }
 
+-(NSArray *)fileRanges
+{
+	return [NSArray arrayWithArray:_unlimitedLengthArray];
+}
+
 -(NSString *)description
 {
 	NSMutableString *aString = [[NSMutableString alloc] init];
@@ -9,7 +9,7 @@
 #import <Foundation/Foundation.h>
 #import "NCDFProtocols.h"
 
-@class NCDFSeriesHandle, NCDFVariable;
+@class NCDFSeriesHandle, NCDFVariable, NCDFReadToken;
 /*!
 @header
  @class NCDFSeriesVariable
@@ -25,6 +25,7 @@
     NCDFSeriesHandle *_seriesHandle;
 	NSArray *_theDims;
 	int32_t _unlimitedDimLocation;
+	size_t _readAheadBufferLimit;
 }
 
 /*!
@@ -90,7 +91,7 @@
 	/*!
 	@method getSingleValue:
 	@abstract Returns a single value as an id value.
-	@param coordinates NSArray object with the coordinates of the data using NSNumber intValues.
+	@param coordinates NSArray object with the coordinates of the data using NSNumber unsignedLongLongValues.
 	@discussion Returns a single value.  See NCDFVariable getSingleValue method for more information.  This method is transparent to which file contains the data.
 	*/
 -(id)getSingleValue:(NSArray *)coordinates;
@@ -98,8 +99,8 @@
 	/*!
 	@method getValueArrayAtLocation:edgeLengths:
 	@abstract Returns selected data as an NSData object.
-	@param startCoordinates NSArray object with the coordinates of the data using NSNumber intValues. Values range from 0 to dimension length -1 for each dimension (in significance order).
-	@param edgeLengths NSArray object with the lengths of the data along dimensions using NSNumber intValues. Values range from 1 to dimension length  for each dimension (in significance order).
+	@param startCoordinates NSArray object with the coordinates of the data using NSNumber unsignedLongLongValues. Values range from 0 to dimension length -1 for each dimension (in significance order).
+	@param edgeLengths NSArray object with the lengths of the data along dimensions using NSNumber unsignedLongLongValues. Values range from 1 to dimension length  for each dimension (in significance order).
 	@discussion Returns an NSData object containing all selected data.  The data will automatically span files.
 	*/
 -(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths;
@@ -116,28 +117,28 @@
 	@abstract Returns the size of the variable in value counts for a unlimited variable unit.
 	@discussion This method returns the size of the variable in counts of values for each unlimited step or, when the variable has no unlimited variable, the count of the entire variable.
 	*/
--(int)sizeUnitVariable;
+-(size_t)sizeUnitVariable;
 
 	/*!
 	@method sizeUnitVariableForType
 	@abstract Returns the size of the variable in bytes for a unlimited variable unit.
 	@discussion This method returns the size of the variable in bytes for each unlimited step or, when the variable has no unlimited variable, the bytes of the entire variable.
 	*/
--(int)sizeUnitVariableForType;
+-(size_t)sizeUnitVariableForType;
 
 	/*!
 	@method currentVariableSize
 	@abstract Returns the total size of the variable in counts for a unlimited variable unit.
 	@discussion This method returns the count size of the variable.
 	*/
--(int)currentVariableSize;
+-(size_t)currentVariableSize;
 
 	/*!
 	@method currentVariableByteSize
 	@abstract Returns the total size of the variable in bytes for a unlimited variable unit.
 	@discussion This method returns the byte size of the variable.
 	*/
--(int)currentVariableByteSize;
+-(size_t)currentVariableByteSize;
 
 	/*!
 	@method lengthArray
@@ -162,7 +163,7 @@
 	@method unlimitedVariableLength
 	@abstract Returns the length of the unlimited dimension used by the variable.
 	*/
--(int)unlimitedVariableLength;
+-(int64_t)unlimitedVariableLength;
 
 	/*!
 	@method dimensionNames
@@ -210,10 +211,113 @@
 	*/
 -(NCDFSlab *)getAllDataInSlab;
 
+	/*!
+	@method enumerateChunksWithMaxBytes:alongDimensions:usingBlock:
+	@abstract Reads the whole series one chunk at a time.
+	@param maxBytes target size in bytes of one chunk.
+	@param dimensionNames names of the dimensions the variable may be split along, or nil for any dimension.  Other dimensions are always whole within a chunk, which can make a chunk larger than maxBytes.
+	@param block called with each chunk as an NCDFSlab and its origin, an array of NSNumber start coordinates in significance order.  Setting *stop to YES ends the enumeration.
+	@discussion Chunks are planned with NCDFPlanChunk, filling the fastest varying dimensions first, and visited in row-major order, so only one chunk is in memory at a time.  A chunk that crosses from one file into the next is read from both.  Returns NO if a read failed.
+	*/
+-(BOOL)enumerateChunksWithMaxBytes:(size_t)maxBytes alongDimensions:(NSArray *)dimensionNames usingBlock:(void (^)(NCDFSlab *chunk,NSArray *origin,BOOL *stop))block;
+
+	/*!
+	@method enumerateChunksWithMaxBytes:alongDimensions:prefetch:usingBlock:
+	@abstract Reads the whole variable one chunk at a time, optionally reading the next chunk while the block runs.
+	@discussion See enumerateChunksWithMaxBytes:alongDimensions:usingBlock:.  With prefetch set to YES the next chunk is read on a background queue while the block works on the current one, so up to two chunks are in memory.
+	*/
+-(BOOL)enumerateChunksWithMaxBytes:(size_t)maxBytes alongDimensions:(NSArray *)dimensionNames prefetch:(BOOL)prefetch usingBlock:(void (^)(NCDFSlab *chunk,NSArray *origin,BOOL *stop))block;
+
+	/*!
+	@method getValueArrayAtLocation:edgeLengths:priority:completionQueue:completion:
+	@abstract Reads a subset of variable data asynchronously.
+	@param startCoordinates An integer array with an NSNumber object representing the start position along each dimension in significance order.
+	@param edgeLengths An integer array with an NSNumber object representing the number of units to be read along each dimension in significance order.
+	@param priority quality of service class of the read, QOS_CLASS_USER_INITIATED for example.
+	@param queue queue on which completion is called.  The main queue is used if nil.
+	@param completion called with the data, or nil if the read failed.
+	@discussion Returns an NCDFReadToken that can cancel the read.  Requests for the same region that are in flight at the same time share one read.  If the read fails, completion receives nil and the error is posted to the error handle on the completion queue, just before completion is called.
+	*/
+-(NCDFReadToken *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths priority:(qos_class_t)priority completionQueue:(dispatch_queue_t)queue completion:(void (^)(NSData *data))completion;
+
+	/*!
+	@method getSlabForStartCoordinates:edgeLengths:priority:completionQueue:completion:
+	@abstract Reads a slab of data asynchronously.
+	@discussion The asynchronous form of getSlabForStartCoordinates:edgeLengths:.  See getValueArrayAtLocation:edgeLengths:priority:completionQueue:completion:.
+	*/
+-(NCDFReadToken *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths priority:(qos_class_t)priority completionQueue:(dispatch_queue_t)queue completion:(void (^)(NCDFSlab *slab))completion;
+
+	/*!
+	@method getValueArrayAtLocation:edgeLengths:stride:
+	@abstract Reads every stride-th value of a subset of the series.
+	@discussion See NCDFVariable's getValueArrayAtLocation:edgeLengths:stride:.  The stride along the unlimited dimension is kept across file boundaries.
+	*/
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride;
+
+	/*!
+	@method getValueArrayAtLocation:edgeLengths:stride:imap:
+	@abstract Reads a subset of the series laid out in memory with an index map.
+	@discussion See NCDFVariable's getValueArrayAtLocation:edgeLengths:stride:imap:.  Each file's part is read straight to its place in the result.
+	*/
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride imap:(NSArray *)imap;
+
+	/*!
+	@method getValueArrayAtLocation:edgeLengths:asType:
+	@abstract Reads a subset of the series converted to another type.
+	@discussion See NCDFVariable's getValueArrayAtLocation:edgeLengths:asType:.  Each file's part is converted by the netcdf library straight to its place in the result.
+	*/
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths asType:(nc_type)type;
+
+	/*!
+	@method getUnpackedValueArrayAtLocation:edgeLengths:asType:validity:
+	@abstract Reads a subset of a CF packed series as real values.
+	@discussion See NCDFVariable's getUnpackedValueArrayAtLocation:edgeLengths:asType:validity:.  The packing attributes of the root file apply to the whole series.
+	*/
+-(NSData *)getUnpackedValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths asType:(nc_type)type validity:(NSData **)validity;
+
+	/*!
+	@method getSlabForStartCoordinates:edgeLengths:stride:
+	@abstract Reads every stride-th value of a subset of the series into a slab.
+	*/
+-(NCDFSlab *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride;
+
+	/*!
+	@method getSlabForStartCoordinates:edgeLengths:stride:dimensionOrder:
+	@abstract Reads a subset of the series into a slab with its dimensions reordered.
+	@param order order[i] is the variable dimension that becomes dimension i of the slab.
+	*/
+-(NCDFSlab *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride dimensionOrder:(NSArray *)order;
+
 	/*!
 	@method variableID
     @abstract Returns netCDF variable ID number for the variable.
     @discussion  Returns netCDF variable ID number for the variable from the root handle only.
 	*/
 -(int)variableID;
+
+	/*!
+	@method setReadAheadDepth:
+	@abstract Sets the read-ahead depth of the variable in every file of the series.
+	@discussion See NCDFVariable's setReadAheadDepth:.  Each file keeps its own buffer, so reads that cross into the next file start it cold.
+	*/
+-(void)setReadAheadDepth:(int)depth;
+
+	/*!
+	@method readAheadDepth
+	@abstract Returns the read-ahead depth of the variable in the root file.
+	*/
+-(int)readAheadDepth;
+
+	/*!
+	@method setReadAheadBufferLimit:
+	@abstract Sets the most bytes of prefetched records kept by the series as a whole.
+	@discussion The limit, NCDFReadAheadDefaultBufferLimit unless set, is split evenly between the files of the series, since each file keeps its own buffer.  Prefetching stops at the last record of a file; reads that cross into the next file start its buffer cold.
+	*/
+-(void)setReadAheadBufferLimit:(size_t)bytes;
+
+	/*!
+	@method readAheadStatistics
+	@abstract Returns the read-ahead statistics summed over the files of the series, or nil while read-ahead is off.
+	*/
+-(NSDictionary *)readAheadStatistics;
 @end
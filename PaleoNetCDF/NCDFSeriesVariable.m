@@ -14,6 +14,44 @@
 #import "NCDFAttribute.h"
 #import "NCDFVariable.h"
 #import "NCDFHandle.h"
+#import "NCDFErrorHandle.h"
+#import "NCDFError.h"
+#import "NCDFReadToken.h"
+#import "NCDFReadAhead.h"
+#import "NCDFHyperslab.h"
+
+@interface NCDFSeriesVariable (PrivateMethods)
+/*!
+ @method valueArrayAtLocation:edgeLengths:stride:imap:type:
+ @abstract Reads a subset of the series with a stride and an index map, converted to type, each file straight to its place in the result.
+ */
+-(NSData *)valueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride imap:(NSArray *)imap type:(nc_type)type;
+/*!
+ @method valueArrayAtLocation:edgeLengths:status:failedHandle:
+ @abstract Reads a subset of the series like getValueArrayAtLocation:edgeLengths: without posting errors.
+ @discussion On failure the status is returned with the handle of the file that failed, so the error can be posted to that handle later on another thread.
+ */
+-(NSData *)valueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths status:(int32_t *)status failedHandle:(NCDFHandle * __autoreleasing *)failedHandle;
+/*!
+ @method asyncReadResultAtLocation:edgeLengths:slab:
+ @abstract Makes the read of an asynchronous request.
+ @param slab YES to return an NCDFSlab rather than NSData.
+ @result The data or slab, or an NCDFError whose source is the path of the file that failed.  Nothing is posted, so this can run on any thread.
+ */
+-(id)asyncReadResultAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths slab:(BOOL)slab;
+/*!
+ @method postAsyncReadResult:
+ @abstract Posts the error carried by an asynchronous read result to the handle of the file that failed, on the caller's queue.
+ @result The result, or nil if it was an error.
+ */
+-(id)postAsyncReadResult:(id)result;
+/*!
+ @method readAheadBufferLimitPerFile
+ @abstract Returns the share of the series read-ahead buffer limit given to each file.
+ @discussion Every file keeps its own read-ahead buffer, so the limit is divided evenly between them to keep the series as a whole within it.
+ */
+-(size_t)readAheadBufferLimitPerFile;
+@end
 
 @implementation NCDFSeriesVariable
 
@@ -104,7 +142,7 @@
 {
 	NSNumber *unlim = [coordinates objectAtIndex:_unlimitedDimLocation];
 	NSRange aRange;
-	aRange.location = [unlim intValue];
+	aRange.location = (NSUInteger)[unlim unsignedLongLongValue];
 	aRange.length = 1;
 	NSArray *theResultRanges = [[_theDims objectAtIndex:_unlimitedDimLocation] rangeArrayForRange:aRange];
 	int32_t i,fileid = 0;
@@ -122,7 +160,7 @@
 	for(i=0;i<[coordinates count];i++)
 	{
 		if(i==_unlimitedDimLocation)
-			[newCoor addObject:[NSNumber numberWithInt:(int)[theResultRanges[fileid] rangeValue].location]];
+			[newCoor addObject:[NSNumber numberWithUnsignedLongLong:[theResultRanges[fileid] rangeValue].location]];
 		else
 			[newCoor addObject:coordinates[i]];
 	}
@@ -132,8 +170,8 @@
 -(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths
 {
 	NSRange unlimRange;
-	unlimRange.location = [[startCoordinates objectAtIndex:_unlimitedDimLocation] intValue];
-	unlimRange.length = [[edgeLengths objectAtIndex:_unlimitedDimLocation] intValue];
+	unlimRange.location = (NSUInteger)[[startCoordinates objectAtIndex:_unlimitedDimLocation] unsignedLongLongValue];
+	unlimRange.length = (NSUInteger)[[edgeLengths objectAtIndex:_unlimitedDimLocation] unsignedLongLongValue];
 	NSArray *theResultRanges = [[_theDims objectAtIndex:_unlimitedDimLocation] rangeArrayForRange:unlimRange];
 	NSMutableData *theData = [[NSMutableData alloc] init];
 	int32_t i,j;
@@ -149,8 +187,8 @@
 				{
 					if(j==_unlimitedDimLocation)
 					{
-						[newStartArray addObject:[NSNumber numberWithInt:(int)[theResultRanges[i] rangeValue].location]];
-						[newLengthArray addObject:[NSNumber numberWithInt:(int)[theResultRanges[i] rangeValue].length]];
+						[newStartArray addObject:[NSNumber numberWithUnsignedLongLong:[theResultRanges[i] rangeValue].location]];
+						[newLengthArray addObject:[NSNumber numberWithUnsignedLongLong:[theResultRanges[i] rangeValue].length]];
 					}
 					else
 					{
@@ -166,93 +204,103 @@
 	return  theData;
 }
 
+-(NSData *)valueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths status:(int32_t *)status failedHandle:(NCDFHandle * __autoreleasing *)failedHandle
+{
+	NSRange unlimRange;
+	NSArray *theResultRanges;
+	NSMutableData *theData;
+	NSData *fileData;
+	NCDFHandle *fileHandle;
+	int32_t i,j;
+	*status = NC_NOERR;
+	if([startCoordinates count]!=[_theDims count] || [edgeLengths count]!=[_theDims count])
+	{
+		*status = NC_EINVALCOORDS;
+		return nil;
+	}
+	unlimRange.location = (NSUInteger)[[startCoordinates objectAtIndex:_unlimitedDimLocation] unsignedLongLongValue];
+	unlimRange.length = (NSUInteger)[[edgeLengths objectAtIndex:_unlimitedDimLocation] unsignedLongLongValue];
+	theResultRanges = [[_theDims objectAtIndex:_unlimitedDimLocation] rangeArrayForRange:unlimRange];
+	theData = [[NSMutableData alloc] init];
+	for(i=0;i<[theResultRanges count] && *status==NC_NOERR;i++)
+	{
+		@autoreleasepool {
+			NSRange aRange = [theResultRanges[i] rangeValue];
+			if(aRange.length > 0)
+			{
+				NSMutableArray *newStartArray = [[NSMutableArray alloc] init];
+				NSMutableArray *newLengthArray = [[NSMutableArray alloc] init];
+				for(j=0;j<[startCoordinates count];j++)
+				{
+					if(j==_unlimitedDimLocation)
+					{
+						[newStartArray addObject:[NSNumber numberWithUnsignedLongLong:aRange.location]];
+						[newLengthArray addObject:[NSNumber numberWithUnsignedLongLong:aRange.length]];
+					}
+					else
+					{
+						[newStartArray addObject:startCoordinates[j]];
+						[newLengthArray addObject:edgeLengths[j]];
+					}
+				}
+				fileHandle = [[_seriesHandle handles] objectAtIndex:i];
+				fileData = [[fileHandle retrieveVariableByName:_variableName] getValueArrayAtLocation:newStartArray edgeLengths:newLengthArray status:status];
+				if(*status!=NC_NOERR || !fileData)
+				{
+					if(*status==NC_NOERR)
+						*status = NC_ENOTVAR;
+					*failedHandle = fileHandle;
+				}
+				else
+					[theData appendData:fileData];
+			}
+		}
+	}
+	if(*status!=NC_NOERR)
+		return nil;
+	return theData;
+}
+
 -(BOOL)isDimensionVariable
 {
 	return [[[_seriesHandle rootHandle] retrieveVariableByName:_variableName] isDimensionVariable];
 }
 
--(int)sizeUnitVariable
+-(size_t)sizeUnitVariable
 {
     int32_t i;
-    int32_t theSize,aLength;
+    size_t theSize,aLength;
     theSize = 1;
     for(i=0;i<[_theDims count];i++)
     {
-        aLength = (int32_t)[[_theDims objectAtIndex:i] dimLength];
+        aLength = [[_theDims objectAtIndex:i] dimLength];
         if(![[_theDims objectAtIndex:i] isUnlimited])
             theSize *= aLength;
     }
     return theSize;
 }
 
--(int)sizeUnitVariableForType
+-(size_t)sizeUnitVariableForType
 {
-	int32_t size;
-	size = [self sizeUnitVariable];
-	switch(_dataType)
-	{
-        case NC_BYTE:
-            break;
-        case NC_CHAR:
-            break;
-        case NC_SHORT:
-            size = size *2 ;
-            break;
-        case NC_INT:
-            size = size *4 ;
-            break;
-        case NC_FLOAT:
-            size = size *4 ;
-            break;
-        case NC_DOUBLE:
-            size = size *8 ;
-            break;
-        default:
-            break;
-	}
-	return size;
+	return [self sizeUnitVariable]*NCDFSizeOfType(_dataType);
 }
 
--(int)currentVariableSize
+-(size_t)currentVariableSize
 {
 	int32_t i;
-    int32_t theSize,aLength;
+    size_t theSize,aLength;
     theSize = 1;
     for(i=0;i<[_theDims count];i++)
     {
-        aLength = (int32_t)[[_theDims objectAtIndex:i] dimLength];
+        aLength = [[_theDims objectAtIndex:i] dimLength];
         theSize *= aLength;
     }
     return theSize;
 }
 
--(int)currentVariableByteSize
+-(size_t)currentVariableByteSize
 {
-    int32_t size = [self currentVariableSize];
-    switch(_dataType)
-    {
-        case NC_BYTE:
-            return size;
-            break;
-        case NC_CHAR:
-            return size;
-            break;
-        case NC_SHORT:
-            return size*2;
-            break;
-        case NC_INT:
-            return size*4;
-            break;
-        case NC_FLOAT:
-            return size*4;
-            break;
-        case NC_DOUBLE:
-            return size*8;
-            break;
-        default:
-            return -1;
-            break;
-    }
+    return [self currentVariableSize]*NCDFSizeOfType(_dataType);
 }
 
 -(NSArray *)lengthArray
@@ -261,7 +309,7 @@
 	int32_t i;
 	for(i=0;i<[_theDims count];i++)
 	{
-		[theArray addObject:[NSNumber numberWithInt:(int)[[_theDims objectAtIndex:i] dimLength]]];
+		[theArray addObject:[NSNumber numberWithUnsignedLongLong:[[_theDims objectAtIndex:i] dimLength]]];
 	}
 	return [NSArray arrayWithArray:theArray];
 }
@@ -283,9 +331,9 @@
 	return result;
 }
 
--(int)unlimitedVariableLength
+-(int64_t)unlimitedVariableLength
 {
-	return (int)[[_theDims objectAtIndex:_unlimitedDimLocation] length];
+	return (int64_t)[[_theDims objectAtIndex:_unlimitedDimLocation] dimLength];
 }
 
 -(NSArray *)dimensionNames
@@ -349,6 +397,205 @@
 	return theSlab;
 }
 
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride
+{
+	return [self getValueArrayAtLocation:startCoordinates edgeLengths:edgeLengths stride:stride imap:nil];
+}
+
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride imap:(NSArray *)imap
+{
+	return [self valueArrayAtLocation:startCoordinates edgeLengths:edgeLengths stride:stride imap:imap type:_dataType];
+}
+
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths asType:(nc_type)type
+{
+	if(type==_dataType)
+		return [self getValueArrayAtLocation:startCoordinates edgeLengths:edgeLengths];
+	return [self valueArrayAtLocation:startCoordinates edgeLengths:edgeLengths stride:nil imap:nil type:type];
+}
+
+-(NSData *)valueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride imap:(NSArray *)imap type:(nc_type)type
+{
+	int32_t i,j,ndims;
+	size_t *start,*count,*fileStart,*fileCount;
+	ptrdiff_t *strides,*map;
+	size_t elementSize,first,last,offset,fileFirst,fileEnd,covered;
+	NSRange fileRange;
+	NSArray *fileRanges,*theHandles;
+	NSMutableData *theData;
+	BOOL isError;
+	ndims = (int32_t)[_theDims count];
+	if([startCoordinates count]!=ndims || [edgeLengths count]!=ndims || (stride && [stride count]!=ndims) || (imap && [imap count]!=ndims))
+		return nil;
+	start = (size_t *)malloc(sizeof(size_t)*(ndims+1)*4);
+	count = start+ndims+1;
+	fileStart = count+ndims+1;
+	fileCount = fileStart+ndims+1;
+	strides = (ptrdiff_t *)malloc(sizeof(ptrdiff_t)*(ndims+1)*2);
+	map = strides+ndims+1;
+	for(i=0;i<ndims;i++)
+	{
+		start[i] = (size_t)[startCoordinates[i] unsignedLongLongValue];
+		count[i] = (size_t)[edgeLengths[i] unsignedLongLongValue];
+		strides[i] = stride ? (ptrdiff_t)[stride[i] longLongValue] : 1;
+		map[i] = imap ? (ptrdiff_t)[imap[i] longLongValue] : 0;
+		fileStart[i] = start[i];
+		fileCount[i] = count[i];
+	}
+	if(!imap)
+		NCDFRowMajorImap(ndims,count,map);
+	elementSize = NCDFSizeOfType(type);
+	theData = [NSMutableData dataWithLength:NCDFImapExtent(ndims,count,map)*elementSize];
+	theHandles = [_seriesHandle handles];
+	fileRanges = [[_theDims objectAtIndex:_unlimitedDimLocation] fileRanges];
+	isError = (strides[_unlimitedDimLocation]<1 || [fileRanges count]!=[theHandles count]);
+	covered = 0;
+	//each file reads the values of the unlimited dimension that fall inside it, straight to their place in the result.
+	for(j=0;j<[fileRanges count] && !isError && [theData length]>0;j++)
+	{
+		fileRange = [fileRanges[j] rangeValue];
+		fileFirst = fileRange.location;
+		fileEnd = fileRange.location+fileRange.length;
+		if(start[_unlimitedDimLocation]>=fileFirst)
+			first = 0;
+		else
+			first = (fileFirst-start[_unlimitedDimLocation]+strides[_unlimitedDimLocation]-1)/strides[_unlimitedDimLocation];
+		if(first>=count[_unlimitedDimLocation] || start[_unlimitedDimLocation]+first*strides[_unlimitedDimLocation]>=fileEnd)
+			continue;
+		last = (fileEnd-1-start[_unlimitedDimLocation])/strides[_unlimitedDimLocation];
+		if(last>=count[_unlimitedDimLocation])
+			last = count[_unlimitedDimLocation]-1;
+		fileStart[_unlimitedDimLocation] = start[_unlimitedDimLocation]+first*strides[_unlimitedDimLocation]-fileFirst;
+		fileCount[_unlimitedDimLocation] = last-first+1;
+		covered += fileCount[_unlimitedDimLocation];
+		offset = first*(size_t)map[_unlimitedDimLocation]*elementSize;
+		NCDFVariable *fileVariable = [theHandles[j] retrieveVariableByName:_variableName];
+		if(![fileVariable readIntoBuffer:(uint8_t *)[theData mutableBytes]+offset capacity:[theData length]-offset start:fileStart count:fileCount stride:strides imap:map type:type ndims:ndims status:NULL])
+			isError = YES;
+	}
+	//records past the last file would be left as zeros, so the read fails instead.
+	if(!isError && [theData length]>0 && covered!=count[_unlimitedDimLocation])
+	{
+		[[[_seriesHandle rootHandle] theErrorHandle] addErrorFromSource:[[_seriesHandle rootHandle] theFilePath] className:@"NCDFSeriesVariable" methodName:@"valueArrayAtLocation" subMethod:@"Checking coordinates" errorCode:NC_EINVALCOORDS];
+		isError = YES;
+	}
+	free(start);
+	free(strides);
+	if(isError)
+		return nil;
+	return theData;
+}
+
+-(NSData *)getUnpackedValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths asType:(nc_type)type validity:(NSData **)validity
+{
+	NCDFPackingParameters packing;
+	NSData *packedData;
+	NSMutableData *theData,*theMask;
+	size_t count;
+	if((type!=NC_FLOAT && type!=NC_DOUBLE) || _dataType==NC_CHAR)
+		return nil;
+	packedData = [self getValueArrayAtLocation:startCoordinates edgeLengths:edgeLengths];
+	if(!packedData)
+		return nil;
+	//every file of a series shares the root file's packing.
+	packing = [[[_seriesHandle rootHandle] retrieveVariableByName:_variableName] packingParameters];
+	count = [packedData length]/NCDFSizeOfType(_dataType);
+	theData = [NSMutableData dataWithLength:count*NCDFSizeOfType(type)];
+	theMask = validity ? [NSMutableData dataWithLength:NCDFValidityMaskLength(count)] : nil;
+	if(!NCDFUnpackValues([packedData bytes],_dataType,count,&packing,[theData mutableBytes],type,(uint8_t *)[theMask mutableBytes]))
+		return nil;
+	if(validity)
+		*validity = theMask;
+	return theData;
+}
+
+-(NCDFSlab *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride
+{
+	NSData *theTempData = [self getValueArrayAtLocation:startCoordinates edgeLengths:edgeLengths stride:stride];
+	if(!theTempData)
+		return nil;
+	return [[NCDFSlab alloc] initSlabWithData:theTempData withType:_dataType withLengths:edgeLengths];
+}
+
+-(NCDFSlab *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride dimensionOrder:(NSArray *)order
+{
+	NSArray *imap,*lengths;
+	NSData *theTempData;
+	if(![NCDFSlab transposedImap:&imap lengths:&lengths forEdgeLengths:edgeLengths dimensionOrder:order])
+		return nil;
+	theTempData = [self getValueArrayAtLocation:startCoordinates edgeLengths:edgeLengths stride:stride imap:imap];
+	if(!theTempData)
+		return nil;
+	return [[NCDFSlab alloc] initSlabWithData:theTempData withType:_dataType withLengths:lengths];
+}
+
+-(BOOL)enumerateChunksWithMaxBytes:(size_t)maxBytes alongDimensions:(NSArray *)dimensionNames usingBlock:(void (^)(NCDFSlab *chunk,NSArray *origin,BOOL *stop))block
+{
+	return [self enumerateChunksWithMaxBytes:maxBytes alongDimensions:dimensionNames prefetch:NO usingBlock:block];
+}
+
+-(BOOL)enumerateChunksWithMaxBytes:(size_t)maxBytes alongDimensions:(NSArray *)dimensionNames prefetch:(BOOL)prefetch usingBlock:(void (^)(NCDFSlab *chunk,NSArray *origin,BOOL *stop))block
+{
+	int32_t i,ndims;
+	size_t *shape,*tile;
+	BOOL *split;
+	nc_type theType;
+	BOOL result;
+	if(!block)
+		return NO;
+	ndims = (int32_t)[_theDims count];
+	shape = (size_t *)malloc(sizeof(size_t)*(ndims+1));
+	tile = (size_t *)malloc(sizeof(size_t)*(ndims+1));
+	split = (BOOL *)malloc(sizeof(BOOL)*(ndims+1));
+	for(i=0;i<ndims;i++)
+	{
+		shape[i] = [[_theDims objectAtIndex:i] dimLength];
+		split[i] = (!dimensionNames || [dimensionNames containsObject:[[_theDims objectAtIndex:i] dimensionName]]);
+	}
+	theType = _dataType;
+	NCDFPlanChunk(ndims,shape,split,NCDFSizeOfType(theType),maxBytes,tile);
+	//with prefetch the reader runs on a background queue, so the failure is kept and posted here once the enumeration is over.
+	__block int32_t readStatus = NC_NOERR;
+	__block NCDFHandle *failedHandle = nil;
+	result = NCDFEnumerateTiles(ndims,shape,tile,prefetch,^NSData *(const size_t *start,const size_t *count) {
+		NSData *theData;
+		NCDFHandle *tileHandle = nil;
+		int32_t tileStatus;
+		size_t units;
+		int32_t j;
+		theData = [self valueArrayAtLocation:NCDFArrayFromSizes(ndims,start) edgeLengths:NCDFArrayFromSizes(ndims,count) status:&tileStatus failedHandle:&tileHandle];
+		if(tileStatus!=NC_NOERR)
+		{
+			readStatus = tileStatus;
+			failedHandle = tileHandle;
+			return (NSData *)nil;
+		}
+		//a file with fewer records than the series expects leaves the data short.
+		units = 1;
+		for(j=0;j<ndims;j++)
+			units *= count[j];
+		if([theData length]!=units*NCDFSizeOfType(theType))
+		{
+			readStatus = NC_EEDGE;
+			failedHandle = nil;
+			return (NSData *)nil;
+		}
+		return theData;
+	},^(NSData *data,const size_t *start,const size_t *count,BOOL *stop) {
+		block([[NCDFSlab alloc] initSlabWithData:data withType:theType withLengths:NCDFArrayFromSizes(ndims,count)],NCDFArrayFromSizes(ndims,start),stop);
+	});
+	if(readStatus!=NC_NOERR)
+	{
+		if(!failedHandle)
+			failedHandle = [_seriesHandle rootHandle];
+		[[failedHandle theErrorHandle] addErrorFromSource:[failedHandle theFilePath] className:@"NCDFSeriesVariable" methodName:@"enumerateChunksWithMaxBytes" subMethod:[NSString stringWithFormat:@"Read tile of %@",_variableName] errorCode:readStatus];
+	}
+	free(shape);
+	free(tile);
+	free(split);
+	return result;
+}
+
 -(NCDFSlab *)getAllDataInSlab
 {
 	NSData *theTempData = [self readAllVariableData];
@@ -356,11 +603,142 @@
 	return theSlab;
 }
 
+-(NCDFReadToken *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths priority:(qos_class_t)priority completionQueue:(dispatch_queue_t)queue completion:(void (^)(NSData *data))completion
+{
+	NSArray *start = [startCoordinates copy];
+	NSArray *edges = [edgeLengths copy];
+	return [NCDFReadToken readWithKey:[NCDFReadToken keyForReader:self operation:@"getValueArrayAtLocation" startCoordinates:start edgeLengths:edges] priority:priority readBlock:^id{
+		return [self asyncReadResultAtLocation:start edgeLengths:edges slab:NO];
+	} completionQueue:queue completion:^(id result) {
+		NSData *theData = [self postAsyncReadResult:result];
+		if(completion)
+			completion(theData);
+	}];
+}
+
+-(NCDFReadToken *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths priority:(qos_class_t)priority completionQueue:(dispatch_queue_t)queue completion:(void (^)(NCDFSlab *slab))completion
+{
+	NSArray *start = [startCoordinates copy];
+	NSArray *edges = [edgeLengths copy];
+	return [NCDFReadToken readWithKey:[NCDFReadToken keyForReader:self operation:@"getSlabForStartCoordinates" startCoordinates:start edgeLengths:edges] priority:priority readBlock:^id{
+		return [self asyncReadResultAtLocation:start edgeLengths:edges slab:YES];
+	} completionQueue:queue completion:^(id result) {
+		NCDFSlab *theSlab = [self postAsyncReadResult:result];
+		if(completion)
+			completion(theSlab);
+	}];
+}
+
+-(id)asyncReadResultAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths slab:(BOOL)slab
+{
+	int32_t status;
+	NCDFHandle *failedHandle = nil;
+	NSData *theData = [self valueArrayAtLocation:startCoordinates edgeLengths:edgeLengths status:&status failedHandle:&failedHandle];
+	if(!theData)
+	{
+		if(!failedHandle)
+			failedHandle = [_seriesHandle rootHandle];
+		return [[NCDFError alloc] initErrorFromSourceName:[failedHandle theFilePath] theClass:@"NCDFSeriesVariable" fromMethod:slab ? @"getSlabForStartCoordinates" : @"getValueArrayAtLocation" fromSubmethod:[NSString stringWithFormat:@"Asynchronous read of %@",_variableName] withError:(status!=NC_NOERR) ? status : NC_EINVAL];
+	}
+	if(slab)
+		return [[NCDFSlab alloc] initSlabWithData:theData withType:_dataType withLengths:edgeLengths];
+	return theData;
+}
+
+-(id)postAsyncReadResult:(id)result
+{
+	NCDFHandle *failedHandle;
+	NSArray *theHandles;
+	int32_t i;
+	//the error handles are not thread safe, so failures are posted on the caller's queue rather than on the thread that made the read.
+	if(![result isKindOfClass:[NCDFError class]])
+		return result;
+	failedHandle = [_seriesHandle rootHandle];
+	theHandles = [_seriesHandle handles];
+	for(i=0;i<[theHandles count];i++)
+	{
+		if([[theHandles[i] theFilePath] isEqualToString:[result errorSourceObjectName]])
+		{
+			failedHandle = theHandles[i];
+			break;
+		}
+	}
+	[[failedHandle theErrorHandle] addError:result];
+	return nil;
+}
+
 -(int)variableID
 {
 	return [[[_seriesHandle rootHandle] retrieveVariableByName:_variableName] variableID];
 }
 
+-(void)setReadAheadDepth:(int)depth
+{
+	int32_t i;
+	NSArray *theHandles = [_seriesHandle handles];
+	size_t fileLimit = [self readAheadBufferLimitPerFile];
+	for(i=0;i<[theHandles count];i++)
+	{
+		//the limit goes first, so a buffer built by the depth starts with its share.
+		[[theHandles[i] retrieveVariableByName:_variableName] setReadAheadBufferLimit:fileLimit];
+		[[theHandles[i] retrieveVariableByName:_variableName] setReadAheadDepth:depth];
+	}
+}
+
+-(int)readAheadDepth
+{
+	return [[[_seriesHandle rootHandle] retrieveVariableByName:_variableName] readAheadDepth];
+}
+
+-(void)setReadAheadBufferLimit:(size_t)bytes
+{
+	int32_t i;
+	NSArray *theHandles = [_seriesHandle handles];
+	size_t fileLimit;
+	_readAheadBufferLimit = bytes;
+	fileLimit = [self readAheadBufferLimitPerFile];
+	for(i=0;i<[theHandles count];i++)
+		[[theHandles[i] retrieveVariableByName:_variableName] setReadAheadBufferLimit:fileLimit];
+}
+
+-(size_t)readAheadBufferLimitPerFile
+{
+	size_t bytes = _readAheadBufferLimit ? _readAheadBufferLimit : NCDFReadAheadDefaultBufferLimit;
+	NSUInteger fileCount = [[_seriesHandle handles] count];
+	if(fileCount>1)
+		bytes /= fileCount;
+	return bytes>0 ? bytes : 1;
+}
+
+-(NSDictionary *)readAheadStatistics
+{
+	int32_t i;
+	unsigned long long hits,misses,prefetched,bufferedBytes;
+	NSDictionary *fileStatistics;
+	NSArray *theHandles = [_seriesHandle handles];
+	BOOL found = NO;
+	hits = misses = prefetched = bufferedBytes = 0;
+	for(i=0;i<[theHandles count];i++)
+	{
+		fileStatistics = [[theHandles[i] retrieveVariableByName:_variableName] readAheadStatistics];
+		if(!fileStatistics)
+			continue;
+		found = YES;
+		hits += [fileStatistics[NCDFReadAheadStatisticHits] unsignedLongLongValue];
+		misses += [fileStatistics[NCDFReadAheadStatisticMisses] unsignedLongLongValue];
+		prefetched += [fileStatistics[NCDFReadAheadStatisticPrefetchedRecords] unsignedLongLongValue];
+		bufferedBytes += [fileStatistics[NCDFReadAheadStatisticBufferedBytes] unsignedLongLongValue];
+	}
+	if(!found)
+		return nil;
+	return @{NCDFReadAheadStatisticDepth:@([self readAheadDepth]),
+			 NCDFReadAheadStatisticHits:@(hits),
+			 NCDFReadAheadStatisticMisses:@(misses),
+			 NCDFReadAheadStatisticHitRate:@(hits+misses>0 ? (double)hits/(double)(hits+misses) : 0.0),
+			 NCDFReadAheadStatisticPrefetchedRecords:@(prefetched),
+			 NCDFReadAheadStatisticBufferedBytes:@(bufferedBytes)};
+}
+
 -(void)dealloc
 {
     _variableName = nil;
@@ -19,12 +19,14 @@
 
 #import <Cocoa/Cocoa.h>
 #import <netcdf.h>
+#import "NCDFUnpacking.h"
 
 @interface NCDFSlab : NSObject {
 	nc_type theType;
 	size_t *dimensionLengths;
 	int32_t dimCount;
 	NSData *theData;
+	BOOL dataIsBigEndian;
 }
 
 /*!
@@ -37,6 +39,16 @@
 */
 -(id)initSlabWithData:(NSData *)data withType:(nc_type)type withLengths:(NSArray *)lengths;
 
+/*!
+@method initSlabWithBigEndianData:withType:withLengths:
+@abstract Initialize a new NCDFSlab with data in the netcdf external (big-endian) byte order.
+@param data NSData object, typically obtained from NCDFMappedFile.  It is kept without being copied.
+@param type nc_type of the data.  NC_BYTE,NC_CHAR,NC_SHORT, etc.
+@param lengths Lengths along each dimension in significance order.
+@discussion The data is converted to the host's byte order only when it is used: data converts the whole slab once and keeps the result, while subSlabStart:lengths: converts just the values it returns.
+*/
+-(id)initSlabWithBigEndianData:(NSData *)data withType:(nc_type)type withLengths:(NSArray *)lengths;
+
 	/*!
 @method type
 	@abstract Returns the nc_type of the receiver.
@@ -65,4 +77,53 @@
 	@discussion The returned array describes the shape, in length, of the data object.  Use this array to choose subsets of the slab.
 	*/
 -(NSArray *)dimensionLengths;
+
+	/*!
+	@method subSlabStart:lengths:stride:
+	@abstract Returns a subsampled subset of the slab's data using netcdf stride notation.
+	@param startPositions Start locations for each dimension in significance order.
+	@param lengths Number of values wanted along each dimension in significance order.
+	@param stride Distance between values along each dimension, at least 1.  nil is the same as subSlabStart:lengths:.
+	@discussion The in-memory counterpart of NCDFVariable's getValueArrayAtLocation:edgeLengths:stride:.  Taking every eighth value along each horizontal dimension of a grid, for example, gives a 1/8 resolution preview.
+	*/
+-(NSData *)subSlabStart:(NSArray *)startPositions lengths:(NSArray *)lengths stride:(NSArray *)stride;
+
+	/*!
+	@method subSlabStart:lengths:stride:imap:
+	@abstract Returns a subset of the slab's data laid out with an index map, as nc_get_varm_* does.
+	@param startPositions Start locations for each dimension in significance order.
+	@param lengths Number of values wanted along each dimension in significance order.
+	@param stride Distance between values along each dimension, at least 1, or nil.
+	@param imap Distance in values between neighbouring values of the result along each dimension, or nil for row-major order.
+	*/
+-(NSData *)subSlabStart:(NSArray *)startPositions lengths:(NSArray *)lengths stride:(NSArray *)stride imap:(NSArray *)imap;
+
+	/*!
+	@method unpackedDataAsType:packing:validity:
+	@abstract Returns the slab's data unpacked to real values.
+	@param type NC_FLOAT or NC_DOUBLE.
+	@param packing the packing parameters of the variable the slab was read from, see NCDFVariable's packingParameters.
+	@param validity if not NULL, returns a bitmask with one bit per value, least significant bit first, set when the value is valid.
+	@discussion Values equal to the fill or missing values become NaN.  Returns nil if the slab holds text or type is not a floating point type.
+	*/
+-(NSData *)unpackedDataAsType:(nc_type)type packing:(NCDFPackingParameters)packing validity:(NSData **)validity;
+
+	/*!
+	@method slabWithDimensionOrder:
+	@abstract Returns a new slab with the receiver's dimensions reordered.
+	@param order order[i] is the receiver's dimension that becomes dimension i of the new slab.
+	@discussion Returns nil if order is not a permutation of the receiver's dimensions.
+	*/
+-(NCDFSlab *)slabWithDimensionOrder:(NSArray *)order;
+
+	/*!
+	@method transposedImap:lengths:forEdgeLengths:dimensionOrder:
+	@abstract Computes the index map and result lengths of a transposed read.
+	@param imap returns the index map for getValueArrayAtLocation:edgeLengths:stride:imap: and the other imap methods.
+	@param lengths returns the lengths of the transposed result, in its own significance order.
+	@param edgeLengths Number of values read along each dimension of the source.
+	@param order order[i] is the source dimension that becomes dimension i of the result.
+	@result NO if order is not a permutation of the source dimensions.
+	*/
++(BOOL)transposedImap:(NSArray **)imap lengths:(NSArray **)lengths forEdgeLengths:(NSArray *)edgeLengths dimensionOrder:(NSArray *)order;
 @end
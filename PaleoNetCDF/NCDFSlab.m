@@ -7,6 +7,8 @@
 //
 
 #import "NCDFSlab.h"
+#import "NCDFHyperslab.h"
+#import "NCDFMappedFile.h"
 
 @interface NCDFSlab (Private)
     /*!
@@ -34,12 +36,12 @@
     @method startPositionForNextStepFrom:fromStart:withLengths:
     @abstract Private method for determining a position within a NSData object.
     */
--(int)startPositionForNextStepFrom:(NSMutableArray *)current fromStart:(NSArray *)startCoords withLengths:(NSArray *)lengths;
+-(size_t)startPositionForNextStepFrom:(NSMutableArray *)current fromStart:(NSArray *)startCoords withLengths:(NSArray *)lengths;
     /*!
     @method positionFromCoordinates:
     @abstract Private method for determining a position within a NSData object.
     */
--(int)positionFromCoordinates:(NSArray *)coordinates;
+-(size_t)positionFromCoordinates:(NSArray *)coordinates;
 @end
 
 @implementation NCDFSlab
@@ -49,13 +51,21 @@
 	self = [super init];
 	if(self) {
 		[self setData:data];
-		NSLog(@"data length %ld",[data length]);
 		[self setNCType:type];
 		[self setDimensionLengths:lengths];
 	}
 	return self;
 }
 
+-(id)initSlabWithBigEndianData:(NSData *)data withType:(nc_type)type withLengths:(NSArray *)lengths
+{
+	self = [self initSlabWithData:data withType:type withLengths:lengths];
+	if(self) {
+		dataIsBigEndian = (NCDFSizeOfType(type) > 1);
+	}
+	return self;
+}
+
 -(void)dealloc
 {
     free(dimensionLengths);
@@ -83,51 +93,200 @@
 }
 -(NSData *)data
 {
-	return theData;
+	@synchronized(self)
+	{
+		if(dataIsBigEndian)
+		{
+			NSMutableData *hostData = [NSMutableData dataWithLength:[theData length]];
+			NCDFCopyToHostByteOrder([theData bytes],[hostData mutableBytes],[theData length]/NCDFSizeOfType(theType),theType);
+			theData = hostData;
+			dataIsBigEndian = NO;
+		}
+		return theData;
+	}
 }
 
 -(NSData *)subSlabStart:(NSArray *)startPositions lengths:(NSArray *)lengths
 {
     NSAssert(([startPositions count] == dimCount), ([NSString stringWithFormat:@"Incorrect startPositions dimensions count: %li instead of %i",[startPositions count],dimCount]));
 	NSAssert(([lengths count] == dimCount), ([NSString stringWithFormat:@"Incorrect lengths dimensions count: %li instead of %i",[lengths count],dimCount]));
-	int32_t i, temp;
+	int32_t i;
+	size_t temp;
 	for(i=0;i<dimCount;i++)
 	{
-		temp = [startPositions[i] intValue];
-		NSAssert(( temp < dimensionLengths[i]), ([NSString stringWithFormat:@"startPositions out of range: dim %i, %i of %zi",i,temp,dimensionLengths[i]]));
-		NSAssert(( [lengths[i] intValue] > 0), ([NSString stringWithFormat:@"length for dim %i, is zero",i]));
-		temp = temp + [lengths[i] intValue] ;//problem line
-		NSAssert(( temp <= dimensionLengths[i]), ([NSString stringWithFormat:@"lengths out of range: dim %i, max value %i of %zi",i,temp,dimensionLengths[i]]));
+		temp = (size_t)[startPositions[i] unsignedLongLongValue];
+		NSAssert(( temp < dimensionLengths[i]), ([NSString stringWithFormat:@"startPositions out of range: dim %i, %zu of %zu",i,temp,dimensionLengths[i]]));
+		NSAssert(( [lengths[i] unsignedLongLongValue] > 0), ([NSString stringWithFormat:@"length for dim %i, is zero",i]));
+		temp = temp + (size_t)[lengths[i] unsignedLongLongValue] ;//problem line
+		NSAssert(( temp <= dimensionLengths[i]), ([NSString stringWithFormat:@"lengths out of range: dim %i, max value %zu of %zu",i,temp,dimensionLengths[i]]));
 	}
-    int32_t steps = 1;
+    size_t step,steps = 1;
 	if(dimCount != 1)
 	{
 		for (i=(dimCount - 2);i>-1;i--) //note that we don't count the most significant dim because we'll read all those data at once
 		{
-			steps *= [lengths[i] intValue];
+			steps *= (size_t)[lengths[i] unsignedLongLongValue];
 		}
 	}
 
+	NSData *sourceData;
+	BOOL swapBytes;
+	@synchronized(self)
+	{
+		sourceData = theData;
+		swapBytes = dataIsBigEndian;
+	}
 	NSRange readRange;
-	readRange.length = sizeof(theType) * [[lengths lastObject] intValue];
-	NSMutableData *theMutData = [[NSMutableData alloc] init];
+	readRange.length = NCDFSizeOfType(theType) * (NSUInteger)[[lengths lastObject] unsignedLongLongValue];
+	NSMutableData *theMutData = [[NSMutableData alloc] initWithCapacity:readRange.length*steps];
 	NSMutableArray *current = [[NSMutableArray alloc] init];
 	[current addObjectsFromArray:startPositions];
-	for(i=0;i<steps;i++)
+	for(step=0;step<steps;step++)
+	{
+		readRange.location = [self startPositionForNextStepFrom:current fromStart:startPositions withLengths:lengths] * NCDFSizeOfType(theType);
+		[theMutData appendBytes:(const uint8_t *)[sourceData bytes]+readRange.location length:readRange.length];
+	}
+	if(swapBytes)
+		NCDFCopyToHostByteOrder([theMutData bytes],[theMutData mutableBytes],[theMutData length]/NCDFSizeOfType(theType),theType);
+	return [NSData dataWithData:theMutData];
+}
+
+-(NSData *)subSlabStart:(NSArray *)startPositions lengths:(NSArray *)lengths stride:(NSArray *)stride
+{
+	if(!stride)
+		return [self subSlabStart:startPositions lengths:lengths];
+	return [self subSlabStart:startPositions lengths:lengths stride:stride imap:nil];
+}
+
+-(NSData *)subSlabStart:(NSArray *)startPositions lengths:(NSArray *)lengths stride:(NSArray *)stride imap:(NSArray *)imap
+{
+	NSAssert(([startPositions count] == dimCount), ([NSString stringWithFormat:@"Incorrect startPositions dimensions count: %li instead of %i",[startPositions count],dimCount]));
+	NSAssert(([lengths count] == dimCount), ([NSString stringWithFormat:@"Incorrect lengths dimensions count: %li instead of %i",[lengths count],dimCount]));
+	NSAssert((!stride || [stride count] == dimCount), ([NSString stringWithFormat:@"Incorrect stride dimensions count: %li instead of %i",[stride count],dimCount]));
+	NSAssert((!imap || [imap count] == dimCount), ([NSString stringWithFormat:@"Incorrect imap dimensions count: %li instead of %i",[imap count],dimCount]));
+	int32_t i;
+	size_t *start = (size_t *)malloc(sizeof(size_t)*(dimCount+1));
+	size_t *count = (size_t *)malloc(sizeof(size_t)*(dimCount+1));
+	ptrdiff_t *strides = (ptrdiff_t *)malloc(sizeof(ptrdiff_t)*(dimCount+1));
+	ptrdiff_t *map = (ptrdiff_t *)malloc(sizeof(ptrdiff_t)*(dimCount+1));
+	for(i=0;i<dimCount;i++)
+	{
+		start[i] = (size_t)[startPositions[i] unsignedLongLongValue];
+		count[i] = (size_t)[lengths[i] unsignedLongLongValue];
+		strides[i] = stride ? (ptrdiff_t)[stride[i] longLongValue] : 1;
+		map[i] = imap ? (ptrdiff_t)[imap[i] longLongValue] : 0;
+		NSAssert((strides[i] > 0), ([NSString stringWithFormat:@"stride for dim %i is not positive",i]));
+		NSAssert((map[i] >= 0), ([NSString stringWithFormat:@"imap for dim %i is negative",i]));
+		NSAssert((count[i] > 0), ([NSString stringWithFormat:@"length for dim %i, is zero",i]));
+		NSAssert((start[i]+(count[i]-1)*(size_t)strides[i] < dimensionLengths[i]), ([NSString stringWithFormat:@"lengths out of range: dim %i of %zi",i,dimensionLengths[i]]));
+	}
+	if(!imap)
+		NCDFRowMajorImap(dimCount,count,map);
+
+	NSData *sourceData;
+	BOOL swapBytes;
+	@synchronized(self)
 	{
-		readRange.location = [self startPositionForNextStepFrom:current fromStart:startPositions withLengths:lengths] * sizeof(theType);
-		[theMutData appendData:[theData subdataWithRange:readRange]];
+		sourceData = theData;
+		swapBytes = dataIsBigEndian;
 	}
+	NSMutableData *theMutData = [NSMutableData dataWithLength:NCDFImapExtent(dimCount,count,map)*NCDFSizeOfType(theType)];
+	NCDFCopyStridedRegion(dimCount,dimensionLengths,NCDFSizeOfType(theType),[sourceData bytes],start,count,strides,map,[theMutData mutableBytes]);
+	if(swapBytes)
+		NCDFCopyToHostByteOrder([theMutData bytes],[theMutData mutableBytes],[theMutData length]/NCDFSizeOfType(theType),theType);
+	free(start);
+	free(count);
+	free(strides);
+	free(map);
 	return [NSData dataWithData:theMutData];
 }
 
+-(NSData *)unpackedDataAsType:(nc_type)type packing:(NCDFPackingParameters)packing validity:(NSData **)validity
+{
+	NSData *packedData;
+	NSMutableData *theMutData,*theMask;
+	size_t count;
+	if((type!=NC_FLOAT && type!=NC_DOUBLE) || theType==NC_CHAR)
+		return nil;
+	packedData = [self data];
+	count = [packedData length]/NCDFSizeOfType(theType);
+	theMutData = [NSMutableData dataWithLength:count*NCDFSizeOfType(type)];
+	theMask = validity ? [NSMutableData dataWithLength:NCDFValidityMaskLength(count)] : nil;
+	if(!NCDFUnpackValues([packedData bytes],theType,count,&packing,[theMutData mutableBytes],type,(uint8_t *)[theMask mutableBytes]))
+		return nil;
+	if(validity)
+		*validity = theMask;
+	return theMutData;
+}
+
+-(NCDFSlab *)slabWithDimensionOrder:(NSArray *)order
+{
+	NSArray *imap,*lengths,*start;
+	NSMutableArray *zeros;
+	int32_t i;
+	if(![NCDFSlab transposedImap:&imap lengths:&lengths forEdgeLengths:[self dimensionLengths] dimensionOrder:order])
+		return nil;
+	zeros = [[NSMutableArray alloc] init];
+	for(i=0;i<dimCount;i++)
+		[zeros addObject:@0];
+	start = [NSArray arrayWithArray:zeros];
+	return [[NCDFSlab alloc] initSlabWithData:[self subSlabStart:start lengths:[self dimensionLengths] stride:nil imap:imap] withType:theType withLengths:lengths];
+}
+
++(BOOL)transposedImap:(NSArray **)imap lengths:(NSArray **)lengths forEdgeLengths:(NSArray *)edgeLengths dimensionOrder:(NSArray *)order
+{
+	int32_t i,ndims,source;
+	int *dimOrder;
+	size_t *count;
+	ptrdiff_t *map;
+	BOOL *used;
+	BOOL isPermutation;
+	NSMutableArray *theImap,*theLengths;
+	ndims = (int32_t)[edgeLengths count];
+	if([order count]!=ndims)
+		return NO;
+	dimOrder = (int *)malloc(sizeof(int)*(ndims+1));
+	count = (size_t *)malloc(sizeof(size_t)*(ndims+1));
+	map = (ptrdiff_t *)malloc(sizeof(ptrdiff_t)*(ndims+1));
+	used = (BOOL *)calloc(ndims+1,sizeof(BOOL));
+	isPermutation = YES;
+	for(i=0;i<ndims;i++)
+	{
+		count[i] = (size_t)[edgeLengths[i] unsignedLongLongValue];
+		source = [order[i] intValue];
+		if(source<0 || source>=ndims || used[source])
+			isPermutation = NO;
+		else
+			used[source] = YES;
+		dimOrder[i] = source;
+	}
+	if(isPermutation)
+	{
+		NCDFTransposedImap(ndims,count,dimOrder,map);
+		theImap = [[NSMutableArray alloc] init];
+		theLengths = [[NSMutableArray alloc] init];
+		for(i=0;i<ndims;i++)
+		{
+			[theImap addObject:[NSNumber numberWithLongLong:(long long)map[i]]];
+			[theLengths addObject:edgeLengths[dimOrder[i]]];
+		}
+		*imap = [NSArray arrayWithArray:theImap];
+		*lengths = [NSArray arrayWithArray:theLengths];
+	}
+	free(dimOrder);
+	free(count);
+	free(map);
+	free(used);
+	return isPermutation;
+}
+
 -(NSArray *)dimensionLengths
 {
 	NSMutableArray *theArray = [[NSMutableArray alloc] init];
 	int32_t i;
 	for(i=0;i<dimCount;i++)
 	{
-		[theArray addObject:[NSNumber numberWithInt:(int)dimensionLengths[i]]];
+		[theArray addObject:[NSNumber numberWithUnsignedLongLong:dimensionLengths[i]]];
 	}
 	return [NSArray arrayWithArray:theArray];
 }
@@ -139,16 +298,16 @@
 	dimCount = (int)[theLengths count];
 	for(i=0;i<dimCount;i++)
 	{
-		dimensionLengths[i] = (size_t)[theLengths[i] intValue];
+		dimensionLengths[i] = (size_t)[theLengths[i] unsignedLongLongValue];
 	}
 }
 
--(int)startPositionForNextStepFrom:(NSMutableArray *)current fromStart:(NSArray *)startCoords withLengths:(NSArray *)lengths
+-(size_t)startPositionForNextStepFrom:(NSMutableArray *)current fromStart:(NSArray *)startCoords withLengths:(NSArray *)lengths
 {
 	int32_t count = (int)[current count];
 	NSMutableArray *theArray = [[NSMutableArray alloc] init];
 	int32_t i;
-	int32_t newPoint,  startPosition ;
+	size_t newPoint,  startPosition ;
 	int32_t carryover;
 	startPosition = [self positionFromCoordinates:current];//we get value first and then increment by one
 	//NSLog(@"start");
@@ -156,15 +315,15 @@
 	carryover = 1;
 	for(i=(count-2);i>-1;i--)
 	{
-		newPoint = [current[i] intValue] + carryover;
-		if(newPoint == ([startCoords[i] intValue] + [lengths[i] intValue] ))
+		newPoint = (size_t)[current[i] unsignedLongLongValue] + carryover;
+		if(newPoint == ((size_t)[startCoords[i] unsignedLongLongValue] + (size_t)[lengths[i] unsignedLongLongValue] ))
 		{
-			newPoint = [startCoords[i] intValue];//reset dim
+			newPoint = (size_t)[startCoords[i] unsignedLongLongValue];//reset dim
 			carryover = 1;
 		}
 		else
 			carryover = 0;
-		[theArray insertObject:[NSNumber numberWithInt:newPoint] atIndex:0];
+		[theArray insertObject:[NSNumber numberWithUnsignedLongLong:newPoint] atIndex:0];
 	}
 	[theArray addObject:[startCoords lastObject]];
 	[current removeAllObjects];
@@ -172,14 +331,14 @@
 	return startPosition;
 }
 
--(int)positionFromCoordinates:(NSArray *)coordinates
+-(size_t)positionFromCoordinates:(NSArray *)coordinates
 {
 	int32_t i,j;
-	int32_t temp = 0;
-	int32_t startPosition = 0;
+	size_t temp = 0;
+	size_t startPosition = 0;
 	for(i=0;i<[coordinates count];i++)
 	{
-		temp = [coordinates[i] intValue];
+		temp = (size_t)[coordinates[i] unsignedLongLongValue];
 		for(j=i+1;j<[coordinates count];j++)
 		{
 			temp *= dimensionLengths[j];
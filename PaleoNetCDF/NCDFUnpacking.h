@@ -0,0 +1,76 @@
+//
+//  NCDFUnpacking.h
+//  netcdf
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+/*!
+ @header
+ @abstract C helpers for unpacking CF packed data.
+ @discussion Packed variables store integers that stand for real values through the CF attributes scale_factor and add_offset, with _FillValue and missing_value marking values that are absent and valid_min, valid_max or valid_range bounding the values that are valid.  NCDFUnpackValues converts a whole buffer with the vector routines of the Accelerate framework, then replaces absent values with NaN, optionally recording which values are valid in a bitmask.  NCDFVariable, NCDFSeriesVariable and NCDFSlab use these helpers for their unpacked reads.
+ */
+
+#import <Foundation/Foundation.h>
+#import <netcdf.h>
+
+/*!
+ @defined NCDFPackingMaxMissingValues
+ @discussion Most values of missing_value that are honoured.
+ */
+#define NCDFPackingMaxMissingValues 4
+
+/*!
+ @typedef NCDFPackingParameters
+ @abstract The CF packing attributes of a variable.
+ @field scaleFactor scale_factor, or 1.
+ @field addOffset add_offset, or 0.
+ @field hasFillValue YES if the variable has a _FillValue.
+ @field fillValue _FillValue in the packed type.
+ @field missingValueCount number of entries in missingValues.
+ @field missingValues missing_value in the packed type.
+ @field hasValidMin YES if the variable has valid_min or valid_range.
+ @field validMin smallest valid value in the packed type.
+ @field hasValidMax YES if the variable has valid_max or valid_range.
+ @field validMax largest valid value in the packed type.
+ */
+typedef struct {
+    double scaleFactor;
+    double addOffset;
+    BOOL hasFillValue;
+    double fillValue;
+    int missingValueCount;
+    double missingValues[NCDFPackingMaxMissingValues];
+    BOOL hasValidMin;
+    double validMin;
+    BOOL hasValidMax;
+    double validMax;
+} NCDFPackingParameters;
+
+/*!
+ @function NCDFPackingParametersMake
+ @abstract Returns packing parameters that leave values unchanged and mark none absent or out of range.
+ */
+NCDFPackingParameters NCDFPackingParametersMake(void);
+
+/*!
+ @function NCDFValidityMaskLength
+ @abstract Returns the size in bytes of a validity bitmask for count values.
+ */
+size_t NCDFValidityMaskLength(size_t count);
+
+/*!
+ @function NCDFUnpackValues
+ @abstract Converts packed values to floating point real values.
+ @param source packed values in host byte order.
+ @param sourceType NC_BYTE, NC_SHORT, NC_INT, NC_FLOAT or NC_DOUBLE.
+ @param count number of values.
+ @param packing the variable's packing parameters.
+ @param destination buffer for count values of destinationType.  It must not overlap source.
+ @param destinationType NC_FLOAT or NC_DOUBLE.
+ @param validity NULL, or a buffer of NCDFValidityMaskLength(count) bytes that receives one bit per value, least significant bit first, set when the value is valid.
+ @result NO if either type is not supported.
+ @discussion Values equal to the fill or a missing value, or outside the valid range, become NaN in destination.  The tests run on the packed values, before scaling, widened to double, which holds every packed value exactly, so no precision is lost.  They are done a block at a time with vDSP, without branching on the data.
+ */
+BOOL NCDFUnpackValues(const void *source,nc_type sourceType,size_t count,const NCDFPackingParameters *packing,void *destination,nc_type destinationType,uint8_t *validity);
@@ -0,0 +1,188 @@
+//
+//  NCDFUnpacking.m
+//  netcdf
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import "NCDFUnpacking.h"
+#import <Accelerate/Accelerate.h>
+
+/*Number of values masked at a time.  A multiple of 8, so each block fills whole bytes of the validity mask.*/
+#define NCDFUnpackBlockLength 512
+
+/*Widens count packed values starting at first to double, which holds every value of the netCDF-3 types exactly.*/
+static void NCDFWidenToDouble(const void *source,nc_type sourceType,size_t first,size_t count,double *result)
+{
+    switch(sourceType)
+    {
+        case NC_BYTE:
+            vDSP_vflt8D((const char *)source+first,1,result,1,count);
+            break;
+        case NC_SHORT:
+            vDSP_vflt16D((const short *)source+first,1,result,1,count);
+            break;
+        case NC_INT:
+            vDSP_vflt32D((const int *)source+first,1,result,1,count);
+            break;
+        case NC_FLOAT:
+            vDSP_vspdp((const float *)source+first,1,result,1,count);
+            break;
+        case NC_DOUBLE:
+            memcpy(result,(const double *)source+first,count*sizeof(double));
+            break;
+    }
+}
+
+/*test holds +1 where a value passes and -1 where it fails.  Maps it to 1 and 0 and multiplies it into mask.*/
+static void NCDFAccumulateTest(double *test,double *mask,size_t count)
+{
+    const double half = 0.5;
+    vDSP_vsmsaD(test,1,&half,&half,test,1,count);
+    vDSP_vmulD(mask,1,test,1,mask,1,count);
+}
+
+NCDFPackingParameters NCDFPackingParametersMake(void)
+{
+    NCDFPackingParameters packing;
+    memset(&packing,0,sizeof(packing));
+    packing.scaleFactor = 1.0;
+    packing.addOffset = 0.0;
+    return packing;
+}
+
+size_t NCDFValidityMaskLength(size_t count)
+{
+    return (count+7)/8;
+}
+
+BOOL NCDFUnpackValues(const void *source,nc_type sourceType,size_t count,const NCDFPackingParameters *packing,void *destination,nc_type destinationType,uint8_t *validity)
+{
+    double absentValues[NCDFPackingMaxMissingValues+1];
+    double packed[NCDFUnpackBlockLength],mask[NCDFUnpackBlockLength],test[NCDFUnpackBlockLength];
+    float penalty[NCDFUnpackBlockLength];
+    uint8_t valid[NCDFUnpackBlockLength];
+    const double one = 1.0,zero = 0.0;
+    double tiny,bound;
+    int32_t absentCount,j;
+    size_t first,n,k;
+
+    //Step 1. Widen to the destination type.
+    if(destinationType==NC_FLOAT)
+    {
+        float scale = (float)packing->scaleFactor;
+        float offset = (float)packing->addOffset;
+        switch(sourceType)
+        {
+            case NC_BYTE:
+                vDSP_vflt8((const char *)source,1,(float *)destination,1,count);
+                break;
+            case NC_SHORT:
+                vDSP_vflt16((const short *)source,1,(float *)destination,1,count);
+                break;
+            case NC_INT:
+                vDSP_vflt32((const int *)source,1,(float *)destination,1,count);
+                break;
+            case NC_FLOAT:
+                memcpy(destination,source,count*sizeof(float));
+                break;
+            case NC_DOUBLE:
+                vDSP_vdpsp((const double *)source,1,(float *)destination,1,count);
+                break;
+            default:
+                return NO;
+        }
+        //Step 2. Scale and offset in one pass.
+        if(scale!=1.0f || offset!=0.0f)
+            vDSP_vsmsa((const float *)destination,1,&scale,&offset,(float *)destination,1,count);
+    }
+    else if(destinationType==NC_DOUBLE)
+    {
+        double scale = packing->scaleFactor;
+        double offset = packing->addOffset;
+        switch(sourceType)
+        {
+            case NC_BYTE:
+                vDSP_vflt8D((const char *)source,1,(double *)destination,1,count);
+                break;
+            case NC_SHORT:
+                vDSP_vflt16D((const short *)source,1,(double *)destination,1,count);
+                break;
+            case NC_INT:
+                vDSP_vflt32D((const int *)source,1,(double *)destination,1,count);
+                break;
+            case NC_FLOAT:
+                vDSP_vspdp((const float *)source,1,(double *)destination,1,count);
+                break;
+            case NC_DOUBLE:
+                memcpy(destination,source,count*sizeof(double));
+                break;
+            default:
+                return NO;
+        }
+        if(scale!=1.0 || offset!=0.0)
+            vDSP_vsmsaD((const double *)destination,1,&scale,&offset,(double *)destination,1,count);
+    }
+    else
+        return NO;
+
+    //Step 3. Mask the absent and out of range values a block at a time.  Each test yields 1 or 0 per value and is multiplied into the mask, so no branch depends on the data.
+    absentCount = 0;
+    if(packing->hasFillValue)
+        absentValues[absentCount++] = packing->fillValue;
+    for(j=0;j<packing->missingValueCount && j<NCDFPackingMaxMissingValues;j++)
+        absentValues[absentCount++] = packing->missingValues[j];
+    if(absentCount==0 && !packing->hasValidMin && !packing->hasValidMax)
+    {
+        if(validity)
+            memset(validity,0xFF,NCDFValidityMaskLength(count));
+        return YES;
+    }
+    if(validity)
+        memset(validity,0,NCDFValidityMaskLength(count));
+    //The smallest positive double: |packed-absent| reaches it unless the two are equal.
+    tiny = nextafter(0.0,1.0);
+    for(first=0;first<count;first+=NCDFUnpackBlockLength)
+    {
+        n = MIN((size_t)NCDFUnpackBlockLength,count-first);
+        NCDFWidenToDouble(source,sourceType,first,n,packed);
+        vDSP_vfillD(&one,mask,1,n);
+        for(j=0;j<absentCount;j++)
+        {
+            bound = -absentValues[j];
+            vDSP_vsaddD(packed,1,&bound,test,1,n);
+            vDSP_vabsD(test,1,test,1,n);
+            vDSP_vlimD(test,1,&tiny,&one,test,1,n);
+            NCDFAccumulateTest(test,mask,n);
+        }
+        if(packing->hasValidMin)
+        {
+            vDSP_vlimD(packed,1,&packing->validMin,&one,test,1,n);
+            NCDFAccumulateTest(test,mask,n);
+        }
+        if(packing->hasValidMax)
+        {
+            bound = -packing->validMax;
+            vDSP_vnegD(packed,1,test,1,n);
+            vDSP_vlimD(test,1,&bound,&one,test,1,n);
+            NCDFAccumulateTest(test,mask,n);
+        }
+        //0/1 is 0 and 0/0 is NaN, so adding zero/mask leaves valid values alone and turns the rest into NaN.
+        vDSP_svdivD(&zero,mask,1,test,1,n);
+        if(destinationType==NC_FLOAT)
+        {
+            vDSP_vdpsp(test,1,penalty,1,n);
+            vDSP_vadd((const float *)destination+first,1,penalty,1,(float *)destination+first,1,n);
+        }
+        else
+            vDSP_vaddD((const double *)destination+first,1,test,1,(double *)destination+first,1,n);
+        if(validity)
+        {
+            vDSP_vfixu8D(mask,1,valid,1,n);
+            for(k=0;k<n;k++)
+                validity[(first+k)>>3] |= (uint8_t)(valid[k]<<(k&7));
+        }
+    }
+    return YES;
+}
@@ -12,6 +12,7 @@
 #import <AppKit/NSPanel.h>
 #import "NCDFAttribute.h"
 #import "NCDFProtocols.h"
+#import "NCDFUnpacking.h"
 
 /*!
     @defined NCDFVariablePropertyListType
@@ -61,8 +62,44 @@
 */
 #define NCDFVariablePropertyListFieldAttributes @"attributes"
 
+/*!
+    @defined NCDFVariablePropertyListFieldStorage
+    @discussion Defines the string used for accessing property list fields.  This string accesses the storage options dictionary of a netCDF-4 variable.
+*/
+#define NCDFVariablePropertyListFieldStorage @"storage"
+
+/*!
+    @defined NCDFVariableStorageContiguous
+    @discussion Storage option key.  NSNumber BOOL; YES stores the variable contiguously instead of in chunks.
+*/
+#define NCDFVariableStorageContiguous @"contiguous"
+
+/*!
+    @defined NCDFVariableStorageChunkSizes
+    @discussion Storage option key.  NSArray of NSNumber chunk lengths, one per dimension in significance order.
+*/
+#define NCDFVariableStorageChunkSizes @"chunkSizes"
 
-@class NCDFHandle,NCDFAttribute,NCDFSlab;
+/*!
+    @defined NCDFVariableStorageDeflateLevel
+    @discussion Storage option key.  NSNumber deflate level from 0 (no compression) to 9.
+*/
+#define NCDFVariableStorageDeflateLevel @"deflateLevel"
+
+/*!
+    @defined NCDFVariableStorageShuffle
+    @discussion Storage option key.  NSNumber BOOL; YES turns on the shuffle filter.
+*/
+#define NCDFVariableStorageShuffle @"shuffle"
+
+/*!
+    @defined NCDFVariableStorageFletcher32
+    @discussion Storage option key.  NSNumber BOOL; YES turns on fletcher32 checksums.
+*/
+#define NCDFVariableStorageFletcher32 @"fletcher32"
+
+
+@class NCDFHandle,NCDFAttribute,NCDFSlab,NCDFReadToken,NCDFReadAhead;
 
 
 /*!
@@ -83,9 +120,22 @@
     nc_type dataType;
     NSArray *dimIDs;
     int32_t numberOfAttributes;
-    NSArray *attributes;//NCDFAttributes
+    NSArray *attributes;//NCDFAttributes, cached until the next refresh
+    NSDictionary *_attributesByName;
     NCDFHandle *theHandle;
     NCDFErrorHandle *theErrorHandle;
+    size_t _chunkCacheSize;
+    size_t _chunkCacheSlots;
+    float _chunkCachePreemption;
+    BOOL _chunkCacheSet;
+    BOOL _automaticChunkCache;
+    NCDFReadAhead *_readAhead;
+    size_t _readAheadBufferLimit;
+    size_t _cachedRecordCount;
+    uint64_t _recordCountGeneration;
+    BOOL _hasCachedRecordCount;
+    NSTimeInterval _lastFileCheck;
+    NSArray *_fileSignature;
 }
 
 
@@ -176,7 +226,7 @@
     @param attName NSString with the new attribute name
     @param theType nc_type of the values
     @param theValues an Array of values 1 NSString object if NC_CHAR, otherwise multiple NSNumber objects as needed.
-    @discussion Creates a new attribute owned by the receiver.
+    @discussion Creates a new attribute owned by the receiver.  Inside an edit session (see NCDFHandle's beginEditSession) the attribute is only recorded and is created when the session is committed.
 */
 -(BOOL)createNewVariableAttributeWithName:(NSString *)attName dataType:(nc_type)theType values:(NSArray *)theValues;
 
@@ -194,7 +244,7 @@
 /*!
     @method getVariableAttributes
     @abstract Returns an array of attributes.
-    @discussion Returns an array of NCDFAttributes owned by the receiver.
+    @discussion Returns an array of NCDFAttributes owned by the receiver.  The attributes are read from the file once and kept until the handle refreshes the variable.
 */
 -(NSArray *)getVariableAttributes;
 
@@ -202,7 +252,7 @@
     @method deleteVariableAttributeByName:
     @param name a NSString object containing the name of the variable
     @abstract Delete a variable attribute.
-    @discussion Deletes a variable attribute by name from the receiver's file, forcing a NCDFHandle refresh.  Once deleted, the variable attribute is unrecoverable.  This method uses a temporary file during the process.  Creates an NSError if fails and will return a NO.
+    @discussion Deletes a variable attribute by name from the receiver's file, forcing a NCDFHandle refresh.  Once deleted, the variable attribute is unrecoverable.  This method uses a temporary file during the process.  Creates an NSError if fails and will return a NO.  Inside an edit session the deletion is only recorded and is made when the session is committed.
 */
 -(BOOL)deleteVariableAttributeByName:(NSString *)name;
 
@@ -244,10 +294,147 @@
     @abstract Access a subset of variable data.
     @param startCoordinates An integer array with an NSNumber object representing the start position along each dimension in significance order.
     @param edgeLengths An integer array with an NSNumber object representing the number of units to be read along each dimension in significance order.
-    @discussion The method is the fundimental data reading method for NCDFVariable.  Returns a NSData object containing the data or nil if unsuccessful.
+    @discussion The method is the fundimental data reading method for NCDFVariable.  Returns a NSData object containing the data or nil if unsuccessful.  Reads are served, in order of preference, from the read-ahead buffer, the handle's memory mapping and the shared NCDFBlockCache, when each is turned on, before the file is read.
 */
 -(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths;
 
+/*!
+    @method getValueArrayAtLocation:edgeLengths:status:
+    @abstract Access a subset of variable data without posting errors.
+    @param startCoordinates An integer array with an NSNumber object representing the start position along each dimension in significance order.
+    @param edgeLengths An integer array with an NSNumber object representing the number of units to be read along each dimension in significance order.
+    @param status receives the netcdf status of the read.
+    @discussion Reads like getValueArrayAtLocation:edgeLengths: but returns the status instead of posting it to the error handle, so it can be used from background threads that report errors later on the thread that started them.
+*/
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths status:(int32_t *)status;
+
+/*!
+    @method valueArrayWithNCID:start:edges:status:
+    @abstract Reads a subset of variable data through an ncid that is already checked out from the handle.
+    @param ncid a read-only ncid obtained from the handle's ncidWithOpenMode:status:.
+    @param start start position along each dimension in significance order.
+    @param edges number of units to read along each dimension in significance order.
+    @param status returns the netcdf status of the read.
+    @discussion This is the reading core of getValueArrayAtLocation:edgeLengths:.  It does not open or close the file and does not report errors to the error handle, so NCDFHandle can use it to run several reads over shared ncids, on several threads.  Returns nil if the read failed.
+*/
+-(NSData *)valueArrayWithNCID:(int)ncid start:(const size_t *)start edges:(const size_t *)edges status:(int32_t *)status;
+
+/*!
+    @method readIntoBuffer:capacity:start:count:ndims:status:
+    @abstract Reads a subset of variable data into memory owned by the caller.
+    @param buffer receives the values in the variable's type and host byte order.
+    @param capacity size of buffer in bytes.
+    @param start start position along each dimension in significance order.
+    @param count number of units to read along each dimension in significance order.
+    @param ndims number of entries in start and count.  Must equal the variable's number of dimensions.
+    @param status returns the netcdf status of the read, or NC_EINVAL if ndims or capacity do not fit the request.  May be NULL.
+    @discussion The values are read by the library straight into buffer, with no boxing of coordinates and no intermediate objects, which makes this the cheapest way to make many small reads.  When the handle uses mapped reads the values are converted straight from the mapping into buffer instead.  Errors are also posted to the error handle.  Returns YES if successful.
+*/
+-(BOOL)readIntoBuffer:(void *)buffer capacity:(size_t)capacity start:(const size_t *)start count:(const size_t *)count ndims:(int)ndims status:(int32_t *)status;
+
+/*!
+    @method writeFromBuffer:length:start:count:ndims:status:
+    @abstract Writes a subset of variable data from memory owned by the caller.
+    @param buffer the values in the variable's type and host byte order.
+    @param length size of buffer in bytes.  It must hold at least the number of values given by count.
+    @param start start position along each dimension in significance order.
+    @param count number of units to write along each dimension in significance order.
+    @param ndims number of entries in start and count.  Must equal the variable's number of dimensions.
+    @param status returns the netcdf status of the write, or NC_EINVAL if ndims or length do not fit the request.  May be NULL.
+    @discussion The library reads the values straight from buffer.  Errors are also posted to the error handle.  Returns YES if successful.
+*/
+-(BOOL)writeFromBuffer:(const void *)buffer length:(size_t)length start:(const size_t *)start count:(const size_t *)count ndims:(int)ndims status:(int32_t *)status;
+
+/*!
+    @method readIntoBuffer:capacity:start:count:stride:imap:ndims:status:
+    @abstract Reads a strided subset of variable data into memory owned by the caller, laid out with an index map.
+    @param stride distance between values read along each dimension, or NULL for contiguous values.
+    @param imap non-negative distance in values between neighbouring values in buffer along each dimension, or NULL for row-major order.  capacity must cover NCDFImapExtent values.
+    @discussion See readIntoBuffer:capacity:start:count:ndims:status:.  The read is made with nc_get_vars_* or nc_get_varm_*.
+*/
+-(BOOL)readIntoBuffer:(void *)buffer capacity:(size_t)capacity start:(const size_t *)start count:(const size_t *)count stride:(const ptrdiff_t *)stride imap:(const ptrdiff_t *)imap ndims:(int)ndims status:(int32_t *)status;
+
+/*!
+    @method readIntoBuffer:capacity:start:count:stride:imap:type:ndims:status:
+    @abstract Reads a subset of variable data into memory owned by the caller, converted to another type.
+    @param type NC_BYTE, NC_CHAR, NC_SHORT, NC_INT, NC_FLOAT or NC_DOUBLE.  buffer receives values of this type and capacity is counted in its size.
+    @discussion The netcdf library converts each value as it reads, so a short or double variable can fill a float buffer with no second pass.  Text cannot be converted to or from numbers and values out of range of type fail with NC_ERANGE.  See readIntoBuffer:capacity:start:count:stride:imap:ndims:status:.
+*/
+-(BOOL)readIntoBuffer:(void *)buffer capacity:(size_t)capacity start:(const size_t *)start count:(const size_t *)count stride:(const ptrdiff_t *)stride imap:(const ptrdiff_t *)imap type:(nc_type)type ndims:(int)ndims status:(int32_t *)status;
+
+/*!
+    @method getValueArrayAtLocation:edgeLengths:asType:
+    @abstract Reads a subset of variable data converted to another type.
+    @param startCoordinates An integer array with an NSNumber object representing the start position along each dimension in significance order.
+    @param edgeLengths An integer array with an NSNumber object representing the number of units to be read along each dimension in significance order.
+    @param type type of the returned values, NC_FLOAT for example.
+    @discussion The conversion is made by the netcdf library straight into the returned object.  Returns nil if unsuccessful.
+*/
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths asType:(nc_type)type;
+
+/*!
+    @method packingParameters
+    @abstract Returns the variable's CF packing attributes.
+    @discussion scale_factor, add_offset, _FillValue, missing_value and the valid range, from valid_range or else valid_min and valid_max, are read from the variable's cached attributes.  Missing attributes leave values unchanged.
+*/
+-(NCDFPackingParameters)packingParameters;
+
+/*!
+    @method getUnpackedValueArrayAtLocation:edgeLengths:asType:validity:
+    @abstract Reads a subset of a CF packed variable as real values.
+    @param startCoordinates An integer array with an NSNumber object representing the start position along each dimension in significance order.
+    @param edgeLengths An integer array with an NSNumber object representing the number of units to be read along each dimension in significance order.
+    @param type NC_FLOAT or NC_DOUBLE.
+    @param validity if not NULL, returns a bitmask with one bit per value, least significant bit first, set when the value is valid.
+    @discussion The packed values are read as getValueArrayAtLocation:edgeLengths: reads them, then unpacked in one vector pass with NCDFUnpackValues using the packing attributes, read once per call.  Values equal to _FillValue or missing_value become NaN.  Returns nil if unsuccessful.
+*/
+-(NSData *)getUnpackedValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths asType:(nc_type)type validity:(NSData **)validity;
+
+/*!
+    @method getValueArrayAtLocation:edgeLengths:stride:
+    @abstract Reads every stride-th value of a subset of variable data.
+    @param startCoordinates An integer array with an NSNumber object representing the start position along each dimension in significance order.
+    @param edgeLengths An integer array with an NSNumber object representing the number of values to be read along each dimension in significance order.
+    @param stride An integer array with an NSNumber object representing the distance between values read along each dimension, at least 1.  nil reads contiguous values.
+    @discussion Subsampling is done by the netcdf library, so a 1/8 resolution preview of a grid reads only the values it needs and never holds the full resolution data.  Returns nil if unsuccessful.
+*/
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride;
+
+/*!
+    @method getValueArrayAtLocation:edgeLengths:stride:imap:
+    @abstract Reads a subset of variable data laid out in memory with an index map.
+    @param startCoordinates An integer array with an NSNumber object representing the start position along each dimension in significance order.
+    @param edgeLengths An integer array with an NSNumber object representing the number of values to be read along each dimension in significance order.
+    @param stride distance between values read along each dimension, or nil.
+    @param imap An integer array with an NSNumber object representing, for each dimension, the distance in values between neighbouring values of the result.  nil gives row-major order.
+    @discussion Uses nc_get_varm_*, so the data can be transposed or interleaved as it is read.  See NCDFSlab's transposedImap:lengths:forEdgeLengths:dimensionOrder:.  Returns nil if unsuccessful.
+*/
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride imap:(NSArray *)imap;
+
+/*!
+    @method getSlabForStartCoordinates:edgeLengths:stride:
+    @abstract Reads every stride-th value of a subset of variable data into a slab.
+    @discussion The slab's dimension lengths are edgeLengths.
+*/
+-(NCDFSlab *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride;
+
+/*!
+    @method getSlabForStartCoordinates:edgeLengths:stride:dimensionOrder:
+    @abstract Reads a subset of variable data into a slab with its dimensions reordered.
+    @param order order[i] is the variable dimension that becomes dimension i of the slab.
+    @discussion The transpose happens as the data is read, with no intermediate copy in the variable's own order.
+*/
+-(NCDFSlab *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride dimensionOrder:(NSArray *)order;
+
+/*!
+    @method mappedDataAtLocation:edgeLengths:
+    @abstract Access a subset of variable data directly in the memory mapped file.
+    @param startCoordinates An integer array with an NSNumber object representing the start position along each dimension in significance order.
+    @param edgeLengths An integer array with an NSNumber object representing the number of units to be read along each dimension in significance order.
+    @discussion Returns an NSData object that points into the handle's mappedFile, without copying, or nil if the variable is a record variable, the file is not a classic or 64-bit offset file, or the region is not contiguous in the file.  The values are in the netcdf external (big-endian) byte order; use NCDFCopyToHostByteOrder or NCDFSlab's initSlabWithBigEndianData:withType:withLengths: to read multi-byte types.  This method does not depend on the handle's usesMappedReads setting.
+*/
+-(NSData *)mappedDataAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths;
+
 
 /*!
     @method isDimensionVariable:
@@ -262,26 +449,26 @@
     @abstract Get the NCDFVariables data unit size in units.
     @discussion Returns the unit size in units for the receiver.  A "unit size" includes a value count based on all dimensions except for any unlimited dimension.
 */
--(int)sizeUnitVariable;
+-(size_t)sizeUnitVariable;
 
 /*!
     @method sizeUnitVariableForType:
     @abstract Get the NCDFVariables data unit size in bytes.
     @discussion Returns the unit size in bytes for the receiver.  A "unit size" includes a value count based on all dimensions except for any unlimited dimension.
 */
--(int)sizeUnitVariableForType;
+-(size_t)sizeUnitVariableForType;
 
 /*!
     @method currentVariableSize:
     @abstract Get the NCDFVariables data size in units.
 */
--(int)currentVariableSize;
+-(size_t)currentVariableSize;
 
 /*!
     @method currentVariableByteSize:
     @abstract Get the NCDFVariables data size in bytes.
 */
--(int)currentVariableByteSize;
+-(size_t)currentVariableByteSize;
 
 /*!
     @method lengthArray:
@@ -332,9 +519,9 @@
 /*!
     @method unlimitedVariableLength
     @abstract Returns the current length of an unlimited variable.
-    @discussion  This method returns the current length of the unlimited Dimension variable.  If the receiver is NOT the dimension variable, then it will return -1.
+    @discussion  This method returns the current length of the unlimited Dimension variable, which is the length of the unlimited dimension; the variable's values are not read.  If the receiver is NOT the dimension variable, or the length cannot be read, then it will return -1.
 */
--(int)unlimitedVariableLength;
+-(int64_t)unlimitedVariableLength;
 
 /*!
     @method propertyList
@@ -351,6 +538,65 @@
 */
 -(NSDictionary *)propertyList;
 
+/*!
+    @method definitionPropertyList
+    @abstract Returns the receiver's property list without its data.
+    @discussion  Contains every field of propertyList except NCDFVariablePropertyListFieldData, so the variable can be defined in another file without reading its data.  Used by the NCDFHandle rewrite methods, which copy the data separately in bounded-size pieces.
+*/
+-(NSDictionary *)definitionPropertyList;
+
+#ifdef NCDF4
+/*!
+    @method storageOptions
+    @abstract Returns how a netCDF-4 variable is stored.
+    @discussion  The dictionary uses the NCDFVariableStorage keys: NCDFVariableStorageContiguous, NCDFVariableStorageChunkSizes for chunked variables, NCDFVariableStorageDeflateLevel, NCDFVariableStorageShuffle and NCDFVariableStorageFletcher32.  Returns nil for variables in classic format files, which have no storage settings.  Returns nil and posts an NCDFError if the file could not be inquired.  definitionPropertyList includes these options under NCDFVariablePropertyListFieldStorage, so they survive file rewrites.
+*/
+-(NSDictionary *)storageOptions;
+
+/*!
+    @method setChunkCacheSize:slots:preemption:
+    @abstract Sets the chunk cache the netcdf library uses when reading the variable.
+    @param size size of the cache in bytes.
+    @param slots number of hash slots.  A prime number well above the number of chunks that fit in the cache works best.
+    @param preemption 0 to 1.  Higher values evict chunks that have been read completely sooner.
+    @discussion Every chunk of a compressed variable is decompressed as a whole, so a cache that is too small for the chunks touched by a read pattern decompresses the same chunks over and over.  The settings are kept by the variable and applied to every ncid the variable reads through, including ncids opened later by the handle's pool.  Turns off automaticChunkCache.  Classic format files have no chunk cache; for them the settings are kept, have no effect and YES is returned.
+    @result NO if the cache could not be set.  An NCDFError is posted.
+*/
+-(BOOL)setChunkCacheSize:(size_t)size slots:(size_t)slots preemption:(float)preemption;
+
+/*!
+    @method chunkCacheSize
+    @abstract Returns the chunk cache size chosen for the variable, or 0 if the library default is used.
+*/
+-(size_t)chunkCacheSize;
+
+/*!
+    @method chunkCacheSlots
+    @abstract Returns the number of chunk cache hash slots chosen for the variable.
+*/
+-(size_t)chunkCacheSlots;
+
+/*!
+    @method chunkCachePreemption
+    @abstract Returns the chunk cache preemption chosen for the variable.
+*/
+-(float)chunkCachePreemption;
+
+/*!
+    @method setAutomaticChunkCache:
+    @abstract Sizes the chunk cache from the reads made through getValueArrayAtLocation:edgeLengths:.
+    @param automatic YES to turn on automatic sizing.
+    @discussion Each read grows the cache, if needed, to hold every chunk the hyperslab touches, up to 256 MB.  Repeated reads of neighbouring hyperslabs, such as time series taken column by column, are then served from chunks that are already decompressed.  The cache never shrinks while automatic sizing is on.
+*/
+-(void)setAutomaticChunkCache:(BOOL)automatic;
+
+/*!
+    @method automaticChunkCache
+    @abstract Returns YES if the chunk cache is sized automatically.
+*/
+-(BOOL)automaticChunkCache;
+#endif
+
 /*!
     @method dimensionNames
     @abstract Returns an array of NCDFDimension names as NSStrings.
@@ -369,7 +615,7 @@
     @method reverseAndStoreDataAlongDimensionName:
     @param theDimName NSString object with an dimension name
     @abstract Reverses data along a dimension and writes to file.
-    @discussion  Flips the order of the data along a dimension.  For example, values stored at 0,1,2,3,4,5 would be reversed to 5,4,3,2,1.  Returns YES if successfully written to file.
+    @discussion  Flips the order of the data along a dimension.  For example, values stored at 0,1,2,3,4,5 would be reversed to 5,4,3,2,1.  The variable is read and reversed in chunks no larger than the handle's rewriteMemoryCeiling where its other dimensions allow, so no read or reversal touches more than that at once.  Every reversed chunk is staged in memory before the first chunk is written back, so a failed read leaves the variable unchanged; the staging takes as much memory as the variable, and NC_ENOMEM is posted if it cannot be allocated.  A failed write can still leave the variable partly rewritten.  Returns YES if successfully written to file.
 */
 -(BOOL)reverseAndStoreDataAlongDimensionName:(NSString *)theDimName;
 
@@ -377,8 +623,7 @@
     @method reverseDataAlongDimensionName:
     @param theDimName NSString object with an dimension name
     @abstract Reverses data along a dimension.
-    @discussion  Flips the order of the data along a dimension.  For example, values stored at 0,1,2,3,4,5 would be reversed to 5,4,3,2,1.
-
+    @discussion  Flips the order of the data along a dimension.  For example, values stored at 0,1,2,3,4,5 would be reversed to 5,4,3,2,1.  The variable is read once into the returned buffer and reversed in place.  Returns nil if the dimension is not used by the receiver or the read fails.
 */
 -(NSData *)reverseDataAlongDimensionName:(NSString *)theDimName;
 
@@ -387,7 +632,7 @@
     @param theDimName NSString object with an dimension name
     @param theShift A int value desribing the direction and count of the shift
     @abstract Shifts data along a dimension and stores the result.
-    @discussion  Shifts data along a dimension according the theShift value.  If theShift is positive, values stored at 0 are moved to a higher position, such as 1.  Values at the end of the dimension are rotated back to the begining.  For example, data at postion 9 with dim length of 10 (0 - 9) would be moved to position 0 if theShift value = 1.  Returns YES if writing is successful.
+    @discussion  Shifts data along a dimension according the theShift value.  If theShift is positive, values stored at 0 are moved to a higher position, such as 1.  Values at the end of the dimension are rotated back to the begining.  For example, data at postion 9 with dim length of 10 (0 - 9) would be moved to position 0 if theShift value = 1.  Like reverseAndStoreDataAlongDimensionName:, the variable is shifted chunk by chunk into a staging buffer in memory and then written back, so a failed read leaves the variable unchanged.  Returns YES if writing is successful.
 */
 -(BOOL)shiftAndStoreDataAlongDimensionName:(NSString *)theDimName shift:(int)theShift;
 
@@ -396,7 +641,7 @@
     @param theDimName NSString object with an dimension name
     @param theShift A int value desribing the direction and count of the shift
     @abstract Shifts data along a dimension
-    @discussion  Shifts data along a dimension according the theShift value.  If theShift is positive, values stored at 0 are moved to a higher position, such as 1.  Values at the end of the dimension are rotated back to the begining.  For example, data at postion 9 with dim length of 10 (0 - 9) would be moved to position 0 if theShift value = 1.
+    @discussion  Shifts data along a dimension according the theShift value.  If theShift is positive, values stored at 0 are moved to a higher position, such as 1.  Values at the end of the dimension are rotated back to the begining.  For example, data at postion 9 with dim length of 10 (0 - 9) would be moved to position 0 if theShift value = 1.  The variable is read once into the returned buffer and rotated in place.
 */
 -(NSData *)shiftDataAlongDimensionName:(NSString *)theDimName shift:(int)theShift;
 
@@ -404,7 +649,7 @@
     @method variableAttributeByName:
     @param name NSString object with an attribute name
     @abstract Access a NCDFVariable's attribute by name.
-    @discussion  Returns a NCDFAttribute object owned by the variable.
+    @discussion  Returns a NCDFAttribute object owned by the variable.  The lookup uses a name index built with the cached attributes.
 */
 -(NCDFAttribute *)variableAttributeByName:(NSString *)name;
 
@@ -429,4 +674,67 @@
 -(void)updateVariableWithVariable:(NCDFVariable *)aVar;
 -(NCDFSlab *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths;
 -(NCDFSlab *)getAllDataInSlab;
+
+/*!
+    @method enumerateChunksWithMaxBytes:alongDimensions:usingBlock:
+    @abstract Reads the whole variable one chunk at a time.
+    @param maxBytes target size in bytes of one chunk.
+    @param dimensionNames names of the dimensions the variable may be split along, or nil for any dimension.  Other dimensions are always whole within a chunk, which can make a chunk larger than maxBytes.
+    @param block called with each chunk as an NCDFSlab and its origin, an array of NSNumber start coordinates in significance order.  Setting *stop to YES ends the enumeration.
+    @discussion Chunks are planned with NCDFPlanChunk, filling the fastest varying dimensions first, and visited in row-major order, so only one chunk is in memory at a time.  Returns NO if a read failed.
+*/
+-(BOOL)enumerateChunksWithMaxBytes:(size_t)maxBytes alongDimensions:(NSArray *)dimensionNames usingBlock:(void (^)(NCDFSlab *chunk,NSArray *origin,BOOL *stop))block;
+
+/*!
+    @method enumerateChunksWithMaxBytes:alongDimensions:prefetch:usingBlock:
+    @abstract Reads the whole variable one chunk at a time, optionally reading the next chunk while the block runs.
+    @discussion See enumerateChunksWithMaxBytes:alongDimensions:usingBlock:.  With prefetch set to YES the next chunk is read on a background queue while the block works on the current one, so up to two chunks are in memory.
+*/
+-(BOOL)enumerateChunksWithMaxBytes:(size_t)maxBytes alongDimensions:(NSArray *)dimensionNames prefetch:(BOOL)prefetch usingBlock:(void (^)(NCDFSlab *chunk,NSArray *origin,BOOL *stop))block;
+
+/*!
+    @method getValueArrayAtLocation:edgeLengths:priority:completionQueue:completion:
+    @abstract Reads a subset of variable data asynchronously.
+    @param startCoordinates An integer array with an NSNumber object representing the start position along each dimension in significance order.
+    @param edgeLengths An integer array with an NSNumber object representing the number of units to be read along each dimension in significance order.
+    @param priority quality of service class of the read, QOS_CLASS_USER_INITIATED for example.
+    @param queue queue on which completion is called.  The main queue is used if nil.
+    @param completion called with the data, or nil if the read failed.
+    @discussion Returns an NCDFReadToken that can cancel the read.  Requests for the same region that are in flight at the same time share one read.  If the read fails, completion receives nil and the error is posted to the error handle on the completion queue, just before completion is called.
+*/
+-(NCDFReadToken *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths priority:(qos_class_t)priority completionQueue:(dispatch_queue_t)queue completion:(void (^)(NSData *data))completion;
+
+/*!
+    @method getSlabForStartCoordinates:edgeLengths:priority:completionQueue:completion:
+    @abstract Reads a slab of data asynchronously.
+    @discussion The asynchronous form of getSlabForStartCoordinates:edgeLengths:.  See getValueArrayAtLocation:edgeLengths:priority:completionQueue:completion:.
+*/
+-(NCDFReadToken *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths priority:(qos_class_t)priority completionQueue:(dispatch_queue_t)queue completion:(void (^)(NCDFSlab *slab))completion;
+
+/*!
+    @method setReadAheadDepth:
+    @abstract Sets how many records are read ahead when a record variable is stepped through.
+    @param depth number of records to prefetch.  0, the default, turns read-ahead off.
+    @discussion Applies to reads of a single record made through getValueArrayAtLocation:edgeLengths:.  Once consecutive reads cover the same region of a record and move along the unlimited dimension by a steady step, the next depth records along that step are read on a background queue and later reads of them are served from memory.  Writes to the file discard the buffered records.  Has no effect on variables that do not use the unlimited dimension.
+*/
+-(void)setReadAheadDepth:(int)depth;
+
+/*!
+    @method readAheadDepth
+    @abstract Returns the number of records read ahead, 0 if read-ahead is off.
+*/
+-(int)readAheadDepth;
+
+/*!
+    @method setReadAheadBufferLimit:
+    @abstract Sets the most bytes of prefetched records the variable keeps.  The default is NCDFReadAheadDefaultBufferLimit, 64 MB.
+*/
+-(void)setReadAheadBufferLimit:(size_t)bytes;
+
+/*!
+    @method readAheadStatistics
+    @abstract Returns the read-ahead depth, hits, misses and hit rate, keyed by the NCDFReadAheadStatistic keys.
+    @discussion Returns nil while read-ahead is off.  Turning read-ahead off and on again starts the counts over.
+*/
+-(NSDictionary *)readAheadStatistics;
 @end
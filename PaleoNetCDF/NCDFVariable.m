@@ -9,14 +9,154 @@
 #import "NCDFVariable.h"
 #import "NCDFHandle.h"
 #import "NCDFErrorHandle.h"
+#import "NCDFError.h"
 #import "NCDFDimension.h"
 #import "NCDFSlab.h"
+#import "NCDFHyperslab.h"
+#import "NCDFMappedFile.h"
+#import "NCDFFileLock.h"
+#import "NCDFReadToken.h"
+#import "NCDFReadAhead.h"
+#import "NCDFBlockCache.h"
 
 #ifndef NOEXCEPTIONHANDLE
 #ifndef GUI_EXCEPTION
 #define NOGUI_EXCEPTION
 #endif
 #endif
+
+#ifdef NCDF4
+#define NCDFVariableMaxAutomaticChunkCache (256*1024*1024)
+#define NCDFVariableDefaultChunkCachePreemption 0.75f
+#endif
+
+@interface NCDFVariable (PrivateMethods)
+/*!
+ @method mappedDataWithStart:edges:hostByteOrder:
+ @abstract Reads a region of the variable from the handle's mapped file.
+ @param start corner of the region, or NULL for the whole variable.
+ @param edges lengths of the region, or NULL for the whole variable.
+ @param hostOrder YES to convert multi-byte types to the host's byte order.  The data is a copy either way.
+ @result The data, or nil if the region cannot be read from the mapping.
+ */
+-(NSData *)mappedDataWithStart:(const size_t *)start edges:(const size_t *)edges hostByteOrder:(BOOL)hostOrder;
+/*!
+ @method copyMappedDataWithStart:edges:toBuffer:
+ @abstract Copies a region of the variable from the handle's mapped file into buffer in the host's byte order.
+ @discussion The copy is made while the file is locked for reading, so no write can change the mapped pages before they are read.
+ @result NO if the region cannot be read from the mapping.
+ */
+-(BOOL)copyMappedDataWithStart:(const size_t *)start edges:(const size_t *)edges toBuffer:(void *)buffer;
+/*!
+ @method prefetchValueArrayWithStart:edges:
+ @abstract Reads a region for the read-ahead buffer.
+ @discussion Errors are not posted: a prefetch past the last record is expected to fail.
+ */
+-(NSData *)prefetchValueArrayWithStart:(const size_t *)start edges:(const size_t *)edges;
+/*!
+ @method valueArrayWithStart:edges:status:subMethod:
+ @abstract Reads a region from the read-ahead buffer, the mapping, the block cache or the file, in that order.
+ @discussion Errors are returned in status, with a description in subMethod if it is not NULL, and not posted.
+ */
+-(NSData *)valueArrayWithStart:(const size_t *)start edges:(const size_t *)edges status:(int32_t *)status subMethod:(NSString * __autoreleasing *)subMethod;
+/*!
+ @method getValuesWithNCID:start:edges:buffer:
+ @abstract Reads a region through a checked out ncid into buffer, which must hold the whole region.
+ @result The netcdf status of the read.
+ */
+-(int)getValuesWithNCID:(int)ncid start:(const size_t *)start edges:(const size_t *)edges buffer:(void *)buffer;
+/*!
+ @method getValuesWithNCID:start:edges:stride:imap:buffer:
+ @abstract Reads a strided region through a checked out ncid into buffer laid out with imap.
+ @discussion stride and imap may be NULL for contiguous values and row-major order.
+ @result The netcdf status of the read.
+ */
+-(int)getValuesWithNCID:(int)ncid start:(const size_t *)start edges:(const size_t *)edges stride:(const ptrdiff_t *)stride imap:(const ptrdiff_t *)imap buffer:(void *)buffer;
+/*!
+ @method getValuesWithNCID:start:edges:stride:imap:type:buffer:
+ @abstract Reads a strided region through a checked out ncid into buffer, converted by the library to type.
+ @result The netcdf status of the read.
+ */
+-(int)getValuesWithNCID:(int)ncid start:(const size_t *)start edges:(const size_t *)edges stride:(const ptrdiff_t *)stride imap:(const ptrdiff_t *)imap type:(nc_type)type buffer:(void *)buffer;
+/*!
+ @method putValuesWithNCID:start:edges:buffer:
+ @abstract Writes a region through a checked out ncid from buffer, which must hold the whole region.
+ @result The netcdf status of the write.
+ */
+-(int)putValuesWithNCID:(int)ncid start:(const size_t *)start edges:(const size_t *)edges buffer:(const void *)buffer;
+/*!
+ @method blockCachedValueArrayWithStart:edges:
+ @abstract Reads a region through the shared NCDFBlockCache.
+ @result The data, or nil if the cache is off, does not apply to the handle or the region, or a block could not be read.
+ */
+-(NSData *)blockCachedValueArrayWithStart:(const size_t *)start edges:(const size_t *)edges;
+/*!
+ @method rebuildReadAheadWithDepth:bufferLimit:
+ @abstract Replaces the read-ahead buffer with one that matches the receiver's current dimensions.
+ @discussion The buffer is dropped if the depth is 0 or the first dimension is not the unlimited dimension.
+ */
+-(void)rebuildReadAheadWithDepth:(int)depth bufferLimit:(size_t)bytes;
+#ifdef NCDF4
+/*!
+ @method applyChunkCacheToNCID:
+ @abstract Sets the receiver's chunk cache on ncid if one has been chosen and ncid does not already use it.
+ @result The netcdf status.  Nothing is posted to the error handle, so this can run on any thread.  Classic format files have no chunk cache, so NC_NOERR is returned for them.
+ @discussion The cache settings belong to an open ncid, and changing them discards the chunks already cached, so the current settings are checked first.
+ */
+-(int)applyChunkCacheToNCID:(int)ncid;
+/*!
+ @method sizeChunkCacheForStart:edges:ncid:
+ @abstract Grows the automatic chunk cache to hold every chunk touched by a hyperslab read.
+ */
+-(void)sizeChunkCacheForStart:(const size_t *)start edges:(const size_t *)edges ncid:(int)ncid;
+#endif
+/*!
+ @method currentShape:
+ @abstract Reads the current length of each of the receiver's dimensions from the file, including the record count.
+ @param shape returns one length per dimension.
+ @result The netcdf status.
+ */
+-(int)currentShape:(size_t *)shape;
+/*!
+ @method reorderBuffer:counts:alongDimension:shift:reverse:
+ @abstract Reverses or rotates a region of the receiver's values, in host byte order, along one dimension in place.
+ @param count lengths of the region, which must be whole along the dimension.
+ @result NO if the rotation could not allocate its scratch buffer.
+ */
+-(BOOL)reorderBuffer:(void *)buffer counts:(const size_t *)count alongDimension:(int)dimension shift:(ptrdiff_t)shift reverse:(BOOL)reverse;
+/*!
+ @method reorderedDataAlongDimensionName:shift:reverse:
+ @abstract Reads the whole variable into one buffer and reverses or rotates it in place.
+ */
+-(NSData *)reorderedDataAlongDimensionName:(NSString *)theDimName shift:(ptrdiff_t)shift reverse:(BOOL)reverse;
+/*!
+ @method reorderAndStoreDataAlongDimensionName:shift:reverse:
+ @abstract Reverses or rotates the variable in the file one chunk at a time.
+ @discussion Chunks hold the whole length of the reordered dimension and are no larger than the handle's rewriteMemoryCeiling where the other dimensions allow, so each one is reordered on its own and written back to the place it was read from.  The reordered chunks are staged in memory until all of them have been read.
+ */
+-(BOOL)reorderAndStoreDataAlongDimensionName:(NSString *)theDimName shift:(ptrdiff_t)shift reverse:(BOOL)reverse;
+/*!
+ @method numericValuesOfAttributeNamed:values:maxCount:
+ @abstract Reads up to maxCount values of a numeric attribute as doubles.
+ @discussion NC_BYTE attributes load as a single NSData of signed bytes rather than NSNumbers, so each byte becomes one value.
+ @result The number of values read, 0 if the attribute does not exist.
+ */
+-(int)numericValuesOfAttributeNamed:(NSString *)theName values:(double *)values maxCount:(int)maxCount;
+/*!
+ @method asyncReadResultAtLocation:edgeLengths:slab:
+ @abstract Makes the read of an asynchronous request.
+ @param slab YES to return an NCDFSlab rather than NSData.
+ @result The data or slab, or an NCDFError describing the failure.  Nothing is posted to the error handle, so this can run on any thread; the error is posted when the result reaches the caller's queue.
+ */
+-(id)asyncReadResultAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths slab:(BOOL)slab;
+/*!
+ @method postAsyncReadResult:
+ @abstract Posts the error carried by an asynchronous read result, on the caller's queue.
+ @result The result, or nil if it was an error.
+ */
+-(id)postAsyncReadResult:(id)result;
+@end
+
 @implementation NCDFVariable
 
 -(id)initWithPath:(NSString *)thePath variableName:(NSString *)theName variableID:(int)theID type:(nc_type)theType theDims:(NSArray *)theDims attributeCount:(int)nAtt handle:(NCDFHandle *)handle
@@ -55,9 +195,16 @@
     size_t total_values;
     int32_t ncid,result;
     NSMutableData *theData;
+    NSData *mappedData;
     theData = nil;
     if(theErrorHandle == nil)
         theErrorHandle = [theHandle theErrorHandle];
+    if([theHandle usesMappedReads])
+    {
+        mappedData = [self mappedDataWithStart:NULL edges:NULL hostByteOrder:YES];
+        if(mappedData)
+            return mappedData;
+    }
     theDims = [theHandle getDimensions];
     total_values = 1;
     for(i=0;i<[dimIDs count];i++)
@@ -70,6 +217,11 @@
        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"readAllVariableData" subMethod:@"Open netCDF failed" errorCode:result];
        return nil;
     }
+#ifdef NCDF4
+    result = [self applyChunkCacheToNCID:ncid];
+    if(result!=NC_NOERR)
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"readAllVariableData" subMethod:@"Set chunk cache" errorCode:result];
+#endif
     switch(dataType)
     {
         case NC_BYTE:
@@ -80,6 +232,7 @@
             if(result!=NC_NOERR)
             {
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"readAllVariableData" subMethod:@"Read NC_Byte" errorCode:result];
+                [theHandle closeNCID:ncid];
                 return nil;
             }
             theData = [NSMutableData dataWithBytes:theText length:total_values];
@@ -94,6 +247,7 @@
             if(result!=NC_NOERR)
             {
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"readAllVariableData" subMethod:@"Read NC_Char" errorCode:result];
+                [theHandle closeNCID:ncid];
                 return nil;
             }
             theData = [NSMutableData dataWithBytes:theText length:total_values+1];
@@ -108,6 +262,7 @@
             if(result!=NC_NOERR)
             {
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"readAllVariableData" subMethod:@"Read NC_Short" errorCode:result];
+                [theHandle closeNCID:ncid];
                 return nil;
             }
             theData = [NSMutableData dataWithBytes:array length:(sizeof(int16_t)*total_values)];
@@ -122,6 +277,7 @@
             if(result!=NC_NOERR)
             {
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"readAllVariableData" subMethod:@"Read NC_Int" errorCode:result];
+                [theHandle closeNCID:ncid];
                 return nil;
             }
             theData = [NSMutableData dataWithBytes:array length:(sizeof(int)*total_values)];
@@ -137,6 +293,7 @@
             if(result!=NC_NOERR)
             {
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"readAllVariableData" subMethod:@"Read NC_Float" errorCode:result];
+                [theHandle closeNCID:ncid];
                 return nil;
             }
             //theData = [[NSData dataWithBytes:array length:(sizeof(float)*total_values)] retain];
@@ -151,6 +308,7 @@
             if(result!=NC_NOERR)
             {
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"readAllVariableData" subMethod:@"Read NC_Double" errorCode:result];
+                [theHandle closeNCID:ncid];
                 return nil;
             }
 
@@ -161,6 +319,7 @@
         case NC_NAT:
         {
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"readAllVariableData" subMethod:@"NC_Nat not handled" errorCode:result];
+                [theHandle closeNCID:ncid];
                 return nil;
             }
     }
@@ -260,6 +419,7 @@
             {
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeAllVariableData" subMethod:@"Write NC_Byte" errorCode:result];
                 free(theText);
+                [theHandle closeNCID:ncid];
                 return;
             }
             else
@@ -281,6 +441,7 @@
             {
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeAllVariableData" subMethod:@"Write NC_Char" errorCode:result];
                 free(theText);
+                [theHandle closeNCID:ncid];
                 return ;
             }
             free(theText);
@@ -299,6 +460,7 @@
             {
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeAllVariableData" subMethod:@"Write NC_Short" errorCode:result];
                 free(array);
+                [theHandle closeNCID:ncid];
                 return ;
             }
             free(array);
@@ -317,6 +479,7 @@
             {
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeAllVariableData" subMethod:@"Write NC_INT" errorCode:result];
                 free(array);
+                [theHandle closeNCID:ncid];
                 return ;
             }
 
@@ -335,6 +498,7 @@
             {
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeAllVariableData" subMethod:@"Write NC_FLOAT" errorCode:result];
                 free(array);
+                [theHandle closeNCID:ncid];
                 return ;
             }
             //NSLog(@"free field");
@@ -354,6 +518,7 @@
             {
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeAllVariableData" subMethod:@"Write NC_Double" errorCode:result];
                 free(array);
+                [theHandle closeNCID:ncid];
                 return ;
             }
             free(array);
@@ -363,6 +528,7 @@
         {
             {
                 [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeAllVariableData" subMethod:@"Write NC_NAT" errorCode:result];
+                [theHandle closeNCID:ncid];
                 return ;
             }
         }
@@ -379,18 +545,12 @@
     BOOL dataWritten;
     if(theErrorHandle == nil)
         theErrorHandle = [theHandle theErrorHandle];
-    ncid = [theHandle ncidWithOpenMode:NC_WRITE status:&status];
-    if(status!=NC_NOERR)
-    {
-        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"createNewVariableAttributeWithName" subMethod:@"Open file" errorCode:status];
-        return NO;
-    }
-    status = nc_redef(ncid);
-
+    if([theHandle isInEditSession])
+        return [theHandle recordVariableAttributeEdit:[NSDictionary dictionaryWithObjectsAndKeys:attName,@"attributeName",[NSNumber numberWithInt:(int)theType],@"nc_type",(theValues?theValues:[NSArray array]),@"values",nil] forVariableName:[self variableName]];
+    ncid = [theHandle ncidForDefineWithStatus:&status];
     if(status!=NC_NOERR)
     {
-        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"createNewVariableAttributeWithName" subMethod:@"Open file" errorCode:status];
-        [theHandle closeNCID:ncid];
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"createNewVariableAttributeWithName" subMethod:@"Open file in define mode" errorCode:status];
         return NO;
     }
     dataWritten = NO;
@@ -501,8 +661,7 @@
     if(!dataWritten)
         return NO;
 
-    [theHandle refresh];
-    numberOfAttributes++;
+    [theHandle refreshVariable:self];
     return YES;
 }
 
@@ -510,7 +669,6 @@
 {
     if([self createNewVariableAttributeWithName:propertyList[@"attributeName"] dataType:[[propertyList objectForKey:@"nc_type"] intValue] values:propertyList[@"values"]])
     {
-		[theHandle refresh];
 		return YES;
 	}
     else
@@ -520,14 +678,21 @@
 
 -(NSArray *)getVariableAttributes
 {
-    /*Returns an array containing all the attributes for the variable.  This method should not be called on from any variable that is not attached to a NCDFHandle.*/
+    /*Returns an array containing all the attributes for the variable.  This method should not be called on from any variable that is not attached to a NCDFHandle.  The attributes are read once and kept until the handle refreshes the variable.*/
     /*Accessor: Attributes*/
     int32_t i;
     int32_t ncid;
     int32_t status;
     NSMutableArray *theAttArray;
+    NSMutableDictionary *theAttIndex;
     NSArray *theFinal;
+    BOOL complete;
 
+    @synchronized(self)
+    {
+        if(attributes)
+            return attributes;
+    }
     if(theErrorHandle == nil)
         theErrorHandle = [theHandle theErrorHandle];
     ncid = [theHandle ncidWithOpenMode:NC_NOWRITE status:&status];
@@ -537,9 +702,11 @@
         return nil;
     }
     theAttArray = [[NSMutableArray alloc] init];
+    theAttIndex = [[NSMutableDictionary alloc] init];
+    complete = YES;
     for(i=0;i<numberOfAttributes;i++)
     {
-        char name[NC_MAX_NAME];
+        char name[NC_MAX_NAME+1];
         nc_type attributeType;
         size_t length;
         NCDFAttribute *theAtt;
@@ -548,20 +715,33 @@
         if(status!=NC_NOERR)
         {
             [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"getVariableAttributes" subMethod:@"nc_inq_attname" errorCode:status];
+            complete = NO;
+            continue;
         }
 
         status = nc_inq_att ( ncid, varID, name, &attributeType, &length);
         if(status!=NC_NOERR)
         {
             [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"getVariableAttributes" subMethod:@"nc_inq_att" errorCode:status];
+            complete = NO;
+            continue;
         }
 
         theAtt = [[NCDFAttribute alloc] initWithPath:fileName name:[NSString stringWithCString:name encoding:NSUTF8StringEncoding] variableID:varID length:length type:attributeType handle:theHandle];
         [theAttArray addObject:theAtt];
+        theAttIndex[[theAtt attributeName]] = theAtt;
     }
     theFinal = [NSArray arrayWithArray:theAttArray];
     theAttArray = nil;
     [theHandle closeNCID:ncid];
+    if(complete)
+    {
+        @synchronized(self)
+        {
+            attributes = theFinal;
+            _attributesByName = [NSDictionary dictionaryWithDictionary:theAttIndex];
+        }
+    }
     return theFinal;
 }
 
@@ -574,17 +754,12 @@
 
     if(theErrorHandle == nil)
         theErrorHandle = [theHandle theErrorHandle];
-    ncid = [theHandle ncidWithOpenMode:NC_WRITE status:&status];
-    if(status!=NC_NOERR)
-    {
-        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"deleteVariableAttributeByName" subMethod:@"Open file" errorCode:status];
-        return NO;
-    }
-    status = nc_redef(ncid);
+    if([theHandle isInEditSession])
+        return [theHandle recordVariableAttributeEdit:[NSDictionary dictionaryWithObject:name forKey:@"attributeName"] forVariableName:[self variableName]];
+    ncid = [theHandle ncidForDefineWithStatus:&status];
     if(status!=NC_NOERR)
     {
-        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"deleteVariableAttributeByName" subMethod:@"nc_redef" errorCode:status];
-        [theHandle closeNCID:ncid];
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"deleteVariableAttributeByName" subMethod:@"Open file in define mode" errorCode:status];
         return NO;
     }
     status = nc_del_att(ncid,varID,[name cStringUsingEncoding:NSUTF8StringEncoding]);
@@ -595,8 +770,7 @@
         return NO;
     }
     [theHandle closeNCID:ncid];
-	[theHandle refresh];
-    numberOfAttributes--;
+	[theHandle refreshVariable:self];
     return YES;
 }
 
@@ -645,17 +819,10 @@
     if(theErrorHandle == nil)
         theErrorHandle = [theHandle theErrorHandle];
     newName = [self parseNameString:newName];
-    ncid = [theHandle ncidWithOpenMode:NC_WRITE status:&status];
-    if(status!=NC_NOERR)
-    {
-        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"renameVariable" subMethod:@"Open file" errorCode:status];
-        return NO;
-    }
-    status = nc_redef(ncid);
+    ncid = [theHandle ncidForDefineWithStatus:&status];
     if(status!=NC_NOERR)
     {
-        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"renameVariable" subMethod:@"nc_redef" errorCode:status];
-        [theHandle closeNCID:ncid];
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"renameVariable" subMethod:@"Open file in define mode" errorCode:status];
         return NO;
     }
     status = nc_rename_var(ncid,varID,[newName cStringUsingEncoding:NSUTF8StringEncoding]);
@@ -666,7 +833,7 @@
         return NO;
     }
     [theHandle closeNCID:ncid];
-	[theHandle refresh];
+	[theHandle refreshVariable:self];
     return YES;
 
 }
@@ -696,7 +863,7 @@
 
 -(BOOL)writeSingleValue:(NSArray *)coordinates withValue:(id)value
 {
-    /*Writes a single value in the reciever's data field.  The coordinates should be an array of NSNumbers (ints) that location the position for each dimension.  This should be in the same order as the dimension ID list.*/
+    /*Writes a single value in the reciever's data field.  The coordinates should be an array of NSNumbers (unsigned long longs) that location the position for each dimension.  This should be in the same order as the dimension ID list.*/
     int32_t ncid,status, i;
     size_t *index;
 
@@ -709,7 +876,7 @@
     index = (size_t *)malloc(sizeof(size_t)*[coordinates count]);
     for(i=0;i<[coordinates count];i++)
     {
-        index[i] = [coordinates[i] intValue];
+        index[i] = [coordinates[i] unsignedLongLongValue];
     }
     ncid = [theHandle ncidWithOpenMode:NC_WRITE status:&status];
     if(status!=NC_NOERR)
@@ -841,8 +1008,8 @@
     edges = (size_t *)malloc(sizeof(size_t)*[edgeLengths count]);
     for(i=0;i<[startCoordinates count];i++)
     {
-        index[i] = (size_t)[startCoordinates[i] intValue];
-        edges[i] = (size_t)[edgeLengths[i] intValue];
+        index[i] = (size_t)[startCoordinates[i] unsignedLongLongValue];
+        edges[i] = (size_t)[edgeLengths[i] unsignedLongLongValue];
 
     }
     ncid = [theHandle ncidWithOpenMode:NC_WRITE status:&status];
@@ -854,116 +1021,24 @@
         free(edges);
         return NO;
     }
-    //NSLog(@"Data length: %i",[dataObject length]);
-    switch(dataType)
+    //the library reads straight from the data object.
+    status = [self putValuesWithNCID:ncid start:index edges:edges buffer:[dataObject bytes]];
+    if(status!=NC_NOERR)
     {
-        case NC_BYTE:
-        {
-            uint8 *theText;
-            theText = (uint8 *)malloc(sizeof(uint8) * [dataObject length]);
-            [dataObject getBytes:theText length: [dataObject length]];
-            status = nc_put_vara_uchar(ncid,varID,index,edges,theText);
-            if(status!=NC_NOERR)
-            {
-                isError = YES;
-                [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeValueArrayAtLocation" subMethod:@"Write NC_BYTE" errorCode:status];
-            }
-            free(theText);
-            break;
-        }
-        case NC_CHAR:
-        {
-            char *theText;
-            theText = (char *)malloc(sizeof(char)* [dataObject length]+1);
-            [dataObject getBytes:theText length: [dataObject length]+1];
-            status = nc_put_vara_text(ncid,varID,index,edges,theText);
-            if(status!=NC_NOERR)
-            {
-                isError = YES;
-                [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeValueArrayAtLocation" subMethod:@"Write NC_CHAR" errorCode:status];
-            }
-
-            free(theText);
-            break;
-        }
-        case NC_SHORT:
-        {
-            int16_t *theNumber;
-            theNumber = (int16_t *)malloc([dataObject length]);
-            [dataObject getBytes:theNumber length: [dataObject length]];
-            status = nc_put_vara_short(ncid,varID,index,edges,theNumber);
-            if(status!=NC_NOERR)
-            {
-                isError = YES;
-                [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeValueArrayAtLocation" subMethod:@"Write NC_SHORT" errorCode:status];
-            }
-            free(theNumber);
-            break;
-        }
-        case NC_INT:
-        {
-            int32_t *theNumber;
-            theNumber = (int32_t *)malloc([dataObject length]);
-            [dataObject getBytes:theNumber length: [dataObject length]];
-            status = nc_put_vara_int(ncid,varID,index,edges,theNumber);
-            if(status!=NC_NOERR)
-            {
-                isError = YES;
-                [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeValueArrayAtLocation" subMethod:@"Write NC_INT" errorCode:status];
-            }
-            free(theNumber);
-            break;
-        }
-        case NC_FLOAT:
-        {
-            float *theNumber;
-
-            theNumber = (float *)malloc([dataObject length]);
-
-            [dataObject getBytes:theNumber length: [dataObject length]];
-
-            status = nc_put_vara_float(ncid,varID,index,edges,theNumber);
-            if(status!=NC_NOERR)
-            {
-                isError = YES;
-                [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeValueArrayAtLocation" subMethod:@"Write NC_FLOAT" errorCode:status];
-            }
-
-            free(theNumber);
-
-            break;
-        }
-        case NC_DOUBLE:
-        {
-            double *theNumber;
-            theNumber = (double *)malloc([dataObject length]);
-            [dataObject getBytes:theNumber length: [dataObject length]];
-            status = nc_put_vara_double(ncid,varID,index,edges,theNumber);
-            if(status!=NC_NOERR)
-            {
-                isError = YES;
-                [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeValueArrayAtLocation" subMethod:@"Write NC_DOUBLE" errorCode:status];
-            }
-            free(theNumber);
-            break;
-        }
-        case NC_NAT:
-        {
-            isError = YES;
-            [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeValueArrayAtLocation" subMethod:@"Write NC_NAT" errorCode:status];
-        }
+        isError = YES;
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeValueArrayAtLocation" subMethod:[NSString stringWithFormat:@"Write %@",[self variableType]] errorCode:status];
     }
     free(index);
     free(edges);
+    [theHandle closeNCID:ncid];
     if(isError)
         return NO;
-    [theHandle closeNCID:ncid];
     return YES;
 }
 
 -(id)getSingleValue:(NSArray *)coordinates
 {
-    /*Reads a single value at the stated coordinates.  The coordinates are an array of NSNumber objects (ints) for each dimension.*/
+    /*Reads a single value at the stated coordinates.  The coordinates are an array of NSNumber objects (unsigned long longs) for each dimension.*/
     /*Accessor: Read Values*/
     int32_t ncid,status, i,errorCount;
     id theObject;
@@ -979,7 +1054,7 @@
     index = (size_t *)malloc(sizeof(size_t)*[coordinates count]);
     for(i=0;i<[coordinates count];i++)
     {
-        index[i] = [coordinates[i] intValue];
+        index[i] = [coordinates[i] unsignedLongLongValue];
     }
     ncid = [theHandle ncidWithOpenMode:NC_NOWRITE status:&status];
     if(status!=NC_NOERR)
@@ -988,6 +1063,11 @@
         [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"getSingleValue" subMethod:@"Open File" errorCode:status];
         return nil;
     }
+#ifdef NCDF4
+    status = [self applyChunkCacheToNCID:ncid];
+    if(status!=NC_NOERR)
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"getSingleValue" subMethod:@"Set chunk cache" errorCode:status];
+#endif
     switch(dataType)
     {
         case NC_BYTE:
@@ -1065,278 +1145,783 @@
 
 -(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths
 {
-    /*Reads an array ofs values at the stated coordinates.  The coordinates are an array of NSNumber objects (ints) for each dimension.  Edge lengths are the lengths for each dimension.*/
+    /*Reads an array ofs values at the stated coordinates.  The coordinates are an array of NSNumber objects (unsigned long longs) for each dimension.  Edge lengths are the lengths for each dimension.*/
     /*Accessor: Read Values*/
-    int32_t ncid,status, i,errorCount;
-    size_t *index,*edges,unitSize;
+    int32_t status, i;
+    size_t *index,*edges;
     NSData *theData;
-    unitSize = 1;
+    NSString *subMethod;
     if(theErrorHandle == nil)
         theErrorHandle = [theHandle theErrorHandle];
-    errorCount = [theErrorHandle errorCount];
     if(([dimIDs count]!=[startCoordinates count])||([dimIDs count]!=[edgeLengths count]))
     {
         return nil;
     }
-    index = (size_t *)malloc(sizeof(size_t)*[startCoordinates count]);
-    edges = (size_t *)malloc(sizeof(size_t)*[edgeLengths count]);
+    index = (size_t *)malloc(sizeof(size_t)*([startCoordinates count]+1));
+    edges = (size_t *)malloc(sizeof(size_t)*([edgeLengths count]+1));
     for(i=0;i<[startCoordinates count];i++)
     {
-        index[i] = (size_t)[startCoordinates[i] intValue];
-        edges[i] = (size_t)[edgeLengths[i] intValue];
-        if(i==0)
-            unitSize = (size_t)([edgeLengths[i] intValue]);
-        else
-            unitSize *= (size_t)[edgeLengths[i] intValue];
+        index[i] = (size_t)[startCoordinates[i] unsignedLongLongValue];
+        edges[i] = (size_t)[edgeLengths[i] unsignedLongLongValue];
     }
-    ncid = [theHandle ncidWithOpenMode:NC_NOWRITE status:&status];;
+    theData = [self valueArrayWithStart:index edges:edges status:&status subMethod:&subMethod];
+    free(index);
+    free(edges);
     if(status!=NC_NOERR)
     {
-        free(index);
-        free(edges);
-        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"getValueArrayAtLocation" subMethod:@"Open File" errorCode:status];
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"getValueArrayAtLocation" subMethod:subMethod errorCode:status];
         return nil;
     }
-    switch(dataType)
-    {
-        case NC_BYTE:
-        {
-            uint8 *theText;
-            theText = (uint8 *)malloc(sizeof(uint8) *unitSize);
-
-            status = nc_get_vara_uchar(ncid,varID,index,edges,theText);
-            theData = [NSData dataWithBytes:theText length:(sizeof(uint8) *unitSize)];
-            if(status!=NC_NOERR)
-                [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"getValueArrayAtLocation" subMethod:@"Read NC_BYTE" errorCode:status];
-            free(theText);
-            break;
-        }
-        case NC_CHAR:
-        {
-            char *theText;
-            theText = (char *)malloc(sizeof(char) *unitSize+1);
-
-            status = nc_get_vara_text(ncid,varID,index,edges,theText);
-            theData = [NSData dataWithBytes:theText length:(sizeof(char) *unitSize)];
-            if(status!=NC_NOERR)
-                [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"getValueArrayAtLocation" subMethod:@"Read NC_CHAR" errorCode:status];
-
-            free(theText);
-            break;
-        }
-        case NC_SHORT:
-        {
-            int16_t *theNumber;
-            theNumber = (int16_t *)malloc(sizeof(int16_t)*unitSize);
-            status = nc_get_vara_short(ncid,varID,index,edges,theNumber);
-            theData = [NSData dataWithBytes:theNumber length:(sizeof(int16_t) *unitSize)];
-            if(status!=NC_NOERR)
-                [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"getValueArrayAtLocation" subMethod:@"Read NC_SHORT" errorCode:status];
-            free(theNumber);
-            break;
-        }
-        case NC_INT:
-        {
-            int32_t *theNumber;
-            theNumber = (int32_t *)malloc(sizeof(int)*unitSize);
-            status = nc_get_vara_int(ncid,varID,index,edges,theNumber);
-            theData = [NSData dataWithBytes:theNumber length:(sizeof(int) *unitSize)];
-
-            if(status!=NC_NOERR)
-                [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"getValueArrayAtLocation" subMethod:@"Read NC_INT" errorCode:status];
-            free(theNumber);
-            break;
-        }
-        case NC_FLOAT:
-        {
-            float *theNumber;
-            theNumber = (float *)malloc(sizeof(float)*unitSize);
-            status = nc_get_vara_float(ncid,varID,index,edges,theNumber);
-            theData = [NSData dataWithBytes:theNumber length:(sizeof(float) *unitSize)];
-
-            if(status!=NC_NOERR)
-                [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"getValueArrayAtLocation" subMethod:@"Read NC_FLOAT" errorCode:status];
-            free(theNumber);
-            break;
-        }
-        case NC_DOUBLE:
-        {
-            double *theNumber;
-            theNumber = (double *)malloc(sizeof(double)*unitSize);
-            status = nc_get_vara_double(ncid,varID,index,edges,theNumber);
-            theData = [NSData dataWithBytes:theNumber length:(sizeof(double) *unitSize)];
+    return theData;
+}
 
-            if(status!=NC_NOERR)
-                [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"getValueArrayAtLocation" subMethod:@"Read NC_DOUBLE" errorCode:status];
-            free(theNumber);
-            break;
-        }
-        case NC_NAT:
-        {
-            [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"getValueArrayAtLocation" subMethod:@"Read NC_NAT" errorCode:status];
-            theData = nil;
-        }
-        default:
-            theData = nil;
-            break;
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths status:(int32_t *)status
+{
+    int32_t i;
+    size_t *index,*edges;
+    NSData *theData;
+    if(([dimIDs count]!=[startCoordinates count])||([dimIDs count]!=[edgeLengths count]))
+    {
+        *status = NC_EINVALCOORDS;
+        return nil;
     }
-    [theHandle closeNCID:ncid];
+    index = (size_t *)malloc(sizeof(size_t)*([startCoordinates count]+1));
+    edges = (size_t *)malloc(sizeof(size_t)*([edgeLengths count]+1));
+    for(i=0;i<[startCoordinates count];i++)
+    {
+        index[i] = (size_t)[startCoordinates[i] unsignedLongLongValue];
+        edges[i] = (size_t)[edgeLengths[i] unsignedLongLongValue];
+    }
+    theData = [self valueArrayWithStart:index edges:edges status:status subMethod:NULL];
     free(index);
     free(edges);
-    if(errorCount == [theErrorHandle errorCount])
-        return theData;
-    else
-        return nil;
+    return theData;
 }
 
--(BOOL)isDimensionVariable
+-(NSData *)valueArrayWithStart:(const size_t *)start edges:(const size_t *)edges status:(int32_t *)status subMethod:(NSString * __autoreleasing *)subMethod
 {
-    /*This method is to test weather the reciever is a variable that represents dimension values.*/
-    NSArray *theArray;
-    if([dimIDs count]!=1)
-        return NO;
-    theArray = [theHandle getDimensions];
-    if([[[theArray objectAtIndex:[dimIDs[0] intValue]]  dimensionName] isEqualToString:variableName])
-        return YES;
-    return NO;
+    int32_t ncid;
+    NSData *theData;
+    NCDFReadAhead *readAhead;
+    *status = NC_NOERR;
+    @synchronized(self)
+    {
+        readAhead = _readAhead;
+    }
+    if(readAhead)
+    {
+        theData = [readAhead dataForStart:start edges:edges];
+        if(theData)
+            return theData;
+    }
+    if([theHandle usesMappedReads])
+    {
+        theData = [self mappedDataWithStart:start edges:edges hostByteOrder:YES];
+        if(theData)
+            return theData;
+    }
+    theData = [self blockCachedValueArrayWithStart:start edges:edges];
+    if(theData)
+        return theData;
+    ncid = [theHandle ncidWithOpenMode:NC_NOWRITE status:status];
+    if(*status!=NC_NOERR)
+    {
+        if(subMethod)
+            *subMethod = @"Open File";
+        return nil;
+    }
+    theData = [self valueArrayWithNCID:ncid start:start edges:edges status:status];
+    [theHandle closeNCID:ncid];
+    if(*status!=NC_NOERR)
+    {
+        if(subMethod)
+            *subMethod = [NSString stringWithFormat:@"Read %@",[self variableType]];
+        return nil;
+    }
+    return theData;
 }
 
--(int)sizeUnitVariable
+-(NSData *)valueArrayWithNCID:(int)ncid start:(const size_t *)start edges:(const size_t *)edges status:(int32_t *)status
 {
-    NSMutableArray *theDims = [theHandle getDimensions];
     int32_t i;
-    int32_t theSize,aLength;
-
-    theSize = 1;
+    size_t unitSize;
+    NSMutableData *theData;
+    unitSize = 1;
     for(i=0;i<[dimIDs count];i++)
-    {
-        aLength = (int32_t)[[theDims objectAtIndex:[dimIDs[i] intValue]] dimLength];
-        if(![[theDims objectAtIndex:[dimIDs[i] intValue]] isUnlimited])
-            theSize *= aLength;
-    }
-    return theSize;
+        unitSize *= edges[i];
+    //the library converts straight into the returned object.
+    theData = [NSMutableData dataWithLength:NCDFSizeOfType(dataType)*unitSize];
+    *status = [self getValuesWithNCID:ncid start:start edges:edges buffer:[theData mutableBytes]];
+    if(*status!=NC_NOERR)
+        return nil;
+    return theData;
 }
 
--(int)sizeUnitVariableForType
+-(int)getValuesWithNCID:(int)ncid start:(const size_t *)start edges:(const size_t *)edges buffer:(void *)buffer
 {
-   int32_t size;
-
-   size = [self sizeUnitVariable];
-   switch(dataType)
-   {
-        case NC_BYTE:
-            break;
-        case NC_CHAR:
-            break;
-        case NC_SHORT:
-            size = size *2 ;
-            break;
-        case NC_INT:
-            size = size *4 ;
-            break;
-        case NC_FLOAT:
-            size = size *4 ;
-            break;
-        case NC_DOUBLE:
-            size = size *8 ;
-            break;
-        default:
-            break;
-   }
-   return size;
+    return [self getValuesWithNCID:ncid start:start edges:edges stride:NULL imap:NULL buffer:buffer];
 }
 
--(int)currentVariableSize
+-(int)getValuesWithNCID:(int)ncid start:(const size_t *)start edges:(const size_t *)edges stride:(const ptrdiff_t *)stride imap:(const ptrdiff_t *)imap buffer:(void *)buffer
 {
-    NSMutableArray *theDims = [theHandle getDimensions];
-    int32_t i;
-    int32_t theSize,aLength;
-
-    theSize = 1;
-    for(i=0;i<[dimIDs count];i++)
-    {
-        aLength = (int32_t)[[theDims objectAtIndex:[dimIDs[i] intValue]] dimLength];
-        theSize *= aLength;
-    }
-    return theSize;
+    return [self getValuesWithNCID:ncid start:start edges:edges stride:stride imap:imap type:dataType buffer:buffer];
 }
 
--(int)currentVariableByteSize
+-(int)getValuesWithNCID:(int)ncid start:(const size_t *)start edges:(const size_t *)edges stride:(const ptrdiff_t *)stride imap:(const ptrdiff_t *)imap type:(nc_type)type buffer:(void *)buffer
 {
-    int32_t size = [self currentVariableSize];
-    switch(dataType)
+    ptrdiff_t *unitStride;
+    int32_t i,status;
+    //the library converts from the variable's type to type as it reads.
+#ifdef NCDF4
+    //a strided read touches the chunks of its whole span, which the sizing does not model.
+    if(_automaticChunkCache && !stride)
+        [self sizeChunkCacheForStart:start edges:edges ncid:ncid];
+    //the status is returned rather than posted because this method runs on the worker threads of readVariables:atLocations:edgeLengths:.
+    status = [self applyChunkCacheToNCID:ncid];
+    if(status!=NC_NOERR)
+        return status;
+#endif
+    if(imap)
     {
-        case NC_BYTE:
-            return size;
-            break;
-        case NC_CHAR:
-            return size;
-            break;
-        case NC_SHORT:
-            return size*2;
-            break;
-        case NC_INT:
-            return size*4;
-            break;
-        case NC_FLOAT:
-            return size*4;
-            break;
-        case NC_DOUBLE:
-            return size*8;
-            break;
-        default:
-            return -1;
-            break;
-
-    }
-}
-
--(int)unlimitedVariableLength
-{
-    if([[[theHandle retrieveUnlimitedDimension] dimensionName] isEqualToString:[self variableName]])
-    {
-        NSData *theData = [self readAllVariableData];
-        switch(dataType)
+        unitStride = NULL;
+        if(!stride)
+        {
+            unitStride = (ptrdiff_t *)malloc(sizeof(ptrdiff_t)*([dimIDs count]+1));
+            for(i=0;i<[dimIDs count];i++)
+                unitStride[i] = 1;
+            stride = unitStride;
+        }
+        switch(type)
         {
             case NC_BYTE:
-                return (int)[theData length];
+                status = nc_get_varm_schar(ncid,varID,start,edges,stride,imap,(signed char *)buffer);
                 break;
             case NC_CHAR:
-                return (int)[theData length];
+                status = nc_get_varm_text(ncid,varID,start,edges,stride,imap,(char *)buffer);
                 break;
             case NC_SHORT:
-                return (int)[theData length]/2;
+                status = nc_get_varm_short(ncid,varID,start,edges,stride,imap,(short *)buffer);
                 break;
             case NC_INT:
-                return (int)[theData length]/4 ;
+                status = nc_get_varm_int(ncid,varID,start,edges,stride,imap,(int *)buffer);
                 break;
             case NC_FLOAT:
-                return (int)[theData length]/4 ;
+                status = nc_get_varm_float(ncid,varID,start,edges,stride,imap,(float *)buffer);
                 break;
             case NC_DOUBLE:
-                return (int)[theData length]/8 ;
+                status = nc_get_varm_double(ncid,varID,start,edges,stride,imap,(double *)buffer);
                 break;
             default:
+                status = NC_EBADTYPE;
                 break;
         }
+        if(unitStride)
+            free(unitStride);
+        return status;
+    }
+    if(stride)
+    {
+        switch(type)
+        {
+            case NC_BYTE:
+                return nc_get_vars_schar(ncid,varID,start,edges,stride,(signed char *)buffer);
+            case NC_CHAR:
+                return nc_get_vars_text(ncid,varID,start,edges,stride,(char *)buffer);
+            case NC_SHORT:
+                return nc_get_vars_short(ncid,varID,start,edges,stride,(short *)buffer);
+            case NC_INT:
+                return nc_get_vars_int(ncid,varID,start,edges,stride,(int *)buffer);
+            case NC_FLOAT:
+                return nc_get_vars_float(ncid,varID,start,edges,stride,(float *)buffer);
+            case NC_DOUBLE:
+                return nc_get_vars_double(ncid,varID,start,edges,stride,(double *)buffer);
+            default:
+                return NC_EBADTYPE;
+        }
+    }
+    switch(type)
+    {
+        case NC_BYTE:
+            return nc_get_vara_schar(ncid,varID,start,edges,(signed char *)buffer);
+        case NC_CHAR:
+            return nc_get_vara_text(ncid,varID,start,edges,(char *)buffer);
+        case NC_SHORT:
+            return nc_get_vara_short(ncid,varID,start,edges,(short *)buffer);
+        case NC_INT:
+            return nc_get_vara_int(ncid,varID,start,edges,(int *)buffer);
+        case NC_FLOAT:
+            return nc_get_vara_float(ncid,varID,start,edges,(float *)buffer);
+        case NC_DOUBLE:
+            return nc_get_vara_double(ncid,varID,start,edges,(double *)buffer);
+        default:
+            return NC_EBADTYPE;
     }
-    return -1;
+}
+
+-(int)putValuesWithNCID:(int)ncid start:(const size_t *)start edges:(const size_t *)edges buffer:(const void *)buffer
+{
+    switch(dataType)
+    {
+        case NC_BYTE:
+            return nc_put_vara_uchar(ncid,varID,start,edges,(const unsigned char *)buffer);
+        case NC_CHAR:
+            return nc_put_vara_text(ncid,varID,start,edges,(const char *)buffer);
+        case NC_SHORT:
+            return nc_put_vara_short(ncid,varID,start,edges,(const short *)buffer);
+        case NC_INT:
+            return nc_put_vara_int(ncid,varID,start,edges,(const int *)buffer);
+        case NC_FLOAT:
+            return nc_put_vara_float(ncid,varID,start,edges,(const float *)buffer);
+        case NC_DOUBLE:
+            return nc_put_vara_double(ncid,varID,start,edges,(const double *)buffer);
+        default:
+            return NC_EBADTYPE;
+    }
+}
+
+-(BOOL)readIntoBuffer:(void *)buffer capacity:(size_t)capacity start:(const size_t *)start count:(const size_t *)count ndims:(int)ndims status:(int32_t *)status
+{
+    return [self readIntoBuffer:buffer capacity:capacity start:start count:count stride:NULL imap:NULL ndims:ndims status:status];
+}
+
+-(BOOL)readIntoBuffer:(void *)buffer capacity:(size_t)capacity start:(const size_t *)start count:(const size_t *)count stride:(const ptrdiff_t *)stride imap:(const ptrdiff_t *)imap ndims:(int)ndims status:(int32_t *)status
+{
+    return [self readIntoBuffer:buffer capacity:capacity start:start count:count stride:stride imap:imap type:dataType ndims:ndims status:status];
+}
+
+-(BOOL)readIntoBuffer:(void *)buffer capacity:(size_t)capacity start:(const size_t *)start count:(const size_t *)count stride:(const ptrdiff_t *)stride imap:(const ptrdiff_t *)imap type:(nc_type)type ndims:(int)ndims status:(int32_t *)status
+{
+    int32_t ncid,readStatus,i;
+    size_t byteCount;
+    BOOL isValid;
+    if(theErrorHandle == nil)
+        theErrorHandle = [theHandle theErrorHandle];
+    isValid = (ndims==(int)[dimIDs count] && NCDFSizeOfType(type)>0);
+    for(i=0;i<ndims && imap;i++)
+    {
+        if(imap[i]<0)
+            isValid = NO;
+    }
+    if(imap)
+        byteCount = NCDFSizeOfType(type)*NCDFImapExtent(ndims,count,imap);
+    else
+    {
+        byteCount = NCDFSizeOfType(type);
+        for(i=0;i<ndims;i++)
+            byteCount *= count[i];
+    }
+    if(!isValid || byteCount>capacity || (byteCount>0 && !buffer))
+    {
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"readIntoBuffer" subMethod:@"Check buffer" errorCode:NC_EINVAL];
+        if(status)
+            *status = NC_EINVAL;
+        return NO;
+    }
+    if([theHandle usesMappedReads] && !stride && !imap && type==dataType)
+    {
+        if([self copyMappedDataWithStart:start edges:count toBuffer:buffer])
+        {
+            if(status)
+                *status = NC_NOERR;
+            return YES;
+        }
+    }
+    ncid = [theHandle ncidWithOpenMode:NC_NOWRITE status:&readStatus];
+    if(readStatus!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"readIntoBuffer" subMethod:@"Open File" errorCode:readStatus];
+        if(status)
+            *status = readStatus;
+        return NO;
+    }
+    readStatus = [self getValuesWithNCID:ncid start:start edges:count stride:stride imap:imap type:type buffer:buffer];
+    [theHandle closeNCID:ncid];
+    if(status)
+        *status = readStatus;
+    if(readStatus!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"readIntoBuffer" subMethod:[NSString stringWithFormat:@"Read %@",[self variableType]] errorCode:readStatus];
+        return NO;
+    }
+    return YES;
+}
+
+-(BOOL)writeFromBuffer:(const void *)buffer length:(size_t)length start:(const size_t *)start count:(const size_t *)count ndims:(int)ndims status:(int32_t *)status
+{
+    int32_t ncid,writeStatus,i;
+    size_t byteCount;
+    if(theErrorHandle == nil)
+        theErrorHandle = [theHandle theErrorHandle];
+    byteCount = NCDFSizeOfType(dataType);
+    for(i=0;i<ndims;i++)
+        byteCount *= count[i];
+    if(ndims!=(int)[dimIDs count] || byteCount>length || (byteCount>0 && !buffer))
+    {
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeFromBuffer" subMethod:@"Check buffer" errorCode:NC_EINVAL];
+        if(status)
+            *status = NC_EINVAL;
+        return NO;
+    }
+    ncid = [theHandle ncidWithOpenMode:NC_WRITE status:&writeStatus];
+    if(writeStatus!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeFromBuffer" subMethod:@"Open File" errorCode:writeStatus];
+        if(status)
+            *status = writeStatus;
+        return NO;
+    }
+    writeStatus = [self putValuesWithNCID:ncid start:start edges:count buffer:buffer];
+    [theHandle closeNCID:ncid];
+    if(status)
+        *status = writeStatus;
+    if(writeStatus!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"writeFromBuffer" subMethod:[NSString stringWithFormat:@"Write %@",[self variableType]] errorCode:writeStatus];
+        return NO;
+    }
+    return YES;
+}
+
+-(NSData *)mappedDataAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths
+{
+    int32_t i;
+    size_t *index,*edges;
+    NSData *theData;
+    if(([dimIDs count]!=[startCoordinates count])||([dimIDs count]!=[edgeLengths count]))
+        return nil;
+    index = (size_t *)malloc(sizeof(size_t)*([startCoordinates count]+1));
+    edges = (size_t *)malloc(sizeof(size_t)*([edgeLengths count]+1));
+    for(i=0;i<[startCoordinates count];i++)
+    {
+        index[i] = (size_t)[startCoordinates[i] unsignedLongLongValue];
+        edges[i] = (size_t)[edgeLengths[i] unsignedLongLongValue];
+    }
+    theData = [self mappedDataWithStart:index edges:edges hostByteOrder:NO];
+    free(index);
+    free(edges);
+    return theData;
+}
+
+-(NSData *)mappedDataWithStart:(const size_t *)start edges:(const size_t *)edges hostByteOrder:(BOOL)hostOrder
+{
+    NCDFMappedFile *mappedFile;
+    NSMutableData *fileData;
+    //no write can happen between checking the mapping and copying out of it.
+    [[theHandle fileLock] lockForReading];
+    mappedFile = [theHandle mappedFile];
+    if(start)
+        fileData = [mappedFile dataForVariableID:varID start:start edges:edges];
+    else
+        fileData = [mappedFile dataForVariableID:varID];
+    [[theHandle fileLock] unlockForReading];
+    //the data is already a copy of its own, so it is converted in place.
+    if(fileData && hostOrder && NCDFSizeOfType(dataType)>1)
+        NCDFCopyToHostByteOrder([fileData bytes],[fileData mutableBytes],[fileData length]/NCDFSizeOfType(dataType),dataType);
+    return fileData;
+}
+
+-(BOOL)copyMappedDataWithStart:(const size_t *)start edges:(const size_t *)edges toBuffer:(void *)buffer
+{
+    BOOL isCopied;
+    [[theHandle fileLock] lockForReading];
+    isCopied = [[theHandle mappedFile] copyVariableID:varID start:start edges:edges toHostBuffer:buffer];
+    [[theHandle fileLock] unlockForReading];
+    return isCopied;
+}
+
+-(NSData *)prefetchValueArrayWithStart:(const size_t *)start edges:(const size_t *)edges
+{
+    int32_t ncid,status;
+    NSData *theData;
+    ncid = [theHandle ncidWithOpenMode:NC_NOWRITE status:&status];
+    if(status!=NC_NOERR)
+        return nil;
+    theData = [self valueArrayWithNCID:ncid start:start edges:edges status:&status];
+    [theHandle closeNCID:ncid];
+    if(status!=NC_NOERR)
+        return nil;
+    return theData;
+}
+
+-(NSData *)blockCachedValueArrayWithStart:(const size_t *)start edges:(const size_t *)edges
+{
+    NCDFBlockCache *cache;
+    NCDFFileLock *fileLock;
+    NSData *theData;
+    NSDictionary *attributes;
+    NSArray *signature;
+    NSTimeInterval now;
+    size_t *shape;
+    size_t recordCount;
+    uint64_t generation;
+    BOOL checkFile,hasRecordCount;
+    int32_t i,ndims,ncid,status;
+    __weak NCDFVariable *weakSelf;
+    cache = [NCDFBlockCache sharedCache];
+    //in-memory datasets are already in memory, and a define session's writes are not yet visible to the generation.
+    if([cache byteBudget]==0 || [theHandle isInDefineSession])
+        return nil;
+#ifdef NCDF4
+    if([theHandle isInMemory])
+        return nil;
+#endif
+    fileLock = [theHandle fileLock];
+    //taken before the record count is read, so a count read after a write is never kept under the older generation.
+    generation = [fileLock writeGeneration];
+    if([theHandle sharedAccess])
+    {
+        //writes by other processes do not move the generation, so the file itself is checked, though not on every read.
+        now = [NSDate timeIntervalSinceReferenceDate];
+        @synchronized(self)
+        {
+            checkFile = (!_fileSignature || now<_lastFileCheck || now-_lastFileCheck>=NCDFBlockCacheFileCheckInterval);
+        }
+        if(checkFile)
+        {
+            attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:[theHandle theFilePath] error:nil];
+            if(!attributes)
+                return nil;
+            signature = @[[attributes fileModificationDate] ? [attributes fileModificationDate] : [NSDate distantPast],@([attributes fileSize])];
+            @synchronized(self)
+            {
+                _lastFileCheck = now;
+                if(![signature isEqualToArray:_fileSignature])
+                {
+                    _fileSignature = signature;
+                    _hasCachedRecordCount = NO;
+                }
+            }
+            [cache validateBlocksForPath:[fileLock path] modificationDate:[attributes fileModificationDate] size:[attributes fileSize]];
+        }
+    }
+    ndims = (int32_t)[dimIDs count];
+    shape = (size_t *)malloc(sizeof(size_t)*(ndims+1));
+    recordCount = 0;
+    for(i=0;i<ndims;i++)
+    {
+        NCDFDimension *aDim = [theHandle retrieveDimensionByIndex:[dimIDs[i] intValue]];
+        if([aDim isUnlimited])
+        {
+            shape[i] = SIZE_MAX;
+            @synchronized(self)
+            {
+                hasRecordCount = (_hasCachedRecordCount && _recordCountGeneration==generation);
+                recordCount = _cachedRecordCount;
+            }
+            if(!hasRecordCount)
+            {
+                //the record count is read from the file, since the dimension object does not track it, and kept until the generation moves on.
+                ncid = [theHandle ncidWithOpenMode:NC_NOWRITE status:&status];
+                if(status==NC_NOERR)
+                {
+                    status = nc_inq_dimlen(ncid,[dimIDs[i] intValue],&recordCount);
+                    [theHandle closeNCID:ncid];
+                }
+                if(status!=NC_NOERR)
+                {
+                    free(shape);
+                    return nil;
+                }
+                @synchronized(self)
+                {
+                    _cachedRecordCount = recordCount;
+                    _recordCountGeneration = generation;
+                    _hasCachedRecordCount = YES;
+                }
+            }
+        }
+        else
+            shape[i] = (size_t)[aDim dimLength];
+    }
+    weakSelf = self;
+    theData = [cache dataForPath:[fileLock path] generation:generation variableID:varID ndims:ndims shape:shape recordCount:recordCount elementSize:NCDFSizeOfType(dataType) start:start edges:edges reader:^NSData *(const size_t *blockStart, const size_t *blockEdges) {
+        return [weakSelf prefetchValueArrayWithStart:blockStart edges:blockEdges];
+    }];
+    free(shape);
+    return theData;
+}
+
+-(int)currentShape:(size_t *)shape
+{
+    int32_t ncid,status,i;
+    ncid = [theHandle ncidWithOpenMode:NC_NOWRITE status:&status];
+    if(status!=NC_NOERR)
+        return status;
+    for(i=0;i<[dimIDs count] && status==NC_NOERR;i++)
+        status = nc_inq_dimlen(ncid,[dimIDs[i] intValue],&shape[i]);
+    [theHandle closeNCID:ncid];
+    return status;
+}
+
+-(BOOL)reorderBuffer:(void *)buffer counts:(const size_t *)count alongDimension:(int)dimension shift:(ptrdiff_t)shift reverse:(BOOL)reverse
+{
+    size_t outerCount,unitBytes;
+    int32_t i;
+    //the region is outerCount blocks of count[dimension] units, each unit covering the dimensions after the reordered one.
+    outerCount = 1;
+    for(i=0;i<dimension;i++)
+        outerCount *= count[i];
+    unitBytes = NCDFSizeOfType(dataType);
+    for(i=dimension+1;i<[dimIDs count];i++)
+        unitBytes *= count[i];
+    if(reverse)
+    {
+        NCDFReverseUnits(buffer,outerCount,count[dimension],unitBytes,YES);
+        return YES;
+    }
+    return NCDFRotateUnits(buffer,outerCount,count[dimension],unitBytes,shift,YES);
+}
+
+-(NSData *)reorderedDataAlongDimensionName:(NSString *)theDimName shift:(ptrdiff_t)shift reverse:(BOOL)reverse
+{
+    NSMutableData *theData;
+    NSUInteger dimIndex;
+    size_t *shape,*start;
+    size_t byteCount;
+    int32_t i,ndims,dimension,status;
+    if(theErrorHandle == nil)
+        theErrorHandle = [theHandle theErrorHandle];
+    dimIndex = theDimName ? [[self dimensionNames] indexOfObject:theDimName] : NSNotFound;
+    if(dimIndex==NSNotFound)
+        return nil;
+    dimension = (int32_t)dimIndex;
+    ndims = (int32_t)[dimIDs count];
+    shape = (size_t *)calloc(ndims+1,sizeof(size_t));
+    start = (size_t *)calloc(ndims+1,sizeof(size_t));
+    status = [self currentShape:shape];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"reorderedDataAlongDimensionName" subMethod:@"Read shape" errorCode:status];
+        free(shape);
+        free(start);
+        return nil;
+    }
+    byteCount = NCDFSizeOfType(dataType);
+    for(i=0;i<ndims;i++)
+        byteCount *= shape[i];
+    //the variable is read once into the buffer that is returned, and reordered there.
+    theData = [NSMutableData dataWithLength:byteCount];
+    if(byteCount>0 && ![self readIntoBuffer:[theData mutableBytes] capacity:byteCount start:start count:shape ndims:ndims status:NULL])
+        theData = nil;
+    if(theData && ![self reorderBuffer:[theData mutableBytes] counts:shape alongDimension:dimension shift:shift reverse:reverse])
+        theData = nil;
+    free(shape);
+    free(start);
+    return theData;
+}
+
+-(BOOL)reorderAndStoreDataAlongDimensionName:(NSString *)theDimName shift:(ptrdiff_t)shift reverse:(BOOL)reverse
+{
+    size_t *shape,*tile,*start,*count;
+    BOOL *split;
+    size_t tileElements,elementSize,stagingBytes,chunkBytes,offset;
+    NSUInteger dimIndex;
+    int32_t i,ndims,dimension,status;
+    uint8_t *staging;
+    BOOL isValid;
+    if(theErrorHandle == nil)
+        theErrorHandle = [theHandle theErrorHandle];
+    dimIndex = theDimName ? [[self dimensionNames] indexOfObject:theDimName] : NSNotFound;
+    if(dimIndex==NSNotFound)
+        return NO;
+    dimension = (int32_t)dimIndex;
+    ndims = (int32_t)[dimIDs count];
+    shape = (size_t *)calloc(ndims+1,sizeof(size_t));
+    tile = (size_t *)calloc(ndims+1,sizeof(size_t));
+    start = (size_t *)calloc(ndims+1,sizeof(size_t));
+    count = (size_t *)calloc(ndims+1,sizeof(size_t));
+    split = (BOOL *)calloc(ndims+1,sizeof(BOOL));
+    staging = NULL;
+    status = [self currentShape:shape];
+    isValid = (status==NC_NOERR);
+    if(!isValid)
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"reorderAndStoreDataAlongDimensionName" subMethod:@"Read shape" errorCode:status];
+    else
+    {
+        //every dimension but the reordered one may be split, so each chunk is reordered on its own.
+        for(i=0;i<ndims;i++)
+            split[i] = (i!=dimension);
+        elementSize = NCDFSizeOfType(dataType);
+        tileElements = NCDFPlanChunk(ndims,shape,split,elementSize,[theHandle rewriteMemoryCeiling],tile);
+        if(tileElements>0)
+        {
+            //the chunks tile the variable, so staging every one of them takes the variable's size.
+            stagingBytes = elementSize;
+            for(i=0;i<ndims && stagingBytes>0;i++)
+            {
+                if(shape[i]>SIZE_MAX/stagingBytes)
+                    stagingBytes = 0;
+                else
+                    stagingBytes *= shape[i];
+            }
+            staging = stagingBytes>0 ? (uint8_t *)malloc(stagingBytes) : NULL;
+            if(!staging)
+            {
+                [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"reorderAndStoreDataAlongDimensionName" subMethod:@"Allocate staging" errorCode:NC_ENOMEM];
+                isValid = NO;
+            }
+            for(i=0;i<ndims;i++)
+                count[i] = tile[i];
+            //every chunk is reordered into its own place in the staging buffer before the first is written back, so a failed read leaves the variable as it was.
+            offset = 0;
+            while(isValid)
+            {
+                chunkBytes = elementSize;
+                for(i=0;i<ndims;i++)
+                    chunkBytes *= count[i];
+                isValid = [self readIntoBuffer:staging+offset capacity:chunkBytes start:start count:count ndims:ndims status:NULL];
+                if(isValid)
+                    isValid = [self reorderBuffer:staging+offset counts:count alongDimension:dimension shift:shift reverse:reverse];
+                offset += chunkBytes;
+                if(!isValid || !NCDFAdvanceTile(ndims,shape,tile,start,count))
+                    break;
+            }
+            //the chunks are written back in the order they were staged.
+            if(isValid)
+            {
+                for(i=0;i<ndims;i++)
+                {
+                    start[i] = 0;
+                    count[i] = tile[i];
+                }
+            }
+            offset = 0;
+            while(isValid)
+            {
+                chunkBytes = elementSize;
+                for(i=0;i<ndims;i++)
+                    chunkBytes *= count[i];
+                isValid = [self writeFromBuffer:staging+offset length:chunkBytes start:start count:count ndims:ndims status:NULL];
+                offset += chunkBytes;
+                if(!isValid || !NCDFAdvanceTile(ndims,shape,tile,start,count))
+                    break;
+            }
+        }
+    }
+    free(staging);
+    free(shape);
+    free(tile);
+    free(start);
+    free(count);
+    free(split);
+    return isValid;
+}
+
+-(void)rebuildReadAheadWithDepth:(int)depth bufferLimit:(size_t)bytes
+{
+    NCDFReadAhead *readAhead;
+    __weak NCDFVariable *weakSelf;
+    readAhead = nil;
+    //the record dimension has to come first for records to be contiguous steps.
+    if(depth>0 && [dimIDs count]>0 && [[theHandle retrieveDimensionByIndex:[dimIDs[0] intValue]] isUnlimited])
+    {
+        weakSelf = self;
+        readAhead = [[NCDFReadAhead alloc] initWithDimensionCount:(int)[dimIDs count] fileLock:[theHandle fileLock] fetchBlock:^NSData *(const size_t *start, const size_t *edges) {
+            return [weakSelf prefetchValueArrayWithStart:start edges:edges];
+        }];
+        [readAhead setBufferLimit:bytes];
+        [readAhead setDepth:depth];
+    }
+    @synchronized(self)
+    {
+        _readAhead = readAhead;
+    }
+}
+
+-(BOOL)isDimensionVariable
+{
+    /*This method is to test weather the reciever is a variable that represents dimension values.*/
+    NSArray *theArray;
+    if([dimIDs count]!=1)
+        return NO;
+    theArray = [theHandle getDimensions];
+    if([[[theArray objectAtIndex:[dimIDs[0] intValue]]  dimensionName] isEqualToString:variableName])
+        return YES;
+    return NO;
+}
+
+-(size_t)sizeUnitVariable
+{
+    NSMutableArray *theDims = [theHandle getDimensions];
+    int32_t i;
+    size_t theSize,aLength;
+
+    theSize = 1;
+    for(i=0;i<[dimIDs count];i++)
+    {
+        aLength = [[theDims objectAtIndex:[dimIDs[i] intValue]] dimLength];
+        if(![[theDims objectAtIndex:[dimIDs[i] intValue]] isUnlimited])
+            theSize *= aLength;
+    }
+    return theSize;
+}
+
+-(size_t)sizeUnitVariableForType
+{
+    return [self sizeUnitVariable]*NCDFSizeOfType(dataType);
+}
+
+-(size_t)currentVariableSize
+{
+    NSMutableArray *theDims = [theHandle getDimensions];
+    int32_t i;
+    size_t theSize,aLength;
+
+    theSize = 1;
+    for(i=0;i<[dimIDs count];i++)
+    {
+        aLength = [[theDims objectAtIndex:[dimIDs[i] intValue]] dimLength];
+        theSize *= aLength;
+    }
+    return theSize;
+}
+
+-(size_t)currentVariableByteSize
+{
+    return [self currentVariableSize]*NCDFSizeOfType(dataType);
+}
+
+-(int64_t)unlimitedVariableLength
+{
+    NCDFDimension *unlimitedDim;
+    int32_t ncid,status;
+    size_t recordCount;
+    unlimitedDim = [theHandle retrieveUnlimitedDimension];
+    if(!unlimitedDim || ![[unlimitedDim dimensionName] isEqualToString:[self variableName]])
+        return -1;
+    if(theErrorHandle == nil)
+        theErrorHandle = [theHandle theErrorHandle];
+    //the variable holds one value per record, so its length is the record count and its values need not be read.
+    ncid = [theHandle ncidWithOpenMode:NC_NOWRITE status:&status];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"unlimitedVariableLength" subMethod:@"Open File" errorCode:status];
+        return -1;
+    }
+    status = nc_inq_dimlen(ncid,[unlimitedDim dimensionID],&recordCount);
+    [theHandle closeNCID:ncid];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"unlimitedVariableLength" subMethod:@"Read record count" errorCode:status];
+        return -1;
+    }
+    return (int64_t)recordCount;
 }
 -(NSArray *)lengthArray
 {
     NSMutableArray *theDims = [theHandle getDimensions];
     NSMutableArray *theLengths = [[NSMutableArray alloc] init];
     int32_t i;
-    int32_t aLength;
+    size_t aLength;
 
     for(i=0;i<[dimIDs count];i++)
     {
-        aLength = (int32_t)[[theDims objectAtIndex:[dimIDs[i] intValue]] dimLength];
+        aLength = [[theDims objectAtIndex:[dimIDs[i] intValue]] dimLength];
         if(aLength != NC_UNLIMITED)
-            [theLengths addObject:[NSNumber numberWithInt:aLength]];
+            [theLengths addObject:[NSNumber numberWithUnsignedLongLong:aLength]];
         else
         {
-            [theLengths addObject:[NSNumber numberWithInt:[[theHandle retrieveUnlimitedVariable] unlimitedVariableLength]]];
+            [theLengths addObject:[NSNumber numberWithLongLong:[[theHandle retrieveUnlimitedVariable] unlimitedVariableLength]]];
         }
     }
     return theLengths;
@@ -1382,7 +1967,7 @@
     int32_t i;
     for(i=0;i<[dimLengths1 count];i++)
     {
-        if([dimLengths1[i] intValue]!=[dimLengths2[i] intValue])
+        if([dimLengths1[i] unsignedLongLongValue]!=[dimLengths2[i] unsignedLongLongValue])
         {
             //i = [dimLengths1 count];
             return NO;
@@ -1404,54 +1989,244 @@
     return NO;
 }
 
--(BOOL)doesVariableUseDimensionID:(int)aDimID
+-(BOOL)doesVariableUseDimensionID:(int)aDimID
+{
+    int32_t i;
+
+    for(i=0;i<[dimIDs count];i++)
+    {
+        if([dimIDs[i] intValue]==aDimID)
+            return YES;
+    }
+    return NO;
+}
+
+-(BOOL)createAttributesFromAttributeArray:(NSArray *)newAttributes
+{
+    int32_t i;
+
+    for(i=0;i<[newAttributes count];i++)
+    {
+        if(![self createNewVariableAttributeWithName:[newAttributes[i] attributeName] dataType:[newAttributes[i] attributeNC_TYPE] values:[newAttributes[i] getAttributeValueArray]])
+            return NO;
+    }
+    return YES;
+}
+
+-(NSDictionary *)propertyList
+{
+    NSMutableDictionary *theTemp;
+    theTemp = [NSMutableDictionary dictionaryWithDictionary:[self definitionPropertyList]];
+    [theTemp setObject:[self readAllVariableData] forKey:@"data"];
+    return [NSDictionary dictionaryWithDictionary:theTemp];
+}
+
+-(NSDictionary *)definitionPropertyList
+{
+    NSDictionary *thePropertyList;
+    NSMutableDictionary *theTemp;
+    NSMutableArray *attributeDictionaries;
+    NSArray *originalAtts;
+    int32_t i;
+    theTemp = [[NSMutableDictionary alloc] init];
+    [theTemp setObject:fileName forKey:@"fileName"];
+    [theTemp setObject:[NSNumber numberWithInt:varID] forKey:@"variableID"];
+    [theTemp setObject:variableName forKey:@"variableName"];
+    [theTemp setObject:[NSNumber numberWithInt:(int)dataType] forKey:@"nc_type"];
+    [theTemp setObject:[self dimensionNames] forKey:@"dimNames"];
+    attributeDictionaries = [[NSMutableArray alloc] init];
+    originalAtts = [self getVariableAttributes];
+    for(i=0;i<[originalAtts count];i++)
+    {
+        [attributeDictionaries addObject:[originalAtts[i] propertyList]];
+    }
+    [theTemp setObject:[NSArray arrayWithArray:attributeDictionaries]  forKey:@"attributes"];
+#ifdef NCDF4
+    NSDictionary *storage = [self storageOptions];
+    if(storage)
+        [theTemp setObject:storage forKey:NCDFVariablePropertyListFieldStorage];
+#endif
+    thePropertyList = [NSDictionary dictionaryWithDictionary:theTemp];
+    return thePropertyList;
+}
+
+#ifdef NCDF4
+-(BOOL)setChunkCacheSize:(size_t)size slots:(size_t)slots preemption:(float)preemption
+{
+    int32_t ncid,status;
+
+    if(theErrorHandle == nil)
+        theErrorHandle = [theHandle theErrorHandle];
+    @synchronized(self)
+    {
+        _chunkCacheSize = size;
+        _chunkCacheSlots = slots;
+        _chunkCachePreemption = preemption;
+        _chunkCacheSet = YES;
+        _automaticChunkCache = NO;
+    }
+    ncid = [theHandle ncidWithOpenMode:NC_NOWRITE status:&status];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"setChunkCacheSize" subMethod:@"Open File" errorCode:status];
+        return NO;
+    }
+    status = [self applyChunkCacheToNCID:ncid];
+    [theHandle closeNCID:ncid];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"setChunkCacheSize" subMethod:@"Set chunk cache" errorCode:status];
+        return NO;
+    }
+    return YES;
+}
+
+-(size_t)chunkCacheSize
+{
+    return _chunkCacheSize;
+}
+
+-(size_t)chunkCacheSlots
+{
+    return _chunkCacheSlots;
+}
+
+-(float)chunkCachePreemption
+{
+    return _chunkCachePreemption;
+}
+
+-(void)setAutomaticChunkCache:(BOOL)automatic
+{
+    @synchronized(self)
+    {
+        _automaticChunkCache = automatic;
+    }
+}
+
+-(BOOL)automaticChunkCache
+{
+    return _automaticChunkCache;
+}
+
+-(int)applyChunkCacheToNCID:(int)ncid
 {
-    int32_t i;
+    size_t size,slots,currentSize,currentSlots;
+    float preemption,currentPreemption;
+    int32_t status;
 
-    for(i=0;i<[dimIDs count];i++)
+    @synchronized(self)
     {
-        if([dimIDs[i] intValue]==aDimID)
-            return YES;
+        if(!_chunkCacheSet)
+            return NC_NOERR;
+        size = _chunkCacheSize;
+        slots = _chunkCacheSlots;
+        preemption = _chunkCachePreemption;
     }
-    return NO;
+    status = nc_get_var_chunk_cache(ncid,varID,&currentSize,&currentSlots,&currentPreemption);
+    //a chunk cache does not apply to classic format files.
+    if(status==NC_ENOTNC4)
+        return NC_NOERR;
+    if(status==NC_NOERR && currentSize==size && currentSlots==slots && currentPreemption==preemption)
+        return NC_NOERR;
+    return nc_set_var_chunk_cache(ncid,varID,size,slots,preemption);
 }
 
--(BOOL)createAttributesFromAttributeArray:(NSArray *)newAttributes
+-(void)sizeChunkCacheForStart:(const size_t *)start edges:(const size_t *)edges ncid:(int)ncid
 {
-    int32_t i;
+    int32_t status,storage,i;
+    size_t chunks[NC_MAX_VAR_DIMS],chunkBytes,chunkCount,cacheSize,slots,j;
+    BOOL isPrime;
 
-    for(i=0;i<[newAttributes count];i++)
+    status = nc_inq_var_chunking(ncid,varID,&storage,chunks);
+    if(status!=NC_NOERR || storage!=NC_CHUNKED)
+        return;
+    chunkBytes = NCDFSizeOfType(dataType);
+    chunkCount = 1;
+    for(i=0;i<[dimIDs count];i++)
     {
-        if(![self createNewVariableAttributeWithName:[newAttributes[i] attributeName] dataType:[newAttributes[i] attributeNC_TYPE] values:[newAttributes[i] getAttributeValueArray]])
-            return NO;
+        chunkBytes *= chunks[i];
+        if(edges[i]>0)
+            chunkCount *= (start[i]+edges[i]-1)/chunks[i]-start[i]/chunks[i]+1;
+    }
+    if(chunkBytes>NCDFVariableMaxAutomaticChunkCache)
+        return;
+    if(chunkCount>NCDFVariableMaxAutomaticChunkCache/chunkBytes)
+        chunkCount = NCDFVariableMaxAutomaticChunkCache/chunkBytes;
+    cacheSize = chunkCount*chunkBytes;
+    //the library wants a prime number of hash slots, well above the number of chunks held.
+    slots = chunkCount*4+1;
+    do
+    {
+        isPrime = YES;
+        for(j=3;j*j<=slots && isPrime;j+=2)
+        {
+            if(slots%j==0)
+                isPrime = NO;
+        }
+        if(!isPrime)
+            slots += 2;
+    }
+    while(!isPrime);
+    @synchronized(self)
+    {
+        //the cache only grows, so alternating read shapes do not keep discarding it.
+        if(_chunkCacheSet && cacheSize<=_chunkCacheSize)
+            return;
+        _chunkCacheSize = cacheSize;
+        _chunkCacheSlots = slots;
+        _chunkCachePreemption = NCDFVariableDefaultChunkCachePreemption;
+        _chunkCacheSet = YES;
     }
-    return YES;
 }
 
--(NSDictionary *)propertyList
+-(NSDictionary *)storageOptions
 {
-    NSDictionary *thePropertyList;
-    NSMutableDictionary *theTemp;
-    NSMutableArray *attributeDictionaries;
-    NSArray *originalAtts;
-    int32_t i;
-    theTemp = [[NSMutableDictionary alloc] init];
-    [theTemp setObject:fileName forKey:@"fileName"];
-    [theTemp setObject:[NSNumber numberWithInt:varID] forKey:@"variableID"];
-    [theTemp setObject:variableName forKey:@"variableName"];
-    [theTemp setObject:[NSNumber numberWithInt:(int)dataType] forKey:@"nc_type"];
-    [theTemp setObject:[self dimensionNames] forKey:@"dimNames"];
-    [theTemp setObject:[self readAllVariableData] forKey:@"data"];
-    attributeDictionaries = [[NSMutableArray alloc] init];
-    originalAtts = [self getVariableAttributes];
-    for(i=0;i<[originalAtts count];i++)
+    int32_t ncid,status,storage,shuffle,deflate,deflateLevel,checksum,i;
+    size_t chunks[NC_MAX_VAR_DIMS];
+    NSMutableDictionary *options;
+    NSMutableArray *chunkSizes;
+
+    if(theErrorHandle == nil)
+        theErrorHandle = [theHandle theErrorHandle];
+    ncid = [theHandle ncidWithOpenMode:NC_NOWRITE status:&status];
+    if(status!=NC_NOERR)
     {
-        [attributeDictionaries addObject:[originalAtts[i] propertyList]];
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"storageOptions" subMethod:@"Open file failed" errorCode:status];
+        return nil;
     }
-    [theTemp setObject:[NSArray arrayWithArray:attributeDictionaries]  forKey:@"attributes"];
-    thePropertyList = [NSDictionary dictionaryWithDictionary:theTemp];
-    return thePropertyList;
+    status = nc_inq_var_chunking(ncid,varID,&storage,chunks);
+    if(status==NC_ENOTNC4)
+    {
+        //classic format variables have no storage settings.
+        [theHandle closeNCID:ncid];
+        return nil;
+    }
+    if(status==NC_NOERR)
+        status = nc_inq_var_deflate(ncid,varID,&shuffle,&deflate,&deflateLevel);
+    if(status==NC_NOERR)
+        status = nc_inq_var_fletcher32(ncid,varID,&checksum);
+    [theHandle closeNCID:ncid];
+    if(status!=NC_NOERR)
+    {
+        [theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"storageOptions" subMethod:@"Inquire storage" errorCode:status];
+        return nil;
+    }
+    options = [[NSMutableDictionary alloc] init];
+    [options setObject:[NSNumber numberWithBool:(storage==NC_CONTIGUOUS)] forKey:NCDFVariableStorageContiguous];
+    if(storage==NC_CHUNKED)
+    {
+        chunkSizes = [[NSMutableArray alloc] init];
+        for(i=0;i<[dimIDs count];i++)
+            [chunkSizes addObject:[NSNumber numberWithUnsignedLong:chunks[i]]];
+        [options setObject:chunkSizes forKey:NCDFVariableStorageChunkSizes];
+    }
+    [options setObject:[NSNumber numberWithInt:(deflate?deflateLevel:0)] forKey:NCDFVariableStorageDeflateLevel];
+    [options setObject:[NSNumber numberWithBool:(shuffle!=0)] forKey:NCDFVariableStorageShuffle];
+    [options setObject:[NSNumber numberWithBool:(checksum==NC_FLETCHER32)] forKey:NCDFVariableStorageFletcher32];
+    return [NSDictionary dictionaryWithDictionary:options];
 }
+#endif
 
 -(NSArray *)dimensionNames
 {
@@ -1484,259 +2259,39 @@
 
 -(BOOL)reverseAndStoreDataAlongDimensionName:(NSString *)theDimName
 {
-    NSData *theData = [self reverseDataAlongDimensionName:theDimName];
-    if(theData != NULL)
-    {
-        [self writeAllVariableData:theData];
-        return YES;
-    }
-    else
-        return NO;
-
+    return [self reorderAndStoreDataAlongDimensionName:theDimName shift:0 reverse:YES];
 }
 
 -(NSData *)reverseDataAlongDimensionName:(NSString *)theDimName
 {
-    /*QA tested for shifts of 5 for 1, 2, and 3d cases.*/
-    NSArray *theVarDims = [self allVariableDimInformation];
-    NSArray *theLengths = [self lengthArray];
-    int32_t i,j,flippedDim;
-    NSMutableArray *theResetLengths = [[NSMutableArray alloc] init];
-    NSData *theData = [self readAllVariableData];
-    NSMutableData *theFinalData = [[NSMutableData alloc] initWithCapacity:[theData length]];
-    NSRange theRange;
-    int32_t unitSize,unitCount,totalUnits;
-    NSData *returnData;
-    flippedDim = -1;
-
-    //get all variable dims and determine which is flipped
-    for(i=0;i<[theVarDims count];i++)
-    {
-        if([[theVarDims[i] dimensionName] isEqualToString:theDimName])
-            flippedDim = i;
-    }
-    if(flippedDim == -1)
-        return nil;
-
-    //estimate new lengths from theLengths - lengths for each dim
-    //here what we want to do is figure the minimum unit that needs flipping.  We also want to know about how that will work with other dimensions.
-    for(i=0;i<[theLengths count];i++)
-    {
-
-        int32_t newValue = 1;
-        for(j=i+1;j<[theLengths count];j++)
-        {
-            newValue *= [theLengths[j] intValue];
-        }
-        //NSLog(@"new Length: %i",newValue);
-        [theResetLengths addObject:[NSNumber numberWithInt:newValue]];
-    }
-    int32_t bytes;
-    switch([self variableNC_TYPE])
-    {
-        case NC_BYTE:
-        {
-            bytes = 1;
-        }
-        break;
-        case NC_CHAR:
-        {
-            bytes = 1;
-        }
-        break;
-        case NC_SHORT:
-        {
-            bytes = 2;
-        }
-        break;
-        case NC_INT:
-        {
-            bytes = 4;
-        }
-        break;
-        case NC_FLOAT:
-        {
-            bytes = 4;
-        }
-        break;
-        case NC_DOUBLE:
-        {
-            bytes = 8;
-        }
-        break;
-        default:
-            bytes = 1;
-            break;
-    }
-    unitSize = bytes * [theResetLengths[flippedDim] intValue];
-    unitCount = [theLengths[flippedDim] intValue];
-    totalUnits = (int32_t)[theData length]/(unitSize * unitCount);
-    theRange.length = unitSize;
-
-    for(i=0;i<totalUnits;i++)
-    {
-        NSMutableArray *theArrayOfData = [[NSMutableArray alloc] init];
-        for(j=0;j<unitCount;j++)
-        {
-            theRange.location = (i*unitSize*unitCount) + j *unitSize;
-            [theArrayOfData addObject:[theData subdataWithRange:theRange]];
-        }
-        for(j=unitCount-1;j>-1;j--)
-        {
-            [theFinalData appendData:theArrayOfData[j]];
-        }
-
-
-    }
-    returnData = [NSData dataWithData:theFinalData];
-    return returnData;
-
+    return [self reorderedDataAlongDimensionName:theDimName shift:0 reverse:YES];
 }
 
 -(BOOL)shiftAndStoreDataAlongDimensionName:(NSString *)theDimName shift:(int)theShift
 {
-        NSData *theData = [self shiftDataAlongDimensionName:theDimName shift:theShift];
-    if(theData != NULL)
-    {
-        [self writeAllVariableData:theData];
-        return YES;
-    }
-    else
-        return NO;
+    return [self reorderAndStoreDataAlongDimensionName:theDimName shift:theShift reverse:NO];
 }
 
 -(NSData *)shiftDataAlongDimensionName:(NSString *)theDimName shift:(int)theShift
 {
-    /*QA tested for shifts of 5 for 1, 2, and 3d cases.*/
-    NSArray *theVarDims = [self allVariableDimInformation];
-    NSArray *theLengths = [self lengthArray];
-    int32_t i,j,flippedDim;
-    NSMutableArray *theResetLengths = [[NSMutableArray alloc] init];
-    NSData *theData = [self readAllVariableData];
-    NSMutableData *theFinalData = [[NSMutableData alloc] initWithCapacity:[theData length]];
-    NSRange theRange;
-    int32_t unitSize,unitCount,totalUnits;
-    NSData *returnData;
-    flippedDim = -1;
-    //get all variable dims and determine which is flipped
-    for(i=0;i<[theVarDims count];i++)
-    {
-        if([[theVarDims[i] dimensionName] isEqualToString:theDimName])
-            flippedDim = i;
-    }
-    if(flippedDim == -1)
-        return nil;
-
-    //estimate new lengths from theLengths - lengths for each dim
-    //here what we want to do is figure the minimum unit that needs flipping.  We also want to know about how that will work with other dimensions.
-    for(i=0;i<[theLengths count];i++)
-    {
-
-        int32_t newValue = 1;
-        for(j=i+1;j<[theLengths count];j++)
-        {
-            newValue *= [theLengths[j] intValue];
-        }
-        [theResetLengths addObject:[NSNumber numberWithInt:newValue]];
-    }
-    int32_t bytes = 0;
-    switch([self variableNC_TYPE])
-    {
-        case NC_BYTE:
-        {
-            bytes = 1;
-        }
-        break;
-        case NC_CHAR:
-        {
-            bytes = 1;
-        }
-        break;
-        case NC_SHORT:
-        {
-            bytes = 2;
-        }
-        break;
-        case NC_INT:
-        {
-            bytes = 4;
-        }
-        break;
-        case NC_FLOAT:
-        {
-            bytes = 4;
-        }
-        break;
-        case NC_DOUBLE:
-        {
-            bytes = 8;
-        }
-        break;
-        default:
-            bytes = 1;
-            break;
-    }
-    //int32_t unitSize,unitCount,totalUnits;
-    unitSize = bytes * [theResetLengths[flippedDim] intValue];
-    unitCount = [theLengths[flippedDim] intValue];
-    totalUnits = (int32_t)[theData length]/(unitSize * unitCount);
-    theRange.length = unitSize;
-    for(i=0;i<totalUnits;i++)
-    {
-        NSMutableArray *theArrayOfData = [[NSMutableArray alloc] init];
-        for(j=0;j<unitCount;j++)
-        {
-            theRange.location = (i*unitSize*unitCount) + j *unitSize;
-            [theArrayOfData addObject:[theData subdataWithRange:theRange]];
-        }
-        //recalculate shift point32_t - eliminates the possibility of emptying theArrayOfData
-        if(theShift>0)
-        {
-            while(theShift>=unitCount)
-                theShift -= unitCount;
-        }
-        else if(theShift<0)
-        {
-            while(theShift<=unitCount)
-                theShift += unitCount;
-        }
-        //shift point
-        if(theShift>0)
-        {
-            NSData *someData;
-            for(j=0;j<theShift;j++)
-            {
-                someData = [theArrayOfData lastObject];
-                [theArrayOfData removeLastObject];
-                [theArrayOfData insertObject:someData atIndex:0];
-            }
-        }
-        else if(theShift<0)
-        {
-            NSData *someData;
-            theShift *= -1;
-            for(j=0;j<theShift;j++)
-            {
-                someData = theArrayOfData[0];
-                [theArrayOfData removeObjectAtIndex:0];
-                [theArrayOfData addObject:someData];
-            }
-        }
-        //load into a new data object
-        for(j=0;j<unitCount;j++)
-        {
-            [theFinalData appendData:theArrayOfData[j]];
-        }
-    }
-    returnData = [NSData dataWithData:theFinalData];
-    return returnData;
-
+    return [self reorderedDataAlongDimensionName:theDimName shift:theShift reverse:NO];
 }
 
 -(NCDFAttribute *)variableAttributeByName:(NSString *)name
 {
+    NSDictionary *theIndex;
+    NSArray *theCurrentAtts;
     int32_t i;
-    NSArray *theCurrentAtts = [self getVariableAttributes];
+    if(!name)
+        return nil;
+    theCurrentAtts = [self getVariableAttributes];
+    @synchronized(self)
+    {
+        theIndex = _attributesByName;
+    }
+    if(theIndex)
+        return theIndex[name];
+    //the attributes could not all be read, so nothing was cached.
     for(i=0;i<[theCurrentAtts count];i++)
     {
         if([[theCurrentAtts[i] attributeName] isEqualToString:name])
@@ -1869,11 +2424,21 @@
 
 -(void)updateVariableWithVariable:(NCDFVariable *)aVar
 {
+    NCDFReadAhead *readAhead;
     variableName = [[aVar variableName] copy];
     varID = [aVar variableID];
     dataType = [aVar variableNC_TYPE];
     dimIDs = [[aVar variableDimensions] copy];
     numberOfAttributes = [aVar attributeCount];
+    @synchronized(self)
+    {
+        attributes = nil;
+        _attributesByName = nil;
+        readAhead = _readAhead;
+    }
+    //the dimensions may have changed, so the buffer is rebuilt rather than just emptied.
+    if(readAhead)
+        [self rebuildReadAheadWithDepth:[readAhead depth] bufferLimit:[readAhead bufferLimit]];
 }
 
 -(int)variableID
@@ -1901,6 +2466,12 @@
 
 -(NCDFSlab *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths
 {
+	if([theHandle usesMappedReads])
+	{
+		NSData *theMappedData = [self mappedDataAtLocation:startCoordinates edgeLengths:edgeLengths];
+		if(theMappedData)
+			return [[NCDFSlab alloc] initSlabWithBigEndianData:theMappedData withType:[self variableNC_TYPE] withLengths:edgeLengths];
+	}
 	NSData *theTempData = [self getValueArrayAtLocation:startCoordinates edgeLengths:edgeLengths];
 	NCDFSlab *theSlab = [[NCDFSlab alloc] initSlabWithData:theTempData withType:[self variableNC_TYPE] withLengths:edgeLengths];
 	return theSlab;
@@ -1909,17 +2480,359 @@
 
 -(NCDFSlab *)getAllDataInSlab
 {
+	if([theHandle usesMappedReads])
+	{
+		NSData *theMappedData = [self mappedDataWithStart:NULL edges:NULL hostByteOrder:NO];
+		if(theMappedData)
+			return [[NCDFSlab alloc] initSlabWithBigEndianData:theMappedData withType:[self variableNC_TYPE] withLengths:[self lengthArray]];
+	}
 	NSData *theTempData = [self readAllVariableData];
 	NCDFSlab *theSlab = [[NCDFSlab alloc] initSlabWithData:theTempData withType:[self variableNC_TYPE] withLengths:[self lengthArray]];
 	return theSlab;
 }
 
+-(BOOL)enumerateChunksWithMaxBytes:(size_t)maxBytes alongDimensions:(NSArray *)dimensionNames usingBlock:(void (^)(NCDFSlab *chunk,NSArray *origin,BOOL *stop))block
+{
+	return [self enumerateChunksWithMaxBytes:maxBytes alongDimensions:dimensionNames prefetch:NO usingBlock:block];
+}
+
+-(BOOL)enumerateChunksWithMaxBytes:(size_t)maxBytes alongDimensions:(NSArray *)dimensionNames prefetch:(BOOL)prefetch usingBlock:(void (^)(NCDFSlab *chunk,NSArray *origin,BOOL *stop))block
+{
+	int32_t i,ndims,status;
+	size_t *shape,*tile;
+	BOOL *split;
+	NSArray *theNames;
+	nc_type theType;
+	BOOL result;
+	if(!block)
+		return NO;
+	if(theErrorHandle == nil)
+		theErrorHandle = [theHandle theErrorHandle];
+	ndims = (int32_t)[dimIDs count];
+	shape = (size_t *)malloc(sizeof(size_t)*(ndims+1));
+	tile = (size_t *)malloc(sizeof(size_t)*(ndims+1));
+	split = (BOOL *)malloc(sizeof(BOOL)*(ndims+1));
+	//the record count is read from the file; the dimension object does not track it.
+	status = [self currentShape:shape];
+	if(status!=NC_NOERR)
+	{
+		[theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"enumerateChunksWithMaxBytes" subMethod:@"Read shape" errorCode:status];
+		free(shape);
+		free(tile);
+		free(split);
+		return NO;
+	}
+	theNames = [self dimensionNames];
+	for(i=0;i<ndims;i++)
+		split[i] = (!dimensionNames || [dimensionNames containsObject:theNames[i]]);
+	theType = dataType;
+	NCDFPlanChunk(ndims,shape,split,NCDFSizeOfType(theType),maxBytes,tile);
+	//with prefetch the reader runs on a background queue, so its status is kept and posted here once the enumeration is over.
+	__block int32_t readStatus = NC_NOERR;
+	result = NCDFEnumerateTiles(ndims,shape,tile,prefetch,^NSData *(const size_t *start,const size_t *count) {
+		int32_t ncid,tileStatus;
+		NSData *theData = nil;
+		//each tile is read once, so it is read straight from the file rather than through the block cache, which it would only flush.
+		ncid = [self->theHandle ncidWithOpenMode:NC_NOWRITE status:&tileStatus];
+		if(tileStatus==NC_NOERR)
+		{
+			theData = [self valueArrayWithNCID:ncid start:start edges:count status:&tileStatus];
+			[self->theHandle closeNCID:ncid];
+		}
+		if(tileStatus!=NC_NOERR)
+			readStatus = tileStatus;
+		return theData;
+	},^(NSData *data,const size_t *start,const size_t *count,BOOL *stop) {
+		block([[NCDFSlab alloc] initSlabWithData:data withType:theType withLengths:NCDFArrayFromSizes(ndims,count)],NCDFArrayFromSizes(ndims,start),stop);
+	});
+	if(readStatus!=NC_NOERR)
+		[theErrorHandle addErrorFromSource:fileName className:@"NCDFVariable" methodName:@"enumerateChunksWithMaxBytes" subMethod:[NSString stringWithFormat:@"Read %@",[self variableType]] errorCode:readStatus];
+	free(shape);
+	free(tile);
+	free(split);
+	return result;
+}
+
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride
+{
+	return [self getValueArrayAtLocation:startCoordinates edgeLengths:edgeLengths stride:stride imap:nil];
+}
+
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride imap:(NSArray *)imap
+{
+	int32_t i,ndims;
+	size_t *start,*count;
+	ptrdiff_t *strides,*map;
+	size_t extent;
+	NSMutableData *theData;
+	ndims = (int32_t)[dimIDs count];
+	if([startCoordinates count]!=ndims || [edgeLengths count]!=ndims || (stride && [stride count]!=ndims) || (imap && [imap count]!=ndims))
+		return nil;
+	start = (size_t *)malloc(sizeof(size_t)*(ndims+1));
+	count = (size_t *)malloc(sizeof(size_t)*(ndims+1));
+	strides = (ptrdiff_t *)malloc(sizeof(ptrdiff_t)*(ndims+1));
+	map = (ptrdiff_t *)malloc(sizeof(ptrdiff_t)*(ndims+1));
+	for(i=0;i<ndims;i++)
+	{
+		start[i] = (size_t)[startCoordinates[i] unsignedLongLongValue];
+		count[i] = (size_t)[edgeLengths[i] unsignedLongLongValue];
+		strides[i] = stride ? (ptrdiff_t)[stride[i] longLongValue] : 1;
+		map[i] = imap ? (ptrdiff_t)[imap[i] longLongValue] : 0;
+	}
+	if(!imap)
+		NCDFRowMajorImap(ndims,count,map);
+	extent = NCDFImapExtent(ndims,count,map);
+	theData = [NSMutableData dataWithLength:extent*NCDFSizeOfType(dataType)];
+	if(![self readIntoBuffer:[theData mutableBytes] capacity:[theData length] start:start count:count stride:stride?strides:NULL imap:imap?map:NULL ndims:ndims status:NULL])
+		theData = nil;
+	free(start);
+	free(count);
+	free(strides);
+	free(map);
+	return theData;
+}
+
+-(NSData *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths asType:(nc_type)type
+{
+	int32_t i,ndims;
+	size_t *start,*count;
+	size_t unitCount;
+	NSMutableData *theData;
+	if(type==dataType)
+		return [self getValueArrayAtLocation:startCoordinates edgeLengths:edgeLengths];
+	ndims = (int32_t)[dimIDs count];
+	if([startCoordinates count]!=ndims || [edgeLengths count]!=ndims)
+		return nil;
+	start = (size_t *)malloc(sizeof(size_t)*(ndims+1));
+	count = (size_t *)malloc(sizeof(size_t)*(ndims+1));
+	unitCount = 1;
+	for(i=0;i<ndims;i++)
+	{
+		start[i] = (size_t)[startCoordinates[i] unsignedLongLongValue];
+		count[i] = (size_t)[edgeLengths[i] unsignedLongLongValue];
+		unitCount *= count[i];
+	}
+	theData = [NSMutableData dataWithLength:unitCount*NCDFSizeOfType(type)];
+	if(![self readIntoBuffer:[theData mutableBytes] capacity:[theData length] start:start count:count stride:NULL imap:NULL type:type ndims:ndims status:NULL])
+		theData = nil;
+	free(start);
+	free(count);
+	return theData;
+}
+
+-(int)numericValuesOfAttributeNamed:(NSString *)theName values:(double *)values maxCount:(int)maxCount
+{
+	NSArray *theValues;
+	const signed char *bytes;
+	NSUInteger i,j;
+	int count;
+	theValues = [[self variableAttributeByName:theName] getAttributeValueArray];
+	count = 0;
+	for(i=0;i<[theValues count] && count<maxCount;i++)
+	{
+		if([theValues[i] isKindOfClass:[NSData class]])
+		{
+			bytes = (const signed char *)[theValues[i] bytes];
+			for(j=0;j<[theValues[i] length] && count<maxCount;j++)
+				values[count++] = (double)bytes[j];
+		}
+		else if([theValues[i] respondsToSelector:@selector(doubleValue)])
+			values[count++] = [theValues[i] doubleValue];
+	}
+	return count;
+}
+
+-(NCDFPackingParameters)packingParameters
+{
+	NCDFPackingParameters packing;
+	double values[2];
+	packing = NCDFPackingParametersMake();
+	if([self numericValuesOfAttributeNamed:@"scale_factor" values:values maxCount:1]>0)
+		packing.scaleFactor = values[0];
+	if([self numericValuesOfAttributeNamed:@"add_offset" values:values maxCount:1]>0)
+		packing.addOffset = values[0];
+	if([self numericValuesOfAttributeNamed:@"_FillValue" values:values maxCount:1]>0)
+	{
+		packing.hasFillValue = YES;
+		packing.fillValue = values[0];
+	}
+	packing.missingValueCount = [self numericValuesOfAttributeNamed:@"missing_value" values:packing.missingValues maxCount:NCDFPackingMaxMissingValues];
+	//valid_range takes precedence over valid_min and valid_max, as in the CF conventions.
+	if([self numericValuesOfAttributeNamed:@"valid_range" values:values maxCount:2]==2)
+	{
+		packing.hasValidMin = YES;
+		packing.validMin = values[0];
+		packing.hasValidMax = YES;
+		packing.validMax = values[1];
+	}
+	else
+	{
+		if([self numericValuesOfAttributeNamed:@"valid_min" values:values maxCount:1]>0)
+		{
+			packing.hasValidMin = YES;
+			packing.validMin = values[0];
+		}
+		if([self numericValuesOfAttributeNamed:@"valid_max" values:values maxCount:1]>0)
+		{
+			packing.hasValidMax = YES;
+			packing.validMax = values[0];
+		}
+	}
+	return packing;
+}
+
+-(NSData *)getUnpackedValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths asType:(nc_type)type validity:(NSData **)validity
+{
+	NCDFPackingParameters packing;
+	NSData *packedData;
+	NSMutableData *theData,*theMask;
+	size_t count;
+	if((type!=NC_FLOAT && type!=NC_DOUBLE) || dataType==NC_CHAR)
+		return nil;
+	packedData = [self getValueArrayAtLocation:startCoordinates edgeLengths:edgeLengths];
+	if(!packedData)
+		return nil;
+	packing = [self packingParameters];
+	count = [packedData length]/NCDFSizeOfType(dataType);
+	theData = [NSMutableData dataWithLength:count*NCDFSizeOfType(type)];
+	theMask = validity ? [NSMutableData dataWithLength:NCDFValidityMaskLength(count)] : nil;
+	if(!NCDFUnpackValues([packedData bytes],dataType,count,&packing,[theData mutableBytes],type,(uint8_t *)[theMask mutableBytes]))
+		return nil;
+	if(validity)
+		*validity = theMask;
+	return theData;
+}
+
+-(NCDFSlab *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride
+{
+	NSData *theTempData = [self getValueArrayAtLocation:startCoordinates edgeLengths:edgeLengths stride:stride];
+	if(!theTempData)
+		return nil;
+	return [[NCDFSlab alloc] initSlabWithData:theTempData withType:[self variableNC_TYPE] withLengths:edgeLengths];
+}
+
+-(NCDFSlab *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths stride:(NSArray *)stride dimensionOrder:(NSArray *)order
+{
+	NSArray *imap,*lengths;
+	NSData *theTempData;
+	if(![NCDFSlab transposedImap:&imap lengths:&lengths forEdgeLengths:edgeLengths dimensionOrder:order])
+		return nil;
+	theTempData = [self getValueArrayAtLocation:startCoordinates edgeLengths:edgeLengths stride:stride imap:imap];
+	if(!theTempData)
+		return nil;
+	return [[NCDFSlab alloc] initSlabWithData:theTempData withType:[self variableNC_TYPE] withLengths:lengths];
+}
+
+-(NCDFReadToken *)getValueArrayAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths priority:(qos_class_t)priority completionQueue:(dispatch_queue_t)queue completion:(void (^)(NSData *data))completion
+{
+	NSArray *start = [startCoordinates copy];
+	NSArray *edges = [edgeLengths copy];
+	return [NCDFReadToken readWithKey:[NCDFReadToken keyForReader:self operation:@"getValueArrayAtLocation" startCoordinates:start edgeLengths:edges] priority:priority readBlock:^id{
+		return [self asyncReadResultAtLocation:start edgeLengths:edges slab:NO];
+	} completionQueue:queue completion:^(id result) {
+		NSData *theData = [self postAsyncReadResult:result];
+		if(completion)
+			completion(theData);
+	}];
+}
+
+-(NCDFReadToken *)getSlabForStartCoordinates:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths priority:(qos_class_t)priority completionQueue:(dispatch_queue_t)queue completion:(void (^)(NCDFSlab *slab))completion
+{
+	NSArray *start = [startCoordinates copy];
+	NSArray *edges = [edgeLengths copy];
+	return [NCDFReadToken readWithKey:[NCDFReadToken keyForReader:self operation:@"getSlabForStartCoordinates" startCoordinates:start edgeLengths:edges] priority:priority readBlock:^id{
+		return [self asyncReadResultAtLocation:start edgeLengths:edges slab:YES];
+	} completionQueue:queue completion:^(id result) {
+		NCDFSlab *theSlab = [self postAsyncReadResult:result];
+		if(completion)
+			completion(theSlab);
+	}];
+}
+
+-(id)asyncReadResultAtLocation:(NSArray *)startCoordinates edgeLengths:(NSArray *)edgeLengths slab:(BOOL)slab
+{
+	int32_t status;
+	NSData *theData;
+	if(slab && [theHandle usesMappedReads])
+	{
+		theData = [self mappedDataAtLocation:startCoordinates edgeLengths:edgeLengths];
+		if(theData)
+			return [[NCDFSlab alloc] initSlabWithBigEndianData:theData withType:[self variableNC_TYPE] withLengths:edgeLengths];
+	}
+	theData = [self getValueArrayAtLocation:startCoordinates edgeLengths:edgeLengths status:&status];
+	if(!theData)
+		return [[NCDFError alloc] initErrorFromSourceName:fileName theClass:@"NCDFVariable" fromMethod:slab ? @"getSlabForStartCoordinates" : @"getValueArrayAtLocation" fromSubmethod:@"Asynchronous read" withError:(status!=NC_NOERR) ? status : NC_EINVAL];
+	if(slab)
+		return [[NCDFSlab alloc] initSlabWithData:theData withType:[self variableNC_TYPE] withLengths:edgeLengths];
+	return theData;
+}
+
+-(id)postAsyncReadResult:(id)result
+{
+	//the error handle is not thread safe, so failures are posted on the caller's queue rather than on the thread that made the read.
+	if([result isKindOfClass:[NCDFError class]])
+	{
+		if(theErrorHandle == nil)
+			theErrorHandle = [theHandle theErrorHandle];
+		[theErrorHandle addError:result];
+		return nil;
+	}
+	return result;
+}
+
+-(void)setReadAheadDepth:(int)depth
+{
+    NCDFReadAhead *readAhead;
+    @synchronized(self)
+    {
+        readAhead = _readAhead;
+    }
+    if(readAhead && depth>0)
+        [readAhead setDepth:depth];
+    else
+        [self rebuildReadAheadWithDepth:depth bufferLimit:_readAheadBufferLimit ? _readAheadBufferLimit : NCDFReadAheadDefaultBufferLimit];
+}
+
+-(int)readAheadDepth
+{
+    NCDFReadAhead *readAhead;
+    @synchronized(self)
+    {
+        readAhead = _readAhead;
+    }
+    return readAhead ? [readAhead depth] : 0;
+}
+
+-(void)setReadAheadBufferLimit:(size_t)bytes
+{
+    NCDFReadAhead *readAhead;
+    @synchronized(self)
+    {
+        _readAheadBufferLimit = bytes;
+        readAhead = _readAhead;
+    }
+    [readAhead setBufferLimit:bytes];
+}
+
+-(NSDictionary *)readAheadStatistics
+{
+    NCDFReadAhead *readAhead;
+    @synchronized(self)
+    {
+        readAhead = _readAhead;
+    }
+    return [readAhead statistics];
+}
+
 -(void)dealloc
 {
+    _readAhead=nil;
+    _fileSignature=nil;
     fileName=nil;
     variableName=nil;
     dimIDs=nil;
     attributes=nil;
+    _attributesByName=nil;
     theHandle=nil;
     theErrorHandle = nil;
 }
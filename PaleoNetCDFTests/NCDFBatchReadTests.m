@@ -0,0 +1,120 @@
+//
+//  NCDFBatchReadTests.m
+//  PaleoNetCDFTests
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <PaleoNetCDF/NCDFHandle.h>
+#import <PaleoNetCDF/NCDFVariable.h>
+#import <PaleoNetCDF/NCDFSlab.h>
+#import <PaleoNetCDF/NCDFErrorHandle.h>
+#import <PaleoNetCDF/NCDFError.h>
+
+#define NCDFBatchReadTestsRows 5
+#define NCDFBatchReadTestsColumns 4
+
+@interface NCDFBatchReadTests : XCTestCase {
+    NSString *_path;
+    NCDFHandle *_handle;
+}
+
+@end
+
+@implementation NCDFBatchReadTests
+
+/*A double grid(row,column), a short level(row) and an int counts(column) with distinct values.*/
+- (void)setUp {
+    NSMutableData *grid = [NSMutableData dataWithLength:NCDFBatchReadTestsRows*NCDFBatchReadTestsColumns*sizeof(double)];
+    NSMutableData *level = [NSMutableData dataWithLength:NCDFBatchReadTestsRows*sizeof(int16_t)];
+    NSMutableData *counts = [NSMutableData dataWithLength:NCDFBatchReadTestsColumns*sizeof(int32_t)];
+    int32_t i;
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"NCDFBatchReadTests-%@.nc",[[NSUUID UUID] UUIDString]]];
+    _handle = [[NCDFHandle alloc] initByCreatingFileAtPath:_path withSettings:NC_CLOBBER];
+    XCTAssertTrue([_handle createNewDimensionWithName:@"row" size:NCDFBatchReadTestsRows]);
+    XCTAssertTrue([_handle createNewDimensionWithName:@"column" size:NCDFBatchReadTestsColumns]);
+    XCTAssertTrue([_handle createNewVariableWithName:@"grid" type:NC_DOUBLE dimNameArray:@[@"row",@"column"]]);
+    XCTAssertTrue([_handle createNewVariableWithName:@"level" type:NC_SHORT dimNameArray:@[@"row"]]);
+    XCTAssertTrue([_handle createNewVariableWithName:@"counts" type:NC_INT dimNameArray:@[@"column"]]);
+    for(i=0;i<NCDFBatchReadTestsRows*NCDFBatchReadTestsColumns;i++)
+        ((double *)[grid mutableBytes])[i] = 0.5*i;
+    for(i=0;i<NCDFBatchReadTestsRows;i++)
+        ((int16_t *)[level mutableBytes])[i] = (int16_t)(100-i);
+    for(i=0;i<NCDFBatchReadTestsColumns;i++)
+        ((int32_t *)[counts mutableBytes])[i] = 7*i;
+    [[_handle retrieveVariableByName:@"grid"] writeAllVariableData:grid];
+    [[_handle retrieveVariableByName:@"level"] writeAllVariableData:level];
+    [[_handle retrieveVariableByName:@"counts"] writeAllVariableData:counts];
+}
+
+- (void)tearDown {
+    [_handle closeAll];
+    [[NSFileManager defaultManager] removeItemAtPath:_path error:nil];
+}
+
+/*Checks a batch of regions against reads of the same regions made one variable at a time.*/
+- (void)checkBatchRead {
+    NSArray *names = @[@"grid",@"level",@"counts"];
+    NSArray *starts = @[@[@1,@1],@[@2],[NSNull null]];
+    NSArray *edges = @[@[@3,@2],@[@3],[NSNull null]];
+    NSDictionary *slabs = [_handle readVariables:names atLocations:starts edgeLengths:edges];
+    XCTAssertEqual([slabs count],3);
+    XCTAssertEqualObjects([slabs[@"grid"] data],[[_handle retrieveVariableByName:@"grid"] getValueArrayAtLocation:@[@1,@1] edgeLengths:@[@3,@2]]);
+    XCTAssertEqualObjects([slabs[@"grid"] dimensionLengths],(@[@3,@2]));
+    XCTAssertEqualObjects([slabs[@"level"] data],[[_handle retrieveVariableByName:@"level"] getValueArrayAtLocation:@[@2] edgeLengths:@[@3]]);
+    XCTAssertEqualObjects([slabs[@"counts"] data],[[_handle retrieveVariableByName:@"counts"] readAllVariableData]);
+    XCTAssertEqual([[_handle theErrorHandle] errorCount],0);
+}
+
+- (void)testBatchRead {
+    [self checkBatchRead];
+}
+
+- (void)testBatchReadThroughMapping {
+    [_handle setUsesMappedReads:YES];
+    [self checkBatchRead];
+}
+
+- (void)testWholeVariablesWithoutCoordinates {
+    NSDictionary *slabs = [_handle readVariables:@[@"level",@"grid"] atLocations:nil edgeLengths:nil];
+    XCTAssertEqualObjects([slabs[@"level"] data],[[_handle retrieveVariableByName:@"level"] readAllVariableData]);
+    XCTAssertEqualObjects([slabs[@"grid"] data],[[_handle retrieveVariableByName:@"grid"] readAllVariableData]);
+}
+
+- (void)testMismatchedArgumentCountsReadNothing {
+    NCDFErrorHandle *errors = [_handle theErrorHandle];
+    NSDictionary *slabs;
+    //one coordinate array for two variables.
+    slabs = [_handle readVariables:@[@"grid",@"level"] atLocations:@[@[@0,@0]] edgeLengths:nil];
+    XCTAssertEqual([slabs count],0);
+    XCTAssertEqual([errors errorCount],1);
+    XCTAssertEqual([[errors lastError] errorNCDFCode],NC_EINVAL);
+    //and three edge arrays for two.
+    slabs = [_handle readVariables:@[@"grid",@"level"] atLocations:nil edgeLengths:@[[NSNull null],[NSNull null],[NSNull null]]];
+    XCTAssertEqual([slabs count],0);
+    XCTAssertEqual([errors errorCount],2);
+    XCTAssertEqual([[errors lastError] errorNCDFCode],NC_EINVAL);
+}
+
+- (void)testBadEntriesAreReportedAndSkipped {
+    NCDFErrorHandle *errors = [_handle theErrorHandle];
+    NSDictionary *slabs;
+    //a missing variable, a repeated name, coordinates of the wrong length and an entry that is not an array.
+    slabs = [_handle readVariables:@[@"missing",@"level",@"level",@"grid",@"counts"] atLocations:@[[NSNull null],[NSNull null],[NSNull null],@[@0],@0] edgeLengths:nil];
+    XCTAssertEqualObjects([slabs allKeys],@[@"level"]);
+    XCTAssertEqual([errors errorCount],4);
+}
+
+- (void)testBatchReadCompletion {
+    XCTestExpectation *done = [self expectationWithDescription:@"read"];
+    NSData *expected = [[_handle retrieveVariableByName:@"counts"] readAllVariableData];
+    [_handle readVariables:@[@"counts"] atLocations:nil edgeLengths:nil completion:^(NSDictionary *slabsByVariableName) {
+        XCTAssertEqualObjects([slabsByVariableName[@"counts"] data],expected);
+        [done fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+}
+
+@end
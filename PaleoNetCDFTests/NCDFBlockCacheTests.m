@@ -0,0 +1,122 @@
+//
+//  NCDFBlockCacheTests.m
+//  PaleoNetCDFTests
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <PaleoNetCDF/NCDFHandle.h>
+#import <PaleoNetCDF/NCDFVariable.h>
+#import <PaleoNetCDF/NCDFBlockCache.h>
+#import <PaleoNetCDF/NCDFFileLock.h>
+
+@interface NCDFBlockCacheTests : XCTestCase {
+    NSString *_path;
+    NCDFBlockCache *_cache;
+    size_t _byteBudget;
+}
+
+@end
+
+@implementation NCDFBlockCacheTests
+
+- (void)setUp {
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"NCDFBlockCacheTests-%@.nc",[[NSUUID UUID] UUIDString]]];
+    _cache = [NCDFBlockCache sharedCache];
+    _byteBudget = [_cache byteBudget];
+    [_cache removeAllBlocks];
+    [_cache resetStatistics];
+}
+
+- (void)tearDown {
+    [_cache setByteBudget:_byteBudget];
+    [[NSFileManager defaultManager] removeItemAtPath:_path error:nil];
+}
+
+/*An int record(time,x) of two records holding 10*record+x.*/
+- (NCDFHandle *)createRecords {
+    NCDFHandle *aHandle = [[NCDFHandle alloc] initByCreatingFileAtPath:_path withSettings:NC_CLOBBER];
+    int32_t values[2*4];
+    size_t start[2] = {0,0},count[2] = {2,4};
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"time" size:NC_UNLIMITED]);
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"x" size:4]);
+    XCTAssertTrue([aHandle createNewVariableWithName:@"record" type:NC_INT dimNameArray:@[@"time",@"x"]]);
+    for(int32_t i=0;i<8;i++)
+        values[i] = 10*(i/4)+i%4;
+    XCTAssertTrue([[aHandle retrieveVariableByName:@"record"] writeFromBuffer:values length:sizeof(values) start:start count:count ndims:2 status:NULL]);
+    return aHandle;
+}
+
+- (unsigned long long)statistic:(NSString *)key {
+    return [[_cache statistics][key] unsignedLongLongValue];
+}
+
+- (void)testCacheIsOffByDefault {
+    NCDFBlockCache *aCache = [[NCDFBlockCache alloc] init];
+    NCDFVariable *record;
+    XCTAssertEqual([aCache byteBudget],0);
+    [_cache setByteBudget:0];
+    record = [[self createRecords] retrieveVariableByName:@"record"];
+    XCTAssertNotNil([record getValueArrayAtLocation:@[@0,@1] edgeLengths:@[@1,@1]]);
+    XCTAssertEqual([self statistic:NCDFBlockCacheStatisticMisses],0);
+    XCTAssertEqual([self statistic:NCDFBlockCacheStatisticBlocks],0);
+}
+
+- (void)testWriteMovesBlocksToNewGeneration {
+    NCDFHandle *aHandle;
+    NCDFVariable *record;
+    int32_t changed = -5;
+    size_t start[2] = {1,2},count[2] = {1,1};
+    int32_t expected[4] = {10,11,-5,13};
+    [_cache setByteBudget:NCDFBlockCacheSuggestedByteBudget];
+    aHandle = [self createRecords];
+    record = [aHandle retrieveVariableByName:@"record"];
+    XCTAssertNotNil([record getValueArrayAtLocation:@[@1,@0] edgeLengths:@[@1,@4]]);
+    XCTAssertGreaterThan([self statistic:NCDFBlockCacheStatisticBlocks],0);
+    XCTAssertNotNil([record getValueArrayAtLocation:@[@1,@0] edgeLengths:@[@1,@4]]);
+    XCTAssertGreaterThan([self statistic:NCDFBlockCacheStatisticHits],0);
+    //the write drops the file's blocks, and the next read is made at the new generation.
+    XCTAssertTrue([record writeFromBuffer:&changed length:sizeof(changed) start:start count:count ndims:2 status:NULL]);
+    XCTAssertEqual([self statistic:NCDFBlockCacheStatisticBlocks],0);
+    XCTAssertEqualObjects([record getValueArrayAtLocation:@[@1,@0] edgeLengths:@[@1,@4]],[NSData dataWithBytes:expected length:sizeof(expected)]);
+}
+
+- (void)testAppendedRecordsAreRead {
+    NCDFHandle *aHandle;
+    NCDFVariable *record;
+    int32_t appended[4] = {20,21,22,23};
+    size_t start[2] = {2,0},count[2] = {1,4};
+    NSData *data;
+    [_cache setByteBudget:NCDFBlockCacheSuggestedByteBudget];
+    aHandle = [self createRecords];
+    record = [aHandle retrieveVariableByName:@"record"];
+    XCTAssertNotNil([record getValueArrayAtLocation:@[@0,@0] edgeLengths:@[@2,@4]]);
+    //the record count read for the first generation must not hide the new record.
+    XCTAssertTrue([record writeFromBuffer:appended length:sizeof(appended) start:start count:count ndims:2 status:NULL]);
+    data = [record getValueArrayAtLocation:@[@1,@0] edgeLengths:@[@2,@4]];
+    XCTAssertEqual([data length],8*sizeof(int32_t));
+    XCTAssertEqual(((const int32_t *)[data bytes])[0],10);
+    XCTAssertEqualObjects([data subdataWithRange:NSMakeRange(4*sizeof(int32_t),sizeof(appended))],[NSData dataWithBytes:appended length:sizeof(appended)]);
+}
+
+- (void)testRemoveBlocksForPathLeavesOtherFiles {
+    NCDFHandle *aHandle,*otherHandle;
+    NSString *otherPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"NCDFBlockCacheTests-%@.nc",[[NSUUID UUID] UUIDString]]];
+    unsigned long long blocks;
+    [_cache setByteBudget:NCDFBlockCacheSuggestedByteBudget];
+    aHandle = [self createRecords];
+    XCTAssertTrue([[NSFileManager defaultManager] copyItemAtPath:_path toPath:otherPath error:nil]);
+    otherHandle = [[NCDFHandle alloc] initWithFileAtPath:otherPath];
+    XCTAssertNotNil([[aHandle retrieveVariableByName:@"record"] getValueArrayAtLocation:@[@0,@0] edgeLengths:@[@1,@4]]);
+    blocks = [self statistic:NCDFBlockCacheStatisticBlocks];
+    XCTAssertNotNil([[otherHandle retrieveVariableByName:@"record"] getValueArrayAtLocation:@[@0,@0] edgeLengths:@[@1,@4]]);
+    XCTAssertGreaterThan([self statistic:NCDFBlockCacheStatisticBlocks],blocks);
+    [_cache removeBlocksForPath:[[otherHandle fileLock] path]];
+    XCTAssertEqual([self statistic:NCDFBlockCacheStatisticBlocks],blocks);
+    [otherHandle closeAll];
+    [[NSFileManager defaultManager] removeItemAtPath:otherPath error:nil];
+}
+
+@end
@@ -0,0 +1,109 @@
+//
+//  NCDFChunkEnumerationTests.m
+//  PaleoNetCDFTests
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <PaleoNetCDF/NCDFHandle.h>
+#import <PaleoNetCDF/NCDFVariable.h>
+#import <PaleoNetCDF/NCDFSlab.h>
+#import <PaleoNetCDF/NCDFErrorHandle.h>
+#import <PaleoNetCDF/NCDFBlockCache.h>
+
+#define NCDFChunkEnumerationTestsRows 6
+#define NCDFChunkEnumerationTestsColumns 7
+
+@interface NCDFChunkEnumerationTests : XCTestCase {
+    NSString *_path;
+    NCDFHandle *_handle;
+    NSData *_values;
+}
+
+@end
+
+@implementation NCDFChunkEnumerationTests
+
+- (void)setUp {
+    NSMutableData *values = [NSMutableData dataWithLength:NCDFChunkEnumerationTestsRows*NCDFChunkEnumerationTestsColumns*sizeof(double)];
+    double *doubles = (double *)[values mutableBytes];
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"NCDFChunkEnumerationTests-%@.nc",[[NSUUID UUID] UUIDString]]];
+    _handle = [[NCDFHandle alloc] initByCreatingFileAtPath:_path withSettings:NC_CLOBBER];
+    XCTAssertTrue([_handle createNewDimensionWithName:@"row" size:NCDFChunkEnumerationTestsRows]);
+    XCTAssertTrue([_handle createNewDimensionWithName:@"column" size:NCDFChunkEnumerationTestsColumns]);
+    XCTAssertTrue([_handle createNewVariableWithName:@"field" type:NC_DOUBLE dimNameArray:@[@"row",@"column"]]);
+    for(int i=0;i<NCDFChunkEnumerationTestsRows*NCDFChunkEnumerationTestsColumns;i++)
+        doubles[i] = 0.25*i;
+    _values = values;
+    [[_handle retrieveVariableByName:@"field"] writeAllVariableData:_values];
+}
+
+- (void)tearDown {
+    [_handle closeAll];
+    [[NSFileManager defaultManager] removeItemAtPath:_path error:nil];
+}
+
+/*Enumerates the field and puts every chunk back in its place, checking that each value is delivered exactly once.*/
+- (void)checkEnumerationWithMaxBytes:(size_t)maxBytes alongDimensions:(NSArray *)dimensionNames prefetch:(BOOL)prefetch {
+    NSMutableData *assembled = [NSMutableData dataWithLength:[_values length]];
+    NSMutableData *visits = [NSMutableData dataWithLength:NCDFChunkEnumerationTestsRows*NCDFChunkEnumerationTestsColumns];
+    double *output = (double *)[assembled mutableBytes];
+    uint8_t *visited = (uint8_t *)[visits mutableBytes];
+    __block int chunkCount = 0;
+    NCDFVariable *field = [_handle retrieveVariableByName:@"field"];
+    XCTAssertTrue([field enumerateChunksWithMaxBytes:maxBytes alongDimensions:dimensionNames prefetch:prefetch usingBlock:^(NCDFSlab *chunk, NSArray *origin, BOOL *stop) {
+        NSArray *lengths = [chunk dimensionLengths];
+        const double *input = (const double *)[[chunk data] bytes];
+        size_t rowStart = [origin[0] unsignedLongValue],columnStart = [origin[1] unsignedLongValue];
+        size_t rows = [lengths[0] unsignedLongValue],columns = [lengths[1] unsignedLongValue];
+        XCTAssertLessThanOrEqual(rows*columns*sizeof(double),maxBytes);
+        for(size_t r=0;r<rows;r++)
+            for(size_t c=0;c<columns;c++)
+            {
+                size_t index = (rowStart+r)*NCDFChunkEnumerationTestsColumns+columnStart+c;
+                output[index] = input[r*columns+c];
+                visited[index]++;
+            }
+        chunkCount++;
+    }]);
+    XCTAssertGreaterThan(chunkCount,1);
+    XCTAssertEqualObjects(assembled,_values);
+    for(int i=0;i<NCDFChunkEnumerationTestsRows*NCDFChunkEnumerationTestsColumns;i++)
+        XCTAssertEqual(visited[i],1,@"value %d",i);
+}
+
+- (void)testEnumerateWholeRows {
+    //two rows per chunk.
+    [self checkEnumerationWithMaxBytes:2*NCDFChunkEnumerationTestsColumns*sizeof(double) alongDimensions:@[@"row"] prefetch:NO];
+}
+
+- (void)testEnumerateTilesWithPrefetch {
+    [self checkEnumerationWithMaxBytes:5*sizeof(double) alongDimensions:nil prefetch:YES];
+}
+
+- (void)testStopEndsEnumeration {
+    __block int chunkCount = 0;
+    XCTAssertTrue([[_handle retrieveVariableByName:@"field"] enumerateChunksWithMaxBytes:NCDFChunkEnumerationTestsColumns*sizeof(double) alongDimensions:@[@"row"] prefetch:YES usingBlock:^(NCDFSlab *chunk, NSArray *origin, BOOL *stop) {
+        chunkCount++;
+        if(chunkCount==2)
+            *stop = YES;
+    }]);
+    XCTAssertEqual(chunkCount,2);
+}
+
+- (void)testEnumerationBypassesBlockCache {
+    NCDFBlockCache *cache = [NCDFBlockCache sharedCache];
+    size_t byteBudget = [cache byteBudget];
+    [cache setByteBudget:NCDFBlockCacheSuggestedByteBudget];
+    [cache removeAllBlocks];
+    [cache resetStatistics];
+    [self checkEnumerationWithMaxBytes:NCDFChunkEnumerationTestsColumns*sizeof(double) alongDimensions:nil prefetch:NO];
+    XCTAssertEqualObjects([cache statistics][NCDFBlockCacheStatisticMisses],@0);
+    XCTAssertEqualObjects([cache statistics][NCDFBlockCacheStatisticBlocks],@0);
+    [cache setByteBudget:byteBudget];
+    XCTAssertEqual([[_handle theErrorHandle] errorCount],0);
+}
+
+@end
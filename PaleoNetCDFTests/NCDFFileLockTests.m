@@ -0,0 +1,101 @@
+//
+//  NCDFFileLockTests.m
+//  PaleoNetCDFTests
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <PaleoNetCDF/NCDFFileLock.h>
+
+@interface NCDFFileLockTests : XCTestCase {
+    NSString *_path;
+}
+
+@end
+
+@implementation NCDFFileLockTests
+
+- (void)setUp {
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"NCDFFileLockTests-%@.nc",[[NSUUID UUID] UUIDString]]];
+}
+
+/*Takes the write lock on another thread and reports whether it was granted within the timeout.  The lock is released again on that thread once it has been taken.*/
+- (BOOL)writeLockGrantedOnOtherThread:(NCDFFileLock *)aLock within:(NSTimeInterval)timeout finished:(dispatch_semaphore_t)finished {
+    dispatch_semaphore_t granted = dispatch_semaphore_create(0);
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT,0),^{
+        [aLock lockForWriting];
+        dispatch_semaphore_signal(granted);
+        [aLock unlockForWriting];
+        dispatch_semaphore_signal(finished);
+    });
+    return dispatch_semaphore_wait(granted,dispatch_time(DISPATCH_TIME_NOW,(int64_t)(timeout*NSEC_PER_SEC)))==0;
+}
+
+- (void)testFileLockIsSharedPerPath {
+    NCDFFileLock *aLock = [NCDFFileLock fileLockForPath:_path];
+    NSString *otherSpelling = [[[_path stringByDeletingLastPathComponent] stringByAppendingPathComponent:@"."] stringByAppendingPathComponent:[_path lastPathComponent]];
+    XCTAssertNotNil(aLock);
+    XCTAssertTrue([NCDFFileLock fileLockForPath:_path] == aLock);
+    XCTAssertTrue([NCDFFileLock fileLockForPath:otherSpelling] == aLock);
+    XCTAssertFalse([NCDFFileLock fileLockForPath:[_path stringByAppendingString:@".other"]] == aLock);
+}
+
+- (void)testNestedLocksOnOneThread {
+    NCDFFileLock *aLock = [NCDFFileLock fileLockForPath:_path];
+    uint64_t generation = [aLock writeGeneration];
+    //nested reads.
+    [aLock lockForReading];
+    [aLock lockForReading];
+    [aLock unlockForReading];
+    [aLock unlockForReading];
+    XCTAssertEqual([aLock writeGeneration],generation);
+    //nested writes, with a read inside them.
+    [aLock lockForWriting];
+    [aLock lockForWriting];
+    [aLock lockForReading];
+    [aLock unlockForReading];
+    XCTAssertEqual([aLock unlockForWriting],generation);
+    XCTAssertEqual([aLock writeGeneration],generation);
+    XCTAssertGreaterThan([aLock unlockForWriting],generation);
+    XCTAssertGreaterThan([aLock writeGeneration],generation);
+}
+
+- (void)testWriterWaitsForReaders {
+    NCDFFileLock *aLock = [NCDFFileLock fileLockForPath:_path];
+    dispatch_semaphore_t finished = dispatch_semaphore_create(0);
+    [aLock lockForReading];
+    XCTAssertFalse([self writeLockGrantedOnOtherThread:aLock within:0.2 finished:finished]);
+    [aLock unlockForReading];
+    XCTAssertEqual(dispatch_semaphore_wait(finished,dispatch_time(DISPATCH_TIME_NOW,(int64_t)(5*NSEC_PER_SEC))),0);
+}
+
+- (void)testUpgradeFromReadToWrite {
+    NCDFFileLock *aLock = [NCDFFileLock fileLockForPath:_path];
+    dispatch_semaphore_t finished = dispatch_semaphore_create(0);
+    uint64_t generation;
+    [aLock lockForReading];
+    generation = [aLock writeGeneration];
+    [aLock lockForWriting];
+    XCTAssertGreaterThan([aLock unlockForWriting],generation);
+    //the read lock is held again after the upgrade, so other writers still wait.
+    XCTAssertFalse([self writeLockGrantedOnOtherThread:aLock within:0.2 finished:finished]);
+    [aLock unlockForReading];
+    XCTAssertEqual(dispatch_semaphore_wait(finished,dispatch_time(DISPATCH_TIME_NOW,(int64_t)(5*NSEC_PER_SEC))),0);
+}
+
+- (void)testGenerationsGrowAcrossLocksForOnePath {
+    uint64_t generation;
+    @autoreleasepool {
+        NCDFFileLock *aLock = [NCDFFileLock fileLockForPath:_path];
+        [aLock lockForWriting];
+        generation = [aLock unlockForWriting];
+    }
+    @autoreleasepool {
+        NCDFFileLock *aLock = [NCDFFileLock fileLockForPath:_path];
+        XCTAssertGreaterThan([aLock writeGeneration],generation);
+    }
+}
+
+@end
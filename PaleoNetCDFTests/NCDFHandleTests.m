@@ -0,0 +1,261 @@
+//
+//  NCDFHandleTests.m
+//  PaleoNetCDFTests
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <PaleoNetCDF/NCDFHandle.h>
+#import <PaleoNetCDF/NCDFVariable.h>
+#import <PaleoNetCDF/NCDFDimension.h>
+#import <PaleoNetCDF/NCDFErrorHandle.h>
+#import <PaleoNetCDF/NCDFMappedFile.h>
+#import <PaleoNetCDF/NCDFFileLock.h>
+
+#define NCDFHandleTestsLatLength 4
+#define NCDFHandleTestsLonLength 5
+
+@interface NCDFHandleTests : XCTestCase {
+    NSString *_path;
+}
+
+@end
+
+@implementation NCDFHandleTests
+
+- (void)setUp {
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"NCDFHandleTests-%@.nc",[[NSUUID UUID] UUIDString]]];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:_path error:nil];
+}
+
+/*Creates a file with a float grid(lat,lon), a short level(lat) and an empty record variable series(time).  The grid holds 1.5 times each value's position.*/
+- (NCDFHandle *)createTestFileWithSettings:(int)settings {
+    NCDFHandle *aHandle = [[NCDFHandle alloc] initByCreatingFileAtPath:_path withSettings:settings];
+    NSMutableData *gridData = [NSMutableData dataWithLength:NCDFHandleTestsLatLength*NCDFHandleTestsLonLength*sizeof(float)];
+    NSMutableData *levelData = [NSMutableData dataWithLength:NCDFHandleTestsLatLength*sizeof(int16_t)];
+    float *grid = (float *)[gridData mutableBytes];
+    int16_t *level = (int16_t *)[levelData mutableBytes];
+    int i;
+    XCTAssertNotNil(aHandle);
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"lat" size:NCDFHandleTestsLatLength]);
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"lon" size:NCDFHandleTestsLonLength]);
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"time" size:NC_UNLIMITED]);
+    XCTAssertTrue([aHandle createNewVariableWithName:@"grid" type:NC_FLOAT dimNameArray:@[@"lat",@"lon"]]);
+    XCTAssertTrue([aHandle createNewVariableWithName:@"level" type:NC_SHORT dimNameArray:@[@"lat"]]);
+    XCTAssertTrue([aHandle createNewVariableWithName:@"series" type:NC_FLOAT dimNameArray:@[@"time"]]);
+    for(i=0;i<NCDFHandleTestsLatLength*NCDFHandleTestsLonLength;i++)
+        grid[i] = 1.5f*i;
+    for(i=0;i<NCDFHandleTestsLatLength;i++)
+        level[i] = (int16_t)(1000-i*250);
+    [[aHandle retrieveVariableByName:@"grid"] writeAllVariableData:gridData];
+    [[aHandle retrieveVariableByName:@"level"] writeAllVariableData:levelData];
+    return aHandle;
+}
+
+- (NSData *)hostOrderData:(NSData *)fileData type:(nc_type)type {
+    NSMutableData *hostData = [fileData mutableCopy];
+    size_t valueSize = (type==NC_SHORT) ? sizeof(int16_t) : sizeof(float);
+    NCDFCopyToHostByteOrder([fileData bytes],[hostData mutableBytes],[fileData length]/valueSize,type);
+    return hostData;
+}
+
+- (void)checkMappedHeaderWithSettings:(int)settings formatVersion:(int)formatVersion {
+    NCDFHandle *aHandle = [self createTestFileWithSettings:settings];
+    NCDFVariable *grid = [aHandle retrieveVariableByName:@"grid"];
+    NCDFVariable *level = [aHandle retrieveVariableByName:@"level"];
+    NCDFVariable *series = [aHandle retrieveVariableByName:@"series"];
+    NSData *gridData = [grid readAllVariableData];
+    NCDFMappedFile *mapping = [[NCDFMappedFile alloc] initWithPath:_path];
+    NSData *mapped;
+    size_t start[2],edges[2];
+    XCTAssertNotNil(mapping);
+    XCTAssertEqual([mapping formatVersion],formatVersion);
+    XCTAssertTrue([mapping matchesFileOnDisk]);
+    XCTAssertTrue([mapping canMapVariableID:[grid variableID]]);
+    XCTAssertTrue([mapping canMapVariableID:[level variableID]]);
+    XCTAssertFalse([mapping canMapVariableID:[series variableID]]);
+    XCTAssertNil([mapping dataForVariableID:[series variableID]]);
+    //whole variables.
+    mapped = [mapping dataForVariableID:[grid variableID]];
+    XCTAssertEqualObjects([self hostOrderData:mapped type:NC_FLOAT],gridData);
+    mapped = [mapping dataForVariableID:[level variableID]];
+    XCTAssertEqual([mapped length],NCDFHandleTestsLatLength*sizeof(int16_t));
+    XCTAssertEqualObjects([self hostOrderData:mapped type:NC_SHORT],[level readAllVariableData]);
+    //one row is contiguous.
+    start[0] = 2;
+    start[1] = 0;
+    edges[0] = 1;
+    edges[1] = NCDFHandleTestsLonLength;
+    mapped = [mapping dataForVariableID:[grid variableID] start:start edges:edges];
+    XCTAssertEqualObjects([self hostOrderData:mapped type:NC_FLOAT],[grid getValueArrayAtLocation:@[@2,@0] edgeLengths:@[@1,@(NCDFHandleTestsLonLength)]]);
+    //a block of two partial rows is not, and a region past the end is out of range.
+    start[1] = 1;
+    edges[0] = 2;
+    edges[1] = 2;
+    XCTAssertNil([mapping dataForVariableID:[grid variableID] start:start edges:edges]);
+    start[0] = NCDFHandleTestsLatLength;
+    start[1] = 0;
+    edges[0] = 1;
+    edges[1] = 1;
+    XCTAssertNil([mapping dataForVariableID:[grid variableID] start:start edges:edges]);
+    //the handle's own mapping reads the same bytes.
+    mapped = [[aHandle mappedFile] dataForVariableID:[grid variableID]];
+    XCTAssertEqualObjects([self hostOrderData:mapped type:NC_FLOAT],gridData);
+}
+
+- (void)testMappedHeaderOfClassicFile {
+    [self checkMappedHeaderWithSettings:NC_CLOBBER formatVersion:1];
+}
+
+- (void)testMappedHeaderOf64BitOffsetFile {
+    [self checkMappedHeaderWithSettings:NC_CLOBBER|NC_64BIT_OFFSET formatVersion:2];
+}
+
+- (void)testMappedDataIsCopied {
+    NCDFHandle *aHandle = [self createTestFileWithSettings:NC_CLOBBER];
+    NCDFVariable *grid = [aHandle retrieveVariableByName:@"grid"];
+    NSData *gridData = [grid readAllVariableData];
+    NSData *mapped,*row;
+    float changed = -1.0f;
+    float buffer[NCDFHandleTestsLonLength];
+    size_t start[2] = {0,0},edges[2] = {1,1};
+    mapped = [[aHandle mappedFile] dataForVariableID:[grid variableID]];
+    XCTAssertNotNil(mapped);
+    //an in-place write moves the generation on and does not reach data taken from the old mapping.
+    XCTAssertTrue([grid writeFromBuffer:&changed length:sizeof(changed) start:start count:edges ndims:2 status:NULL]);
+    XCTAssertEqualObjects([self hostOrderData:mapped type:NC_FLOAT],gridData);
+    edges[1] = NCDFHandleTestsLonLength;
+    XCTAssertTrue([[aHandle mappedFile] copyVariableID:[grid variableID] start:start edges:edges toHostBuffer:buffer]);
+    row = [grid getValueArrayAtLocation:@[@0,@0] edgeLengths:@[@1,@(NCDFHandleTestsLonLength)]];
+    XCTAssertEqualObjects([NSData dataWithBytes:buffer length:sizeof(buffer)],row);
+    XCTAssertEqual(buffer[0],changed);
+}
+
+- (void)testMappingRejectsOtherFiles {
+    NSString *textPath = [_path stringByAppendingPathExtension:@"txt"];
+    XCTAssertTrue([@"not a netcdf file" writeToFile:textPath atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+    XCTAssertNil([[NCDFMappedFile alloc] initWithPath:textPath]);
+    XCTAssertNil([[NCDFMappedFile alloc] initWithPath:[_path stringByAppendingPathExtension:@"missing"]]);
+    [[NSFileManager defaultManager] removeItemAtPath:textPath error:nil];
+}
+
+- (void)testReorderRoundTrip {
+    NCDFHandle *aHandle = [self createTestFileWithSettings:NC_CLOBBER];
+    NCDFVariable *grid = [aHandle retrieveVariableByName:@"grid"];
+    NSData *original = [grid readAllVariableData];
+    const float *before = (const float *)[original bytes];
+    const float *after;
+    NSData *reordered;
+    int lat,lon;
+    //one row per chunk, so every chunk is staged before the first is written back.
+    [aHandle setRewriteMemoryCeiling:NCDFHandleTestsLonLength*sizeof(float)];
+    XCTAssertTrue([grid reverseAndStoreDataAlongDimensionName:@"lon"]);
+    reordered = [grid readAllVariableData];
+    after = (const float *)[reordered bytes];
+    for(lat=0;lat<NCDFHandleTestsLatLength;lat++)
+        for(lon=0;lon<NCDFHandleTestsLonLength;lon++)
+            XCTAssertEqual(after[lat*NCDFHandleTestsLonLength+lon],before[lat*NCDFHandleTestsLonLength+NCDFHandleTestsLonLength-1-lon]);
+    XCTAssertTrue([grid reverseAndStoreDataAlongDimensionName:@"lon"]);
+    XCTAssertEqualObjects([grid readAllVariableData],original);
+    //a shift along lat moves the value at row r to row r+1.
+    XCTAssertTrue([grid shiftAndStoreDataAlongDimensionName:@"lat" shift:1]);
+    reordered = [grid readAllVariableData];
+    after = (const float *)[reordered bytes];
+    for(lat=0;lat<NCDFHandleTestsLatLength;lat++)
+        for(lon=0;lon<NCDFHandleTestsLonLength;lon++)
+            XCTAssertEqual(after[((lat+1)%NCDFHandleTestsLatLength)*NCDFHandleTestsLonLength+lon],before[lat*NCDFHandleTestsLonLength+lon]);
+    XCTAssertTrue([grid shiftAndStoreDataAlongDimensionName:@"lat" shift:-1]);
+    XCTAssertEqualObjects([grid readAllVariableData],original);
+    XCTAssertEqual([[aHandle theErrorHandle] errorCount],0);
+}
+
+- (void)testFileRewriteRoundTrip {
+    NCDFHandle *aHandle = [self createTestFileWithSettings:NC_CLOBBER];
+    NSData *gridData = [[aHandle retrieveVariableByName:@"grid"] readAllVariableData];
+    NCDFHandle *reopened;
+    //a ceiling of one row copies the grid in several hyperslabs.
+    [aHandle setRewriteMemoryCeiling:NCDFHandleTestsLonLength*sizeof(float)];
+    XCTAssertTrue([aHandle deleteVariableWithName:@"level"]);
+    XCTAssertNil([aHandle retrieveVariableByName:@"level"]);
+    XCTAssertEqualObjects([[aHandle retrieveVariableByName:@"grid"] readAllVariableData],gridData);
+    [aHandle closeAll];
+    reopened = [[NCDFHandle alloc] initWithFileAtPath:_path];
+    XCTAssertNotNil(reopened);
+    XCTAssertNil([reopened retrieveVariableByName:@"level"]);
+    XCTAssertNotNil([reopened retrieveVariableByName:@"series"]);
+    XCTAssertEqual([[reopened retrieveDimensionByName:@"lat"] dimLength],(size_t)NCDFHandleTestsLatLength);
+    XCTAssertEqualObjects([[reopened retrieveVariableByName:@"grid"] readAllVariableData],gridData);
+    XCTAssertEqual([[aHandle theErrorHandle] errorCount],0);
+    XCTAssertEqual([[reopened theErrorHandle] errorCount],0);
+}
+
+- (void)testAppendAndExtendRecords {
+    NCDFHandle *aHandle = [self createTestFileWithSettings:NC_CLOBBER];
+    float seriesValues[2] = {1.5f,2.5f};
+    double timeValues[2] = {10.0,20.0};
+    NSData *series,*time;
+    int32_t errorCount;
+    XCTAssertTrue([aHandle createNewVariableWithName:@"time" type:NC_DOUBLE dimNameArray:@[@"time"]]);
+    XCTAssertTrue([aHandle appendRecords:2 withData:@{@"series":[NSData dataWithBytes:seriesValues length:sizeof(seriesValues)],@"time":[NSData dataWithBytes:timeValues length:sizeof(timeValues)]}]);
+    XCTAssertEqual([[aHandle retrieveUnlimitedDimension] dimLength],(size_t)2);
+    XCTAssertTrue([aHandle appendRecords:0 withData:@{}]);
+    //the new records of every record variable, the dimension variable included, hold fill values.
+    XCTAssertTrue([aHandle extendUnlimitedVariableBy:3]);
+    XCTAssertEqual([[aHandle retrieveUnlimitedDimension] dimLength],(size_t)5);
+    series = [[aHandle retrieveVariableByName:@"series"] readAllVariableData];
+    time = [[aHandle retrieveVariableByName:@"time"] readAllVariableData];
+    XCTAssertEqual([series length],5*sizeof(float));
+    XCTAssertEqual([time length],5*sizeof(double));
+    XCTAssertEqual(memcmp([series bytes],seriesValues,sizeof(seriesValues)),0);
+    XCTAssertEqual(memcmp([time bytes],timeValues,sizeof(timeValues)),0);
+    for(int r=2;r<5;r++)
+    {
+        XCTAssertEqual(((const float *)[series bytes])[r],NC_FILL_FLOAT);
+        XCTAssertEqual(((const double *)[time bytes])[r],NC_FILL_DOUBLE);
+    }
+    XCTAssertEqual([[aHandle theErrorHandle] errorCount],0);
+    //data that is not a whole number of records is refused.
+    errorCount = [[aHandle theErrorHandle] errorCount];
+    XCTAssertFalse([aHandle appendRecords:1 withData:@{@"time":[NSData dataWithBytes:timeValues length:sizeof(timeValues)]}]);
+    XCTAssertEqual([[aHandle theErrorHandle] errorCount],errorCount+1);
+}
+
+- (void)testUnlimitedVariableLength {
+    NCDFHandle *aHandle = [self createTestFileWithSettings:NC_CLOBBER];
+    double timeValues[3] = {1.0,2.0,3.0};
+    NCDFVariable *time;
+    XCTAssertTrue([aHandle createNewVariableWithName:@"time" type:NC_DOUBLE dimNameArray:@[@"time"]]);
+    time = [aHandle retrieveVariableByName:@"time"];
+    XCTAssertEqual([time unlimitedVariableLength],0);
+    XCTAssertTrue([aHandle appendRecords:3 withData:@{@"time":[NSData dataWithBytes:timeValues length:sizeof(timeValues)]}]);
+    XCTAssertEqual([time unlimitedVariableLength],3);
+    XCTAssertEqualObjects([[aHandle retrieveVariableByName:@"series"] lengthArray],@[@3]);
+    //only the dimension variable has an unlimited variable length.
+    XCTAssertEqual([[aHandle retrieveVariableByName:@"series"] unlimitedVariableLength],-1);
+    XCTAssertEqual([[aHandle theErrorHandle] errorCount],0);
+}
+
+- (void)testFileRewriteMovesGenerationOn {
+    NCDFHandle *aHandle = [self createTestFileWithSettings:NC_CLOBBER];
+    NCDFHandle *otherHandle = [[NCDFHandle alloc] initWithFileAtPath:_path];
+    NSData *gridData = [[aHandle retrieveVariableByName:@"grid"] readAllVariableData];
+    uint64_t generation;
+    //the other handle keeps an ncid of the old file in its pool.
+    XCTAssertEqualObjects([[otherHandle retrieveVariableByName:@"grid"] readAllVariableData],gridData);
+    generation = [[NCDFFileLock fileLockForPath:_path] writeGeneration];
+    XCTAssertTrue([aHandle deleteVariableWithName:@"level"]);
+    XCTAssertGreaterThan([[NCDFFileLock fileLockForPath:_path] writeGeneration],generation);
+    //so it reopens the file it reads from instead of reading the replaced one.
+    [otherHandle refresh];
+    XCTAssertNil([otherHandle retrieveVariableByName:@"level"]);
+    XCTAssertEqualObjects([[otherHandle retrieveVariableByName:@"grid"] readAllVariableData],gridData);
+    XCTAssertEqual([[aHandle theErrorHandle] errorCount],0);
+    XCTAssertEqual([[otherHandle theErrorHandle] errorCount],0);
+}
+
+@end
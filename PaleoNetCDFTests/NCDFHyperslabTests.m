@@ -0,0 +1,131 @@
+//
+//  NCDFHyperslabTests.m
+//  PaleoNetCDFTests
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <PaleoNetCDF/NCDFHyperslab.h>
+
+@interface NCDFHyperslabTests : XCTestCase
+
+@end
+
+@implementation NCDFHyperslabTests
+
+- (void)testReverseUnits {
+    //two blocks of five units of two ints each.
+    int32_t buffer[20],expected[20];
+    size_t block,unit;
+    for(int32_t i=0;i<20;i++)
+        buffer[i] = i;
+    for(block=0;block<2;block++)
+        for(unit=0;unit<5;unit++)
+        {
+            expected[block*10+unit*2] = (int32_t)(block*10+(4-unit)*2);
+            expected[block*10+unit*2+1] = (int32_t)(block*10+(4-unit)*2+1);
+        }
+    NCDFReverseUnits(buffer,2,5,2*sizeof(int32_t),NO);
+    XCTAssertEqual(memcmp(buffer,expected,sizeof(buffer)),0);
+    NCDFReverseUnits(buffer,2,5,2*sizeof(int32_t),NO);
+    for(int32_t i=0;i<20;i++)
+        XCTAssertEqual(buffer[i],i);
+}
+
+- (void)testReverseUnitsConcurrently {
+    size_t outerCount = 64,unitCount = 1024,count = outerCount*unitCount;
+    NSMutableData *data = [NSMutableData dataWithLength:count*sizeof(float)];
+    float *values = (float *)[data mutableBytes];
+    size_t i,j;
+    XCTAssertGreaterThanOrEqual([data length],(NSUInteger)NCDFReorderConcurrentMinimumBytes);
+    for(i=0;i<count;i++)
+        values[i] = (float)i;
+    NCDFReverseUnits(values,outerCount,unitCount,sizeof(float),YES);
+    for(i=0;i<outerCount;i++)
+        for(j=0;j<unitCount;j++)
+            XCTAssertEqual(values[i*unitCount+j],(float)(i*unitCount+unitCount-1-j));
+}
+
+- (void)testRotateUnits {
+    int16_t buffer[14];
+    ptrdiff_t shifts[] = {0,1,3,-2,7,-8,15};
+    for(size_t s=0;s<sizeof(shifts)/sizeof(shifts[0]);s++)
+    {
+        ptrdiff_t shift = shifts[s];
+        //two blocks of seven units of one short each.
+        for(int16_t i=0;i<14;i++)
+            buffer[i] = i;
+        XCTAssertTrue(NCDFRotateUnits(buffer,2,7,sizeof(int16_t),shift,NO));
+        for(ptrdiff_t block=0;block<2;block++)
+            for(ptrdiff_t p=0;p<7;p++)
+            {
+                //the unit at p moves to p+shift.
+                ptrdiff_t q = ((p+shift)%7+7)%7;
+                XCTAssertEqual((ptrdiff_t)buffer[block*7+q],block*7+p,@"shift %ld",(long)shift);
+            }
+    }
+}
+
+- (void)testRotateUnitsThenBack {
+    size_t outerCount = 32,unitCount = 999,unitBytes = 3*sizeof(double);
+    NSMutableData *data = [NSMutableData dataWithLength:outerCount*unitCount*unitBytes];
+    NSData *original;
+    double *values = (double *)[data mutableBytes];
+    for(size_t i=0;i<[data length]/sizeof(double);i++)
+        values[i] = (double)i;
+    original = [data copy];
+    XCTAssertTrue(NCDFRotateUnits(values,outerCount,unitCount,unitBytes,400,YES));
+    XCTAssertNotEqualObjects(data,original);
+    XCTAssertTrue(NCDFRotateUnits(values,outerCount,unitCount,unitBytes,-400,YES));
+    XCTAssertEqualObjects(data,original);
+}
+
+- (void)testPlanChunkFitsCeiling {
+    size_t shape[3] = {10,20,30};
+    size_t tile[3];
+    size_t elements;
+    elements = NCDFPlanChunk(3,shape,NULL,sizeof(float),1000*sizeof(float),tile);
+    XCTAssertGreaterThan(elements,(size_t)0);
+    XCTAssertEqual(elements,tile[0]*tile[1]*tile[2]);
+    XCTAssertLessThanOrEqual(elements*sizeof(float),1000*sizeof(float));
+    for(int i=0;i<3;i++)
+    {
+        XCTAssertGreaterThanOrEqual(tile[i],(size_t)1);
+        XCTAssertLessThanOrEqual(tile[i],shape[i]);
+    }
+    //the fastest varying dimension is filled first.
+    XCTAssertEqual(tile[2],shape[2]);
+}
+
+- (void)testPlanChunkKeepsUnsplitDimensionsWhole {
+    size_t shape[3] = {40,50,60};
+    BOOL split[3] = {YES,NO,YES};
+    size_t tile[3];
+    size_t elements;
+    elements = NCDFPlanChunk(3,shape,split,sizeof(double),30*50*sizeof(double),tile);
+    XCTAssertEqual(elements,tile[0]*tile[1]*tile[2]);
+    XCTAssertLessThanOrEqual(elements*sizeof(double),30*50*sizeof(double));
+    XCTAssertEqual(tile[0],(size_t)1);
+    XCTAssertEqual(tile[1],shape[1]);
+    XCTAssertEqual(tile[2],(size_t)30);
+    //the ceiling is smaller than the whole unsplit dimension, so the split ones are cut to a single element.
+    elements = NCDFPlanChunk(3,shape,split,sizeof(double),256,tile);
+    XCTAssertEqual(elements,shape[1]);
+    XCTAssertEqual(tile[0],(size_t)1);
+    XCTAssertEqual(tile[1],shape[1]);
+    XCTAssertEqual(tile[2],(size_t)1);
+}
+
+- (void)testPlanChunkWholeRegion {
+    size_t shape[2] = {7,9};
+    size_t tile[2];
+    XCTAssertEqual(NCDFPlanChunk(2,shape,NULL,sizeof(short),1<<20,tile),(size_t)63);
+    XCTAssertEqual(tile[0],(size_t)7);
+    XCTAssertEqual(tile[1],(size_t)9);
+    shape[0] = 0;
+    XCTAssertEqual(NCDFPlanChunk(2,shape,NULL,sizeof(short),1<<20,tile),(size_t)0);
+}
+
+@end
@@ -0,0 +1,117 @@
+//
+//  NCDFInMemoryHandleTests.m
+//  PaleoNetCDFTests
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <PaleoNetCDF/NCDFHandle.h>
+#import <PaleoNetCDF/NCDFVariable.h>
+#import <PaleoNetCDF/NCDFErrorHandle.h>
+
+/*The framework is only built with NCDF4 against a netCDF-4 library.  Each test checks whichever behaviour the handle reports: a working in-memory dataset, or nil with nothing left on disk.*/
+@interface NCDFInMemoryHandleTests : XCTestCase {
+    NSString *_path;
+    NSArray *_temporaryFiles;
+}
+
+@end
+
+@implementation NCDFInMemoryHandleTests
+
+- (void)setUp {
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"NCDFInMemoryHandleTests-%@.nc",[[NSUUID UUID] UUIDString]]];
+    _temporaryFiles = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:NSTemporaryDirectory() error:nil];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:_path error:nil];
+}
+
+- (NSData *)valuesData {
+    NSMutableData *values = [NSMutableData dataWithLength:6*sizeof(int32_t)];
+    int32_t *ints = (int32_t *)[values mutableBytes];
+    for(int32_t i=0;i<6;i++)
+        ints[i] = 10*i;
+    return values;
+}
+
+- (void)createTestFile {
+    NCDFHandle *aHandle = [[NCDFHandle alloc] initByCreatingFileAtPath:_path withSettings:NC_CLOBBER];
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"x" size:6]);
+    XCTAssertTrue([aHandle createNewVariableWithName:@"values" type:NC_INT dimNameArray:@[@"x"]]);
+    [[aHandle retrieveVariableByName:@"values"] writeAllVariableData:[self valuesData]];
+    [aHandle closeAll];
+}
+
+/*A failed in-memory initializer must not fall back to files of its own.*/
+- (void)assertNoNewTemporaryFiles {
+    NSArray *files = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:NSTemporaryDirectory() error:nil];
+    for(NSString *file in files)
+        XCTAssertTrue([_temporaryFiles containsObject:file] || [file isEqualToString:[_path lastPathComponent]],@"%@",file);
+}
+
+- (void)testHandleWithData {
+    NCDFHandle *aHandle;
+    NSData *fileData;
+    [self createTestFile];
+    fileData = [NSData dataWithContentsOfFile:_path];
+    XCTAssertNotNil(fileData);
+    aHandle = [[NCDFHandle alloc] initWithData:fileData];
+    if(!aHandle)
+    {
+        [self assertNoNewTemporaryFiles];
+        return;
+    }
+    XCTAssertTrue([aHandle isInMemory]);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:[aHandle theFilePath]]);
+    XCTAssertEqualObjects([[aHandle retrieveVariableByName:@"values"] readAllVariableData],[self valuesData]);
+    //the dataset is read-only.
+    XCTAssertFalse([aHandle createNewDimensionWithName:@"y" size:2]);
+    XCTAssertTrue([aHandle closeInMemoryDataset]);
+}
+
+- (void)testDisklessHandleLeavesFileUntilPersisted {
+    NCDFHandle *aHandle;
+    NSData *original;
+    [self createTestFile];
+    original = [NSData dataWithContentsOfFile:_path];
+    aHandle = [[NCDFHandle alloc] initDisklessWithFileAtPath:_path persist:NO];
+    if(!aHandle)
+    {
+        [self assertNoNewTemporaryFiles];
+        XCTAssertEqualObjects([NSData dataWithContentsOfFile:_path],original);
+        return;
+    }
+    XCTAssertTrue([aHandle isInMemory]);
+    XCTAssertEqualObjects([aHandle theFilePath],_path);
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"y" size:2]);
+    XCTAssertNotNil([aHandle retrieveDimensionByName:@"y"]);
+    XCTAssertTrue([aHandle closeInMemoryDataset]);
+    XCTAssertEqualObjects([NSData dataWithContentsOfFile:_path],original);
+    XCTAssertEqual([[aHandle theErrorHandle] errorCount],0);
+}
+
+- (void)testDisklessCreatePersists {
+    NCDFHandle *aHandle = [[NCDFHandle alloc] initDisklessByCreatingFileAtPath:_path withSettings:NC_CLOBBER persist:YES];
+    NCDFHandle *reopened;
+    if(!aHandle)
+    {
+        [self assertNoNewTemporaryFiles];
+        XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:_path]);
+        return;
+    }
+    XCTAssertTrue([aHandle isInMemory]);
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"x" size:6]);
+    XCTAssertTrue([aHandle createNewVariableWithName:@"values" type:NC_INT dimNameArray:@[@"x"]]);
+    [[aHandle retrieveVariableByName:@"values"] writeAllVariableData:[self valuesData]];
+    XCTAssertTrue([aHandle closeInMemoryDataset]);
+    reopened = [[NCDFHandle alloc] initWithFileAtPath:_path];
+    XCTAssertNotNil(reopened);
+    XCTAssertEqualObjects([[reopened retrieveVariableByName:@"values"] readAllVariableData],[self valuesData]);
+    XCTAssertEqual([[aHandle theErrorHandle] errorCount],0);
+}
+
+@end
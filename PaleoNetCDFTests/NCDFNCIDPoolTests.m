@@ -0,0 +1,110 @@
+//
+//  NCDFNCIDPoolTests.m
+//  PaleoNetCDFTests
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <PaleoNetCDF/NCDFHandle.h>
+#import <PaleoNetCDF/NCDFVariable.h>
+#import <PaleoNetCDF/NCDFErrorHandle.h>
+
+@interface NCDFNCIDPoolTests : XCTestCase {
+    NSString *_path;
+    NCDFHandle *_handle;
+}
+
+@end
+
+@implementation NCDFNCIDPoolTests
+
+- (void)setUp {
+    NCDFHandle *aHandle;
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"NCDFNCIDPoolTests-%@.nc",[[NSUUID UUID] UUIDString]]];
+    aHandle = [[NCDFHandle alloc] initByCreatingFileAtPath:_path withSettings:NC_CLOBBER];
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"x" size:3]);
+    XCTAssertTrue([aHandle createNewVariableWithName:@"values" type:NC_INT dimNameArray:@[@"x"]]);
+    XCTAssertTrue([aHandle createNewVariableWithName:@"other" type:NC_DOUBLE dimNameArray:@[@"x"]]);
+    [aHandle closeAll];
+    _handle = [[NCDFHandle alloc] initWithFileAtPath:_path];
+    XCTAssertNotNil(_handle);
+}
+
+- (void)tearDown {
+    [_handle closeAll];
+    [[NSFileManager defaultManager] removeItemAtPath:_path error:nil];
+}
+
+/*An ncid is open as long as the library still answers for it.*/
+- (BOOL)isOpen:(int)ncid {
+    int nvars;
+    return (nc_inq_nvars(ncid,&nvars)==NC_NOERR && nvars==2);
+}
+
+- (int)checkOutReadOnlyNCID {
+    int32_t status;
+    int ncid = [_handle ncidWithOpenMode:NC_NOWRITE status:&status];
+    XCTAssertEqual(status,NC_NOERR);
+    return ncid;
+}
+
+- (void)testReleasedNCIDIsReused {
+    int first,second;
+    first = [self checkOutReadOnlyNCID];
+    [_handle closeNCID:first];
+    XCTAssertTrue([self isOpen:first]);
+    second = [self checkOutReadOnlyNCID];
+    XCTAssertEqual(second,first);
+    [_handle closeNCID:second];
+}
+
+- (void)testCheckedOutNCIDsAreNotShared {
+    int first,second;
+    //readers share the file lock, but each of them gets an ncid of its own.
+    first = [self checkOutReadOnlyNCID];
+    second = [self checkOutReadOnlyNCID];
+    XCTAssertNotEqual(first,second);
+    XCTAssertTrue([self isOpen:first]);
+    XCTAssertTrue([self isOpen:second]);
+    [_handle closeNCID:second];
+    [_handle closeNCID:first];
+}
+
+- (void)testCloseAllWaitsForCheckedOutNCIDs {
+    int idle,inUse;
+    idle = [self checkOutReadOnlyNCID];
+    inUse = [self checkOutReadOnlyNCID];
+    [_handle closeNCID:idle];
+    [_handle closeAll];
+    XCTAssertFalse([self isOpen:idle]);
+    XCTAssertTrue([self isOpen:inUse]);
+    [_handle closeNCID:inUse];
+    XCTAssertFalse([self isOpen:inUse]);
+}
+
+- (void)testZeroTimeoutDisablesPooling {
+    int ncid;
+    [_handle setNCIDIdleTimeout:0];
+    XCTAssertEqual([_handle ncidIdleTimeout],0);
+    ncid = [self checkOutReadOnlyNCID];
+    [_handle closeNCID:ncid];
+    XCTAssertFalse([self isOpen:ncid]);
+    //reads still work, opening the file each time.
+    XCTAssertEqual([[[_handle retrieveVariableByName:@"values"] readAllVariableData] length],3*sizeof(int32_t));
+    XCTAssertEqual([[_handle theErrorHandle] errorCount],0);
+}
+
+- (void)testIdleNCIDIsClosedAfterTimeout {
+    NSDate *limit = [NSDate dateWithTimeIntervalSinceNow:5];
+    int ncid;
+    [_handle setNCIDIdleTimeout:0.2];
+    ncid = [self checkOutReadOnlyNCID];
+    [_handle closeNCID:ncid];
+    while([self isOpen:ncid] && [limit timeIntervalSinceNow]>0)
+        [NSThread sleepForTimeInterval:0.05];
+    XCTAssertFalse([self isOpen:ncid]);
+}
+
+@end
@@ -0,0 +1,118 @@
+//
+//  NCDFReadAheadTests.m
+//  PaleoNetCDFTests
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <PaleoNetCDF/NCDFHandle.h>
+#import <PaleoNetCDF/NCDFVariable.h>
+#import <PaleoNetCDF/NCDFReadAhead.h>
+#import <PaleoNetCDF/NCDFSeriesHandle.h>
+#import <PaleoNetCDF/NCDFSeriesVariable.h>
+
+#define NCDFReadAheadTestsRecordsPerFile 4
+#define NCDFReadAheadTestsRecordBytes (2*sizeof(int32_t))
+
+@interface NCDFReadAheadTests : XCTestCase {
+    NSMutableArray *_paths;
+}
+
+@end
+
+@implementation NCDFReadAheadTests
+
+- (void)setUp {
+    _paths = [NSMutableArray array];
+}
+
+- (void)tearDown {
+    for(NSString *path in _paths)
+        [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
+/*A file holding records firstRecord onwards of an int record(time,x) that stores 100*record+x.*/
+- (NSString *)createFileFromRecord:(int32_t)firstRecord {
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"NCDFReadAheadTests-%@.nc",[[NSUUID UUID] UUIDString]]];
+    NCDFHandle *aHandle = [[NCDFHandle alloc] initByCreatingFileAtPath:path withSettings:NC_CLOBBER];
+    int32_t values[NCDFReadAheadTestsRecordsPerFile*2];
+    size_t start[2] = {0,0},count[2] = {NCDFReadAheadTestsRecordsPerFile,2};
+    [_paths addObject:path];
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"time" size:NC_UNLIMITED]);
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"x" size:2]);
+    XCTAssertTrue([aHandle createNewVariableWithName:@"record" type:NC_INT dimNameArray:@[@"time",@"x"]]);
+    for(int32_t r=0;r<NCDFReadAheadTestsRecordsPerFile;r++)
+    {
+        values[2*r] = 100*(firstRecord+r);
+        values[2*r+1] = 100*(firstRecord+r)+1;
+    }
+    XCTAssertTrue([[aHandle retrieveVariableByName:@"record"] writeFromBuffer:values length:sizeof(values) start:start count:count ndims:2 status:NULL]);
+    [aHandle closeAll];
+    return path;
+}
+
+/*Prefetching runs on a background queue; waits until the variable holds at least bytes of it.*/
+- (void)waitForBufferedBytes:(unsigned long long)bytes ofVariable:(NCDFVariable *)aVariable {
+    NSDate *limit = [NSDate dateWithTimeIntervalSinceNow:5];
+    while([[aVariable readAheadStatistics][NCDFReadAheadStatisticBufferedBytes] unsignedLongLongValue]<bytes && [limit timeIntervalSinceNow]>0)
+        [NSThread sleepForTimeInterval:0.01];
+}
+
+- (void)checkRecord:(NSData *)data value:(int32_t)record {
+    int32_t expected[2] = {100*record,100*record+1};
+    XCTAssertEqualObjects(data,[NSData dataWithBytes:expected length:sizeof(expected)],@"record %d",record);
+}
+
+- (void)testSteppedReadsAreServedFromBuffer {
+    NCDFHandle *aHandle = [[NCDFHandle alloc] initWithFileAtPath:[self createFileFromRecord:0]];
+    NCDFVariable *record = [aHandle retrieveVariableByName:@"record"];
+    int32_t changed[2] = {-1,-2};
+    size_t start[2] = {3,0},count[2] = {1,2};
+    XCTAssertNil([record readAheadStatistics]);
+    [record setReadAheadDepth:2];
+    XCTAssertEqual([record readAheadDepth],2);
+    for(int32_t r=0;r<NCDFReadAheadTestsRecordsPerFile-1;r++)
+    {
+        [self checkRecord:[record getValueArrayAtLocation:@[@(r),@0] edgeLengths:@[@1,@2]] value:r];
+        if(r>0)
+            [self waitForBufferedBytes:NCDFReadAheadTestsRecordBytes ofVariable:record];
+    }
+    XCTAssertGreaterThan([[record readAheadStatistics][NCDFReadAheadStatisticHits] unsignedLongLongValue],0);
+    //a write moves the file's generation on, so the buffered copy of record 3 is not used.
+    XCTAssertTrue([record writeFromBuffer:changed length:sizeof(changed) start:start count:count ndims:2 status:NULL]);
+    XCTAssertEqualObjects([record getValueArrayAtLocation:@[@3,@0] edgeLengths:@[@1,@2]],[NSData dataWithBytes:changed length:sizeof(changed)]);
+    [record setReadAheadDepth:0];
+    XCTAssertNil([record readAheadStatistics]);
+}
+
+- (void)testSeriesSplitsBufferLimitBetweenFiles {
+    NSMutableArray *paths = [NSMutableArray array];
+    NCDFSeriesHandle *series;
+    NCDFSeriesVariable *record;
+    NCDFVariable *fileRecord;
+    unsigned long long limit = 3*2*NCDFReadAheadTestsRecordBytes;
+    int32_t r,recordInFile;
+    for(r=0;r<3;r++)
+        [paths addObject:[self createFileFromRecord:r*NCDFReadAheadTestsRecordsPerFile]];
+    series = [[NCDFSeriesHandle alloc] initWithOrderedPathSeries:paths];
+    record = [series retrieveVariableByName:@"record"];
+    //room for two records in each of the three files, although the depth asks for three.
+    [record setReadAheadBufferLimit:limit];
+    [record setReadAheadDepth:3];
+    XCTAssertEqual([record readAheadDepth],3);
+    for(r=0;r<3*NCDFReadAheadTestsRecordsPerFile;r++)
+    {
+        recordInFile = r%NCDFReadAheadTestsRecordsPerFile;
+        fileRecord = [[series handles][r/NCDFReadAheadTestsRecordsPerFile] retrieveVariableByName:@"record"];
+        [self checkRecord:[record getValueArrayAtLocation:@[@(r),@0] edgeLengths:@[@1,@2]] value:r];
+        if(recordInFile>0 && recordInFile<NCDFReadAheadTestsRecordsPerFile-1)
+            [self waitForBufferedBytes:NCDFReadAheadTestsRecordBytes ofVariable:fileRecord];
+        XCTAssertLessThanOrEqual([[fileRecord readAheadStatistics][NCDFReadAheadStatisticBufferedBytes] unsignedLongLongValue],limit/3);
+        XCTAssertLessThanOrEqual([[record readAheadStatistics][NCDFReadAheadStatisticBufferedBytes] unsignedLongLongValue],limit);
+    }
+    XCTAssertGreaterThan([[record readAheadStatistics][NCDFReadAheadStatisticHits] unsignedLongLongValue],0);
+}
+
+@end
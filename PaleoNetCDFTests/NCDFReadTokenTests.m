@@ -0,0 +1,182 @@
+//
+//  NCDFReadTokenTests.m
+//  PaleoNetCDFTests
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <PaleoNetCDF/NCDFReadToken.h>
+#import <PaleoNetCDF/NCDFHandle.h>
+#import <PaleoNetCDF/NCDFVariable.h>
+#import <PaleoNetCDF/NCDFErrorHandle.h>
+#import <PaleoNetCDF/NCDFError.h>
+
+@interface NCDFReadTokenTests : XCTestCase {
+    NSString *_path;
+}
+
+@end
+
+@implementation NCDFReadTokenTests
+
+- (void)setUp {
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"NCDFReadTokenTests-%@.nc",[[NSUUID UUID] UUIDString]]];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:_path error:nil];
+}
+
+- (NSString *)uniqueKey {
+    return [[NSUUID UUID] UUIDString];
+}
+
+- (void)testCoalescedReadIsMadeOnce {
+    __block int32_t readCount = 0;
+    dispatch_semaphore_t release = dispatch_semaphore_create(0);
+    XCTestExpectation *first = [self expectationWithDescription:@"first"];
+    XCTestExpectation *second = [self expectationWithDescription:@"second"];
+    NSString *key = [self uniqueKey];
+    id (^readBlock)(void) = ^id{
+        @synchronized(self) {
+            readCount++;
+        }
+        dispatch_semaphore_wait(release,DISPATCH_TIME_FOREVER);
+        return @"result";
+    };
+    [NCDFReadToken readWithKey:key priority:QOS_CLASS_UTILITY readBlock:readBlock completionQueue:nil completion:^(id result) {
+        XCTAssertEqualObjects(result,@"result");
+        [first fulfill];
+    }];
+    [NCDFReadToken readWithKey:key priority:QOS_CLASS_USER_INITIATED readBlock:readBlock completionQueue:nil completion:^(id result) {
+        XCTAssertEqualObjects(result,@"result");
+        [second fulfill];
+    }];
+    dispatch_semaphore_signal(release);
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+    XCTAssertEqual(readCount,1);
+}
+
+- (void)testCancelBeforeStartDropsRead {
+    dispatch_semaphore_t release = dispatch_semaphore_create(0);
+    dispatch_semaphore_t started = dispatch_semaphore_create(0);
+    NSMutableArray *blockers = [NSMutableArray array];
+    __block BOOL cancelledReadMade = NO;
+    __block BOOL cancelledCompletionCalled = NO;
+    NCDFReadToken *token;
+    XCTestExpectation *done = [self expectationWithDescription:@"blockers"];
+    __block int32_t remaining = NCDFReadTokenMaxConcurrentReads;
+    int32_t i;
+    //occupy every worker, so the next request has to wait in the pending list.
+    for(i=0;i<NCDFReadTokenMaxConcurrentReads;i++)
+    {
+        [blockers addObject:[NCDFReadToken readWithKey:[self uniqueKey] priority:QOS_CLASS_USER_INITIATED readBlock:^id{
+            dispatch_semaphore_signal(started);
+            dispatch_semaphore_wait(release,DISPATCH_TIME_FOREVER);
+            return @"blocker";
+        } completionQueue:nil completion:^(id result) {
+            if(--remaining==0)
+                [done fulfill];
+        }]];
+    }
+    for(i=0;i<NCDFReadTokenMaxConcurrentReads;i++)
+        XCTAssertEqual(dispatch_semaphore_wait(started,dispatch_time(DISPATCH_TIME_NOW,5*NSEC_PER_SEC)),0);
+    token = [NCDFReadToken readWithKey:[self uniqueKey] priority:QOS_CLASS_USER_INTERACTIVE readBlock:^id{
+        cancelledReadMade = YES;
+        return @"cancelled";
+    } completionQueue:nil completion:^(id result) {
+        cancelledCompletionCalled = YES;
+    }];
+    XCTAssertFalse([token isFinished]);
+    [token cancel];
+    XCTAssertTrue([token isCancelled]);
+    XCTAssertTrue([token isFinished]);
+    for(i=0;i<NCDFReadTokenMaxConcurrentReads;i++)
+        dispatch_semaphore_signal(release);
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+    XCTAssertFalse(cancelledReadMade);
+    XCTAssertFalse(cancelledCompletionCalled);
+}
+
+- (void)testPendingReadsStartMostUrgentFirst {
+    dispatch_semaphore_t release = dispatch_semaphore_create(0);
+    dispatch_semaphore_t started = dispatch_semaphore_create(0);
+    NSMutableArray *order = [NSMutableArray array];
+    NSLock *orderLock = [[NSLock alloc] init];
+    dispatch_semaphore_t recorded = dispatch_semaphore_create(0);
+    XCTestExpectation *done = [self expectationWithDescription:@"all"];
+    __block int32_t remaining = NCDFReadTokenMaxConcurrentReads+2;
+    int32_t i;
+    void (^completion)(id result) = ^(id result) {
+        if(--remaining==0)
+            [done fulfill];
+    };
+    for(i=0;i<NCDFReadTokenMaxConcurrentReads;i++)
+    {
+        [NCDFReadToken readWithKey:[self uniqueKey] priority:QOS_CLASS_USER_INITIATED readBlock:^id{
+            dispatch_semaphore_signal(started);
+            dispatch_semaphore_wait(release,DISPATCH_TIME_FOREVER);
+            return @"blocker";
+        } completionQueue:nil completion:completion];
+    }
+    for(i=0;i<NCDFReadTokenMaxConcurrentReads;i++)
+        XCTAssertEqual(dispatch_semaphore_wait(started,dispatch_time(DISPATCH_TIME_NOW,5*NSEC_PER_SEC)),0);
+    [NCDFReadToken readWithKey:[self uniqueKey] priority:QOS_CLASS_BACKGROUND readBlock:^id{
+        [orderLock lock];
+        [order addObject:@"background"];
+        [orderLock unlock];
+        dispatch_semaphore_signal(recorded);
+        return @"background";
+    } completionQueue:nil completion:completion];
+    [NCDFReadToken readWithKey:[self uniqueKey] priority:QOS_CLASS_USER_INTERACTIVE readBlock:^id{
+        [orderLock lock];
+        [order addObject:@"interactive"];
+        [orderLock unlock];
+        dispatch_semaphore_signal(recorded);
+        return @"interactive";
+    } completionQueue:nil completion:completion];
+    //one worker frees up, and takes the more urgent of the two pending reads.
+    dispatch_semaphore_signal(release);
+    XCTAssertEqual(dispatch_semaphore_wait(recorded,dispatch_time(DISPATCH_TIME_NOW,5*NSEC_PER_SEC)),0);
+    [orderLock lock];
+    XCTAssertEqualObjects(order,@[@"interactive"]);
+    [orderLock unlock];
+    for(i=1;i<NCDFReadTokenMaxConcurrentReads;i++)
+        dispatch_semaphore_signal(release);
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+    XCTAssertEqualObjects(order,(@[@"interactive",@"background"]));
+}
+
+- (void)testVariableReadsAsynchronously {
+    NCDFHandle *aHandle = [[NCDFHandle alloc] initByCreatingFileAtPath:_path withSettings:NC_CLOBBER];
+    NCDFVariable *aVariable;
+    NSMutableData *values = [NSMutableData dataWithLength:8*sizeof(int32_t)];
+    int32_t *ints = (int32_t *)[values mutableBytes];
+    dispatch_queue_t queue = dispatch_queue_create("NCDFReadTokenTests",DISPATCH_QUEUE_SERIAL);
+    XCTestExpectation *read = [self expectationWithDescription:@"read"];
+    XCTestExpectation *failed = [self expectationWithDescription:@"failed"];
+    int32_t i,errorCount;
+    for(i=0;i<8;i++)
+        ints[i] = i*i;
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"x" size:8]);
+    XCTAssertTrue([aHandle createNewVariableWithName:@"squares" type:NC_INT dimNameArray:@[@"x"]]);
+    aVariable = [aHandle retrieveVariableByName:@"squares"];
+    [aVariable writeAllVariableData:values];
+    errorCount = [[aHandle theErrorHandle] errorCount];
+    [aVariable getValueArrayAtLocation:@[@2] edgeLengths:@[@3] priority:QOS_CLASS_USER_INITIATED completionQueue:queue completion:^(NSData *data) {
+        XCTAssertEqualObjects(data,[values subdataWithRange:NSMakeRange(2*sizeof(int32_t),3*sizeof(int32_t))]);
+        [read fulfill];
+    }];
+    //a failed read delivers nil and posts its error on the completion queue.
+    [aVariable getValueArrayAtLocation:@[@6] edgeLengths:@[@5] priority:QOS_CLASS_USER_INITIATED completionQueue:queue completion:^(NSData *data) {
+        XCTAssertNil(data);
+        XCTAssertEqual([[aHandle theErrorHandle] errorCount],errorCount+1);
+        XCTAssertEqualObjects([[[aHandle theErrorHandle] lastError] errorMethod],@"getValueArrayAtLocation");
+        [failed fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+}
+
+@end
@@ -0,0 +1,165 @@
+//
+//  NCDFStridedReadTests.m
+//  PaleoNetCDFTests
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <PaleoNetCDF/NCDFHandle.h>
+#import <PaleoNetCDF/NCDFVariable.h>
+#import <PaleoNetCDF/NCDFSlab.h>
+#import <PaleoNetCDF/NCDFErrorHandle.h>
+#import <PaleoNetCDF/NCDFError.h>
+#import <PaleoNetCDF/NCDFSeriesHandle.h>
+#import <PaleoNetCDF/NCDFSeriesVariable.h>
+
+#define NCDFStridedReadTestsRows 4
+#define NCDFStridedReadTestsColumns 6
+#define NCDFStridedReadTestsRecordsPerFile 3
+
+@interface NCDFStridedReadTests : XCTestCase {
+    NSMutableArray *_paths;
+}
+
+@end
+
+@implementation NCDFStridedReadTests
+
+- (void)setUp {
+    _paths = [NSMutableArray array];
+}
+
+- (void)tearDown {
+    for(NSString *path in _paths)
+        [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
+- (NSString *)temporaryPath {
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"NCDFStridedReadTests-%@.nc",[[NSUUID UUID] UUIDString]]];
+    [_paths addObject:path];
+    return path;
+}
+
+/*An int grid(row,column) holding 100*row+column.*/
+- (NCDFHandle *)createGrid {
+    NCDFHandle *aHandle = [[NCDFHandle alloc] initByCreatingFileAtPath:[self temporaryPath] withSettings:NC_CLOBBER];
+    NSMutableData *values = [NSMutableData dataWithLength:NCDFStridedReadTestsRows*NCDFStridedReadTestsColumns*sizeof(int32_t)];
+    int32_t *ints = (int32_t *)[values mutableBytes];
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"row" size:NCDFStridedReadTestsRows]);
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"column" size:NCDFStridedReadTestsColumns]);
+    XCTAssertTrue([aHandle createNewVariableWithName:@"grid" type:NC_INT dimNameArray:@[@"row",@"column"]]);
+    for(int32_t r=0;r<NCDFStridedReadTestsRows;r++)
+        for(int32_t c=0;c<NCDFStridedReadTestsColumns;c++)
+            ints[r*NCDFStridedReadTestsColumns+c] = 100*r+c;
+    [[aHandle retrieveVariableByName:@"grid"] writeAllVariableData:values];
+    return aHandle;
+}
+
+/*A file of the series holding records firstRecord onwards of an int record(time,x) that stores 100*record+x.*/
+- (NSString *)createSeriesFileFromRecord:(int32_t)firstRecord {
+    NSString *path = [self temporaryPath];
+    NCDFHandle *aHandle = [[NCDFHandle alloc] initByCreatingFileAtPath:path withSettings:NC_CLOBBER];
+    int32_t values[NCDFStridedReadTestsRecordsPerFile*2];
+    size_t start[2] = {0,0},count[2] = {NCDFStridedReadTestsRecordsPerFile,2};
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"time" size:NC_UNLIMITED]);
+    XCTAssertTrue([aHandle createNewDimensionWithName:@"x" size:2]);
+    XCTAssertTrue([aHandle createNewVariableWithName:@"record" type:NC_INT dimNameArray:@[@"time",@"x"]]);
+    for(int32_t r=0;r<NCDFStridedReadTestsRecordsPerFile;r++)
+    {
+        values[2*r] = 100*(firstRecord+r);
+        values[2*r+1] = 100*(firstRecord+r)+1;
+    }
+    XCTAssertTrue([[aHandle retrieveVariableByName:@"record"] writeFromBuffer:values length:sizeof(values) start:start count:count ndims:2 status:NULL]);
+    [aHandle closeAll];
+    return path;
+}
+
+- (void)testStridedRead {
+    NCDFVariable *grid = [[self createGrid] retrieveVariableByName:@"grid"];
+    NSData *data = [grid getValueArrayAtLocation:@[@0,@1] edgeLengths:@[@2,@2] stride:@[@2,@3]];
+    int32_t expected[4] = {1,4,201,204};
+    XCTAssertEqualObjects(data,[NSData dataWithBytes:expected length:sizeof(expected)]);
+    //a negative stride is refused.
+    XCTAssertNil([grid getValueArrayAtLocation:@[@0,@0] edgeLengths:@[@1,@1] stride:@[@1,@-1]]);
+}
+
+- (void)testTransposedSlab {
+    NCDFVariable *grid = [[self createGrid] retrieveVariableByName:@"grid"];
+    NCDFSlab *slab = [grid getSlabForStartCoordinates:@[@1,@2] edgeLengths:@[@2,@3] stride:nil dimensionOrder:@[@1,@0]];
+    const int32_t *values = (const int32_t *)[[slab data] bytes];
+    XCTAssertEqualObjects([slab dimensionLengths],(@[@3,@2]));
+    for(int32_t c=0;c<3;c++)
+        for(int32_t r=0;r<2;r++)
+            XCTAssertEqual(values[c*2+r],100*(r+1)+c+2);
+    XCTAssertNil([grid getSlabForStartCoordinates:@[@0,@0] edgeLengths:@[@1,@1] stride:nil dimensionOrder:@[@0,@0]]);
+}
+
+- (void)testReadIntoBufferWithStrideAndImap {
+    NCDFVariable *grid = [[self createGrid] retrieveVariableByName:@"grid"];
+    size_t start[2] = {0,0},count[2] = {2,3};
+    ptrdiff_t stride[2] = {3,2},imap[2] = {1,2};
+    int32_t buffer[6];
+    int32_t status;
+    //rows 0 and 3, columns 0, 2 and 4, stored column by column.
+    XCTAssertTrue([grid readIntoBuffer:buffer capacity:sizeof(buffer) start:start count:count stride:stride imap:imap ndims:2 status:&status]);
+    XCTAssertEqual(status,NC_NOERR);
+    for(int32_t c=0;c<3;c++)
+    {
+        XCTAssertEqual(buffer[c*2],2*c);
+        XCTAssertEqual(buffer[c*2+1],300+2*c);
+    }
+    //the buffer must cover the extent of the map.
+    XCTAssertFalse([grid readIntoBuffer:buffer capacity:sizeof(buffer)-1 start:start count:count stride:stride imap:imap ndims:2 status:&status]);
+    XCTAssertEqual(status,NC_EINVAL);
+}
+
+- (void)testTypeConvertingRead {
+    NCDFHandle *aHandle = [self createGrid];
+    NCDFVariable *grid = [aHandle retrieveVariableByName:@"grid"];
+    NSData *data = [grid getValueArrayAtLocation:@[@1,@0] edgeLengths:@[@1,@3] asType:NC_DOUBLE];
+    double expected[3] = {100.0,101.0,102.0};
+    size_t start[2] = {3,0},count[2] = {1,2};
+    int8_t bytes[2];
+    int32_t status,errorCount;
+    XCTAssertEqualObjects(data,[NSData dataWithBytes:expected length:sizeof(expected)]);
+    data = [grid getValueArrayAtLocation:@[@0,@0] edgeLengths:@[@1,@3] asType:NC_SHORT];
+    XCTAssertEqual([data length],3*sizeof(int16_t));
+    XCTAssertEqual(((const int16_t *)[data bytes])[2],2);
+    //300 does not fit in a byte.
+    errorCount = [[aHandle theErrorHandle] errorCount];
+    XCTAssertFalse([grid readIntoBuffer:bytes capacity:sizeof(bytes) start:start count:count stride:NULL imap:NULL type:NC_BYTE ndims:2 status:&status]);
+    XCTAssertEqual(status,NC_ERANGE);
+    XCTAssertEqual([[aHandle theErrorHandle] errorCount],errorCount+1);
+}
+
+- (void)testSeriesStridedReadAcrossFiles {
+    NCDFSeriesHandle *series = [[NCDFSeriesHandle alloc] initWithOrderedPathSeries:@[[self createSeriesFileFromRecord:0],[self createSeriesFileFromRecord:NCDFStridedReadTestsRecordsPerFile]]];
+    NCDFSeriesVariable *record = [series retrieveVariableByName:@"record"];
+    NSData *data;
+    const int32_t *values;
+    XCTAssertNotNil(record);
+    //records 1, 3 and 5, the first from the first file and the others from the second.
+    data = [record getValueArrayAtLocation:@[@1,@0] edgeLengths:@[@3,@2] stride:@[@2,@1]];
+    XCTAssertEqual([data length],6*sizeof(int32_t));
+    values = (const int32_t *)[data bytes];
+    for(int32_t r=0;r<3;r++)
+    {
+        XCTAssertEqual(values[2*r],100*(1+2*r));
+        XCTAssertEqual(values[2*r+1],100*(1+2*r)+1);
+    }
+}
+
+- (void)testSeriesReadPastLastFileFails {
+    NCDFSeriesHandle *series = [[NCDFSeriesHandle alloc] initWithOrderedPathSeries:@[[self createSeriesFileFromRecord:0],[self createSeriesFileFromRecord:NCDFStridedReadTestsRecordsPerFile]]];
+    NCDFSeriesVariable *record = [series retrieveVariableByName:@"record"];
+    NCDFErrorHandle *errors = [[series rootHandle] theErrorHandle];
+    int32_t errorCount = [errors errorCount];
+    //records 4 to 7, of which only 4 and 5 exist.
+    XCTAssertNil([record getValueArrayAtLocation:@[@4,@0] edgeLengths:@[@4,@2] stride:nil imap:nil]);
+    XCTAssertEqual([errors errorCount],errorCount+1);
+    XCTAssertEqual([[errors lastError] errorNCDFCode],NC_EINVALCOORDS);
+}
+
+@end
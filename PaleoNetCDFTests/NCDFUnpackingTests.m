@@ -0,0 +1,101 @@
+//
+//  NCDFUnpackingTests.m
+//  PaleoNetCDFTests
+//
+//  Created by Thomas Moore on 10/17/26.
+//  Copyright © 2026 Thomas Moore. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <PaleoNetCDF/NCDFUnpacking.h>
+
+@interface NCDFUnpackingTests : XCTestCase
+
+@end
+
+@implementation NCDFUnpackingTests
+
+- (void)testUnpackShortsToDouble {
+    int16_t packed[10] = {-32767,0,10,100,200,-5,50,999,1000,7};
+    double expected[10] = {NAN,10.0,15.0,60.0,110.0,NAN,35.0,NAN,NAN,13.5};
+    double unpacked[10];
+    uint8_t validity[2];
+    NCDFPackingParameters packing = NCDFPackingParametersMake();
+    packing.scaleFactor = 0.5;
+    packing.addOffset = 10.0;
+    packing.hasFillValue = YES;
+    packing.fillValue = -32767;
+    packing.missingValueCount = 1;
+    packing.missingValues[0] = 1000;
+    packing.hasValidMin = YES;
+    packing.validMin = -1;
+    packing.hasValidMax = YES;
+    packing.validMax = 500;
+    XCTAssertEqual(NCDFValidityMaskLength(10),(size_t)2);
+    XCTAssertTrue(NCDFUnpackValues(packed,NC_SHORT,10,&packing,unpacked,NC_DOUBLE,validity));
+    for(int i=0;i<10;i++)
+    {
+        if(isnan(expected[i]))
+            XCTAssertTrue(isnan(unpacked[i]),@"value %d",i);
+        else
+            XCTAssertEqualWithAccuracy(unpacked[i],expected[i],1e-12,@"value %d",i);
+    }
+    //values 1, 2, 3, 4, 6 and 9 are valid, least significant bit first.
+    XCTAssertEqual(validity[0],(uint8_t)0x5E);
+    XCTAssertEqual(validity[1],(uint8_t)0x02);
+}
+
+- (void)testUnpackBytesToFloatAcrossBlocks {
+    size_t count = 5000,i;
+    NSMutableData *packedData = [NSMutableData dataWithLength:count];
+    NSMutableData *unpackedData = [NSMutableData dataWithLength:count*sizeof(float)];
+    NSMutableData *validityData = [NSMutableData dataWithLength:NCDFValidityMaskLength(count)];
+    int8_t *packed = (int8_t *)[packedData mutableBytes];
+    float *unpacked = (float *)[unpackedData mutableBytes];
+    uint8_t *validity = (uint8_t *)[validityData mutableBytes];
+    NCDFPackingParameters packing = NCDFPackingParametersMake();
+    packing.scaleFactor = 2.0;
+    packing.addOffset = -1.0;
+    packing.hasFillValue = YES;
+    packing.fillValue = -128;
+    for(i=0;i<count;i++)
+        packed[i] = (i%3==0) ? -128 : (int8_t)(i%100);
+    XCTAssertTrue(NCDFUnpackValues(packed,NC_BYTE,count,&packing,unpacked,NC_FLOAT,validity));
+    for(i=0;i<count;i++)
+    {
+        BOOL isValid = (validity[i>>3]>>(i&7))&1;
+        if(i%3==0)
+        {
+            XCTAssertTrue(isnan(unpacked[i]));
+            XCTAssertFalse(isValid);
+        }
+        else
+        {
+            XCTAssertEqual(unpacked[i],(float)(i%100)*2.0f-1.0f);
+            XCTAssertTrue(isValid);
+        }
+    }
+}
+
+- (void)testUnpackWithoutPacking {
+    float packed[9] = {1.5f,-2.0f,0.0f,3.25f,4.0f,5.0f,6.0f,7.0f,8.0f};
+    double unpacked[9];
+    uint8_t validity[2] = {0,0};
+    NCDFPackingParameters packing = NCDFPackingParametersMake();
+    XCTAssertTrue(NCDFUnpackValues(packed,NC_FLOAT,9,&packing,unpacked,NC_DOUBLE,validity));
+    for(int i=0;i<9;i++)
+        XCTAssertEqual(unpacked[i],(double)packed[i]);
+    XCTAssertEqual(validity[0],(uint8_t)0xFF);
+    XCTAssertEqual(validity[1]&0x01,0x01);
+}
+
+- (void)testUnpackRejectsUnsupportedTypes {
+    char text[4] = "abc";
+    float unpacked[4];
+    int16_t packed[4] = {1,2,3,4};
+    NCDFPackingParameters packing = NCDFPackingParametersMake();
+    XCTAssertFalse(NCDFUnpackValues(text,NC_CHAR,4,&packing,unpacked,NC_FLOAT,NULL));
+    XCTAssertFalse(NCDFUnpackValues(packed,NC_SHORT,4,&packing,unpacked,NC_INT,NULL));
+}
+
+@end